@@ -0,0 +1,66 @@
+#include "HttpAwaitable.h"
+
+FHttpRequestAwaiter::FHttpRequestAwaiter(FHttpRequestPtr InRequest, FHttpExecutor InResumeExecutor)
+	: Request(std::move(InRequest))
+	, State(std::make_shared<FState>())
+{
+	State->ResumeExecutor = std::move(InResumeExecutor);
+}
+
+FHttpRequestAwaiter::~FHttpRequestAwaiter()
+{
+	if (State && State->Phase.exchange(EPhase::Abandoned) == EPhase::Pending)
+	{
+		// the coroutine was destroyed while suspended, the delegate won't resume it
+		Request->CancelRequest();
+	}
+}
+
+bool FHttpRequestAwaiter::await_suspend(std::coroutine_handle<> Handle)
+{
+	// the coroutine may be resumed and this awaiter destroyed before ProcessRequest returns, only use locals from there on
+	std::shared_ptr<FState> SharedState = State;
+	SharedState->Handle = Handle;
+	SharedState->Phase = EPhase::Pending;
+	Request->OnProcessRequestComplete() = [SharedState](FHttpRequestPtr, FHttpResponsePtr Response)
+	{
+		// abandoned when the coroutine is gone
+		EPhase Expected = EPhase::Pending;
+		if (SharedState->Phase.compare_exchange_strong(Expected, EPhase::Completed))
+		{
+			SharedState->Response = std::move(Response);
+			Resume(SharedState);
+		}
+	};
+	FHttpRequestPtr LocalRequest = Request;
+	if (!LocalRequest->ProcessRequest())
+	{
+		EPhase Expected = EPhase::Pending;
+		// not started, carry on without suspending
+		return !SharedState->Phase.compare_exchange_strong(Expected, EPhase::NotSuspended);
+	}
+	return true;
+}
+
+FHttpResponsePtr FHttpRequestAwaiter::await_resume()
+{
+	return std::move(State->Response);
+}
+
+void FHttpRequestAwaiter::Resume(const std::shared_ptr<FState>& State)
+{
+	if (!State->ResumeExecutor)
+	{
+		State->Phase = EPhase::Resumed;
+		State->Handle.resume();
+		return;
+	}
+	State->ResumeExecutor([State]()
+	{
+		EPhase Expected = EPhase::Completed;
+		if (State->Phase.compare_exchange_strong(Expected, EPhase::Resumed))
+		{
+			State->Handle.resume();
+		}
+	});
+}
@@ -0,0 +1,245 @@
+#include "HttpBody.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+FHttpCallbackBodySource::FHttpCallbackBodySource(FHttpBodyReadDelegate InReadDelegate, int64_t InSize, FHttpBodyRewindDelegate InRewindDelegate)
+	: ReadDelegate(std::move(InReadDelegate))
+	, RewindDelegate(std::move(InRewindDelegate))
+	, Size(InSize)
+	, bStarted(false)
+{
+}
+
+int64_t FHttpCallbackBodySource::GetSize()
+{
+	return Size;
+}
+
+size_t FHttpCallbackBodySource::Read(std::span<uint8_t> Dest)
+{
+	if (!ReadDelegate)
+	{
+		return ReadError;
+	}
+	bStarted = true;
+	return ReadDelegate(Dest);
+}
+
+bool FHttpCallbackBodySource::Rewind()
+{
+	if (!bStarted)
+	{
+		return true;
+	}
+	if (!RewindDelegate || !RewindDelegate())
+	{
+		return false;
+	}
+	bStarted = false;
+	return true;
+}
+
+std::shared_ptr<FHttpFileBodySource> FHttpFileBodySource::Open(const std::string& Path, int64_t Offset, int64_t Length)
+{
+	int64_t FileSize = 0;
+#ifdef _WIN32
+	HANDLE Handle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (Handle == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER Size;
+	if (!GetFileSizeEx(Handle, &Size))
+	{
+		CloseHandle(Handle);
+		return nullptr;
+	}
+	FileSize = Size.QuadPart;
+	const intptr_t File = reinterpret_cast<intptr_t>(Handle);
+#else
+	const int Descriptor = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (Descriptor < 0)
+	{
+		return nullptr;
+	}
+	struct stat Stat;
+	if (fstat(Descriptor, &Stat) != 0)
+	{
+		close(Descriptor);
+		return nullptr;
+	}
+	FileSize = Stat.st_size;
+	const intptr_t File = Descriptor;
+#endif
+
+	// owns the file from here on, the destructor closes it
+	std::shared_ptr<FHttpFileBodySource> Source(new FHttpFileBodySource(File, Offset, Length));
+	if (Offset < 0 || Offset > FileSize || Length > FileSize - Offset)
+	{
+		return nullptr;
+	}
+	if (Length < 0)
+	{
+		Source->Length = FileSize - Offset;
+	}
+#if !defined(_WIN32) && defined(POSIX_FADV_SEQUENTIAL)
+	posix_fadvise(int(File), off_t(Offset), off_t(Source->Length), POSIX_FADV_SEQUENTIAL);
+#endif
+	return Source;
+}
+
+FHttpFileBodySource::FHttpFileBodySource(intptr_t InFile, int64_t InOffset, int64_t InLength)
+	: File(InFile)
+	, Offset(InOffset)
+	, Length(InLength)
+	, Position(0)
+{
+}
+
+FHttpFileBodySource::~FHttpFileBodySource()
+{
+#ifdef _WIN32
+	CloseHandle(reinterpret_cast<HANDLE>(File));
+#else
+	close(int(File));
+#endif
+}
+
+int64_t FHttpFileBodySource::GetSize()
+{
+	return Length;
+}
+
+size_t FHttpFileBodySource::Read(std::span<uint8_t> Dest)
+{
+	const size_t SizeToRead = size_t(std::min<int64_t>(int64_t(Dest.size()), Length - Position));
+	if (SizeToRead == 0)
+	{
+		return 0;
+	}
+	const int64_t FileOffset = Offset + Position;
+#ifdef _WIN32
+	OVERLAPPED Overlapped = {};
+	Overlapped.Offset = DWORD(FileOffset & 0xFFFFFFFF);
+	Overlapped.OffsetHigh = DWORD(FileOffset >> 32);
+	DWORD BytesRead = 0;
+	if (!ReadFile(reinterpret_cast<HANDLE>(File), Dest.data(), DWORD(std::min<size_t>(SizeToRead, MAXDWORD)), &BytesRead, &Overlapped) || BytesRead == 0)
+	{
+		return ReadError;
+	}
+#else
+	ssize_t BytesRead = 0;
+	do
+	{
+		BytesRead = pread(int(File), Dest.data(), SizeToRead, off_t(FileOffset));
+	} while (BytesRead < 0 && errno == EINTR);
+	if (BytesRead <= 0)
+	{
+		// the file shrunk while it was being sent
+		return ReadError;
+	}
+#endif
+	Position += int64_t(BytesRead);
+	return size_t(BytesRead);
+}
+
+bool FHttpFileBodySource::Rewind()
+{
+	Position = 0;
+	return true;
+}
+
+void FHttpRequestBody::Reset()
+{
+	Owner.reset();
+	Data = std::span<const uint8_t>();
+	Vector = nullptr;
+	ContentCopy.clear();
+	Source.reset();
+	ReadOffset = 0;
+}
+
+void FHttpRequestBody::SetBuffer(const std::vector<uint8_t>& Content)
+{
+	SetBuffer(std::make_shared<const std::vector<uint8_t>>(Content));
+}
+
+void FHttpRequestBody::SetBuffer(std::vector<uint8_t>&& Content)
+{
+	SetBuffer(std::make_shared<const std::vector<uint8_t>>(std::move(Content)));
+}
+
+void FHttpRequestBody::SetBuffer(FHttpSharedBuffer Content)
+{
+	Reset();
+	if (Content)
+	{
+		Vector = Content.get();
+		Data = std::span<const uint8_t>(Content->data(), Content->size());
+		Owner = std::move(Content);
+	}
+}
+
+void FHttpRequestBody::SetString(std::string&& Content)
+{
+	Reset();
+	std::shared_ptr<const std::string> String = std::make_shared<const std::string>(std::move(Content));
+	Data = std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(String->data()), String->size());
+	Owner = std::move(String);
+}
+
+void FHttpRequestBody::SetSource(FHttpBodySourcePtr InSource)
+{
+	Reset();
+	Source = std::move(InSource);
+}
+
+int64_t FHttpRequestBody::GetSize() const
+{
+	return Source ? Source->GetSize() : int64_t(Data.size());
+}
+
+const std::vector<uint8_t>& FHttpRequestBody::GetContent()
+{
+	if (Vector)
+	{
+		return *Vector;
+	}
+	if (ContentCopy.size() != Data.size())
+	{
+		ContentCopy.assign(Data.begin(), Data.end());
+	}
+	return ContentCopy;
+}
+
+bool FHttpRequestBody::Rewind()
+{
+	ReadOffset = 0;
+	return !Source || Source->Rewind();
+}
+
+size_t FHttpRequestBody::Read(std::span<uint8_t> Dest)
+{
+	if (Source)
+	{
+		return Source->Read(Dest);
+	}
+	const size_t SizeToRead = std::min(Data.size() - ReadOffset, Dest.size());
+	if (SizeToRead != 0)
+	{
+		std::memcpy(Dest.data(), Data.data() + ReadOffset, SizeToRead);
+		ReadOffset += SizeToRead;
+	}
+	return SizeToRead;
+}
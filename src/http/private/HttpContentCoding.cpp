@@ -0,0 +1,199 @@
+#include "HttpContentCoding.h"
+#include "HttpHeaders.h"
+#include <zlib.h>
+#include <algorithm>
+#include <limits>
+
+/** Size of the chunks decoded data is handed out in */
+static constexpr size_t DecodeChunkSize = 64 * 1024;
+
+EHttpContentEncoding::Type EHttpContentEncoding::FromString(std::string_view ContentEncoding)
+{
+	while (!ContentEncoding.empty() && (ContentEncoding.front() == ' ' || ContentEncoding.front() == '\t'))
+	{
+		ContentEncoding.remove_prefix(1);
+	}
+	while (!ContentEncoding.empty() && (ContentEncoding.back() == ' ' || ContentEncoding.back() == '\t'))
+	{
+		ContentEncoding.remove_suffix(1);
+	}
+	if (HttpHeaderNameEquals(ContentEncoding, "gzip") || HttpHeaderNameEquals(ContentEncoding, "x-gzip"))
+	{
+		return Gzip;
+	}
+	if (HttpHeaderNameEquals(ContentEncoding, "deflate"))
+	{
+		return Deflate;
+	}
+	return Identity;
+}
+
+FHttpContentDecoder::FHttpContentDecoder()
+	: Encoding(EHttpContentEncoding::Identity)
+	, bStreamEnded(false)
+	, bProducedOutput(false)
+	, bRawDeflate(false)
+{
+}
+
+FHttpContentDecoder::~FHttpContentDecoder()
+{
+	Reset();
+}
+
+bool FHttpContentDecoder::Begin(EHttpContentEncoding::Type InEncoding)
+{
+	Reset();
+	if (InEncoding == EHttpContentEncoding::Identity)
+	{
+		return true;
+	}
+	Stream = std::make_unique<z_stream>();
+	// 16 + window bits reads the gzip wrapper, plain window bits the zlib one
+	const int WindowBits = InEncoding == EHttpContentEncoding::Gzip ? 16 + MAX_WBITS : MAX_WBITS;
+	if (inflateInit2(Stream.get(), WindowBits) != Z_OK)
+	{
+		Stream.reset();
+		return false;
+	}
+	Encoding = InEncoding;
+	OutputBuffer.resize(DecodeChunkSize);
+	return true;
+}
+
+bool FHttpContentDecoder::RestartAsRawDeflate()
+{
+	inflateEnd(Stream.get());
+	*Stream = z_stream();
+	if (inflateInit2(Stream.get(), -MAX_WBITS) != Z_OK)
+	{
+		// nothing left to end
+		Stream.reset();
+		Encoding = EHttpContentEncoding::Identity;
+		return false;
+	}
+	bRawDeflate = true;
+	return true;
+}
+
+bool FHttpContentDecoder::Decode(std::span<const uint8_t> Input, const FOutputFunction& Output)
+{
+	if (!IsDecoding())
+	{
+		if (!Input.empty())
+		{
+			Output(Input);
+		}
+		return true;
+	}
+	if (Encoding == EHttpContentEncoding::Deflate && !bRawDeflate && !bProducedOutput)
+	{
+		// kept until the format is known for sure
+		ConsumedInput.insert(ConsumedInput.end(), Input.begin(), Input.end());
+	}
+
+	while (!Input.empty())
+	{
+		const uInt InputSize = uInt(std::min<size_t>(Input.size(), std::numeric_limits<uInt>::max()));
+		Stream->next_in = const_cast<Bytef*>(Input.data());
+		Stream->avail_in = InputSize;
+		do
+		{
+			if (bStreamEnded)
+			{
+				// data past the end of the body, only gzip allows several members back to back
+				if (Encoding != EHttpContentEncoding::Gzip || inflateReset(Stream.get()) != Z_OK)
+				{
+					return false;
+				}
+				bStreamEnded = false;
+			}
+			Stream->next_out = OutputBuffer.data();
+			Stream->avail_out = uInt(OutputBuffer.size());
+			const int Result = inflate(Stream.get(), Z_NO_FLUSH);
+			if (Result == Z_DATA_ERROR && Encoding == EHttpContentEncoding::Deflate && !bRawDeflate && !bProducedOutput)
+			{
+				// no zlib header, decode everything received so far again as raw deflate data
+				std::vector<uint8_t> Replay;
+				Replay.swap(ConsumedInput);
+				if (!RestartAsRawDeflate())
+				{
+					return false;
+				}
+				return Decode(Replay, Output);
+			}
+			if (Result != Z_OK && Result != Z_STREAM_END && Result != Z_BUF_ERROR)
+			{
+				return false;
+			}
+			const size_t Produced = OutputBuffer.size() - Stream->avail_out;
+			if (Produced > 0)
+			{
+				if (!bProducedOutput)
+				{
+					bProducedOutput = true;
+					std::vector<uint8_t>().swap(ConsumedInput);
+				}
+				Output(std::span<const uint8_t>(OutputBuffer.data(), Produced));
+			}
+			if (Result == Z_STREAM_END)
+			{
+				bStreamEnded = true;
+			}
+			else if (Result == Z_BUF_ERROR)
+			{
+				// needs more input
+				break;
+			}
+			// a full output buffer may leave decoded data behind even once the input is consumed
+		} while (Stream->avail_in > 0 || (Stream->avail_out == 0 && !bStreamEnded));
+		Input = Input.subspan(InputSize);
+	}
+	return true;
+}
+
+bool FHttpContentDecoder::Finish()
+{
+	if (!IsDecoding())
+	{
+		return true;
+	}
+	// Decode never leaves decoded data inside zlib, only a missing end can remain
+	return bStreamEnded;
+}
+
+void FHttpContentDecoder::Reset()
+{
+	if (Stream)
+	{
+		inflateEnd(Stream.get());
+		Stream.reset();
+	}
+	Encoding = EHttpContentEncoding::Identity;
+	bStreamEnded = false;
+	bProducedOutput = false;
+	bRawDeflate = false;
+	ConsumedInput.clear();
+}
+
+bool HttpGzipCompress(std::span<const uint8_t> Input, std::vector<uint8_t>& OutEncoded, int32_t Level)
+{
+	if (Input.size() > std::numeric_limits<uInt>::max())
+	{
+		return false;
+	}
+	z_stream Stream = {};
+	if (deflateInit2(&Stream, Level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+	{
+		return false;
+	}
+	OutEncoded.resize(deflateBound(&Stream, uLong(Input.size())));
+	Stream.next_in = const_cast<Bytef*>(Input.data());
+	Stream.avail_in = uInt(Input.size());
+	Stream.next_out = OutEncoded.data();
+	Stream.avail_out = uInt(OutEncoded.size());
+	const int Result = deflate(&Stream, Z_FINISH);
+	OutEncoded.resize(Stream.total_out);
+	deflateEnd(&Stream);
+	return Result == Z_STREAM_END;
+}
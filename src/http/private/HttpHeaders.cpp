@@ -0,0 +1,288 @@
+#include "HttpHeaders.h"
+#include <array>
+#include <cstring>
+
+namespace
+{
+	constexpr std::array<std::string_view, EHttpHeader::Count> WellKnownHeaderNames =
+	{
+		"",
+		"Accept",
+		"Accept-Encoding",
+		"Authorization",
+		"Cache-Control",
+		"Connection",
+		"Content-Encoding",
+		"Content-Length",
+		"Content-Type",
+		"ETag",
+		"Expect",
+		"Expires",
+		"Host",
+		"If-Modified-Since",
+		"If-None-Match",
+		"Last-Modified",
+		"Location",
+		"Range",
+		"Set-Cookie",
+		"Transfer-Encoding",
+		"User-Agent",
+	};
+
+	/** Lower case the ASCII letters of eight bytes at once */
+	inline uint64_t FoldCase(uint64_t Word)
+	{
+		constexpr uint64_t Ones = 0x0101010101010101ull;
+		constexpr uint64_t HighBits = 0x8080808080808080ull;
+		const uint64_t LowBits = Word & ~HighBits;
+		// the high bit of each byte ends up set when its low seven bits are >= 'A', respectively > 'Z'
+		const uint64_t AtLeastA = LowBits + Ones * (0x80 - 'A');
+		const uint64_t AboveZ = LowBits + Ones * (0x80 - 'Z' - 1);
+		const uint64_t IsUpper = AtLeastA & ~AboveZ & ~Word & HighBits;
+		return Word | (IsUpper >> 2);
+	}
+}
+
+namespace EHttpHeader
+{
+	std::string_view ToString(Type Header)
+	{
+		return Header < Count ? WellKnownHeaderNames[Header] : std::string_view();
+	}
+
+	Type FromString(std::string_view HeaderName)
+	{
+		for (uint8_t Id = 1; Id < Count; ++Id)
+		{
+			if (HttpHeaderNameEquals(HeaderName, WellKnownHeaderNames[Id]))
+			{
+				return Type(Id);
+			}
+		}
+		return Unknown;
+	}
+}
+
+bool HttpHeaderNameEquals(std::string_view A, std::string_view B)
+{
+	if (A.size() != B.size())
+	{
+		return false;
+	}
+	size_t Index = 0;
+	for (; Index + sizeof(uint64_t) <= A.size(); Index += sizeof(uint64_t))
+	{
+		uint64_t WordA;
+		uint64_t WordB;
+		std::memcpy(&WordA, A.data() + Index, sizeof(uint64_t));
+		std::memcpy(&WordB, B.data() + Index, sizeof(uint64_t));
+		if (WordA != WordB && FoldCase(WordA) != FoldCase(WordB))
+		{
+			return false;
+		}
+	}
+	if (Index < A.size())
+	{
+		uint64_t WordA = 0;
+		uint64_t WordB = 0;
+		std::memcpy(&WordA, A.data() + Index, A.size() - Index);
+		std::memcpy(&WordB, B.data() + Index, B.size() - Index);
+		return WordA == WordB || FoldCase(WordA) == FoldCase(WordB);
+	}
+	return true;
+}
+
+FHttpHeaders::FHttpHeaders()
+	: WastedBytes(0)
+{
+}
+
+void FHttpHeaders::Set(std::string_view Name, std::string_view Value)
+{
+	const EHttpHeader::Type Id = EHttpHeader::FromString(Name);
+	const int32_t Index = FindIndex(Name, Id);
+	if (Index >= 0)
+	{
+		FEntry& Entry = Entries[Index];
+		if (Value.size() <= Entry.ValueLength)
+		{
+			// fits in place
+			std::memmove(Buffer.data() + Entry.ValueOffset, Value.data(), Value.size());
+			WastedBytes += Entry.ValueLength - Value.size();
+			Entry.ValueLength = uint32_t(Value.size());
+			return;
+		}
+		WastedBytes += Entry.ValueLength;
+		StoreValue(Entry, std::string_view(), Value);
+		CompactIfNeeded();
+		return;
+	}
+	if (Name.size() > UINT16_MAX)
+	{
+		return;
+	}
+
+	FEntry Entry;
+	Entry.Id = Id;
+	Entry.NameLength = uint16_t(Name.size());
+	if (Id != EHttpHeader::Unknown && Name == EHttpHeader::ToString(Id))
+	{
+		// canonical spelling, no need to store the name
+		Entry.NameOffset = UINT32_MAX;
+	}
+	else
+	{
+		Entry.NameOffset = uint32_t(Buffer.size());
+		Buffer.append(Name);
+	}
+	StoreValue(Entry, std::string_view(), Value);
+	Entries.push_back(Entry);
+}
+
+void FHttpHeaders::Append(std::string_view Name, std::string_view Value)
+{
+	const int32_t Index = FindIndex(Name, EHttpHeader::FromString(Name));
+	if (Index < 0 || Entries[Index].ValueLength == 0)
+	{
+		Set(Name, Value);
+		return;
+	}
+	FEntry& Entry = Entries[Index];
+	WastedBytes += Entry.ValueLength;
+	StoreValue(Entry, GetValue(Entry), Value);
+	CompactIfNeeded();
+}
+
+bool FHttpHeaders::Remove(std::string_view Name)
+{
+	const int32_t Index = FindIndex(Name, EHttpHeader::FromString(Name));
+	if (Index < 0)
+	{
+		return false;
+	}
+	const FEntry& Entry = Entries[Index];
+	WastedBytes += Entry.ValueLength + (Entry.NameOffset == UINT32_MAX ? 0 : Entry.NameLength);
+	Entries.erase(Entries.begin() + Index);
+	CompactIfNeeded();
+	return true;
+}
+
+void FHttpHeaders::Empty()
+{
+	Buffer.clear();
+	Entries.clear();
+	WastedBytes = 0;
+}
+
+std::string_view FHttpHeaders::Find(std::string_view Name) const
+{
+	const int32_t Index = FindIndex(Name, EHttpHeader::FromString(Name));
+	return Index >= 0 ? GetValue(Entries[Index]) : std::string_view();
+}
+
+std::string_view FHttpHeaders::Find(EHttpHeader::Type Id) const
+{
+	const int32_t Index = FindIndex(EHttpHeader::ToString(Id), Id);
+	return Index >= 0 ? GetValue(Entries[Index]) : std::string_view();
+}
+
+bool FHttpHeaders::Contains(std::string_view Name) const
+{
+	return FindIndex(Name, EHttpHeader::FromString(Name)) >= 0;
+}
+
+bool FHttpHeaders::Contains(EHttpHeader::Type Id) const
+{
+	return FindIndex(EHttpHeader::ToString(Id), Id) >= 0;
+}
+
+FHttpHeaders::FHeader FHttpHeaders::GetHeader(size_t Index) const
+{
+	const FEntry& Entry = Entries[Index];
+	return FHeader{ GetName(Entry), GetValue(Entry), Entry.Id };
+}
+
+std::vector<std::string> FHttpHeaders::ToStrings() const
+{
+	std::vector<std::string> Result;
+	Result.reserve(Entries.size());
+	for (const FEntry& Entry : Entries)
+	{
+		const std::string_view Name = GetName(Entry);
+		const std::string_view Value = GetValue(Entry);
+		std::string& Line = Result.emplace_back();
+		Line.reserve(Name.size() + 2 + Value.size());
+		Line.append(Name).append(": ").append(Value);
+	}
+	return Result;
+}
+
+int32_t FHttpHeaders::FindIndex(std::string_view Name, EHttpHeader::Type Id) const
+{
+	for (size_t Index = 0; Index < Entries.size(); ++Index)
+	{
+		const FEntry& Entry = Entries[Index];
+		if (Id != EHttpHeader::Unknown)
+		{
+			// interned, the id decides
+			if (Entry.Id == Id)
+			{
+				return int32_t(Index);
+			}
+		}
+		else if (Entry.Id == EHttpHeader::Unknown && Entry.NameLength == Name.size() && HttpHeaderNameEquals(GetName(Entry), Name))
+		{
+			return int32_t(Index);
+		}
+	}
+	return -1;
+}
+
+void FHttpHeaders::StoreValue(FEntry& Entry, std::string_view Previous, std::string_view Value)
+{
+	// the new bytes may come from this very buffer, which appending can reallocate
+	const char* BufferBegin = Buffer.data();
+	const char* BufferEnd = Buffer.data() + Buffer.size();
+	std::string AliasedValue;
+	if (Value.data() >= BufferBegin && Value.data() < BufferEnd)
+	{
+		AliasedValue.assign(Value);
+		Value = AliasedValue;
+	}
+	const size_t PreviousOffset = Previous.empty() ? 0 : size_t(Previous.data() - BufferBegin);
+
+	const size_t ValueOffset = Buffer.size();
+	Buffer.reserve(ValueOffset + Previous.size() + 2 + Value.size());
+	if (!Previous.empty())
+	{
+		Buffer.append(Buffer.data() + PreviousOffset, Previous.size());
+		Buffer.append(", ");
+	}
+	Buffer.append(Value);
+	Entry.ValueOffset = uint32_t(ValueOffset);
+	Entry.ValueLength = uint32_t(Buffer.size() - ValueOffset);
+}
+
+void FHttpHeaders::CompactIfNeeded()
+{
+	if (WastedBytes < 256 || WastedBytes * 2 < Buffer.size())
+	{
+		return;
+	}
+	std::string Compacted;
+	Compacted.reserve(Buffer.size() - WastedBytes);
+	for (FEntry& Entry : Entries)
+	{
+		if (Entry.NameOffset != UINT32_MAX)
+		{
+			const uint32_t NameOffset = uint32_t(Compacted.size());
+			Compacted.append(GetName(Entry));
+			Entry.NameOffset = NameOffset;
+		}
+		const uint32_t ValueOffset = uint32_t(Compacted.size());
+		Compacted.append(GetValue(Entry));
+		Entry.ValueOffset = ValueOffset;
+	}
+	Buffer = std::move(Compacted);
+	WastedBytes = 0;
+}
@@ -1,67 +1,356 @@
 #include "HttpManager.h"
+#include "HttpTrace.h"
+#include "HttpUrl.h"
 #include <logger.h>
 #include <chrono>
-FHttpManager::FHttpManager():DeferredDestroyDelay(10)
+#include <algorithm>
+#include <string_view>
+#include <iterator>
+#include <cctype>
+#include <thread>
+
+FHttpManager::FHttpManager()
+	: PendingDestroyTimers(0.1)
+	, LastPendingDestroyTime(std::chrono::steady_clock::now())
+	, CompletionDispatch(EHttpCompletionDispatch::Tick)
+	, bCompletionDispatchPosted(false)
+	, CompletionSerial(0)
+	, HttpThreadCount(1)
+	, MaxRunningRequests(0)
+	, MaxRunningRequestsPerHost(0)
+	, bCoalesceRequests(false)
+	, CoalescingTransferCount(0)
+	, CoalescedRequestCount(0)
+	, DeferredDestroyDelay(10)
+	, HostLatencyCount(0)
 {
 }
 
 FHttpManager::~FHttpManager()
 {
-	if (Thread)
+	// Stop every thread before deleting any, a running thread may still look at the queue of a sibling
+	for (FHttpThread* Thread : Threads)
 	{
 		Thread->StopThread();
+	}
+	for (FHttpThread* Thread : Threads)
+	{
 		delete Thread;
-		Thread = nullptr;
+	}
+	Threads.clear();
+	for (FHostLatencySlot& Slot : HostLatencySlots)
+	{
+		delete Slot.Latency.load();
 	}
 }
 
 void FHttpManager::Initialize()
 {
-	Thread = CreateHttpThread();
-	Thread->StartThread();
+	for (uint32_t Index = 0; Index < HttpThreadCount; ++Index)
+	{
+		Threads.push_back(CreateHttpThread());
+	}
+	for (FHttpThread* Thread : Threads)
+	{
+		Thread->SetSiblingThreads(Threads);
+		Thread->SetConnectionSettings(ConnectionSettings);
+		Thread->SetRequestLimits(MaxRunningRequests, MaxRunningRequestsPerHost);
+		Thread->SetCompletionCallback([this](FHttpThread& CompletingThread) { OnThreadCompletions(CompletingThread); });
+		Thread->StartThread();
+	}
+	for (const FHttpPreconnectTarget& Target : PreconnectTargets)
+	{
+		GetThreadForUrl(Target.URL)->Preconnect(Target);
+	}
+	PreconnectTargets.clear();
 }
 
-void FHttpManager::AddRequest(const std::shared_ptr<IHttpRequest>& Request)
+void FHttpManager::SetHttpThreadCount(uint32_t InHttpThreadCount)
 {
-	std::scoped_lock(RequestLock);
-	Requests.push_back(Request);
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetHttpThreadCount() - ignored, http threads are already running");
+		return;
+	}
+	HttpThreadCount = std::max<uint32_t>(InHttpThreadCount, 1);
 }
 
-void FHttpManager::RemoveRequest(const std::shared_ptr<IHttpRequest>& Request)
+void FHttpManager::SetConnectionSettings(const FHttpConnectionSettings& InConnectionSettings)
 {
-	std::scoped_lock(RequestLock);
-	// Keep track of requests that have been removed to be destroyed later
-	PendingDestroyRequests.push_back(FRequestPendingDestroy(DeferredDestroyDelay, Request));
-	std::erase( Requests,Request);
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetConnectionSettings() - ignored, http threads are already running");
+		return;
+	}
+	ConnectionSettings = InConnectionSettings;
 }
 
-bool FHttpManager::IsValidRequest(const IHttpRequest* RequestPtr) const
+void FHttpManager::SetRequestLimits(uint32_t InMaxRunningRequests, uint32_t InMaxRunningRequestsPerHost)
+{
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetRequestLimits() - ignored, http threads are already running");
+		return;
+	}
+	MaxRunningRequests = InMaxRunningRequests;
+	MaxRunningRequestsPerHost = InMaxRunningRequestsPerHost;
+}
+
+void FHttpManager::SetPreconnectTargets(std::vector<FHttpPreconnectTarget> InPreconnectTargets)
+{
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetPreconnectTargets() - ignored, http threads are already running, use Preconnect");
+		return;
+	}
+	PreconnectTargets = std::move(InPreconnectTargets);
+}
+
+void FHttpManager::Preconnect(const std::string& URL, uint32_t ConnectionCount)
+{
+	FHttpPreconnectTarget Target;
+	Target.URL = URL;
+	Target.ConnectionCount = ConnectionCount;
+	if (Threads.empty())
+	{
+		PreconnectTargets.push_back(std::move(Target));
+		return;
+	}
+	GetThreadForUrl(URL)->Preconnect(Target);
+}
+
+void FHttpManager::SetRequestCoalescing(bool bInCoalesceRequests)
+{
+	bCoalesceRequests = bInCoalesceRequests;
+}
+
+void FHttpManager::SetCompletionDispatch(EHttpCompletionDispatch::Type InCompletionDispatch, FHttpExecutor InCompletionExecutor)
+{
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetCompletionDispatch() - ignored, http threads are already running");
+		return;
+	}
+	if (InCompletionDispatch == EHttpCompletionDispatch::Executor && !InCompletionExecutor)
+	{
+		LOG_INFO("FHttpManager::SetCompletionDispatch() - ignored, Executor mode needs an executor");
+		return;
+	}
+	CompletionDispatch = InCompletionDispatch;
+	CompletionExecutor = std::move(InCompletionExecutor);
+}
+
+void FHttpManager::SetCompletionSignal(std::function<void()> InCompletionSignal)
+{
+	if (!Threads.empty())
+	{
+		LOG_INFO("FHttpManager::SetCompletionSignal() - ignored, http threads are already running");
+		return;
+	}
+	CompletionSignal = std::move(InCompletionSignal);
+}
+
+void FHttpManager::SetResponseCache(std::shared_ptr<FHttpResponseCache> InResponseCache)
 {
-	bool bResult = false;
-	for (const auto& Request : Requests)
+	if (!Threads.empty())
 	{
-		if (Request.get() == RequestPtr)
+		LOG_INFO("FHttpManager::SetResponseCache() - ignored, http threads are already running");
+		return;
+	}
+	ResponseCache = std::move(InResponseCache);
+}
+
+FHttpCoalescingStats FHttpManager::GetCoalescingStats() const
+{
+	FHttpCoalescingStats Stats;
+	Stats.Transfers = CoalescingTransferCount;
+	Stats.CoalescedRequests = CoalescedRequestCount;
+	return Stats;
+}
+
+bool FHttpManager::CanCoalesceRequest(IHttpRequest& Request) const
+{
+	if (!bCoalesceRequests || Request.GetContentLength() != 0 || Request.OnResponseStream())
+	{
+		return false;
+	}
+	const std::string Verb = Request.GetVerb();
+	return Verb == "GET" || Verb == "HEAD";
+}
+
+std::string FHttpManager::MakeCoalescingKey(IHttpRequest& Request)
+{
+	std::string Key = Request.GetVerb();
+	Key.append(" ").append(Request.GetURL());
+	for (const FHttpHeaders::FHeader Header : Request.GetHeaders())
+	{
+		// names are case-insensitive
+		Key.append("\n");
+		std::transform(Header.Name.begin(), Header.Name.end(), std::back_inserter(Key), [](unsigned char Char) { return char(std::tolower(Char)); });
+		Key.append(": ").append(Header.Value);
+	}
+	return Key;
+}
+
+void FHttpManager::RecordRequestLatency(IHttpThreadedRequest& Request)
+{
+	const FHttpRequestTimings Timings = Request.GetTimings();
+	if (Timings.Started == 0)
+	{
+		return;
+	}
+	// the host is hashed in place, there is no key to build unless it is new
+	FUrlView Url;
+	FUrlView::Parse(Request.GetThreadedRequestURL(), Url);
+	const uint32_t Port = Url.GetPortOrDefault();
+	const uint64_t HostHash = (uint64_t(std::hash<std::string_view>()(Url.Host)) ^ (uint64_t(Port) * 0x9E3779B97F4A7C15ull)) | 1;
+	RecordHttpRequestTimings(FindOrAddHostLatency(HostHash, Url.Host, Port).Histograms, Timings);
+}
+
+FHttpManager::FHostLatency& FHttpManager::FindOrAddHostLatency(uint64_t HostHash, std::string_view Host, uint32_t Port)
+{
+	// linear probing, the table never fills up since it has room for every host and "*"
+	for (uint64_t Index = HostHash;; ++Index)
+	{
+		FHostLatencySlot& Slot = HostLatencySlots[Index & (HostLatencySlotCount - 1)];
+		uint64_t SlotHash = Slot.HostHash.load(std::memory_order_acquire);
+		if (SlotHash == 0)
 		{
-			bResult = true;
-			break;
+			// reserve the place of the host before claiming the slot, so concurrent hosts can't go past the limit
+			const bool bCounted = HostHash != OverflowHostHash;
+			if (bCounted && HostLatencyCount.fetch_add(1, std::memory_order_relaxed) >= MaxLatencyHosts)
+			{
+				HostLatencyCount.fetch_sub(1, std::memory_order_relaxed);
+				return FindOrAddHostLatency(OverflowHostHash, "*", 0);
+			}
+			if (Slot.HostHash.compare_exchange_strong(SlotHash, HostHash, std::memory_order_acq_rel))
+			{
+				FHostLatency* Created = new FHostLatency();
+				Created->Host = Host;
+				if (Port != 0)
+				{
+					Created->Host.append(":").append(std::to_string(Port));
+				}
+				Slot.Latency.store(Created, std::memory_order_release);
+				return *Created;
+			}
+			// another thread claimed it first, SlotHash now holds its hash
+			if (bCounted)
+			{
+				HostLatencyCount.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		if (SlotHash == HostHash)
+		{
+			// claimed by another thread, its histograms are published right after
+			FHostLatency* Latency = Slot.Latency.load(std::memory_order_acquire);
+			while (!Latency)
+			{
+				std::this_thread::yield();
+				Latency = Slot.Latency.load(std::memory_order_acquire);
+			}
+			return *Latency;
+		}
+	}
+}
+
+std::vector<FHttpHostLatencySnapshot> FHttpManager::GetLatencyStats() const
+{
+	std::vector<FHttpHostLatencySnapshot> Stats;
+	for (const FHostLatencySlot& Slot : HostLatencySlots)
+	{
+		const FHostLatency* HostLatency = Slot.Latency.load(std::memory_order_acquire);
+		if (!HostLatency)
+		{
+			continue;
+		}
+		FHttpHostLatencySnapshot& Snapshot = Stats.emplace_back();
+		Snapshot.Host = HostLatency->Host;
+		for (uint32_t Phase = 0; Phase < EHttpTimingPhase::Count; ++Phase)
+		{
+			Snapshot.Phases[Phase] = HostLatency->Histograms[Phase].Snapshot();
 		}
 	}
+	return Stats;
+}
 
-	return bResult;
+std::vector<FHttpThreadStats> FHttpManager::GetHttpThreadStats() const
+{
+	std::vector<FHttpThreadStats> Stats;
+	Stats.reserve(Threads.size());
+	for (FHttpThread* Thread : Threads)
+	{
+		Stats.push_back(Thread->GetStats());
+	}
+	return Stats;
 }
 
-void FHttpManager::Flush(bool bShutdown)
+FHttpThread* FHttpManager::GetThreadForRequest(IHttpRequest& Request) const
+{
+	if (Threads.size() == 1)
+	{
+		return Threads[0];
+	}
+	return GetThreadForUrl(Request.GetURL());
+}
+
+FHttpThread* FHttpManager::GetThreadForUrl(std::string_view URL) const
+{
+	if (Threads.size() == 1)
+	{
+		return Threads[0];
+	}
+	// keep every request to a host and port on the same http thread, it holds the connections to it
+	FUrlView Url;
+	FUrlView::Parse(URL, Url);
+	const size_t HostHash = std::hash<std::string_view>()(Url.Host) ^ (size_t(Url.GetPortOrDefault()) * 0x9E3779B97F4A7C15ull);
+	return Threads[HostHash % Threads.size()];
+}
+
+FHttpRequestPtr FHttpManager::CreateRequest()
+{
+	return nullptr;
+}
+
+FHttpRequestAwaiter FHttpManager::Send(FHttpRequestPtr Request, FHttpExecutor ResumeExecutor)
+{
+	return FHttpRequestAwaiter(std::move(Request), std::move(ResumeExecutor));
+}
+
+void FHttpManager::AddRequest(const std::shared_ptr<IHttpRequest>& Request)
+{
+	// only progress needs a Tick
+	Requests.Add(Request, bool(Request->OnRequestProgress()));
+}
+
+void FHttpManager::RemoveRequest(const std::shared_ptr<IHttpRequest>& Request)
+{
+	if (FHttpRequestPtr Removed = Requests.Remove(Request.get()))
+	{
+		// Keep track of requests that have been removed to be destroyed later
+		std::scoped_lock Lock(PendingDestroyLock);
+		PendingDestroyTimers.Schedule(DeferredDestroyDelay, [Removed]() {});
+	}
+}
+
+bool FHttpManager::IsValidRequest(const IHttpRequest* RequestPtr) const
+{
+	return Requests.Contains(RequestPtr);
+}
+
+bool FHttpManager::Flush(bool bShutdown, double TimeoutSeconds)
 {
 	if (bShutdown)
 	{
-		if (Requests.size())
+		if (Requests.Num())
 		{
-			LOG_INFO("Http module shutting down, but needs to wait on {} outstanding Http requests:", Requests.size());
+			LOG_INFO("Http module shutting down, but needs to wait on {} outstanding Http requests:", Requests.Num());
 		}
 		// Clear delegates since they may point to deleted instances
-		for (auto& Request : Requests)
+		std::vector<FHttpRequestPtr> ActiveRequests;
+		Requests.GetAll(ActiveRequests);
+		for (auto& Request : ActiveRequests)
 		{
-			
 			Request->OnProcessRequestComplete() = nullptr;
 			Request->OnRequestProgress() = nullptr;
 			LOG_INFO(("	verb={} url={} status={}"), Request->GetVerb(), Request->GetURL(), EHttpRequestStatus::ToString(Request->GetStatus()));
@@ -69,77 +358,458 @@ void FHttpManager::Flush(bool bShutdown)
 	}
 
 	// block until all active requests have completed
-	auto LastTime = std::chrono::steady_clock::now();
-	while (Requests.size() > 0)
+	if (WaitForCompletions([this]() { return Requests.Num() == 0; }, TimeoutSeconds))
+	{
+		return true;
+	}
+	std::vector<FHttpRequestPtr> ActiveRequests;
+	Requests.GetAll(ActiveRequests);
+	LOG_INFO("FHttpManager::Flush() - timed out after {} seconds with {} outstanding Http requests:", TimeoutSeconds, ActiveRequests.size());
+	for (const auto& Request : ActiveRequests)
+	{
+		LOG_INFO(("	verb={} url={} status={}"), Request->GetVerb(), Request->GetURL(), EHttpRequestStatus::ToString(Request->GetStatus()));
+	}
+	return false;
+}
+
+static bool IsRequestProcessing(const FHttpRequestPtr& Request)
+{
+	return Request && Request->GetStatus() == EHttpRequestStatus::Processing;
+}
+
+std::vector<FHttpRequestPtr> FHttpManager::WaitAll(const std::vector<FHttpRequestPtr>& InRequests, double TimeoutSeconds)
+{
+	std::vector<FHttpRequestPtr> Stragglers;
+	if (WaitForCompletions([&InRequests]() { return std::none_of(InRequests.begin(), InRequests.end(), IsRequestProcessing); }, TimeoutSeconds))
+	{
+		return Stragglers;
+	}
+	std::copy_if(InRequests.begin(), InRequests.end(), std::back_inserter(Stragglers), IsRequestProcessing);
+	LOG_INFO("FHttpManager::WaitAll() - timed out after {} seconds with {} of {} Http requests still processing:", TimeoutSeconds, Stragglers.size(), InRequests.size());
+	for (const auto& Request : Stragglers)
 	{
-		auto AppTime = std::chrono::steady_clock::now();
-		Tick(std::chrono::duration_cast<std::chrono::seconds>(AppTime - LastTime).count());
-		LastTime = AppTime;
-		if (Requests.size() > 0)
+		LOG_INFO(("	verb={} url={} elapsed={}"), Request->GetVerb(), Request->GetURL(), Request->GetElapsedTime());
+	}
+	return Stragglers;
+}
+
+FHttpRequestPtr FHttpManager::WaitAny(const std::vector<FHttpRequestPtr>& InRequests, double TimeoutSeconds)
+{
+	FHttpRequestPtr Finished;
+	auto FindFinished = [&InRequests, &Finished]()
+	{
+		auto Itr = std::find_if(InRequests.begin(), InRequests.end(), [](const FHttpRequestPtr& Request) { return Request && !IsRequestProcessing(Request); });
+		if (Itr == InRequests.end())
 		{
-			Thread->Tick();
+			return false;
 		}
+		Finished = *Itr;
+		return true;
+	};
+	if (!WaitForCompletions(FindFinished, TimeoutSeconds))
+	{
+		LOG_INFO("FHttpManager::WaitAny() - timed out after {} seconds with all {} Http requests still processing", TimeoutSeconds, InRequests.size());
 	}
+	return Finished;
 }
 
-bool FHttpManager::Tick(float DeltaSeconds)
+bool FHttpManager::WaitForCompletions(const std::function<bool()>& IsDone, double TimeoutSeconds)
 {
-	std::scoped_lock(RequestLock);
+	using FClock = std::chrono::steady_clock;
+	const bool bHasDeadline = TimeoutSeconds >= 0.0;
+	const FClock::time_point Deadline = FClock::now() + std::chrono::duration_cast<FClock::duration>(std::chrono::duration<double>(bHasDeadline ? TimeoutSeconds : 0.0));
+	FClock::time_point LastTime = FClock::now();
+	for (;;)
+	{
+		// read before delivering, so completions arriving meanwhile are not slept through
+		uint64_t Serial = 0;
+		{
+			std::scoped_lock Lock(CompletionWaitLock);
+			Serial = CompletionSerial;
+		}
+
+		// deliver what waits on this thread, with the real elapsed time so dead requests keep aging
+		const FClock::time_point Now = FClock::now();
+		Tick(std::chrono::duration<float>(Now - LastTime).count());
+		LastTime = Now;
+		// in Executor mode only the executor delivers, PostCompletionDispatch wakes this thread once it did
+		bool bPumping = false;
+		for (FHttpThread* Thread : Threads)
+		{
+			if (!Thread->IsThreadRunning())
+			{
+				Thread->Tick();
+				bPumping = true;
+			}
+		}
+
+		if (IsDone())
+		{
+			return true;
+		}
+		if (bHasDeadline && FClock::now() >= Deadline)
+		{
+			return false;
+		}
 
-	// Tick each active request
-	for (auto& Request: Requests)
+		std::unique_lock Lock(CompletionWaitLock);
+		auto HasNewCompletions = [this, Serial]() { return CompletionSerial != Serial; };
+		if (bPumping)
+		{
+			// nothing runs the requests but this thread, come back at the active frame rate of an http thread
+			const FClock::time_point PumpTime = FClock::now() + std::chrono::milliseconds(5);
+			CompletionWaitEvent.wait_until(Lock, bHasDeadline ? std::min(PumpTime, Deadline) : PumpTime, HasNewCompletions);
+		}
+		else if (bHasDeadline)
+		{
+			CompletionWaitEvent.wait_until(Lock, Deadline, HasNewCompletions);
+		}
+		else
+		{
+			CompletionWaitEvent.wait(Lock, HasNewCompletions);
+		}
+	}
+}
+
+void FHttpManager::NotifyCompletionWaiters()
+{
 	{
-		Request->Tick(DeltaSeconds);
+		std::scoped_lock Lock(CompletionWaitLock);
+		++CompletionSerial;
 	}
-	// Tick any pending destroy objects
-	for (auto itr= PendingDestroyRequests.begin();itr!= PendingDestroyRequests.end();)
+	CompletionWaitEvent.notify_all();
+}
+
+bool FHttpManager::Tick(float DeltaSeconds)
+{
+	HTTP_TRACE_SCOPE("FHttpManager::Tick");
+
+	// Tick the requests reporting progress, outside of any lock since ticking may run delegates
+	if (Requests.NumTickable() > 0)
 	{
-		FRequestPendingDestroy& Request = *itr;
-		Request.TimeLeft -= DeltaSeconds;
-		if (Request.TimeLeft <= 0)
+		std::vector<FHttpRequestPtr> TickableRequests;
+		Requests.GetTickable(TickableRequests);
+		for (auto& Request : TickableRequests)
 		{
-			PendingDestroyRequests.erase(itr);
+			Request->Tick(DeltaSeconds);
 		}
-		else {
-			itr++;
+	}
+
+	// Completions delivered elsewhere also age the dead requests there
+	if (CompletionDispatch == EHttpCompletionDispatch::Tick)
+	{
+		// Tick any pending destroy objects, the requests are released with the callbacks once the lock is released
+		std::vector<FHttpTimerWheel::FTimerCallback> ExpiredDestroyTimers;
+		{
+			std::scoped_lock Lock(PendingDestroyLock);
+			PendingDestroyTimers.Advance(DeltaSeconds, ExpiredDestroyTimers);
 		}
+		ExpiredDestroyTimers.clear();
+
+		DispatchCompletions(nullptr);
 	}
+	// keep ticking
+	return true;
+}
 
+void FHttpManager::DispatchCompletions(FHttpThread* OnlyThread)
+{
+	HTTP_TRACE_SCOPE("FHttpManager::DispatchCompletions");
 	std::vector<IHttpThreadedRequest*> CompletedThreadedRequests;
-	Thread->GetCompletedRequests(CompletedThreadedRequests);
+	if (OnlyThread)
+	{
+		// called on that http thread, the only consumer of its queue in this mode
+		OnlyThread->GetCompletedRequests(CompletedThreadedRequests);
+	}
+	else
+	{
+		std::scoped_lock Lock(CompletionConsumerLock);
+		for (FHttpThread* Thread : Threads)
+		{
+			Thread->GetCompletedRequests(CompletedThreadedRequests);
+		}
+	}
+
+	if (CompletionDispatch != EHttpCompletionDispatch::Tick)
+	{
+		// nothing may be ticking, age the dead requests by wall clock time instead
+		std::vector<FHttpTimerWheel::FTimerCallback> ExpiredDestroyTimers;
+		{
+			std::scoped_lock Lock(PendingDestroyLock);
+			const std::chrono::steady_clock::time_point Now = std::chrono::steady_clock::now();
+			PendingDestroyTimers.Advance(std::chrono::duration<double>(Now - LastPendingDestroyTime).count(), ExpiredDestroyTimers);
+			LastPendingDestroyTime = Now;
+		}
+	}
+
+	// Finish requests served by the response cache, a cancelled one finishes as cancelled
+	std::vector<std::pair<std::shared_ptr<IHttpThreadedRequest>, FHttpResponsePtr>> Hits;
+	{
+		std::scoped_lock Lock(CacheHitsLock);
+		Hits.swap(CacheHits);
+	}
+	for (auto& [HitRequest, CachedResponse] : Hits)
+	{
+		RemoveRequest(HitRequest);
+		HitRequest->FinishCachedRequest(std::move(CachedResponse));
+	}
+
+	// Finish coalesced requests cancelled while they waited on their leader
+	std::vector<std::shared_ptr<IHttpThreadedRequest>> Followers;
+	{
+		std::scoped_lock Lock(CoalescingLock);
+		Followers.swap(CancelledFollowers);
+	}
+	for (const std::shared_ptr<IHttpThreadedRequest>& Follower : Followers)
+	{
+		RemoveRequest(Follower);
+		if (ResponseCache)
+		{
+			ResponseCache->AbandonRequest(*Follower);
+		}
+		Follower->FinishRequest();
+	}
 
 	// Finish and remove any completed requests
+	const bool bDeliveredAny = !Hits.empty() || !Followers.empty() || !CompletedThreadedRequests.empty();
 	for (IHttpThreadedRequest* CompletedRequest : CompletedThreadedRequests)
 	{
-		auto itr=std::find(Requests.begin(), Requests.end(), CompletedRequest);
-		if (itr == Requests.end()) {
+		FHttpRequestPtr Request = Requests.Remove(CompletedRequest);
+		if (!Request)
+		{
 			continue;
 		}
-		// Keep track of requests that have been removed to be destroyed later
-		PendingDestroyRequests.push_back(FRequestPendingDestroy(DeferredDestroyDelay, *itr));
-		Requests.erase(itr);
-		CompletedRequest->FinishRequest();
+		HTTP_TRACE_SCOPE("FinishRequest");
+		{
+			// Keep track of requests that have been removed to be destroyed later
+			std::scoped_lock Lock(PendingDestroyLock);
+			PendingDestroyTimers.Schedule(DeferredDestroyDelay, [Request]() {});
+		}
+		// A 304 Not Modified completes with the response the cache revalidated
+		FHttpResponsePtr RevalidatedResponse = ResponseCache ? ResponseCache->EndRequest(*CompletedRequest, CompletedRequest->HasThreadedRequestSucceeded()) : nullptr;
+		if (RevalidatedResponse)
+		{
+			CompletedRequest->FinishCachedRequest(std::move(RevalidatedResponse));
+		}
+		else
+		{
+			CompletedRequest->FinishRequest();
+		}
+		RecordRequestLatency(*CompletedRequest);
+
+		// Complete every request that attached to this transfer with the same response
+		Followers.clear();
+		{
+			std::scoped_lock Lock(CoalescingLock);
+			auto KeyItr = CoalescingKeys.find(CompletedRequest);
+			if (KeyItr != CoalescingKeys.end())
+			{
+				auto TransferItr = CoalescedTransfers.find(KeyItr->second);
+				for (std::shared_ptr<IHttpThreadedRequest>& Follower : TransferItr->second.Followers)
+				{
+					CoalescedFollowers.erase(Follower.get());
+					Followers.push_back(std::move(Follower));
+				}
+				CoalescedTransfers.erase(TransferItr);
+				CoalescingKeys.erase(KeyItr);
+			}
+		}
+		for (const std::shared_ptr<IHttpThreadedRequest>& Follower : Followers)
+		{
+			RemoveRequest(Follower);
+			if (ResponseCache)
+			{
+				ResponseCache->AbandonRequest(*Follower);
+			}
+			Follower->FinishCoalescedRequest(*CompletedRequest);
+		}
+	}
+
+	if (bDeliveredAny)
+	{
+		NotifyCompletionWaiters();
+	}
+}
+
+void FHttpManager::OnThreadCompletions(FHttpThread& Thread)
+{
+	if (CompletionDispatch != EHttpCompletionDispatch::HttpThread)
+	{
+		// a waiting thread may be the one delivering them
+		NotifyCompletionWaiters();
+	}
+	switch (CompletionDispatch)
+	{
+		case EHttpCompletionDispatch::Tick:
+		{
+			if (CompletionSignal)
+			{
+				CompletionSignal();
+			}
+			break;
+		}
+		case EHttpCompletionDispatch::HttpThread:
+		{
+			DispatchCompletions(&Thread);
+			break;
+		}
+		case EHttpCompletionDispatch::Executor:
+		{
+			PostCompletionDispatch();
+			break;
+		}
+	}
+}
+
+void FHttpManager::SignalCompletions(IHttpRequest& Request)
+{
+	if (CompletionDispatch != EHttpCompletionDispatch::HttpThread)
+	{
+		NotifyCompletionWaiters();
+	}
+	switch (CompletionDispatch)
+	{
+		case EHttpCompletionDispatch::Tick:
+		{
+			if (CompletionSignal)
+			{
+				CompletionSignal();
+			}
+			break;
+		}
+		case EHttpCompletionDispatch::HttpThread:
+		{
+			// the lists of such completions are shared, any http thread can deliver them
+			GetThreadForRequest(Request)->RequestCompletionCallback();
+			break;
+		}
+		case EHttpCompletionDispatch::Executor:
+		{
+			PostCompletionDispatch();
+			break;
+		}
+	}
+}
+
+void FHttpManager::PostCompletionDispatch()
+{
+	if (!bCompletionDispatchPosted.exchange(true))
+	{
+		CompletionExecutor([this]()
+		{
+			// cleared first, completions arriving meanwhile post another dispatch
+			bCompletionDispatchPosted = false;
+			DispatchCompletions(nullptr);
+		});
 	}
-	// keep ticking
-	return true;
 }
 
 void FHttpManager::AddThreadedRequest(const std::shared_ptr<IHttpThreadedRequest>& Request)
 {
 	AddRequest(Request);
-	Thread->AddRequest(Request.get());
+	if (ResponseCache)
+	{
+		FHttpHeaders Validators;
+		if (FHttpResponsePtr CachedResponse = ResponseCache->BeginRequest(*Request, Validators))
+		{
+			{
+				std::scoped_lock Lock(CacheHitsLock);
+				CacheHits.emplace_back(Request, std::move(CachedResponse));
+			}
+			SignalCompletions(*Request);
+			return;
+		}
+		for (const FHttpHeaders::FHeader Header : Validators)
+		{
+			Request->AddTransferHeader(Header.Name, Header.Value);
+		}
+	}
+	if (CanCoalesceRequest(*Request))
+	{
+		std::string Key = MakeCoalescingKey(*Request);
+		std::scoped_lock Lock(CoalescingLock);
+		auto [Itr, bInserted] = CoalescedTransfers.try_emplace(std::move(Key));
+		if (!bInserted)
+		{
+			// an identical request is in flight, wait for its response
+			FCoalescedTransfer& Transfer = Itr->second;
+			Transfer.Followers.push_back(Request);
+			CoalescedFollowers.emplace(Request.get(), FCoalescedFollower{ &Transfer, std::prev(Transfer.Followers.end()) });
+			++CoalescedRequestCount;
+			return;
+		}
+		Itr->second.Leader = Request;
+		CoalescingKeys.emplace(Request.get(), Itr->first);
+		++CoalescingTransferCount;
+	}
+	GetThreadForRequest(*Request)->AddRequest(Request.get());
 }
 
 void FHttpManager::CancelThreadedRequest(const std::shared_ptr<IHttpThreadedRequest>& Request)
 {
-	Thread->CancelRequest(Request.get());
+	bool bCancelledFollower = false;
+	{
+		// coalescing may have been turned off since the request was added, always look it up
+		std::scoped_lock Lock(CoalescingLock);
+		auto KeyItr = CoalescingKeys.find(Request.get());
+		if (KeyItr != CoalescingKeys.end())
+		{
+			// a cancelled leader hands its transfer over to the first request waiting on it
+			const std::string Key = std::move(KeyItr->second);
+			CoalescingKeys.erase(KeyItr);
+			auto TransferItr = CoalescedTransfers.find(Key);
+			FCoalescedTransfer& Transfer = TransferItr->second;
+			if (!Transfer.Followers.empty())
+			{
+				Transfer.Leader = std::move(Transfer.Followers.front());
+				Transfer.Followers.pop_front();
+				CoalescedFollowers.erase(Transfer.Leader.get());
+				CoalescingKeys.emplace(Transfer.Leader.get(), Key);
+				GetThreadForRequest(*Transfer.Leader)->AddRequest(Transfer.Leader.get());
+			}
+			else
+			{
+				CoalescedTransfers.erase(TransferItr);
+			}
+		}
+		else if (auto FollowerItr = CoalescedFollowers.find(Request.get()); FollowerItr != CoalescedFollowers.end())
+		{
+			// never reached an http thread, finish it with the next completions
+			CancelledFollowers.push_back(Request);
+			FollowerItr->second.Transfer->Followers.erase(FollowerItr->second.Itr);
+			CoalescedFollowers.erase(FollowerItr);
+			bCancelledFollower = true;
+		}
+	}
+	if (bCancelledFollower)
+	{
+		// outside of the lock, an inline executor dispatches right away
+		SignalCompletions(*Request);
+		return;
+	}
+
+	// a thread stealing the request in the meantime gets the cancel forwarded by the one it stole from
+	if (FHttpThread* Owner = Request->GetThreadedRequestOwner())
+	{
+		Owner->CancelRequest(Request.get());
+	}
+}
+
+void FHttpManager::WakeUpThreadedRequest(const std::shared_ptr<IHttpThreadedRequest>& Request)
+{
+	// only the thread running the request has anything to do
+	if (FHttpThread* Owner = Request->GetThreadedRequestOwner())
+	{
+		Owner->WakeUp();
+	}
 }
 
 void FHttpManager::DumpRequests() const
 {
-	std::scoped_lock(RequestLock);
-	LOG_INFO("------- ({}) Http Requests", Requests.size());
-	for (const auto& Request : Requests)
+	std::vector<FHttpRequestPtr> ActiveRequests;
+	Requests.GetAll(ActiveRequests);
+	LOG_INFO("------- ({}) Http Requests", ActiveRequests.size());
+	for (const auto& Request : ActiveRequests)
 	{
 		LOG_INFO("verb=[{}] url=[{}] status={}", Request->GetVerb(),Request->GetURL(), EHttpRequestStatus::ToString(Request->GetStatus()));
 	}
@@ -0,0 +1,698 @@
+#include "HttpRequestBase.h"
+#include "HttpManager.h"
+#include "HttpTrace.h"
+#include "HttpUrl.h"
+#include <logger.h>
+#include <algorithm>
+#include <cctype>
+#include <string_view>
+
+FHttpRequestBase::FHttpRequestBase(FHttpManager& InManager)
+	: Manager(InManager)
+	, HttpVersion(EHttpVersion::Default)
+	, Priority(EHttpRequestPriority::Normal)
+	, bCanceled(false)
+	, bTimedOut(false)
+	, bTransferCompleted(false)
+	, OwningThread(nullptr)
+	, ContentCompressionThreshold(0)
+	, bDecompressResponse(true)
+	, BytesSent(0)
+	, BytesReceived(0)
+	, LastReportedBytesSent(0)
+	, LastReportedBytesReceived(0)
+	, CompletionStatus(EHttpRequestStatus::NotStarted)
+	, Timeout(0.0f)
+	, ConnectTimeout(0.0f)
+	, ElapsedTime(0.0f)
+	, MaxQueuedStreamBytes(0)
+	, QueuedStreamBytes(0)
+	, QueuedStreamChunks(0)
+	, bStreamDrainPosted(false)
+	, bStreamPauseRequested(false)
+	, bStreamPaused(false)
+{
+}
+
+FHttpRequestBase::~FHttpRequestBase()
+{
+}
+
+std::string FHttpRequestBase::GetURL()
+{
+	return URL;
+}
+
+std::string FHttpRequestBase::GetURLParameter(const std::string& ParameterName)
+{
+	FUrlView Url;
+	std::string_view Value;
+	if (FUrlView::Parse(URL, Url) && FindUrlQueryParameter(Url.Query, ParameterName, Value))
+	{
+		return std::string(Value);
+	}
+	return std::string();
+}
+
+std::string FHttpRequestBase::GetHeader(const std::string& HeaderName)
+{
+	return std::string(Headers.Find(HeaderName));
+}
+
+std::string_view FHttpRequestBase::GetHeaderView(std::string_view HeaderName)
+{
+	return Headers.Find(HeaderName);
+}
+
+const FHttpHeaders& FHttpRequestBase::GetHeaders()
+{
+	return Headers;
+}
+
+std::vector<std::string> FHttpRequestBase::GetAllHeaders()
+{
+	return Headers.ToStrings();
+}
+
+std::string FHttpRequestBase::GetContentType()
+{
+	return GetHeader("Content-Type");
+}
+
+int32_t FHttpRequestBase::GetContentLength()
+{
+	return int32_t(std::max<int64_t>(RequestBody.GetSize(), 0));
+}
+
+const std::vector<uint8_t>& FHttpRequestBase::GetContent()
+{
+	return RequestBody.GetContent();
+}
+
+std::string FHttpRequestBase::GetVerb()
+{
+	return Verb.empty() ? std::string("GET") : Verb;
+}
+
+void FHttpRequestBase::SetVerb(const std::string& InVerb)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetVerb() - attempted to set verb on a request that is inflight");
+		return;
+	}
+	Verb = InVerb;
+	std::transform(Verb.begin(), Verb.end(), Verb.begin(), [](unsigned char Char) { return char(std::toupper(Char)); });
+}
+
+void FHttpRequestBase::SetURL(const std::string& InURL)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetURL() - attempted to set url on a request that is inflight");
+		return;
+	}
+	URL = InURL;
+}
+
+void FHttpRequestBase::SetContent(const std::vector<uint8_t>& ContentPayload)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContent() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetBuffer(ContentPayload);
+}
+
+void FHttpRequestBase::SetContent(std::vector<uint8_t>&& ContentPayload)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContent() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetBuffer(std::move(ContentPayload));
+}
+
+void FHttpRequestBase::SetContent(FHttpSharedBuffer ContentPayload)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContent() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetBuffer(std::move(ContentPayload));
+}
+
+void FHttpRequestBase::SetContentAsString(const std::string& ContentString)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContentAsString() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetBuffer(std::vector<uint8_t>(ContentString.begin(), ContentString.end()));
+}
+
+void FHttpRequestBase::SetContentAsString(std::string&& ContentString)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContentAsString() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetString(std::move(ContentString));
+}
+
+void FHttpRequestBase::SetContentSource(FHttpBodySourcePtr ContentSource)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContentSource() - attempted to set content on a request that is inflight");
+		return;
+	}
+	RequestBody.SetSource(std::move(ContentSource));
+}
+
+void FHttpRequestBase::SetHeader(const std::string& HeaderName, const std::string& HeaderValue)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetHeader() - attempted to set header on a request that is inflight");
+		return;
+	}
+	Headers.Set(HeaderName, HeaderValue);
+}
+
+void FHttpRequestBase::AppendToHeader(const std::string& HeaderName, const std::string& AdditionalHeaderValue)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::AppendToHeader() - attempted to append to header on a request that is inflight");
+		return;
+	}
+	Headers.Append(HeaderName, AdditionalHeaderValue);
+}
+
+void FHttpRequestBase::SetHttpVersion(EHttpVersion::Type InHttpVersion)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetHttpVersion() - attempted to set http version on a request that is inflight");
+		return;
+	}
+	HttpVersion = InHttpVersion;
+}
+
+EHttpVersion::Type FHttpRequestBase::GetHttpVersion()
+{
+	return HttpVersion;
+}
+
+void FHttpRequestBase::SetPriority(EHttpRequestPriority::Type InPriority)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetPriority() - attempted to set priority on a request that is inflight");
+		return;
+	}
+	Priority = InPriority;
+}
+
+EHttpRequestPriority::Type FHttpRequestBase::GetPriority()
+{
+	return Priority;
+}
+
+void FHttpRequestBase::SetResponseDecompression(bool bInDecompress)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetResponseDecompression() - attempted to set decompression on a request that is inflight");
+		return;
+	}
+	bDecompressResponse = bInDecompress;
+}
+
+bool FHttpRequestBase::GetResponseDecompression()
+{
+	return bDecompressResponse;
+}
+
+void FHttpRequestBase::SetContentCompressionThreshold(size_t InThreshold)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetContentCompressionThreshold() - attempted to set compression on a request that is inflight");
+		return;
+	}
+	ContentCompressionThreshold = InThreshold;
+}
+
+size_t FHttpRequestBase::GetContentCompressionThreshold()
+{
+	return ContentCompressionThreshold;
+}
+
+bool FHttpRequestBase::ProcessRequest()
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::ProcessRequest() - attempted to process a request that is already inflight");
+		return false;
+	}
+	if (URL.empty())
+	{
+		LOG_INFO("FHttpRequestBase::ProcessRequest() - no URL was specified");
+		return false;
+	}
+	if (QueuedStreamChunks != 0)
+	{
+		// only left behind by a cancelled or timed out run, its chunks are being dropped
+		LOG_INFO("FHttpRequestBase::ProcessRequest() - the stream executor is still delivering the previous response");
+		return false;
+	}
+	if (!RequestBody.Rewind())
+	{
+		LOG_INFO("FHttpRequestBase::ProcessRequest() - the content source can't be sent again");
+		return false;
+	}
+	if (!SetupRequest())
+	{
+		return false;
+	}
+
+	bCanceled = false;
+	bTimedOut = false;
+	bTransferCompleted = false;
+	BytesSent = 0;
+	BytesReceived = 0;
+	LastReportedBytesSent = 0;
+	LastReportedBytesReceived = 0;
+	bStreamPaused = false;
+	ElapsedTime = 0.0f;
+	BorrowedResponse = nullptr;
+	Timings = FHttpRequestTimings();
+	Timings.Queued = GetHttpTimestamp();
+	PublishTimings();
+	CompletionStatus = EHttpRequestStatus::Processing;
+	HTTP_TRACE_EVENT(AsyncBegin("Queued", GetTraceId(), Timings.Queued));
+
+	Manager.AddThreadedRequest(shared_from_this());
+	return true;
+}
+
+FHttpRequestCompleteDelegate& FHttpRequestBase::OnProcessRequestComplete()
+{
+	return RequestCompleteDelegate;
+}
+
+FHttpRequestProgressDelegate& FHttpRequestBase::OnRequestProgress()
+{
+	return RequestProgressDelegate;
+}
+
+FHttpRequestStreamDelegate& FHttpRequestBase::OnResponseStream()
+{
+	return RequestStreamDelegate;
+}
+
+void FHttpRequestBase::SetResponseStreamExecutor(FHttpExecutor Executor, size_t MaxQueuedBytes)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetResponseStreamExecutor() - attempted to set stream executor on a request that is inflight");
+		return;
+	}
+	StreamExecutor = std::move(Executor);
+	MaxQueuedStreamBytes = std::max<size_t>(MaxQueuedBytes, 1);
+}
+
+void FHttpRequestBase::PauseResponseStream()
+{
+	bStreamPauseRequested = true;
+}
+
+void FHttpRequestBase::ResumeResponseStream()
+{
+	if (bStreamPauseRequested.exchange(false) && CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		Manager.WakeUpThreadedRequest(shared_from_this());
+	}
+}
+
+void FHttpRequestBase::CancelRequest()
+{
+	if (bCanceled)
+	{
+		return;
+	}
+	bCanceled = true;
+
+	if (Manager.IsValidRequest(this))
+	{
+		Manager.CancelThreadedRequest(shared_from_this());
+	}
+	else
+	{
+		// Finish immediately
+		FinishRequest();
+	}
+}
+
+EHttpRequestStatus::Type FHttpRequestBase::GetStatus()
+{
+	return CompletionStatus;
+}
+
+const FHttpResponsePtr FHttpRequestBase::GetResponse() const
+{
+	if (BorrowedResponse)
+	{
+		return BorrowedResponse;
+	}
+	return GetTransferResponse();
+}
+
+void FHttpRequestBase::Tick(float DeltaSeconds)
+{
+	if (CompletionStatus != EHttpRequestStatus::Processing || !RequestProgressDelegate)
+	{
+		return;
+	}
+	const size_t CurrentBytesSent = BytesSent;
+	const size_t CurrentBytesReceived = BytesReceived;
+	if (CurrentBytesSent != LastReportedBytesSent || CurrentBytesReceived != LastReportedBytesReceived)
+	{
+		LastReportedBytesSent = CurrentBytesSent;
+		LastReportedBytesReceived = CurrentBytesReceived;
+		RequestProgressDelegate(shared_from_this(), int32_t(CurrentBytesSent), int32_t(CurrentBytesReceived));
+	}
+}
+
+void FHttpRequestBase::SetTimeout(float InTimeoutSecs)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetTimeout() - attempted to set timeout on a request that is inflight");
+		return;
+	}
+	Timeout = std::max(InTimeoutSecs, 0.0f);
+}
+
+float FHttpRequestBase::GetTimeout()
+{
+	return Timeout;
+}
+
+void FHttpRequestBase::SetConnectTimeout(float InTimeoutSecs)
+{
+	if (CompletionStatus == EHttpRequestStatus::Processing)
+	{
+		LOG_INFO("FHttpRequestBase::SetConnectTimeout() - attempted to set timeout on a request that is inflight");
+		return;
+	}
+	ConnectTimeout = std::max(InTimeoutSecs, 0.0f);
+}
+
+float FHttpRequestBase::GetConnectTimeout()
+{
+	return ConnectTimeout;
+}
+
+float FHttpRequestBase::GetElapsedTime()
+{
+	return ElapsedTime;
+}
+
+FHttpRequestTimings FHttpRequestBase::GetTimings()
+{
+	// Timings itself is written by the http thread while the request runs
+	std::scoped_lock Lock(PublishedTimingsLock);
+	return PublishedTimings;
+}
+
+bool FHttpRequestBase::StartThreadedRequest()
+{
+	if (bCanceled)
+	{
+		return false;
+	}
+	Timings.Started = GetHttpTimestamp();
+	HTTP_TRACE_EVENT(AsyncStep("Started", GetTraceId(), Timings.Started));
+	return true;
+}
+
+bool FHttpRequestBase::IsThreadedRequestComplete()
+{
+	// the completion follows the whole body through the stream executor
+	return bCanceled || (bTransferCompleted && QueuedStreamChunks == 0);
+}
+
+void FHttpRequestBase::TickThreadedRequest(float DeltaSeconds)
+{
+	ElapsedTime += DeltaSeconds;
+	if (RequestStreamDelegate)
+	{
+		UpdateResponseStreamPause();
+	}
+}
+
+bool FHttpRequestBase::IsThreadedRequestTickable()
+{
+	// a pause the transport could not apply yet is retried every tick, the rest follows the activity of the transfer
+	return RequestStreamDelegate && !bTransferCompleted && ShouldPauseResponseStream() != bStreamPaused;
+}
+
+void FHttpRequestBase::TimeoutThreadedRequest()
+{
+	bTimedOut = true;
+}
+
+bool FHttpRequestBase::HasThreadedRequestSucceeded()
+{
+	return !bCanceled && bTransferCompleted && HasTransferSucceeded();
+}
+
+std::string_view FHttpRequestBase::GetThreadedRequestURL()
+{
+	return URL;
+}
+
+void FHttpRequestBase::SetThreadedRequestOwner(FHttpThread* Owner)
+{
+	OwningThread = Owner;
+}
+
+FHttpThread* FHttpRequestBase::GetThreadedRequestOwner()
+{
+	return OwningThread;
+}
+
+void FHttpRequestBase::FinishRequest()
+{
+	// report the final progress before the completion
+	Tick(0.0f);
+
+	const bool bSucceeded = HasThreadedRequestSucceeded();
+	if (bSucceeded)
+	{
+		CompletionStatus = EHttpRequestStatus::Succeeded;
+	}
+	else
+	{
+		const bool bConnectionError = !bCanceled && bTransferCompleted && IsTransferConnectionError();
+		CompletionStatus = bConnectionError ? EHttpRequestStatus::Failed_ConnectionError : EHttpRequestStatus::Failed;
+
+		if (bCanceled)
+		{
+			LOG_INFO("{} {} canceled", GetVerb(), URL);
+		}
+		else if (bTimedOut)
+		{
+			LOG_INFO("{} {} timed out after {} seconds", GetVerb(), URL, Timeout);
+		}
+		else if (bTransferCompleted)
+		{
+			const std::string Error = GetTransferError();
+			if (!Error.empty())
+			{
+				LOG_INFO("{} {} failed: {}", GetVerb(), URL, Error);
+			}
+		}
+	}
+
+	MarkTransferResponseReady(bSucceeded);
+
+	Timings.Completed = GetHttpTimestamp();
+	PublishTimings();
+	HTTP_TRACE_EVENT(AsyncEnd("Completed", GetTraceId(), Timings.Completed));
+	ExecuteCompleteDelegate(bSucceeded ? GetTransferResponse() : nullptr);
+}
+
+void FHttpRequestBase::FinishCoalescedRequest(IHttpRequest& LeaderRequest)
+{
+	BorrowedResponse = LeaderRequest.GetResponse();
+	CompletionStatus = LeaderRequest.GetStatus();
+	ElapsedTime = LeaderRequest.GetElapsedTime();
+	const bool bSucceeded = CompletionStatus == EHttpRequestStatus::Succeeded;
+
+	// the network phases are the ones of the shared transfer
+	const int64_t Queued = Timings.Queued;
+	Timings = LeaderRequest.GetTimings();
+	Timings.Queued = Queued;
+	Timings.Completed = GetHttpTimestamp();
+	PublishTimings();
+	HTTP_TRACE_EVENT(AsyncEnd("Coalesced", GetTraceId(), Timings.Completed));
+	ExecuteCompleteDelegate(bSucceeded ? BorrowedResponse : nullptr);
+}
+
+void FHttpRequestBase::FinishCachedRequest(FHttpResponsePtr CachedResponse)
+{
+	if (bCanceled)
+	{
+		FinishRequest();
+		return;
+	}
+	BorrowedResponse = std::move(CachedResponse);
+	CompletionStatus = EHttpRequestStatus::Succeeded;
+	Timings.Completed = GetHttpTimestamp();
+	PublishTimings();
+	HTTP_TRACE_EVENT(AsyncEnd("Cached", GetTraceId(), Timings.Completed));
+	ExecuteCompleteDelegate(BorrowedResponse);
+}
+
+void FHttpRequestBase::ExecuteCompleteDelegate(FHttpResponsePtr CompletedResponse)
+{
+	if (RequestCompleteDelegate)
+	{
+		HTTP_TRACE_SCOPE("RequestCompleteDelegate");
+		RequestCompleteDelegate(shared_from_this(), std::move(CompletedResponse));
+	}
+}
+
+void FHttpRequestBase::PublishTimings()
+{
+	std::scoped_lock Lock(PublishedTimingsLock);
+	PublishedTimings = Timings;
+}
+
+bool FHttpRequestBase::PauseTransfer(bool bPause)
+{
+	return false;
+}
+
+bool FHttpRequestBase::ShouldPauseResponseStream() const
+{
+	if (bStreamPauseRequested)
+	{
+		return true;
+	}
+	if (!StreamExecutor)
+	{
+		return false;
+	}
+	// resume at half the limit so the transfer does not flip on every chunk
+	const size_t Queued = QueuedStreamBytes;
+	return bStreamPaused ? Queued > MaxQueuedStreamBytes / 2 : Queued > MaxQueuedStreamBytes;
+}
+
+void FHttpRequestBase::UpdateResponseStreamPause()
+{
+	const bool bShouldPause = ShouldPauseResponseStream();
+	if (bShouldPause != bStreamPaused && !bTransferCompleted)
+	{
+		// set first, resuming may deliver buffered data right away
+		bStreamPaused = bShouldPause;
+		if (!PauseTransfer(bShouldPause))
+		{
+			bStreamPaused = !bShouldPause;
+		}
+	}
+}
+
+void FHttpRequestBase::DeliverResponseStream(std::span<const uint8_t> Chunk)
+{
+	if (!StreamExecutor)
+	{
+		RequestStreamDelegate(shared_from_this(), Chunk);
+	}
+	else
+	{
+		// the chunk is only valid during the callback, the executor gets a copy
+		QueueResponseStream(Chunk.empty() ? nullptr : std::make_shared<const std::vector<uint8_t>>(Chunk.begin(), Chunk.end()));
+	}
+	if (!Chunk.empty())
+	{
+		UpdateResponseStreamPause();
+	}
+}
+
+void FHttpRequestBase::DeliverResponseStream(FHttpSharedBuffer Chunk)
+{
+	if (!Chunk || Chunk->empty())
+	{
+		return;
+	}
+	if (!StreamExecutor)
+	{
+		RequestStreamDelegate(shared_from_this(), std::span<const uint8_t>(*Chunk));
+	}
+	else
+	{
+		QueueResponseStream(std::move(Chunk));
+	}
+	UpdateResponseStreamPause();
+}
+
+void FHttpRequestBase::QueueResponseStream(FHttpSharedBuffer Chunk)
+{
+	QueuedStreamBytes += Chunk ? Chunk->size() : 0;
+	++QueuedStreamChunks;
+	bool bPostDrain = false;
+	{
+		std::scoped_lock Lock(StreamQueueLock);
+		StreamQueue.push_back(std::move(Chunk));
+		bPostDrain = !bStreamDrainPosted;
+		bStreamDrainPosted = true;
+	}
+	if (bPostDrain)
+	{
+		StreamExecutor([this, Self = shared_from_this()]()
+		{
+			DrainResponseStream();
+		});
+	}
+}
+
+void FHttpRequestBase::DrainResponseStream()
+{
+	std::shared_ptr<FHttpRequestBase> Self = shared_from_this();
+	for (;;)
+	{
+		FHttpSharedBuffer Chunk;
+		{
+			std::scoped_lock Lock(StreamQueueLock);
+			if (StreamQueue.empty())
+			{
+				bStreamDrainPosted = false;
+				return;
+			}
+			Chunk = std::move(StreamQueue.front());
+			StreamQueue.pop_front();
+		}
+		// a cancelled or timed out request completed without waiting for its body, what is left is dropped
+		if (!bCanceled && !bTimedOut)
+		{
+			RequestStreamDelegate(Self, Chunk ? std::span<const uint8_t>(*Chunk) : std::span<const uint8_t>());
+		}
+		const size_t Remaining = QueuedStreamBytes -= Chunk ? Chunk->size() : 0;
+		// the http thread completes the request once everything was delivered, or resumes the transfer once the backlog shrank
+		const bool bDelivered = --QueuedStreamChunks == 0 && bTransferCompleted;
+		if (bDelivered || (bStreamPaused && !bStreamPauseRequested && Remaining <= MaxQueuedStreamBytes / 2))
+		{
+			Manager.WakeUpThreadedRequest(Self);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#include "HttpRequestRegistry.h"
+#include <functional>
+
+FHttpRequestRegistry::FShard& FHttpRequestRegistry::GetShard(const IHttpRequest* RequestPtr) const
+{
+	// allocations are aligned, drop the low bits that never change
+	const size_t Hash = std::hash<uintptr_t>()(reinterpret_cast<uintptr_t>(RequestPtr) >> 4);
+	return Shards[(Hash ^ (Hash >> 7)) % ShardCount];
+}
+
+bool FHttpRequestRegistry::Add(const FHttpRequestPtr& Request, bool bTickable)
+{
+	FShard& Shard = GetShard(Request.get());
+	std::scoped_lock Lock(Shard.Lock);
+	auto [Itr, bInserted] = Shard.Indices.emplace(Request.get(), FIndices{ Shard.Requests.size(), bTickable ? Shard.TickableRequests.size() : NotTickable });
+	if (!bInserted)
+	{
+		return false;
+	}
+	Shard.Requests.push_back(Request);
+	++Count;
+	if (bTickable)
+	{
+		Shard.TickableRequests.push_back(Request);
+		++TickableCount;
+	}
+	return true;
+}
+
+FHttpRequestPtr FHttpRequestRegistry::Remove(const IHttpRequest* RequestPtr)
+{
+	FShard& Shard = GetShard(RequestPtr);
+	std::scoped_lock Lock(Shard.Lock);
+	auto Itr = Shard.Indices.find(RequestPtr);
+	if (Itr == Shard.Indices.end())
+	{
+		return nullptr;
+	}
+	const FIndices Removed = Itr->second;
+	Shard.Indices.erase(Itr);
+
+	FHttpRequestPtr Request = std::move(Shard.Requests[Removed.Index]);
+	if (Removed.Index + 1 != Shard.Requests.size())
+	{
+		Shard.Requests[Removed.Index] = std::move(Shard.Requests.back());
+		Shard.Indices[Shard.Requests[Removed.Index].get()].Index = Removed.Index;
+	}
+	Shard.Requests.pop_back();
+	--Count;
+
+	if (Removed.TickableIndex != NotTickable)
+	{
+		if (Removed.TickableIndex + 1 != Shard.TickableRequests.size())
+		{
+			Shard.TickableRequests[Removed.TickableIndex] = std::move(Shard.TickableRequests.back());
+			Shard.Indices[Shard.TickableRequests[Removed.TickableIndex].get()].TickableIndex = Removed.TickableIndex;
+		}
+		Shard.TickableRequests.pop_back();
+		--TickableCount;
+	}
+	return Request;
+}
+
+bool FHttpRequestRegistry::Contains(const IHttpRequest* RequestPtr) const
+{
+	FShard& Shard = GetShard(RequestPtr);
+	std::scoped_lock Lock(Shard.Lock);
+	return Shard.Indices.find(RequestPtr) != Shard.Indices.end();
+}
+
+void FHttpRequestRegistry::GetAll(std::vector<FHttpRequestPtr>& OutRequests) const
+{
+	OutRequests.reserve(OutRequests.size() + Num());
+	for (FShard& Shard : Shards)
+	{
+		std::scoped_lock Lock(Shard.Lock);
+		OutRequests.insert(OutRequests.end(), Shard.Requests.begin(), Shard.Requests.end());
+	}
+}
+
+void FHttpRequestRegistry::GetTickable(std::vector<FHttpRequestPtr>& OutRequests) const
+{
+	OutRequests.reserve(OutRequests.size() + NumTickable());
+	for (FShard& Shard : Shards)
+	{
+		std::scoped_lock Lock(Shard.Lock);
+		OutRequests.insert(OutRequests.end(), Shard.TickableRequests.begin(), Shard.TickableRequests.end());
+	}
+}
@@ -0,0 +1,163 @@
+#include "HttpRequestScheduler.h"
+#include "HttpUrl.h"
+#include <algorithm>
+#include <charconv>
+
+void FHttpRequestScheduler::SetLimits(uint32_t InMaxRunning, uint32_t InMaxRunningPerHost)
+{
+	MaxRunning = InMaxRunning;
+	MaxRunningPerHost = InMaxRunningPerHost;
+}
+
+void FHttpRequestScheduler::Enqueue(IHttpThreadedRequest* Request)
+{
+	// key hosts by the same host and port the connections are kept for
+	const std::string URL = Request->GetURL();
+	FUrlView Url;
+	FUrlView::Parse(URL, Url);
+	std::string Key(Url.Host);
+	char Port[8] = { ':' };
+	const auto [PortEnd, Error] = std::to_chars(Port + 1, Port + sizeof(Port), Url.GetPortOrDefault());
+	Key.append(Port, PortEnd);
+
+	std::unique_ptr<FHost>& HostPtr = Hosts[Key];
+	if (!HostPtr)
+	{
+		HostPtr = std::make_unique<FHost>();
+		HostPtr->Key = std::move(Key);
+	}
+	FHost* Host = HostPtr.get();
+
+	const EHttpRequestPriority::Type Priority = std::min(Request->GetPriority(), EHttpRequestPriority::Type(EHttpRequestPriority::Count - 1));
+	Host->Queues[Priority].push_back(Request);
+	if (!Host->bInTurnOrder[Priority])
+	{
+		Host->bInTurnOrder[Priority] = true;
+		TurnOrders[Priority].push_back(Host);
+	}
+	Requests[Request] = FRequestState{ Host, false };
+	++QueuedCount;
+}
+
+bool FHttpRequestScheduler::Remove(IHttpThreadedRequest* Request)
+{
+	auto Itr = Requests.find(Request);
+	if (Itr == Requests.end() || Itr->second.bRunning)
+	{
+		return false;
+	}
+	FHost* Host = Itr->second.Host;
+	Requests.erase(Itr);
+	for (std::deque<IHttpThreadedRequest*>& Queue : Host->Queues)
+	{
+		auto QueueItr = std::find(Queue.begin(), Queue.end(), Request);
+		if (QueueItr != Queue.end())
+		{
+			// the host leaves the turn order lazily once its turn comes with an empty queue
+			Queue.erase(QueueItr);
+			break;
+		}
+	}
+	--QueuedCount;
+	return true;
+}
+
+bool FHttpRequestScheduler::HasRoom(const FHost& Host) const
+{
+	return (MaxRunning == 0 || RunningCount < MaxRunning) && (MaxRunningPerHost == 0 || Host.Running < MaxRunningPerHost);
+}
+
+void FHttpRequestScheduler::DequeueStartable(std::vector<IHttpThreadedRequest*>& OutRequests)
+{
+	for (uint32_t Priority = 0; Priority < EHttpRequestPriority::Count && QueuedCount > 0; ++Priority)
+	{
+		std::deque<FHost*>& TurnOrder = TurnOrders[Priority];
+		// give every host of this priority one turn per round, until a round starts nothing
+		bool bStartedAny = true;
+		while (bStartedAny && !TurnOrder.empty() && (MaxRunning == 0 || RunningCount < MaxRunning))
+		{
+			bStartedAny = false;
+			for (size_t Turns = TurnOrder.size(); Turns > 0; --Turns)
+			{
+				FHost* Host = TurnOrder.front();
+				TurnOrder.pop_front();
+				std::deque<IHttpThreadedRequest*>& Queue = Host->Queues[Priority];
+				if (!Queue.empty() && HasRoom(*Host))
+				{
+					IHttpThreadedRequest* Request = Queue.front();
+					Queue.pop_front();
+					Requests[Request].bRunning = true;
+					++Host->Running;
+					++RunningCount;
+					--QueuedCount;
+					OutRequests.push_back(Request);
+					bStartedAny = true;
+				}
+				if (Queue.empty())
+				{
+					Host->bInTurnOrder[Priority] = false;
+					ReleaseHostIfUnused(Host);
+				}
+				else
+				{
+					TurnOrder.push_back(Host);
+				}
+			}
+		}
+		// a lower priority only gets the slots left once every host of this one is capped
+		if (MaxRunning != 0 && RunningCount >= MaxRunning)
+		{
+			break;
+		}
+	}
+}
+
+void FHttpRequestScheduler::Finish(IHttpThreadedRequest* Request)
+{
+	auto Itr = Requests.find(Request);
+	if (Itr == Requests.end() || !Itr->second.bRunning)
+	{
+		return;
+	}
+	FHost* Host = Itr->second.Host;
+	Requests.erase(Itr);
+	--Host->Running;
+	--RunningCount;
+	ReleaseHostIfUnused(Host);
+}
+
+bool FHttpRequestScheduler::HasStartable() const
+{
+	if (QueuedCount == 0 || (MaxRunning != 0 && RunningCount >= MaxRunning))
+	{
+		return false;
+	}
+	for (const std::deque<FHost*>& TurnOrder : TurnOrders)
+	{
+		for (const FHost* Host : TurnOrder)
+		{
+			if (HasRoom(*Host))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void FHttpRequestScheduler::ReleaseHostIfUnused(FHost* Host)
+{
+	if (Host->Running > 0)
+	{
+		return;
+	}
+	for (uint32_t Priority = 0; Priority < EHttpRequestPriority::Count; ++Priority)
+	{
+		if (Host->bInTurnOrder[Priority])
+		{
+			return;
+		}
+	}
+	// the key lives in the host, don't erase by it
+	Hosts.erase(Hosts.find(Host->Key));
+}
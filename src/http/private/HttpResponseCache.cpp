@@ -0,0 +1,1154 @@
+#include "HttpResponseCache.h"
+#include "HttpUrl.h"
+#include <logger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <charconv>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <thread>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static int64_t GetNowSeconds()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+static std::string_view TrimWhitespace(std::string_view Value)
+{
+	while (!Value.empty() && (Value.front() == ' ' || Value.front() == '\t'))
+	{
+		Value.remove_prefix(1);
+	}
+	while (!Value.empty() && (Value.back() == ' ' || Value.back() == '\t'))
+	{
+		Value.remove_suffix(1);
+	}
+	return Value;
+}
+
+/**
+ * Parse an IMF-fixdate, e.g. "Sun, 06 Nov 1994 08:49:37 GMT", into seconds since the epoch
+ */
+static bool ParseHttpDate(std::string_view Date, int64_t& OutSeconds)
+{
+	const size_t Comma = Date.find(", ");
+	if (Comma == std::string_view::npos || Date.size() < Comma + 2 + 24)
+	{
+		return false;
+	}
+	Date = Date.substr(Comma + 2);
+	static const char* Months[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+	int32_t Month = -1;
+	for (int32_t Index = 0; Index < 12; ++Index)
+	{
+		if (Date.substr(3, 3) == Months[Index])
+		{
+			Month = Index + 1;
+			break;
+		}
+	}
+	auto ParseNumber = [&Date](size_t Offset, size_t Length, int32_t& OutValue)
+	{
+		const char* End = Date.data() + Offset + Length;
+		return std::from_chars(Date.data() + Offset, End, OutValue).ptr == End;
+	};
+	int32_t Day = 0, Year = 0, Hour = 0, Minute = 0, Second = 0;
+	if (Month < 0 || !ParseNumber(0, 2, Day) || !ParseNumber(7, 4, Year) ||
+		!ParseNumber(12, 2, Hour) || !ParseNumber(15, 2, Minute) || !ParseNumber(18, 2, Second))
+	{
+		return false;
+	}
+
+	// days from civil, http://howardhinnant.github.io/date_algorithms.html
+	Year -= Month <= 2;
+	const int64_t Era = (Year >= 0 ? Year : Year - 399) / 400;
+	const int64_t YearOfEra = Year - Era * 400;
+	const int64_t DayOfYear = (153 * (Month + (Month > 2 ? -3 : 9)) + 2) / 5 + Day - 1;
+	const int64_t DayOfEra = YearOfEra * 365 + YearOfEra / 4 - YearOfEra / 100 + DayOfYear;
+	const int64_t Days = Era * 146097 + DayOfEra - 719468;
+	OutSeconds = Days * 86400 + Hour * 3600 + Minute * 60 + Second;
+	return true;
+}
+
+/**
+ * Find a directive of a Cache-Control header
+ *
+ * @param OutValue - receives the value of the directive without quotes, if it has one
+ */
+static bool FindCacheDirective(std::string_view CacheControl, std::string_view Name, std::string_view* OutValue = nullptr)
+{
+	while (!CacheControl.empty())
+	{
+		const size_t Comma = CacheControl.find(',');
+		std::string_view Directive = TrimWhitespace(CacheControl.substr(0, Comma));
+		CacheControl = Comma == std::string_view::npos ? std::string_view() : CacheControl.substr(Comma + 1);
+
+		const size_t Equals = Directive.find('=');
+		if (HttpHeaderNameEquals(TrimWhitespace(Directive.substr(0, Equals)), Name))
+		{
+			if (OutValue)
+			{
+				std::string_view Value = Equals == std::string_view::npos ? std::string_view() : TrimWhitespace(Directive.substr(Equals + 1));
+				if (Value.size() >= 2 && Value.front() == '"' && Value.back() == '"')
+				{
+					Value = Value.substr(1, Value.size() - 2);
+				}
+				*OutValue = Value;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool FindCacheDirectiveSeconds(std::string_view CacheControl, std::string_view Name, int64_t& OutSeconds)
+{
+	std::string_view Value;
+	return FindCacheDirective(CacheControl, Name, &Value) &&
+		std::from_chars(Value.data(), Value.data() + Value.size(), OutSeconds).ec == std::errc();
+}
+
+/**
+ * @return true if the request must neither be answered from the cache nor stored in it
+ */
+static bool IsCacheBypassed(IHttpRequest& Request)
+{
+	// the body goes to the stream delegate, there is nothing to store
+	if (Request.OnResponseStream())
+	{
+		return true;
+	}
+	// the caller manages validators and ranges itself
+	const FHttpHeaders& Headers = Request.GetHeaders();
+	if (Headers.Contains(EHttpHeader::IfNoneMatch) || Headers.Contains(EHttpHeader::IfModifiedSince) || Headers.Contains(EHttpHeader::Range))
+	{
+		return true;
+	}
+	return FindCacheDirective(Request.GetHeaderView("Cache-Control"), "no-store");
+}
+
+/**
+ * @return true if a response with this code may be stored when it has freshness information. A 206 only holds part of
+ * the resource, it is never stored under the URL.
+ */
+static bool IsCacheableResponseCode(int32_t ResponseCode)
+{
+	switch (ResponseCode)
+	{
+		case EHttpResponseCodes::Ok:
+		case EHttpResponseCodes::NoContent:
+		case EHttpResponseCodes::Moved:
+		case EHttpResponseCodes::NotFound:
+		case EHttpResponseCodes::Gone:
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Compute how long a response stays fresh, https://www.rfc-editor.org/rfc/rfc9111#section-4.2.1
+ */
+static int64_t ComputeFreshnessLifetime(const FHttpHeaders& Headers, int64_t ResponseDate)
+{
+	const std::string_view CacheControl = Headers.Find(EHttpHeader::CacheControl);
+	if (FindCacheDirective(CacheControl, "no-cache"))
+	{
+		return 0;
+	}
+	int64_t MaxAge = 0;
+	if (FindCacheDirectiveSeconds(CacheControl, "max-age", MaxAge))
+	{
+		return std::max<int64_t>(MaxAge, 0);
+	}
+	const std::string_view ExpiresHeader = Headers.Find(EHttpHeader::Expires);
+	if (!ExpiresHeader.empty())
+	{
+		// an invalid date means already expired
+		int64_t Expires = 0;
+		return ParseHttpDate(ExpiresHeader, Expires) ? std::max<int64_t>(Expires - ResponseDate, 0) : 0;
+	}
+	// heuristic freshness, a tenth of the time since the last modification, capped at a day
+	int64_t LastModified = 0;
+	if (ParseHttpDate(Headers.Find(EHttpHeader::LastModified), LastModified) && LastModified < ResponseDate)
+	{
+		return std::min<int64_t>((ResponseDate - LastModified) / 10, 86400);
+	}
+	return 0;
+}
+
+/**
+ * Set the time fields of an entry from the headers of the response that was just received
+ */
+static void UpdateEntryTimes(FHttpResponseCache::FEntry& Entry, int64_t Now)
+{
+	int64_t ResponseDate = Now;
+	ParseHttpDate(Entry.Headers.Find("Date"), ResponseDate);
+	int64_t Age = 0;
+	const std::string_view AgeHeader = Entry.Headers.Find("Age");
+	std::from_chars(AgeHeader.data(), AgeHeader.data() + AgeHeader.size(), Age);
+	Entry.ResponseTime = Now - std::max<int64_t>(Age, 0);
+	Entry.FreshnessLifetime = ComputeFreshnessLifetime(Entry.Headers, ResponseDate);
+}
+
+static void ComputeEntryBytes(FHttpResponseCache::FEntry& Entry)
+{
+	Entry.Bytes = sizeof(FHttpResponseCache::FEntry) + Entry.URL.size() + (Entry.Body ? Entry.Body->size() : 0);
+	for (const FHttpHeaders::FHeader Header : Entry.Headers)
+	{
+		Entry.Bytes += Header.Name.size() + Header.Value.size() + 16;
+	}
+	for (const auto& [Name, Value] : Entry.Vary)
+	{
+		Entry.Bytes += Name.size() + Value.size() + 2 * sizeof(std::string);
+	}
+}
+
+/**
+ * Read only memory mapping of a whole file
+ */
+class FHttpMappedFile
+{
+public:
+	FHttpMappedFile() = default;
+	FHttpMappedFile(const FHttpMappedFile&) = delete;
+	FHttpMappedFile& operator=(const FHttpMappedFile&) = delete;
+
+	~FHttpMappedFile()
+	{
+		Unmap();
+	}
+
+	bool Map(const std::string& Path, size_t InSize)
+	{
+		Unmap();
+		if (InSize == 0)
+		{
+			return false;
+		}
+#ifdef _WIN32
+		HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		HANDLE Mapping = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(File);
+		if (Mapping == nullptr)
+		{
+			return false;
+		}
+		void* View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, InSize);
+		CloseHandle(Mapping);
+		if (View == nullptr)
+		{
+			return false;
+		}
+#else
+		const int File = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (File < 0)
+		{
+			return false;
+		}
+		void* View = mmap(nullptr, InSize, PROT_READ, MAP_SHARED, File, 0);
+		close(File);
+		if (View == MAP_FAILED)
+		{
+			return false;
+		}
+#endif
+		Data = static_cast<const uint8_t*>(View);
+		Size = InSize;
+		return true;
+	}
+
+	void Unmap()
+	{
+		if (Data)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(Data);
+#else
+			munmap(const_cast<uint8_t*>(Data), Size);
+#endif
+			Data = nullptr;
+			Size = 0;
+		}
+	}
+
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+};
+
+/**
+ * On-disk store of cache entries. Entries are appended to segment files as records, a record for the same URL
+ * replaces the previous one, and the oldest segment is deleted once the store is over its size.
+ * Segments are read through memory mappings. Thread safe: writes and removals are queued and appended by a writer
+ * thread so the cache never waits on the file system under its lock, and reads see the queued ones first.
+ */
+class FHttpDiskCacheStore
+{
+public:
+	typedef std::shared_ptr<FHttpResponseCache::FEntry> FEntryPtr;
+
+	FHttpDiskCacheStore(const std::string& InDirectory, uint64_t InMaxBytes, uint32_t InSegmentBytes)
+		: Directory(InDirectory)
+		, MaxBytes(InMaxBytes)
+		, SegmentBytes(std::max<uint32_t>(InSegmentBytes, 4096))
+	{
+		std::error_code Error;
+		std::filesystem::create_directories(Directory, Error);
+		for (const std::filesystem::directory_entry& File : std::filesystem::directory_iterator(Directory, Error))
+		{
+			const std::string Name = File.path().filename().string();
+			uint32_t SegmentId = 0;
+			if (File.path().extension() == ".seg" && std::from_chars(Name.data(), Name.data() + Name.size(), SegmentId).ec == std::errc())
+			{
+				Segments[SegmentId].FileSize = File.file_size(Error);
+			}
+		}
+		// rebuild the index, later records replace earlier ones
+		uint64_t Bytes = 0;
+		for (auto& [SegmentId, Segment] : Segments)
+		{
+			ScanSegment(SegmentId, Segment);
+			Bytes += Segment.FileSize;
+			NextSegmentId = SegmentId + 1;
+		}
+		TotalBytes = Bytes;
+		WriterThread = std::thread([this]() { WriterLoop(); });
+	}
+
+	~FHttpDiskCacheStore()
+	{
+		{
+			std::scoped_lock Lock(QueueLock);
+			bExitRequested = true;
+		}
+		QueueEvent.notify_one();
+		WriterThread.join();
+		CloseActiveFile();
+	}
+
+	/** Queue the entry to be written, it replaces the record of its URL */
+	void Write(const FEntryPtr& Entry)
+	{
+		Enqueue(Entry->URL, Entry);
+	}
+
+	/** Queue the removal of the record of a URL */
+	void Remove(const std::string& URL)
+	{
+		Enqueue(URL, nullptr);
+	}
+
+	FEntryPtr Read(const std::string& URL)
+	{
+		{
+			std::scoped_lock Lock(QueueLock);
+			auto PendingItr = PendingByURL.find(URL);
+			if (PendingItr != PendingByURL.end())
+			{
+				// not written yet, nullptr for a queued removal
+				return PendingItr->second;
+			}
+		}
+
+		std::scoped_lock Lock(StoreLock);
+		auto Itr = Index.find(URL);
+		if (Itr == Index.end())
+		{
+			return nullptr;
+		}
+		FLocation& Location = Itr->second;
+		if (FEntryPtr Loaded = Location.Loaded.lock())
+		{
+			// still alive since it was written or last read, share it rather than copying the body again
+			return Loaded;
+		}
+		FSegment& Segment = Segments[Location.SegmentId];
+		if (Segment.Mapping.Size < Location.Offset + Location.Size)
+		{
+			// the active segment grew since it was mapped
+			if (Location.SegmentId == ActiveSegmentId && ActiveFile)
+			{
+				std::fflush(ActiveFile);
+			}
+			Segment.Mapping.Map(GetSegmentPath(Location.SegmentId), size_t(Segment.FileSize));
+		}
+		FEntryPtr Entry = std::make_shared<FHttpResponseCache::FEntry>();
+		bool bRemoved = false;
+		if (Segment.Mapping.Size < Location.Offset + Location.Size ||
+			!DeserializeRecord(std::span<const uint8_t>(Segment.Mapping.Data + Location.Offset, Location.Size), *Entry, bRemoved) || bRemoved)
+		{
+			Index.erase(Itr);
+			return nullptr;
+		}
+		Location.Loaded = Entry;
+		return Entry;
+	}
+
+	void Clear()
+	{
+		{
+			std::scoped_lock Lock(QueueLock);
+			Queue.clear();
+			PendingByURL.clear();
+			++ClearCount;
+		}
+		std::scoped_lock Lock(StoreLock);
+		CloseActiveFile();
+		for (auto& [SegmentId, Segment] : Segments)
+		{
+			Segment.Mapping.Unmap();
+			std::error_code Error;
+			std::filesystem::remove(GetSegmentPath(SegmentId), Error);
+		}
+		Segments.clear();
+		Index.clear();
+		TotalBytes = 0;
+	}
+
+	uint64_t GetBytes() const
+	{
+		return TotalBytes;
+	}
+
+private:
+	static constexpr uint32_t RecordMagic = 0x31435248; // "HRC1"
+	static constexpr size_t RecordHeaderSize = 8;
+
+	struct FLocation
+	{
+		uint32_t SegmentId;
+		uint64_t Offset;
+		uint64_t Size;
+		/** Entry of the record while something holds it, so repeated reads share one copy of the body */
+		std::weak_ptr<FHttpResponseCache::FEntry> Loaded;
+	};
+
+	struct FSegment
+	{
+		uint64_t FileSize = 0;
+		FHttpMappedFile Mapping;
+	};
+
+	/** A write, or a removal when Entry is nullptr */
+	struct FPendingWrite
+	{
+		std::string URL;
+		FEntryPtr Entry;
+	};
+
+	std::string GetSegmentPath(uint32_t SegmentId) const
+	{
+		char Name[32];
+		std::snprintf(Name, sizeof(Name), "%08u.seg", SegmentId);
+		return (std::filesystem::path(Directory) / Name).string();
+	}
+
+	void CloseActiveFile()
+	{
+		if (ActiveFile)
+		{
+			std::fclose(ActiveFile);
+			ActiveFile = nullptr;
+		}
+	}
+
+	void Enqueue(const std::string& URL, FEntryPtr Entry)
+	{
+		{
+			std::scoped_lock Lock(QueueLock);
+			PendingByURL[URL] = Entry;
+			Queue.push_back(FPendingWrite{ URL, std::move(Entry) });
+		}
+		QueueEvent.notify_one();
+	}
+
+	void WriterLoop()
+	{
+		std::unique_lock Lock(QueueLock);
+		for (;;)
+		{
+			QueueEvent.wait(Lock, [this]() { return bExitRequested || !Queue.empty(); });
+			if (Queue.empty())
+			{
+				// exit once everything queued is written
+				return;
+			}
+			FPendingWrite Pending = std::move(Queue.front());
+			Queue.pop_front();
+			const uint32_t PendingClearCount = ClearCount;
+			Lock.unlock();
+			{
+				std::scoped_lock StoreGuard(StoreLock);
+				// a Clear since it was queued dropped it
+				if (PendingClearCount == ClearCount.load())
+				{
+					if (Pending.Entry)
+					{
+						AppendEntry(Pending.Entry);
+					}
+					else
+					{
+						AppendTombstone(Pending.URL);
+					}
+				}
+			}
+			Lock.lock();
+			// readers find it in the index now, unless it was queued again meanwhile
+			auto PendingItr = PendingByURL.find(Pending.URL);
+			if (PendingItr != PendingByURL.end() && PendingItr->second == Pending.Entry)
+			{
+				PendingByURL.erase(PendingItr);
+			}
+			if (Queue.empty())
+			{
+				// caught up, hand what was written to the system
+				Lock.unlock();
+				{
+					std::scoped_lock StoreGuard(StoreLock);
+					if (ActiveFile)
+					{
+						std::fflush(ActiveFile);
+					}
+				}
+				Lock.lock();
+			}
+		}
+	}
+
+	void AppendEntry(const FEntryPtr& Entry)
+	{
+		std::vector<uint8_t> Record;
+		SerializeRecord(*Entry, false, Record);
+		// the body is written straight from the entry rather than copied into the record
+		const size_t BodySize = Entry->Body ? Entry->Body->size() : 0;
+		if (Append(Record, BodySize ? std::span<const uint8_t>(*Entry->Body) : std::span<const uint8_t>()))
+		{
+			Index[Entry->URL] = FLocation{ ActiveSegmentId, Segments[ActiveSegmentId].FileSize - Record.size() - BodySize + RecordHeaderSize, Record.size() + BodySize - RecordHeaderSize, Entry };
+			EvictOldestSegments();
+		}
+	}
+
+	void AppendTombstone(const std::string& URL)
+	{
+		auto Itr = Index.find(URL);
+		if (Itr == Index.end())
+		{
+			return;
+		}
+		Index.erase(Itr);
+		// a tombstone keeps the entry from coming back when the index is rebuilt
+		FHttpResponseCache::FEntry Tombstone;
+		Tombstone.URL = URL;
+		std::vector<uint8_t> Record;
+		SerializeRecord(Tombstone, true, Record);
+		if (Append(Record, std::span<const uint8_t>()))
+		{
+			EvictOldestSegments();
+		}
+	}
+
+	/** Append a record made of its serialized fields followed by the body. StoreLock must be held. */
+	bool Append(const std::vector<uint8_t>& Record, std::span<const uint8_t> Body)
+	{
+		const size_t Size = Record.size() + Body.size();
+		if (!ActiveFile || Segments[ActiveSegmentId].FileSize + Size > SegmentBytes)
+		{
+			CloseActiveFile();
+			ActiveSegmentId = NextSegmentId++;
+			ActiveFile = std::fopen(GetSegmentPath(ActiveSegmentId).c_str(), "ab");
+			if (!ActiveFile)
+			{
+				LOG_ERROR("FHttpResponseCache - could not create a cache segment in {}", Directory);
+				return false;
+			}
+			Segments[ActiveSegmentId];
+		}
+		FSegment& Segment = Segments[ActiveSegmentId];
+		if (std::fwrite(Record.data(), 1, Record.size(), ActiveFile) != Record.size() ||
+			std::fwrite(Body.data(), 1, Body.size(), ActiveFile) != Body.size())
+		{
+			LOG_ERROR("FHttpResponseCache - could not write to a cache segment in {}", Directory);
+			CloseActiveFile();
+			return false;
+		}
+		Segment.FileSize += Size;
+		TotalBytes += Size;
+		return true;
+	}
+
+	/** Drop the oldest segments, never the one being written. StoreLock must be held. */
+	void EvictOldestSegments()
+	{
+		while (TotalBytes > MaxBytes && Segments.size() > 1)
+		{
+			auto Oldest = Segments.begin();
+			const uint32_t SegmentId = Oldest->first;
+			Oldest->second.Mapping.Unmap();
+			TotalBytes -= Oldest->second.FileSize;
+			Segments.erase(Oldest);
+			std::error_code Error;
+			std::filesystem::remove(GetSegmentPath(SegmentId), Error);
+			std::erase_if(Index, [SegmentId](const auto& Item) { return Item.second.SegmentId == SegmentId; });
+		}
+	}
+
+	void ScanSegment(uint32_t SegmentId, FSegment& Segment)
+	{
+		if (!Segment.Mapping.Map(GetSegmentPath(SegmentId), size_t(Segment.FileSize)))
+		{
+			return;
+		}
+		uint64_t Offset = 0;
+		while (Offset + RecordHeaderSize <= Segment.Mapping.Size)
+		{
+			uint32_t Magic = 0;
+			uint32_t Size = 0;
+			std::memcpy(&Magic, Segment.Mapping.Data + Offset, 4);
+			std::memcpy(&Size, Segment.Mapping.Data + Offset + 4, 4);
+			if (Magic != RecordMagic || Offset + RecordHeaderSize + Size > Segment.Mapping.Size)
+			{
+				// torn write at the end of the segment
+				break;
+			}
+			FHttpResponseCache::FEntry Entry;
+			bool bRemoved = false;
+			if (DeserializeRecord(std::span<const uint8_t>(Segment.Mapping.Data + Offset + RecordHeaderSize, Size), Entry, bRemoved))
+			{
+				if (bRemoved)
+				{
+					Index.erase(Entry.URL);
+				}
+				else
+				{
+					Index[Entry.URL] = FLocation{ SegmentId, Offset + RecordHeaderSize, Size, {} };
+				}
+			}
+			Offset += RecordHeaderSize + Size;
+		}
+	}
+
+	static void WriteBytes(std::vector<uint8_t>& Out, const void* Data, size_t Size)
+	{
+		const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+		Out.insert(Out.end(), Bytes, Bytes + Size);
+	}
+
+	template<typename T>
+	static void WriteValue(std::vector<uint8_t>& Out, T Value)
+	{
+		WriteBytes(Out, &Value, sizeof(Value));
+	}
+
+	static void WriteString(std::vector<uint8_t>& Out, std::string_view Value)
+	{
+		WriteValue<uint32_t>(Out, uint32_t(Value.size()));
+		WriteBytes(Out, Value.data(), Value.size());
+	}
+
+	/** Serialize every field of a record up to the body, its size accounts for the body that follows */
+	static void SerializeRecord(const FHttpResponseCache::FEntry& Entry, bool bRemoved, std::vector<uint8_t>& Out)
+	{
+		WriteValue<uint32_t>(Out, RecordMagic);
+		WriteValue<uint32_t>(Out, 0);
+		WriteValue<uint8_t>(Out, bRemoved ? 1 : 0);
+		WriteString(Out, Entry.URL);
+		WriteValue<int32_t>(Out, Entry.ResponseCode);
+		WriteValue<int64_t>(Out, Entry.ResponseTime);
+		WriteValue<int64_t>(Out, Entry.FreshnessLifetime);
+		WriteValue<uint32_t>(Out, uint32_t(Entry.Headers.Num()));
+		for (const FHttpHeaders::FHeader Header : Entry.Headers)
+		{
+			WriteString(Out, Header.Name);
+			WriteString(Out, Header.Value);
+		}
+		WriteValue<uint32_t>(Out, uint32_t(Entry.Vary.size()));
+		for (const auto& [Name, Value] : Entry.Vary)
+		{
+			WriteString(Out, Name);
+			WriteString(Out, Value);
+		}
+		const size_t BodySize = Entry.Body ? Entry.Body->size() : 0;
+		WriteValue<uint64_t>(Out, BodySize);
+		const uint32_t Size = uint32_t(Out.size() + BodySize - RecordHeaderSize);
+		std::memcpy(Out.data() + 4, &Size, 4);
+	}
+
+	/** Reads a record, every read is bounds checked so a corrupt file can't crash */
+	struct FRecordReader
+	{
+		std::span<const uint8_t> Data;
+		bool bValid = true;
+
+		template<typename T>
+		T ReadValue()
+		{
+			T Value{};
+			if (Data.size() < sizeof(T))
+			{
+				bValid = false;
+				return Value;
+			}
+			std::memcpy(&Value, Data.data(), sizeof(T));
+			Data = Data.subspan(sizeof(T));
+			return Value;
+		}
+
+		std::string_view ReadString()
+		{
+			const uint32_t Size = ReadValue<uint32_t>();
+			if (!bValid || Data.size() < Size)
+			{
+				bValid = false;
+				return std::string_view();
+			}
+			std::string_view Value(reinterpret_cast<const char*>(Data.data()), Size);
+			Data = Data.subspan(Size);
+			return Value;
+		}
+	};
+
+	static bool DeserializeRecord(std::span<const uint8_t> Record, FHttpResponseCache::FEntry& OutEntry, bool& bOutRemoved)
+	{
+		FRecordReader Reader{ Record };
+		bOutRemoved = Reader.ReadValue<uint8_t>() != 0;
+		OutEntry.URL = Reader.ReadString();
+		OutEntry.ResponseCode = Reader.ReadValue<int32_t>();
+		OutEntry.ResponseTime = Reader.ReadValue<int64_t>();
+		OutEntry.FreshnessLifetime = Reader.ReadValue<int64_t>();
+		for (uint32_t Count = Reader.ReadValue<uint32_t>(); Count > 0 && Reader.bValid; --Count)
+		{
+			const std::string_view Name = Reader.ReadString();
+			const std::string_view Value = Reader.ReadString();
+			OutEntry.Headers.Append(Name, Value);
+		}
+		for (uint32_t Count = Reader.ReadValue<uint32_t>(); Count > 0 && Reader.bValid; --Count)
+		{
+			const std::string_view Name = Reader.ReadString();
+			const std::string_view Value = Reader.ReadString();
+			OutEntry.Vary.emplace_back(Name, Value);
+		}
+		const uint64_t BodySize = Reader.ReadValue<uint64_t>();
+		if (!Reader.bValid || Reader.Data.size() < BodySize)
+		{
+			return false;
+		}
+		OutEntry.Body = std::make_shared<const std::vector<uint8_t>>(Reader.Data.begin(), Reader.Data.begin() + BodySize);
+		ComputeEntryBytes(OutEntry);
+		return true;
+	}
+
+	std::string Directory;
+	uint64_t MaxBytes;
+	uint32_t SegmentBytes;
+
+	/** Guards the segments, the index and the active file */
+	std::mutex StoreLock;
+	/** Segment files by id, oldest first */
+	std::map<uint32_t, FSegment> Segments;
+	/** Location of the latest record of each URL */
+	std::unordered_map<std::string, FLocation> Index;
+	/** Bytes of every segment, read without the lock by GetBytes */
+	std::atomic<uint64_t> TotalBytes = 0;
+	uint32_t NextSegmentId = 0;
+	uint32_t ActiveSegmentId = 0;
+	std::FILE* ActiveFile = nullptr;
+
+	/** Guards the queue of writes */
+	std::mutex QueueLock;
+	/** Signaled when a write is queued or the writer has to exit */
+	std::condition_variable QueueEvent;
+	/** Writes and removals not appended yet, oldest first */
+	std::deque<FPendingWrite> Queue;
+	/** Latest queued entry of each URL not written yet, nullptr for a removal */
+	std::unordered_map<std::string, FEntryPtr> PendingByURL;
+	/** Number of Clear calls, a write queued before one is dropped */
+	std::atomic<uint32_t> ClearCount = 0;
+	bool bExitRequested = false;
+	/** Appends the queued writes to the segments */
+	std::thread WriterThread;
+};
+
+FHttpCachedResponse::FHttpCachedResponse(const std::string& InURL, int32_t InResponseCode, const FHttpHeaders& InHeaders, FHttpSharedBuffer InBody)
+	: URL(InURL)
+	, ResponseCode(InResponseCode)
+	, Headers(InHeaders)
+	, Body(std::move(InBody))
+{
+	if (!Body)
+	{
+		Body = std::make_shared<const std::vector<uint8_t>>();
+	}
+}
+
+std::string FHttpCachedResponse::GetURL()
+{
+	return URL;
+}
+
+std::string FHttpCachedResponse::GetURLParameter(const std::string& ParameterName)
+{
+	FUrlView Url;
+	std::string_view Value;
+	if (FUrlView::Parse(URL, Url) && FindUrlQueryParameter(Url.Query, ParameterName, Value))
+	{
+		return std::string(Value);
+	}
+	return std::string();
+}
+
+std::string FHttpCachedResponse::GetHeader(const std::string& HeaderName)
+{
+	return std::string(Headers.Find(HeaderName));
+}
+
+std::string_view FHttpCachedResponse::GetHeaderView(std::string_view HeaderName)
+{
+	return Headers.Find(HeaderName);
+}
+
+const FHttpHeaders& FHttpCachedResponse::GetHeaders()
+{
+	return Headers;
+}
+
+std::vector<std::string> FHttpCachedResponse::GetAllHeaders()
+{
+	return Headers.ToStrings();
+}
+
+std::string FHttpCachedResponse::GetContentType()
+{
+	return GetHeader("Content-Type");
+}
+
+int32_t FHttpCachedResponse::GetContentLength()
+{
+	return int32_t(Body->size());
+}
+
+const std::vector<uint8_t>& FHttpCachedResponse::GetContent()
+{
+	return *Body;
+}
+
+int32_t FHttpCachedResponse::GetResponseCode()
+{
+	return ResponseCode;
+}
+
+std::string FHttpCachedResponse::GetContentAsString()
+{
+	return std::string(reinterpret_cast<const char*>(Body->data()), Body->size());
+}
+
+EHttpVersion::Type FHttpCachedResponse::GetHttpVersion()
+{
+	return EHttpVersion::Default;
+}
+
+FHttpResponseCache::FHttpResponseCache(const FHttpResponseCacheSettings& InSettings)
+	: Settings(InSettings)
+{
+	if (!Settings.DiskDirectory.empty())
+	{
+		DiskStore = std::make_unique<FHttpDiskCacheStore>(Settings.DiskDirectory, Settings.MaxDiskBytes, Settings.SegmentBytes);
+	}
+}
+
+FHttpResponseCache::~FHttpResponseCache()
+{
+}
+
+FHttpResponsePtr FHttpResponseCache::BeginRequest(IHttpRequest& Request, FHttpHeaders& OutValidators)
+{
+	if (Request.GetVerb() != "GET" || IsCacheBypassed(Request))
+	{
+		return nullptr;
+	}
+	const std::string_view RequestCacheControl = Request.GetHeaderView("Cache-Control");
+	const bool bForceRevalidate = FindCacheDirective(RequestCacheControl, "no-cache") || Request.GetHeaderView("Pragma") == "no-cache";
+
+	const std::string URL = Request.GetURL();
+	std::unique_lock Lock(CacheLock);
+	FEntryPtr Entry = FindEntry(URL);
+	if (!Entry && DiskStore)
+	{
+		// read the disk without holding up the other requests, what was stored or removed meanwhile wins
+		const uint64_t Generation = EntryGeneration;
+		Lock.unlock();
+		Entry = DiskStore->Read(URL);
+		Lock.lock();
+		if (Generation != EntryGeneration)
+		{
+			Entry = FindEntry(URL);
+		}
+		else if (Entry)
+		{
+			InsertEntry(Entry);
+		}
+	}
+	if (Entry)
+	{
+		for (const auto& [Name, Value] : Entry->Vary)
+		{
+			if (Request.GetHeaderView(Name) != Value)
+			{
+				Entry = nullptr;
+				break;
+			}
+		}
+	}
+	if (!Entry)
+	{
+		++Stats.Misses;
+		return nullptr;
+	}
+
+	const int64_t CurrentAge = GetNowSeconds() - Entry->ResponseTime;
+	if (!bForceRevalidate && CurrentAge < Entry->FreshnessLifetime)
+	{
+		++Stats.Hits;
+		return std::make_shared<FHttpCachedResponse>(Entry->URL, Entry->ResponseCode, Entry->Headers, Entry->Body);
+	}
+
+	// stale, ask the server whether it changed
+	const std::string_view ETag = Entry->Headers.Find(EHttpHeader::ETag);
+	if (!ETag.empty())
+	{
+		OutValidators.Set("If-None-Match", ETag);
+	}
+	const std::string_view LastModified = Entry->Headers.Find(EHttpHeader::LastModified);
+	if (!LastModified.empty())
+	{
+		OutValidators.Set("If-Modified-Since", LastModified);
+	}
+	if (OutValidators.Num() > 0)
+	{
+		PendingRequests[&Request] = Entry;
+	}
+	else
+	{
+		++Stats.Misses;
+	}
+	return nullptr;
+}
+
+FHttpResponsePtr FHttpResponseCache::EndRequest(IHttpRequest& Request, bool bSucceeded)
+{
+	const std::string Verb = Request.GetVerb();
+	std::scoped_lock Lock(CacheLock);
+
+	FEntryPtr Validated;
+	auto PendingItr = PendingRequests.find(&Request);
+	if (PendingItr != PendingRequests.end())
+	{
+		Validated = std::move(PendingItr->second);
+		PendingRequests.erase(PendingItr);
+	}
+
+	FHttpResponsePtr Response = Request.GetResponse();
+	if (!bSucceeded || !Response)
+	{
+		return nullptr;
+	}
+	const int32_t ResponseCode = Response->GetResponseCode();
+	const std::string URL = Request.GetURL();
+	if (Validated && Validated->URL != URL)
+	{
+		// the validators were sent for another URL, the request was reused without going through BeginRequest
+		Validated = nullptr;
+	}
+
+	if (Verb != "GET" && Verb != "HEAD")
+	{
+		// a successful unsafe request invalidates what is cached for its URL
+		if (ResponseCode >= 200 && ResponseCode < 400)
+		{
+			RemoveEntry(URL);
+		}
+		return nullptr;
+	}
+	// like BeginRequest, leave what is cached alone, e.g. a 304 to the validators of the caller says nothing about it
+	if (Verb != "GET" || IsCacheBypassed(Request))
+	{
+		return nullptr;
+	}
+
+	const int64_t Now = GetNowSeconds();
+	if (ResponseCode == EHttpResponseCodes::NotModified && Validated)
+	{
+		// refresh the stored response with the headers of the 304, its body is still good
+		FEntryPtr Refreshed = std::make_shared<FEntry>(*Validated);
+		for (const FHttpHeaders::FHeader Header : Response->GetHeaders())
+		{
+			if (!HttpHeaderNameEquals(Header.Name, "Content-Length"))
+			{
+				Refreshed->Headers.Set(Header.Name, Header.Value);
+			}
+		}
+		UpdateEntryTimes(*Refreshed, Now);
+		ComputeEntryBytes(*Refreshed);
+		InsertEntry(Refreshed);
+		if (DiskStore)
+		{
+			DiskStore->Write(Refreshed);
+		}
+		++Stats.Revalidations;
+		return std::make_shared<FHttpCachedResponse>(Refreshed->URL, Refreshed->ResponseCode, Refreshed->Headers, Refreshed->Body);
+	}
+	if (Validated)
+	{
+		++Stats.Misses;
+	}
+
+	if (ResponseCode == EHttpResponseCodes::Partial)
+	{
+		// a range the server answered on its own, the stored response is still the whole resource
+		return nullptr;
+	}
+	const FHttpHeaders& ResponseHeaders = Response->GetHeaders();
+	const std::string_view CacheControl = ResponseHeaders.Find(EHttpHeader::CacheControl);
+	const std::string_view VaryHeader = ResponseHeaders.Find("Vary");
+	if (!IsCacheableResponseCode(ResponseCode) || FindCacheDirective(CacheControl, "no-store") || TrimWhitespace(VaryHeader) == "*")
+	{
+		RemoveEntry(URL);
+		return nullptr;
+	}
+
+	FEntryPtr Entry = std::make_shared<FEntry>();
+	Entry->URL = URL;
+	Entry->ResponseCode = ResponseCode;
+	Entry->Headers = ResponseHeaders;
+	UpdateEntryTimes(*Entry, Now);
+	// nothing to revalidate with and never fresh, there is no point keeping it
+	if (Entry->FreshnessLifetime == 0 && !ResponseHeaders.Contains(EHttpHeader::ETag) && !ResponseHeaders.Contains(EHttpHeader::LastModified))
+	{
+		RemoveEntry(URL);
+		return nullptr;
+	}
+	Entry->Body = std::make_shared<const std::vector<uint8_t>>(Response->GetContent());
+	for (std::string_view Vary = VaryHeader; !Vary.empty();)
+	{
+		const size_t Comma = Vary.find(',');
+		const std::string_view Name = TrimWhitespace(Vary.substr(0, Comma));
+		Vary = Comma == std::string_view::npos ? std::string_view() : Vary.substr(Comma + 1);
+		if (!Name.empty())
+		{
+			Entry->Vary.emplace_back(Name, Request.GetHeaderView(Name));
+		}
+	}
+	ComputeEntryBytes(*Entry);
+	if (Entry->Bytes > Settings.MaxMemoryBytes && !DiskStore)
+	{
+		return nullptr;
+	}
+	InsertEntry(Entry);
+	if (DiskStore)
+	{
+		DiskStore->Write(Entry);
+	}
+	++Stats.Stores;
+	return nullptr;
+}
+
+void FHttpResponseCache::AbandonRequest(const IHttpRequest& Request)
+{
+	std::scoped_lock Lock(CacheLock);
+	PendingRequests.erase(&Request);
+}
+
+void FHttpResponseCache::Clear()
+{
+	// the disk first, a disk read started before it finishes is then dropped for the generation change
+	if (DiskStore)
+	{
+		DiskStore->Clear();
+	}
+	std::scoped_lock Lock(CacheLock);
+	Lru.clear();
+	Entries.clear();
+	MemoryBytes = 0;
+	++EntryGeneration;
+}
+
+FHttpResponseCacheStats FHttpResponseCache::GetStats() const
+{
+	std::scoped_lock Lock(CacheLock);
+	FHttpResponseCacheStats Result = Stats;
+	Result.MemoryBytes = MemoryBytes;
+	Result.DiskBytes = DiskStore ? DiskStore->GetBytes() : 0;
+	return Result;
+}
+
+FHttpResponseCache::FEntryPtr FHttpResponseCache::FindEntry(const std::string& URL)
+{
+	auto Itr = Entries.find(URL);
+	if (Itr != Entries.end())
+	{
+		Lru.splice(Lru.begin(), Lru, Itr->second);
+		return *Itr->second;
+	}
+	return nullptr;
+}
+
+void FHttpResponseCache::InsertEntry(const FEntryPtr& Entry)
+{
+	++EntryGeneration;
+	RemoveEntryFromMemory(Entry->URL);
+	if (Entry->Bytes > Settings.MaxMemoryBytes)
+	{
+		// too big for memory, only kept on disk
+		return;
+	}
+	Lru.push_front(Entry);
+	Entries[Entry->URL] = Lru.begin();
+	MemoryBytes += Entry->Bytes;
+	while (MemoryBytes > Settings.MaxMemoryBytes)
+	{
+		const FEntryPtr& Oldest = Lru.back();
+		MemoryBytes -= Oldest->Bytes;
+		Entries.erase(Oldest->URL);
+		Lru.pop_back();
+	}
+}
+
+void FHttpResponseCache::RemoveEntryFromMemory(const std::string& URL)
+{
+	auto Itr = Entries.find(URL);
+	if (Itr != Entries.end())
+	{
+		MemoryBytes -= (*Itr->second)->Bytes;
+		Lru.erase(Itr->second);
+		Entries.erase(Itr);
+	}
+}
+
+void FHttpResponseCache::RemoveEntry(const std::string& URL)
+{
+	++EntryGeneration;
+	RemoveEntryFromMemory(URL);
+	if (DiskStore)
+	{
+		DiskStore->Remove(URL);
+	}
+}
@@ -0,0 +1,332 @@
+#include "HttpResponseParser.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+/** Longest chunk size or trailer line accepted */
+static constexpr size_t MaxLineSize = 8 * 1024;
+
+static std::string_view TrimHttpWhitespace(std::string_view Value)
+{
+	while (!Value.empty() && (Value.front() == ' ' || Value.front() == '\t'))
+	{
+		Value.remove_prefix(1);
+	}
+	while (!Value.empty() && (Value.back() == ' ' || Value.back() == '\t'))
+	{
+		Value.remove_suffix(1);
+	}
+	return Value;
+}
+
+/** @return true if a comma separated header value holds a token, compared case-insensitively */
+static bool HttpHeaderListContains(std::string_view Value, std::string_view Token)
+{
+	while (!Value.empty())
+	{
+		const size_t Comma = Value.find(',');
+		if (HttpHeaderNameEquals(TrimHttpWhitespace(Value.substr(0, Comma)), Token))
+		{
+			return true;
+		}
+		if (Comma == std::string_view::npos)
+		{
+			break;
+		}
+		Value.remove_prefix(Comma + 1);
+	}
+	return false;
+}
+
+FHttpResponseParser::FHttpResponseParser()
+{
+	Reset(false);
+}
+
+void FHttpResponseParser::Reset(bool bInHeadRequest)
+{
+	State = EState::Head;
+	bHeadRequest = bInHeadRequest;
+	bKeepAlive = false;
+	HttpVersion = EHttpVersion::Http1_1;
+	RemainingBytes = 0;
+	ReceivedBytes = 0;
+	HeadBuffer.clear();
+	LineBuffer.clear();
+	bLineBufferReturned = false;
+	Headers.Empty();
+}
+
+EHttpResponseParseResult::Type FHttpResponseParser::Parse(std::span<const uint8_t> Input, IHttpResponseParserListener& Listener, size_t& OutConsumed)
+{
+	size_t Offset = 0;
+	while (State != EState::Complete && State != EState::Error && Offset < Input.size())
+	{
+		const std::span<const uint8_t> Available = Input.subspan(Offset);
+		switch (State)
+		{
+			case EState::Head:
+			{
+				const std::string_view Received(reinterpret_cast<const char*>(Available.data()), Available.size());
+				std::string_view Head;
+				if (HeadBuffer.empty())
+				{
+					const size_t End = Received.find("\r\n\r\n");
+					if (End != std::string_view::npos)
+					{
+						// the common case, the whole head arrived at once
+						Head = Received.substr(0, End + 4);
+						Offset += Head.size();
+					}
+				}
+				else
+				{
+					// the end of the head may straddle the two inputs
+					const size_t SearchFrom = HeadBuffer.size() - std::min<size_t>(HeadBuffer.size(), 3);
+					const size_t PreviousSize = HeadBuffer.size();
+					HeadBuffer.append(Received.substr(0, std::min(Received.size(), MaxHeadSize)));
+					const size_t End = HeadBuffer.find("\r\n\r\n", SearchFrom);
+					if (End != std::string::npos)
+					{
+						HeadBuffer.resize(End + 4);
+						Head = HeadBuffer;
+						Offset += HeadBuffer.size() - PreviousSize;
+					}
+					else
+					{
+						HeadBuffer.resize(PreviousSize);
+					}
+				}
+				if (Head.empty())
+				{
+					if (HeadBuffer.size() + Received.size() > MaxHeadSize)
+					{
+						State = EState::Error;
+						break;
+					}
+					HeadBuffer.append(Received);
+					Offset = Input.size();
+					break;
+				}
+				if (!ParseHead(Head, Listener))
+				{
+					State = EState::Error;
+				}
+				HeadBuffer.clear();
+				break;
+			}
+			case EState::Body:
+			case EState::ChunkData:
+			case EState::BodyUntilClose:
+			{
+				const size_t Size = State == EState::BodyUntilClose ? Available.size() : size_t(std::min<uint64_t>(RemainingBytes, Available.size()));
+				if (!Listener.OnResponseBody(Available.first(Size)))
+				{
+					State = EState::Error;
+					break;
+				}
+				Offset += Size;
+				if (State != EState::BodyUntilClose)
+				{
+					RemainingBytes -= Size;
+					if (RemainingBytes == 0)
+					{
+						State = State == EState::Body ? EState::Complete : EState::ChunkDataEnd;
+					}
+				}
+				break;
+			}
+			case EState::ChunkSize:
+			{
+				std::string_view Line;
+				if (!ReadLine(Input, Offset, Line))
+				{
+					break;
+				}
+				// chunk extensions are ignored
+				Line = TrimHttpWhitespace(Line.substr(0, Line.find(';')));
+				uint64_t ChunkSize = 0;
+				const std::from_chars_result Result = std::from_chars(Line.data(), Line.data() + Line.size(), ChunkSize, 16);
+				if (Line.empty() || Result.ec != std::errc() || Result.ptr != Line.data() + Line.size())
+				{
+					State = EState::Error;
+					break;
+				}
+				RemainingBytes = ChunkSize;
+				State = ChunkSize == 0 ? EState::Trailers : EState::ChunkData;
+				break;
+			}
+			case EState::ChunkDataEnd:
+			{
+				std::string_view Line;
+				if (ReadLine(Input, Offset, Line))
+				{
+					State = Line.empty() ? EState::ChunkSize : EState::Error;
+				}
+				break;
+			}
+			case EState::Trailers:
+			{
+				// trailer fields are dropped, the head was already handed out
+				std::string_view Line;
+				if (ReadLine(Input, Offset, Line) && Line.empty())
+				{
+					State = EState::Complete;
+				}
+				break;
+			}
+			default:
+			{
+				break;
+			}
+		}
+	}
+	ReceivedBytes += Offset;
+	OutConsumed = Offset;
+	return State == EState::Complete ? EHttpResponseParseResult::Complete : State == EState::Error ? EHttpResponseParseResult::Error : EHttpResponseParseResult::NeedMoreInput;
+}
+
+EHttpResponseParseResult::Type FHttpResponseParser::ParseEndOfInput()
+{
+	if (State == EState::BodyUntilClose)
+	{
+		State = EState::Complete;
+	}
+	else if (State != EState::Complete)
+	{
+		State = EState::Error;
+	}
+	bKeepAlive = false;
+	return State == EState::Complete ? EHttpResponseParseResult::Complete : EHttpResponseParseResult::Error;
+}
+
+bool FHttpResponseParser::ParseHead(std::string_view Head, IHttpResponseParserListener& Listener)
+{
+	// status line: HTTP/1.1 200 OK
+	const size_t StatusLineEnd = Head.find("\r\n");
+	const std::string_view StatusLine = Head.substr(0, StatusLineEnd);
+	if (StatusLine.size() < 12 || !StatusLine.starts_with("HTTP/1.") || StatusLine[8] != ' ')
+	{
+		return false;
+	}
+	const bool bHttp10 = StatusLine[7] == '0';
+	int32_t StatusCode = 0;
+	const std::from_chars_result Result = std::from_chars(StatusLine.data() + 9, StatusLine.data() + 12, StatusCode);
+	if (Result.ec != std::errc() || Result.ptr != StatusLine.data() + 12 || StatusCode < 100)
+	{
+		return false;
+	}
+
+	Headers.Empty();
+	std::string_view Lines = Head.substr(StatusLineEnd + 2);
+	while (!Lines.empty())
+	{
+		const size_t LineEnd = Lines.find("\r\n");
+		const std::string_view Line = Lines.substr(0, LineEnd);
+		Lines.remove_prefix(LineEnd == std::string_view::npos ? Lines.size() : LineEnd + 2);
+		if (Line.empty())
+		{
+			break;
+		}
+		const size_t Colon = Line.find(':');
+		if (Colon == std::string_view::npos || Colon == 0)
+		{
+			// obsolete line folding or garbage, neither is worth failing the response for
+			continue;
+		}
+		Headers.Append(Line.substr(0, Colon), TrimHttpWhitespace(Line.substr(Colon + 1)));
+	}
+
+	if (StatusCode < 200)
+	{
+		// 100 Continue and other interim responses come before the final one, there is no protocol switching here
+		if (StatusCode == 101)
+		{
+			return false;
+		}
+		Headers.Empty();
+		return true;
+	}
+
+	const std::string_view Connection = Headers.Find(EHttpHeader::Connection);
+	bKeepAlive = bHttp10 ? HttpHeaderListContains(Connection, "keep-alive") : !HttpHeaderListContains(Connection, "close");
+	HttpVersion = EHttpVersion::Http1_1;
+
+	const std::string_view TransferEncoding = Headers.Find(EHttpHeader::TransferEncoding);
+	const std::string_view ContentLength = Headers.Find(EHttpHeader::ContentLength);
+	if (bHeadRequest || StatusCode == 204 || StatusCode == 304)
+	{
+		State = EState::Complete;
+	}
+	else if (!TransferEncoding.empty())
+	{
+		// chunked has to be the last coding, any other one leaves the end of the body to the end of the connection
+		const size_t LastComma = TransferEncoding.rfind(',');
+		const std::string_view LastCoding = TrimHttpWhitespace(LastComma == std::string_view::npos ? TransferEncoding : TransferEncoding.substr(LastComma + 1));
+		if (HttpHeaderNameEquals(LastCoding, "chunked"))
+		{
+			State = EState::ChunkSize;
+		}
+		else
+		{
+			State = EState::BodyUntilClose;
+			bKeepAlive = false;
+		}
+	}
+	else if (!ContentLength.empty())
+	{
+		const std::string_view Length = TrimHttpWhitespace(ContentLength);
+		const std::from_chars_result LengthResult = std::from_chars(Length.data(), Length.data() + Length.size(), RemainingBytes);
+		if (LengthResult.ec != std::errc() || LengthResult.ptr != Length.data() + Length.size())
+		{
+			return false;
+		}
+		State = RemainingBytes == 0 ? EState::Complete : EState::Body;
+	}
+	else
+	{
+		State = EState::BodyUntilClose;
+		bKeepAlive = false;
+	}
+	return Listener.OnResponseHead(StatusCode, Headers);
+}
+
+bool FHttpResponseParser::ReadLine(std::span<const uint8_t> Input, size_t& Offset, std::string_view& OutLine)
+{
+	if (bLineBufferReturned)
+	{
+		LineBuffer.clear();
+		bLineBufferReturned = false;
+	}
+	const char* Begin = reinterpret_cast<const char*>(Input.data()) + Offset;
+	const size_t Size = Input.size() - Offset;
+	const char* NewLine = static_cast<const char*>(std::memchr(Begin, '\n', Size));
+	if (NewLine == nullptr)
+	{
+		if (LineBuffer.size() + Size > MaxLineSize)
+		{
+			State = EState::Error;
+			return false;
+		}
+		LineBuffer.append(Begin, Size);
+		Offset = Input.size();
+		return false;
+	}
+	const size_t LineSize = size_t(NewLine - Begin);
+	Offset += LineSize + 1;
+	if (LineBuffer.empty())
+	{
+		OutLine = std::string_view(Begin, LineSize);
+	}
+	else
+	{
+		LineBuffer.append(Begin, LineSize);
+		OutLine = LineBuffer;
+		bLineBufferReturned = true;
+	}
+	if (!OutLine.empty() && OutLine.back() == '\r')
+	{
+		OutLine.remove_suffix(1);
+	}
+	return true;
+}
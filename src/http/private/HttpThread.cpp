@@ -1,2 +1,534 @@
-#pragma once
-#include <HttpThread.h>
\ No newline at end of file
+#include <HttpThread.h>
+#include <HttpTrace.h>
+#include <logger.h>
+#include <algorithm>
+#include <chrono>
+
+static double GetAppTimeInSeconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void SleepSeconds(double Seconds)
+{
+	if (Seconds > 0.0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+	}
+}
+
+FHttpThread::FHttpThread()
+	: bEventDriven(true)
+	, bWakeUpPending(false)
+	, HttpThreadActiveFrameTimeInSeconds(1.0 / 200.0)
+	, HttpThreadActiveMinimumSleepTimeInSeconds(0.0)
+	, HttpThreadIdleFrameTimeInSeconds(1.0 / 30.0)
+	, HttpThreadIdleMinimumSleepTimeInSeconds(0.0)
+	, LastTime(0.0)
+	, WorkStealingThreshold(4)
+	, Timers(0.005)
+	, Thread(nullptr)
+{
+}
+
+FHttpThread::~FHttpThread()
+{
+	StopThread();
+}
+
+void FHttpThread::StartThread()
+{
+	if (Thread)
+	{
+		return;
+	}
+	ExitRequest = false;
+	Thread = new std::thread([this]()
+		{
+#if ONLINEPP_HTTP_TRACE
+			FHttpTrace::SetThreadName("HttpThread");
+#endif
+			if (Init())
+			{
+				Run();
+			}
+			Exit();
+		});
+}
+
+void FHttpThread::StopThread()
+{
+	if (Thread)
+	{
+		Stop();
+		if (Thread->joinable())
+		{
+			Thread->join();
+		}
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+void FHttpThread::AddRequest(IHttpThreadedRequest* Request)
+{
+	Request->SetThreadedRequestOwner(this);
+	// count first so the consumer never sees fewer queued requests than it dequeues
+	const size_t PendingCount = ++PendingRequestCount;
+	PendingThreadedRequests.Enqueue(Request);
+	WakeUp();
+
+	// This thread is busy and its queue is growing, let an idle sibling help out
+	if (PendingCount >= WorkStealingThreshold && !bWaiting)
+	{
+		for (FHttpThread* Sibling : SiblingThreads)
+		{
+			if (Sibling != this && Sibling->bWaiting)
+			{
+				Sibling->WakeUp();
+				break;
+			}
+		}
+	}
+}
+
+void FHttpThread::CancelRequest(IHttpThreadedRequest* Request)
+{
+	CancelledThreadedRequests.Enqueue(Request);
+	WakeUp();
+}
+
+void FHttpThread::GetCompletedRequests(std::vector<IHttpThreadedRequest*>& OutCompletedRequests)
+{
+	CompletedThreadedRequests.DequeueAll(OutCompletedRequests);
+}
+
+void FHttpThread::Tick()
+{
+	// Only pump from the calling thread when the http thread is not running, otherwise both would process the same arrays
+	if (Thread == nullptr)
+	{
+		if (LastTime == 0.0)
+		{
+			LastTime = GetAppTimeInSeconds();
+		}
+		std::vector<IHttpThreadedRequest*> RequestsToCancel;
+		std::vector<IHttpThreadedRequest*> RequestsToStart;
+		std::vector<IHttpThreadedRequest*> RequestsToComplete;
+		Process(RequestsToCancel, RequestsToStart, RequestsToComplete);
+	}
+}
+
+void FHttpThread::SetEventDriven(bool bInEventDriven)
+{
+	bEventDriven = bInEventDriven;
+}
+
+void FHttpThread::SetSiblingThreads(const std::vector<FHttpThread*>& InSiblingThreads)
+{
+	SiblingThreads = InSiblingThreads;
+}
+
+void FHttpThread::SetConnectionSettings(const FHttpConnectionSettings& InConnectionSettings)
+{
+	ConnectionSettings = InConnectionSettings;
+}
+
+void FHttpThread::SetRequestLimits(uint32_t MaxRunning, uint32_t MaxRunningPerHost)
+{
+	Scheduler.SetLimits(MaxRunning, MaxRunningPerHost);
+}
+
+void FHttpThread::SetCompletionCallback(std::function<void(FHttpThread&)> InCompletionCallback)
+{
+	CompletionCallback = std::move(InCompletionCallback);
+}
+
+void FHttpThread::RequestCompletionCallback()
+{
+	bCompletionCallbackRequested = true;
+	WakeUp();
+}
+
+FHttpThreadStats FHttpThread::GetStats()
+{
+	FHttpThreadStats Stats;
+	Stats.StartedRequests = StartedRequestCount;
+	Stats.CompletedRequests = CompletedRequestCount;
+	Stats.CancelledRequests = CancelledRequestCount;
+	Stats.StolenRequests = StolenRequestCount;
+	Stats.RunningRequests = RunningRequestCount;
+	Stats.BusySeconds = double(BusyNanoseconds) * 1e-9;
+	Stats.PendingRequests = uint32_t(PendingRequestCount) + ScheduledRequestCount;
+	Stats.NewConnections = NewConnectionCount;
+	Stats.ReusedConnections = ReusedConnectionCount;
+	Stats.PreconnectedConnections = PreconnectedConnectionCount;
+	Stats.UsedPreconnectedConnections = UsedPreconnectedConnectionCount;
+	Stats.FailedPreconnects = FailedPreconnectCount;
+	return Stats;
+}
+
+void FHttpThread::Preconnect(const FHttpPreconnectTarget& Target)
+{
+	{
+		std::scoped_lock Lock(PreconnectLock);
+		PendingPreconnects.push_back(Target);
+		bHasPendingPreconnects = true;
+	}
+	WakeUp();
+}
+
+void FHttpThread::HttpThreadTick(float DeltaSeconds)
+{
+	// empty
+}
+
+bool FHttpThread::StartThreadedRequest(IHttpThreadedRequest* Request)
+{
+	return Request->StartThreadedRequest();
+}
+
+void FHttpThread::CompleteThreadedRequest(IHttpThreadedRequest* Request)
+{
+	// empty
+}
+
+void FHttpThread::StartPreconnect(const FHttpPreconnectTarget& Target)
+{
+	// empty
+}
+
+void FHttpThread::WaitForActivity(double MaxWaitSeconds)
+{
+	std::unique_lock Lock(WakeUpLock);
+	if (MaxWaitSeconds < 0.0)
+	{
+		WakeUpEvent.wait(Lock, [this]() { return bWakeUpPending; });
+	}
+	else
+	{
+		WakeUpEvent.wait_for(Lock, std::chrono::duration<double>(MaxWaitSeconds), [this]() { return bWakeUpPending; });
+	}
+	bWakeUpPending = false;
+}
+
+double FHttpThread::GetMaxActivityWaitSeconds() const
+{
+	for (IHttpThreadedRequest* Request : RunningThreadedRequests)
+	{
+		if (Request->IsThreadedRequestTickable())
+		{
+			return HttpThreadActiveFrameTimeInSeconds;
+		}
+	}
+	// running requests wake the thread up on their own activity, only the timeouts need it to come back
+	return Timers.GetSecondsUntilNextExpiry();
+}
+
+void FHttpThread::WakeUp()
+{
+	{
+		std::scoped_lock Lock(WakeUpLock);
+		bWakeUpPending = true;
+	}
+	WakeUpEvent.notify_one();
+}
+
+bool FHttpThread::Init()
+{
+	LastTime = GetAppTimeInSeconds();
+	return true;
+}
+
+uint32_t FHttpThread::Run()
+{
+	// Arrays declared outside of loop to re-use memory
+	std::vector<IHttpThreadedRequest*> RequestsToCancel;
+	std::vector<IHttpThreadedRequest*> RequestsToStart;
+	std::vector<IHttpThreadedRequest*> RequestsToComplete;
+	while (!ExitRequest && bEventDriven)
+	{
+		Process(RequestsToCancel, RequestsToStart, RequestsToComplete);
+		if (!ExitRequest)
+		{
+			// Sleep until new work arrives, or until the running requests need servicing again
+			bWaiting = true;
+			WaitForActivity(GetMaxActivityWaitSeconds());
+			bWaiting = false;
+		}
+	}
+	while (!ExitRequest)
+	{
+		double OuterLoopBegin = GetAppTimeInSeconds();
+		double OuterLoopEnd = 0.0;
+		bool bKeepProcessing = true;
+		while (bKeepProcessing)
+		{
+			double InnerLoopBegin = GetAppTimeInSeconds();
+
+			Process(RequestsToCancel, RequestsToStart, RequestsToComplete);
+
+			if (RunningThreadedRequests.empty() || ExitRequest)
+			{
+				bKeepProcessing = false;
+			}
+
+			double InnerLoopEnd = GetAppTimeInSeconds();
+			if (bKeepProcessing)
+			{
+				double InnerLoopTime = InnerLoopEnd - InnerLoopBegin;
+				double InnerSleep = std::max(HttpThreadActiveFrameTimeInSeconds - InnerLoopTime, HttpThreadActiveMinimumSleepTimeInSeconds);
+				SleepSeconds(InnerSleep);
+			}
+			else
+			{
+				OuterLoopEnd = InnerLoopEnd;
+			}
+		}
+		double OuterLoopTime = OuterLoopEnd - OuterLoopBegin;
+		double OuterSleep = std::max(HttpThreadIdleFrameTimeInSeconds - OuterLoopTime, HttpThreadIdleMinimumSleepTimeInSeconds);
+		SleepSeconds(OuterSleep);
+	}
+	return 0;
+}
+
+void FHttpThread::Stop()
+{
+	ExitRequest = true;
+	WakeUp();
+}
+
+void FHttpThread::Exit()
+{
+	// empty
+}
+
+bool FHttpThread::StealRequests(std::vector<IHttpThreadedRequest*>& RequestsToStart)
+{
+	for (FHttpThread* Sibling : SiblingThreads)
+	{
+		// Only steal from siblings that are busy processing, a waiting sibling picks up its own queue right away
+		if (Sibling == this || Sibling->bWaiting)
+		{
+			continue;
+		}
+		const size_t SiblingPendingCount = Sibling->PendingRequestCount;
+		if (SiblingPendingCount < WorkStealingThreshold)
+		{
+			continue;
+		}
+		// Never wait for the consumer role of a sibling, it is either draining its own queue or another thread is stealing
+		if (Sibling->PendingConsumerFlag.test_and_set(std::memory_order_acquire))
+		{
+			continue;
+		}
+		const size_t StealCount = Sibling->PendingThreadedRequests.DequeueBatch(RequestsToStart, SiblingPendingCount / 2);
+		Sibling->PendingRequestCount -= StealCount;
+		// claim them while the sibling can't dequeue, what is meant for them reaches this thread from now on
+		for (size_t Index = RequestsToStart.size() - StealCount; Index < RequestsToStart.size(); ++Index)
+		{
+			RequestsToStart[Index]->SetThreadedRequestOwner(this);
+		}
+		Sibling->PendingConsumerFlag.clear(std::memory_order_release);
+		if (StealCount > 0)
+		{
+			StolenRequestCount += StealCount;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FHttpThread::RemoveRunningRequest(size_t Index)
+{
+	// swap with the last one, the order of the running requests doesn't matter
+	RunningRequestIndices.erase(RunningThreadedRequests[Index]);
+	IHttpThreadedRequest* Last = RunningThreadedRequests.back();
+	RunningThreadedRequests.pop_back();
+	if (Index < RunningThreadedRequests.size())
+	{
+		RunningThreadedRequests[Index] = Last;
+		RunningRequestIndices[Last] = Index;
+	}
+}
+
+void FHttpThread::Process(std::vector<IHttpThreadedRequest*>& RequestsToCancel, std::vector<IHttpThreadedRequest*>& RequestsToStart, std::vector<IHttpThreadedRequest*>& RequestsToComplete)
+{
+	HTTP_TRACE_SCOPE("FHttpThread::Process");
+	const double ProcessBegin = GetAppTimeInSeconds();
+
+	// open the connections asked for ahead of the requests they are meant for
+	if (bHasPendingPreconnects)
+	{
+		std::vector<FHttpPreconnectTarget> Preconnects;
+		{
+			std::scoped_lock Lock(PreconnectLock);
+			Preconnects.swap(PendingPreconnects);
+			bHasPendingPreconnects = false;
+		}
+		for (const FHttpPreconnectTarget& Target : Preconnects)
+		{
+			StartPreconnect(Target);
+		}
+	}
+
+	// cache all cancelled and new requests
+	CancelledThreadedRequests.DequeueBatch(RequestsToCancel);
+	{
+		// a sibling only holds the consumer role for the duration of one batch
+		while (PendingConsumerFlag.test_and_set(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+		PendingRequestCount -= PendingThreadedRequests.DequeueBatch(RequestsToStart);
+		PendingConsumerFlag.clear(std::memory_order_release);
+	}
+	if (RequestsToStart.empty())
+	{
+		StealRequests(RequestsToStart);
+	}
+
+	// queue the new requests behind the ones still waiting for a slot
+	for (IHttpThreadedRequest* Request : RequestsToStart)
+	{
+		Scheduler.Enqueue(Request);
+	}
+	RequestsToStart.clear();
+
+	// Cancel any pending cancel requests
+	for (IHttpThreadedRequest* Request : RequestsToCancel)
+	{
+		auto Itr = RunningRequestIndices.find(Request);
+		if (Itr != RunningRequestIndices.end())
+		{
+			RemoveRunningRequest(Itr->second);
+			RequestsToComplete.push_back(Request);
+			++CancelledRequestCount;
+		}
+		else if (Scheduler.Remove(Request))
+		{
+			RequestsToComplete.push_back(Request);
+			++CancelledRequestCount;
+		}
+		else if (FHttpThread* Owner = Request->GetThreadedRequestOwner(); Owner != nullptr && Owner != this)
+		{
+			// stolen from the queue of this thread before the cancel got here
+			Owner->CancelRequest(Request);
+		}
+	}
+	RequestsToCancel.clear();
+
+	// Start the best queued requests that fit in the free slots
+	Scheduler.DequeueStartable(RequestsToStart);
+	for (IHttpThreadedRequest* Request : RequestsToStart)
+	{
+		if (StartThreadedRequest(Request))
+		{
+			RunningRequestIndices.emplace(Request, RunningThreadedRequests.size());
+			RunningThreadedRequests.push_back(Request);
+			++StartedRequestCount;
+
+			const float Timeout = Request->GetTimeout();
+			if (Timeout > 0.0f)
+			{
+				RequestTimeouts[Request] = Timers.Schedule(Timeout, [this, Request]() { TimedOutRequests.push_back(Request); });
+			}
+		}
+		else
+		{
+			RequestsToComplete.push_back(Request);
+		}
+	}
+	RequestsToStart.clear();
+
+	const double AppTime = GetAppTimeInSeconds();
+	const double ElapsedTime = AppTime - LastTime;
+	LastTime = AppTime;
+
+	// Tick any running requests
+	for (IHttpThreadedRequest* Request : RunningThreadedRequests)
+	{
+		Request->TickThreadedRequest(float(ElapsedTime));
+	}
+
+	HttpThreadTick(float(ElapsedTime));
+
+	// Fail any request that ran past its timeout, unless it managed to complete in time
+	Timers.Advance(ElapsedTime, ExpiredTimerCallbacks);
+	for (FHttpTimerWheel::FTimerCallback& Callback : ExpiredTimerCallbacks)
+	{
+		Callback();
+	}
+	ExpiredTimerCallbacks.clear();
+	for (IHttpThreadedRequest* Request : TimedOutRequests)
+	{
+		RequestTimeouts.erase(Request);
+		auto Itr = RunningRequestIndices.find(Request);
+		if (Itr != RunningRequestIndices.end() && !Request->IsThreadedRequestComplete())
+		{
+			RemoveRunningRequest(Itr->second);
+			Request->TimeoutThreadedRequest();
+			RequestsToComplete.push_back(Request);
+		}
+	}
+	TimedOutRequests.clear();
+
+	// Move any completed requests
+	for (size_t Index = RunningThreadedRequests.size(); Index-- > 0;)
+	{
+		IHttpThreadedRequest* Request = RunningThreadedRequests[Index];
+
+		if (Request->IsThreadedRequestComplete())
+		{
+			RequestsToComplete.push_back(Request);
+			RemoveRunningRequest(Index);
+		}
+	}
+
+	const bool bCompletedAny = !RequestsToComplete.empty();
+	if (bCompletedAny)
+	{
+		for (IHttpThreadedRequest* Request : RequestsToComplete)
+		{
+			if (!RequestTimeouts.empty())
+			{
+				auto TimeoutItr = RequestTimeouts.find(Request);
+				if (TimeoutItr != RequestTimeouts.end())
+				{
+					Timers.Cancel(TimeoutItr->second);
+					RequestTimeouts.erase(TimeoutItr);
+				}
+			}
+			CompleteThreadedRequest(Request);
+			Scheduler.Finish(Request);
+		}
+
+		CompletedRequestCount += RequestsToComplete.size();
+
+		for (IHttpThreadedRequest* Request : RequestsToComplete)
+		{
+			CompletedThreadedRequests.Enqueue(Request);
+		}
+		RequestsToComplete.clear();
+	}
+
+	// completed requests freed slots, come back right away to start the queued requests they were holding back
+	if (Scheduler.HasStartable())
+	{
+		WakeUp();
+	}
+
+	RunningRequestCount = uint32_t(RunningThreadedRequests.size());
+	ScheduledRequestCount = uint32_t(Scheduler.NumQueued());
+	HTTP_TRACE_EVENT(Counter("PendingRequests", int64_t(PendingRequestCount.load())));
+	HTTP_TRACE_EVENT(Counter("ScheduledRequests", ScheduledRequestCount));
+	HTTP_TRACE_EVENT(Counter("RunningRequests", RunningRequestCount));
+	BusyNanoseconds += uint64_t((GetAppTimeInSeconds() - ProcessBegin) * 1e9);
+
+	// hand the completions over now rather than waiting for them to be polled
+	const bool bCallbackRequested = bCompletionCallbackRequested.exchange(false);
+	if (CompletionCallback && (bCompletedAny || bCallbackRequested))
+	{
+		CompletionCallback(*this);
+	}
+}
@@ -0,0 +1,226 @@
+#include "HttpTimerWheel.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+FHttpTimerWheel::FHttpTimerWheel(double InTickSeconds)
+	: TickSeconds(InTickSeconds > 0.0 ? InTickSeconds : 0.01)
+	, Remainder(0.0)
+	, CurrentTick(0)
+	, TimerCount(0)
+{
+	for (FLevel& Level : Levels)
+	{
+		Level.Heads.fill(InvalidIndex);
+	}
+}
+
+FHttpTimerWheel::FTimerHandle FHttpTimerWheel::Schedule(double DelaySeconds, FTimerCallback Callback)
+{
+	uint32_t TimerIndex;
+	if (!FreeTimers.empty())
+	{
+		TimerIndex = FreeTimers.back();
+		FreeTimers.pop_back();
+	}
+	else
+	{
+		TimerIndex = uint32_t(Timers.size());
+		Timers.emplace_back();
+	}
+
+	// at least one tick away, the slot of the current tick has already been expired
+	const double DelayTicks = std::ceil(std::max(DelaySeconds, 0.0) / TickSeconds);
+	FTimer& Timer = Timers[TimerIndex];
+	Timer.ExpiryTick = CurrentTick + std::max<uint64_t>(uint64_t(DelayTicks), 1);
+	Timer.Callback = std::move(Callback);
+	Timer.bActive = true;
+	Link(TimerIndex);
+	++TimerCount;
+
+	return (uint64_t(Timer.Generation) << 32) | TimerIndex;
+}
+
+bool FHttpTimerWheel::Cancel(FTimerHandle Handle)
+{
+	const uint32_t TimerIndex = uint32_t(Handle);
+	const uint32_t Generation = uint32_t(Handle >> 32);
+	if (TimerIndex >= Timers.size())
+	{
+		return false;
+	}
+	FTimer& Timer = Timers[TimerIndex];
+	if (!Timer.bActive || Timer.Generation != Generation)
+	{
+		return false;
+	}
+	Unlink(TimerIndex);
+	Timer.bActive = false;
+	++Timer.Generation;
+	Timer.Callback = nullptr;
+	FreeTimers.push_back(TimerIndex);
+	--TimerCount;
+	return true;
+}
+
+void FHttpTimerWheel::Advance(double DeltaSeconds, std::vector<FTimerCallback>& OutExpiredCallbacks)
+{
+	Remainder += std::max(DeltaSeconds, 0.0);
+	const double ElapsedTicks = std::floor(Remainder / TickSeconds);
+	Remainder -= ElapsedTicks * TickSeconds;
+	const uint64_t TargetTick = CurrentTick + uint64_t(ElapsedTicks);
+
+	while (CurrentTick < TargetTick)
+	{
+		if (TimerCount == 0)
+		{
+			CurrentTick = TargetTick;
+			break;
+		}
+
+		// Jump straight to the next occupied level 0 slot, or to the next cascade boundary
+		const uint64_t BlockStart = CurrentTick & ~uint64_t(SlotMask);
+		const uint32_t SlotIndex = uint32_t(CurrentTick & SlotMask);
+		const uint64_t OccupiedAfter = SlotIndex == SlotMask ? 0 : Levels[0].Occupied & (~uint64_t(0) << (SlotIndex + 1));
+		const uint64_t NextTick = OccupiedAfter ? BlockStart + std::countr_zero(OccupiedAfter) : BlockStart + SlotCount;
+		if (NextTick > TargetTick)
+		{
+			CurrentTick = TargetTick;
+			break;
+		}
+
+		CurrentTick = NextTick;
+		if ((CurrentTick & SlotMask) == 0)
+		{
+			Cascade(1);
+		}
+		Expire(OutExpiredCallbacks);
+	}
+}
+
+double FHttpTimerWheel::GetSecondsUntilNextExpiry() const
+{
+	if (TimerCount == 0)
+	{
+		return -1.0;
+	}
+	// the first occupied slot of each level after the current tick starts no later than the timers it holds expire
+	uint64_t NextTick = UINT64_MAX;
+	for (uint32_t LevelIndex = 0; LevelIndex < LevelCount; ++LevelIndex)
+	{
+		const uint64_t Occupied = Levels[LevelIndex].Occupied;
+		if (Occupied == 0)
+		{
+			continue;
+		}
+		const uint32_t Shift = SlotBits * LevelIndex;
+		const uint64_t Position = CurrentTick >> Shift;
+		const uint32_t SlotIndex = uint32_t(Position & SlotMask);
+		const uint64_t OccupiedAfter = SlotIndex == SlotMask ? 0 : Occupied & (~uint64_t(0) << (SlotIndex + 1));
+		// slots up to the current one belong to the next revolution
+		const uint64_t Distance = OccupiedAfter ? std::countr_zero(OccupiedAfter) - SlotIndex : std::countr_zero(Occupied) + SlotCount - SlotIndex;
+		NextTick = std::min(NextTick, (Position + Distance) << Shift);
+	}
+	return std::max(double(NextTick - CurrentTick) * TickSeconds - Remainder, 0.0);
+}
+
+void FHttpTimerWheel::Link(uint32_t TimerIndex)
+{
+	FTimer& Timer = Timers[TimerIndex];
+	const uint64_t ExpiryTick = std::max(Timer.ExpiryTick, CurrentTick);
+	const uint64_t Delta = ExpiryTick - CurrentTick;
+
+	uint32_t LevelIndex = 0;
+	while (LevelIndex + 1 < LevelCount && Delta >= (uint64_t(1) << (SlotBits * (LevelIndex + 1))))
+	{
+		++LevelIndex;
+	}
+	uint64_t SlotTick = ExpiryTick;
+	const uint64_t WheelSpan = uint64_t(1) << (SlotBits * LevelCount);
+	if (Delta >= WheelSpan)
+	{
+		// beyond the range of the wheel, park it in the farthest slot and re-evaluate on cascade
+		SlotTick = CurrentTick + WheelSpan - 1;
+	}
+	const uint32_t Slot = uint32_t(SlotTick >> (SlotBits * LevelIndex)) & SlotMask;
+
+	FLevel& Level = Levels[LevelIndex];
+	Timer.Level = uint16_t(LevelIndex);
+	Timer.Slot = uint16_t(Slot);
+	Timer.Prev = InvalidIndex;
+	Timer.Next = Level.Heads[Slot];
+	if (Timer.Next != InvalidIndex)
+	{
+		Timers[Timer.Next].Prev = TimerIndex;
+	}
+	Level.Heads[Slot] = TimerIndex;
+	Level.Occupied |= uint64_t(1) << Slot;
+}
+
+void FHttpTimerWheel::Unlink(uint32_t TimerIndex)
+{
+	FTimer& Timer = Timers[TimerIndex];
+	FLevel& Level = Levels[Timer.Level];
+	if (Timer.Prev != InvalidIndex)
+	{
+		Timers[Timer.Prev].Next = Timer.Next;
+	}
+	else
+	{
+		Level.Heads[Timer.Slot] = Timer.Next;
+	}
+	if (Timer.Next != InvalidIndex)
+	{
+		Timers[Timer.Next].Prev = Timer.Prev;
+	}
+	if (Level.Heads[Timer.Slot] == InvalidIndex)
+	{
+		Level.Occupied &= ~(uint64_t(1) << Timer.Slot);
+	}
+	Timer.Prev = InvalidIndex;
+	Timer.Next = InvalidIndex;
+}
+
+void FHttpTimerWheel::Cascade(uint32_t LevelIndex)
+{
+	const uint32_t Slot = uint32_t(CurrentTick >> (SlotBits * LevelIndex)) & SlotMask;
+	// higher levels first, they may refill this slot
+	if (Slot == 0 && LevelIndex + 1 < LevelCount)
+	{
+		Cascade(LevelIndex + 1);
+	}
+
+	FLevel& Level = Levels[LevelIndex];
+	uint32_t TimerIndex = Level.Heads[Slot];
+	Level.Heads[Slot] = InvalidIndex;
+	Level.Occupied &= ~(uint64_t(1) << Slot);
+	while (TimerIndex != InvalidIndex)
+	{
+		const uint32_t NextIndex = Timers[TimerIndex].Next;
+		Link(TimerIndex);
+		TimerIndex = NextIndex;
+	}
+}
+
+void FHttpTimerWheel::Expire(std::vector<FTimerCallback>& OutExpiredCallbacks)
+{
+	const uint32_t Slot = uint32_t(CurrentTick & SlotMask);
+	FLevel& Level = Levels[0];
+	uint32_t TimerIndex = Level.Heads[Slot];
+	while (TimerIndex != InvalidIndex)
+	{
+		FTimer& Timer = Timers[TimerIndex];
+		const uint32_t NextIndex = Timer.Next;
+		if (Timer.ExpiryTick <= CurrentTick)
+		{
+			Unlink(TimerIndex);
+			OutExpiredCallbacks.push_back(std::move(Timer.Callback));
+			Timer.Callback = nullptr;
+			Timer.bActive = false;
+			++Timer.Generation;
+			FreeTimers.push_back(TimerIndex);
+			--TimerCount;
+		}
+		TimerIndex = NextIndex;
+	}
+}
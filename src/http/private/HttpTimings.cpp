@@ -0,0 +1,113 @@
+#include "HttpTimings.h"
+#include <algorithm>
+#include <bit>
+
+uint64_t FHttpLatencySnapshot::GetPercentile(double Percentile) const
+{
+	if (TotalCount == 0)
+	{
+		return 0;
+	}
+	const double Clamped = std::clamp(Percentile, 0.0, 100.0);
+	const uint64_t Rank = std::max<uint64_t>(uint64_t(Clamped / 100.0 * double(TotalCount) + 0.5), 1);
+	uint64_t Seen = 0;
+	for (uint32_t Index = 0; Index < Counts.size(); ++Index)
+	{
+		Seen += Counts[Index];
+		if (Seen >= Rank)
+		{
+			return std::min(FHttpLatencyHistogram::GetBucketUpperBound(Index), MaxMicroseconds);
+		}
+	}
+	return MaxMicroseconds;
+}
+
+uint32_t FHttpLatencyHistogram::GetBucketIndex(uint64_t Microseconds)
+{
+	Microseconds = std::min<uint64_t>(Microseconds, (uint64_t(1) << MaxValueBits) - 1);
+	if (Microseconds < SubBucketCount)
+	{
+		return uint32_t(Microseconds);
+	}
+	// shift the value so it has SubBucketBits + 1 significant bits, the top one is implied by the exponent
+	const uint32_t Exponent = uint32_t(std::bit_width(Microseconds)) - (SubBucketBits + 1);
+	return (Exponent + 1) * SubBucketCount + uint32_t(Microseconds >> Exponent) - SubBucketCount;
+}
+
+uint64_t FHttpLatencyHistogram::GetBucketUpperBound(uint32_t Index)
+{
+	if (Index < SubBucketCount)
+	{
+		return Index;
+	}
+	const uint32_t Exponent = Index / SubBucketCount - 1;
+	const uint64_t LowerBound = uint64_t(SubBucketCount + Index % SubBucketCount) << Exponent;
+	return LowerBound + (uint64_t(1) << Exponent) - 1;
+}
+
+void FHttpLatencyHistogram::Record(int64_t Nanoseconds)
+{
+	const uint64_t Microseconds = uint64_t(std::max<int64_t>(Nanoseconds, 0) / 1000);
+	Counts[GetBucketIndex(Microseconds)].fetch_add(1, std::memory_order_relaxed);
+	SumMicroseconds.fetch_add(Microseconds, std::memory_order_relaxed);
+	uint64_t Max = MaxMicroseconds.load(std::memory_order_relaxed);
+	while (Microseconds > Max && !MaxMicroseconds.compare_exchange_weak(Max, Microseconds, std::memory_order_relaxed))
+	{
+	}
+	// counted last so a snapshot never has more values than buckets counts
+	TotalCount.fetch_add(1, std::memory_order_release);
+}
+
+FHttpLatencySnapshot FHttpLatencyHistogram::Snapshot() const
+{
+	FHttpLatencySnapshot Snapshot;
+	Snapshot.TotalCount = TotalCount.load(std::memory_order_acquire);
+	Snapshot.Counts.resize(BucketCount);
+	uint64_t BucketTotal = 0;
+	for (uint32_t Index = 0; Index < BucketCount; ++Index)
+	{
+		Snapshot.Counts[Index] = Counts[Index].load(std::memory_order_relaxed);
+		BucketTotal += Snapshot.Counts[Index];
+	}
+	// values recorded while copying are in some buckets already, count them so percentiles stay consistent
+	Snapshot.TotalCount = std::max(Snapshot.TotalCount, BucketTotal);
+	Snapshot.SumMicroseconds = SumMicroseconds.load(std::memory_order_relaxed);
+	Snapshot.MaxMicroseconds = MaxMicroseconds.load(std::memory_order_relaxed);
+	return Snapshot;
+}
+
+void RecordHttpRequestTimings(std::array<FHttpLatencyHistogram, EHttpTimingPhase::Count>& Histograms, const FHttpRequestTimings& Timings)
+{
+	if (Timings.Started == 0 || Timings.Completed == 0)
+	{
+		// never reached an http thread
+		return;
+	}
+	Histograms[EHttpTimingPhase::Queue].Record(Timings.Started - Timings.Queued);
+	Histograms[EHttpTimingPhase::Total].Record(Timings.Completed - Timings.Queued);
+	if (Timings.NameLookup != 0)
+	{
+		Histograms[EHttpTimingPhase::NameLookup].Record(Timings.NameLookup - Timings.Started);
+	}
+	if (Timings.Connected != 0)
+	{
+		Histograms[EHttpTimingPhase::Connect].Record(Timings.Connected - std::max(Timings.NameLookup, Timings.Started));
+	}
+	if (Timings.TlsHandshake != 0)
+	{
+		Histograms[EHttpTimingPhase::TlsHandshake].Record(Timings.TlsHandshake - std::max(Timings.Connected, Timings.Started));
+	}
+	if (Timings.FirstByte != 0)
+	{
+		const int64_t ConnectionReady = std::max({ Timings.Started, Timings.Connected, Timings.TlsHandshake });
+		Histograms[EHttpTimingPhase::FirstByte].Record(Timings.FirstByte - ConnectionReady);
+		if (Timings.LastByte != 0)
+		{
+			Histograms[EHttpTimingPhase::Download].Record(Timings.LastByte - Timings.FirstByte);
+		}
+	}
+	if (Timings.LastByte != 0)
+	{
+		Histograms[EHttpTimingPhase::Delivery].Record(Timings.Completed - Timings.LastByte);
+	}
+}
@@ -0,0 +1,353 @@
+#include "HttpTrace.h"
+#include "HttpTimings.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	enum class EHttpTraceEventType : uint8_t
+	{
+		Begin,
+		End,
+		AsyncBegin,
+		AsyncStep,
+		AsyncEnd,
+		Counter
+	};
+
+	struct FHttpTraceEvent
+	{
+		const char* Name = nullptr;
+		int64_t Timestamp = 0;
+		/** Async id or counter value */
+		uint64_t Value = 0;
+		EHttpTraceEventType Type = EHttpTraceEventType::Begin;
+	};
+
+	/**
+	 * Slot of a ring buffer, relaxed atomics since a dump may read a slot its thread is overwriting. Such an event is
+	 * dropped, the write index tells which.
+	 */
+	struct FHttpTraceEventSlot
+	{
+		std::atomic<const char*> Name{ nullptr };
+		std::atomic<int64_t> Timestamp{ 0 };
+		std::atomic<uint64_t> Value{ 0 };
+		std::atomic<EHttpTraceEventType> Type{ EHttpTraceEventType::Begin };
+	};
+
+	/**
+	 * Ring buffer written by a single thread, read by ToChromeTraceJson
+	 */
+	struct FHttpTraceBuffer
+	{
+		uint32_t ThreadId = 0;
+		std::string ThreadName;
+		std::unique_ptr<FHttpTraceEventSlot[]> Events;
+		uint64_t Capacity = 0;
+		/** Number of events written so far, Events[Index % size] holds the event Index */
+		std::atomic<uint64_t> WriteIndex{ 0 };
+	};
+
+	/** Buffers of the current recording */
+	std::mutex GBuffersLock;
+	std::vector<std::shared_ptr<FHttpTraceBuffer>> GBuffers;
+	size_t GEventsPerThread = 64 * 1024;
+	/** Bumped by Start so every thread moves to a new buffer */
+	std::atomic<uint64_t> GGeneration{ 0 };
+	std::atomic<uint32_t> GNextThreadId{ 1 };
+
+	struct FHttpTraceThreadState
+	{
+		uint32_t ThreadId = GNextThreadId++;
+		std::string ThreadName;
+		uint64_t Generation = 0;
+		std::shared_ptr<FHttpTraceBuffer> Buffer;
+	};
+
+	FHttpTraceThreadState& GetThreadState()
+	{
+		thread_local FHttpTraceThreadState State;
+		return State;
+	}
+
+	FHttpTraceBuffer& GetThreadBuffer()
+	{
+		FHttpTraceThreadState& State = GetThreadState();
+		const uint64_t Generation = GGeneration.load(std::memory_order_acquire);
+		if (State.Generation != Generation || !State.Buffer)
+		{
+			std::shared_ptr<FHttpTraceBuffer> Buffer = std::make_shared<FHttpTraceBuffer>();
+			Buffer->ThreadId = State.ThreadId;
+			Buffer->ThreadName = State.ThreadName;
+			std::scoped_lock Lock(GBuffersLock);
+			Buffer->Capacity = std::max<size_t>(GEventsPerThread, 1);
+			Buffer->Events = std::make_unique<FHttpTraceEventSlot[]>(Buffer->Capacity);
+			GBuffers.push_back(Buffer);
+			State.Buffer = std::move(Buffer);
+			State.Generation = Generation;
+		}
+		return *State.Buffer;
+	}
+
+	void RecordEvent(EHttpTraceEventType Type, const char* Name, uint64_t Value, int64_t Timestamp)
+	{
+		FHttpTraceBuffer& Buffer = GetThreadBuffer();
+		const uint64_t Index = Buffer.WriteIndex.load(std::memory_order_relaxed);
+		FHttpTraceEventSlot& Slot = Buffer.Events[Index % Buffer.Capacity];
+		// pairs with the fence of ToChromeTraceJson, a dump that reads these stores sees this index
+		std::atomic_thread_fence(std::memory_order_release);
+		Slot.Name.store(Name, std::memory_order_relaxed);
+		Slot.Timestamp.store(Timestamp ? Timestamp : GetHttpTimestamp(), std::memory_order_relaxed);
+		Slot.Value.store(Value, std::memory_order_relaxed);
+		Slot.Type.store(Type, std::memory_order_relaxed);
+		Buffer.WriteIndex.store(Index + 1, std::memory_order_release);
+	}
+
+	void AppendJsonString(std::string& Out, std::string_view Value)
+	{
+		Out += '"';
+		for (char Char : Value)
+		{
+			if (Char == '"' || Char == '\\')
+			{
+				Out += '\\';
+				Out += Char;
+			}
+			else if (uint8_t(Char) < 0x20)
+			{
+				char Escaped[8];
+				std::snprintf(Escaped, sizeof(Escaped), "\\u%04x", uint32_t(uint8_t(Char)));
+				Out += Escaped;
+			}
+			else
+			{
+				Out += Char;
+			}
+		}
+		Out += '"';
+	}
+
+	/** Appends the common fields of an event, the trace format wants microseconds */
+	void AppendEventHeader(std::string& Out, const char* Name, const char* Phase, int64_t Timestamp, uint32_t ThreadId)
+	{
+		char Buffer[128];
+		Out += "{\"name\":";
+		AppendJsonString(Out, Name ? Name : "");
+		std::snprintf(Buffer, sizeof(Buffer), ",\"cat\":\"http\",\"ph\":\"%s\",\"ts\":%" PRId64 ".%03" PRId64 ",\"pid\":1,\"tid\":%" PRIu32,
+			Phase, Timestamp / 1000, Timestamp % 1000, ThreadId);
+		Out += Buffer;
+	}
+}
+
+void FHttpTrace::Start(size_t EventsPerThread)
+{
+	{
+		std::scoped_lock Lock(GBuffersLock);
+		GBuffers.clear();
+		GEventsPerThread = EventsPerThread;
+		GGeneration.fetch_add(1, std::memory_order_release);
+	}
+	bEnabled.store(true, std::memory_order_relaxed);
+}
+
+void FHttpTrace::Stop()
+{
+	bEnabled.store(false, std::memory_order_relaxed);
+}
+
+std::string FHttpTrace::ToChromeTraceJson()
+{
+	struct FThreadEvents
+	{
+		uint32_t ThreadId;
+		std::string ThreadName;
+		std::vector<FHttpTraceEvent> Events;
+	};
+	std::vector<FThreadEvents> Threads;
+	{
+		std::scoped_lock Lock(GBuffersLock);
+		Threads.reserve(GBuffers.size());
+		for (const std::shared_ptr<FHttpTraceBuffer>& Buffer : GBuffers)
+		{
+			FThreadEvents& Thread = Threads.emplace_back();
+			Thread.ThreadId = Buffer->ThreadId;
+			Thread.ThreadName = Buffer->ThreadName;
+			const uint64_t Capacity = Buffer->Capacity;
+			const uint64_t EndIndex = Buffer->WriteIndex.load(std::memory_order_acquire);
+			const uint64_t BeginIndex = EndIndex > Capacity ? EndIndex - Capacity : 0;
+			Thread.Events.reserve(size_t(EndIndex - BeginIndex));
+			for (uint64_t Index = BeginIndex; Index < EndIndex; ++Index)
+			{
+				const FHttpTraceEventSlot& Slot = Buffer->Events[Index % Capacity];
+				FHttpTraceEvent& Event = Thread.Events.emplace_back();
+				Event.Name = Slot.Name.load(std::memory_order_relaxed);
+				Event.Timestamp = Slot.Timestamp.load(std::memory_order_relaxed);
+				Event.Value = Slot.Value.load(std::memory_order_relaxed);
+				Event.Type = Slot.Type.load(std::memory_order_relaxed);
+			}
+			// the owning thread kept recording while copying, drop the events it may have been overwriting
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t LatestIndex = Buffer->WriteIndex.load(std::memory_order_relaxed);
+			const uint64_t FirstValidIndex = LatestIndex >= Capacity ? LatestIndex - Capacity + 1 : 0;
+			if (FirstValidIndex > BeginIndex)
+			{
+				const size_t Overwritten = size_t(std::min(FirstValidIndex, EndIndex) - BeginIndex);
+				Thread.Events.erase(Thread.Events.begin(), Thread.Events.begin() + Overwritten);
+			}
+		}
+	}
+
+	// timestamps relative to the oldest event keep the numbers short
+	int64_t BaseTimestamp = INT64_MAX;
+	for (const FThreadEvents& Thread : Threads)
+	{
+		for (const FHttpTraceEvent& Event : Thread.Events)
+		{
+			BaseTimestamp = std::min(BaseTimestamp, Event.Timestamp);
+		}
+	}
+
+	std::string Out;
+	Out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool bFirst = true;
+	auto Separate = [&Out, &bFirst]()
+	{
+		if (!bFirst)
+		{
+			Out += ",\n";
+		}
+		bFirst = false;
+	};
+	char Buffer[128];
+	for (const FThreadEvents& Thread : Threads)
+	{
+		if (!Thread.ThreadName.empty())
+		{
+			Separate();
+			std::snprintf(Buffer, sizeof(Buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"name\":", Thread.ThreadId);
+			Out += Buffer;
+			AppendJsonString(Out, Thread.ThreadName);
+			Out += "}}";
+		}
+		for (const FHttpTraceEvent& Event : Thread.Events)
+		{
+			Separate();
+			const int64_t Timestamp = Event.Timestamp - BaseTimestamp;
+			switch (Event.Type)
+			{
+				case EHttpTraceEventType::Begin:
+				{
+					AppendEventHeader(Out, Event.Name, "B", Timestamp, Thread.ThreadId);
+					break;
+				}
+				case EHttpTraceEventType::End:
+				{
+					AppendEventHeader(Out, Event.Name, "E", Timestamp, Thread.ThreadId);
+					break;
+				}
+				case EHttpTraceEventType::AsyncBegin:
+				case EHttpTraceEventType::AsyncStep:
+				case EHttpTraceEventType::AsyncEnd:
+				{
+					const char* Phase = Event.Type == EHttpTraceEventType::AsyncBegin ? "b" : Event.Type == EHttpTraceEventType::AsyncEnd ? "e" : "n";
+					// every event of an async operation shares the name of the operation, the step is in the args
+					AppendEventHeader(Out, "Request", Phase, Timestamp, Thread.ThreadId);
+					std::snprintf(Buffer, sizeof(Buffer), ",\"id\":\"0x%" PRIx64 "\",\"args\":{\"step\":", Event.Value);
+					Out += Buffer;
+					AppendJsonString(Out, Event.Name ? Event.Name : "");
+					Out += '}';
+					break;
+				}
+				case EHttpTraceEventType::Counter:
+				{
+					AppendEventHeader(Out, Event.Name, "C", Timestamp, Thread.ThreadId);
+					// one series per thread
+					std::snprintf(Buffer, sizeof(Buffer), ",\"id\":%" PRIu32 ",\"args\":{\"value\":%" PRId64 "}", Thread.ThreadId, int64_t(Event.Value));
+					Out += Buffer;
+					break;
+				}
+			}
+			Out += '}';
+		}
+	}
+	Out += "]}\n";
+	return Out;
+}
+
+bool FHttpTrace::WriteChromeTrace(const std::string& Path)
+{
+	std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+	if (!File)
+	{
+		return false;
+	}
+	const std::string Json = ToChromeTraceJson();
+	File.write(Json.data(), std::streamsize(Json.size()));
+	return bool(File);
+}
+
+void FHttpTrace::SetThreadName(const char* Name)
+{
+	FHttpTraceThreadState& State = GetThreadState();
+	State.ThreadName = Name ? Name : "";
+	std::scoped_lock Lock(GBuffersLock);
+	if (State.Buffer)
+	{
+		State.Buffer->ThreadName = State.ThreadName;
+	}
+}
+
+void FHttpTrace::BeginScope(const char* Name)
+{
+	RecordEvent(EHttpTraceEventType::Begin, Name, 0, 0);
+}
+
+void FHttpTrace::EndScope(const char* Name)
+{
+	RecordEvent(EHttpTraceEventType::End, Name, 0, 0);
+}
+
+void FHttpTrace::AsyncBegin(const char* Name, uint64_t Id, int64_t Timestamp)
+{
+	RecordEvent(EHttpTraceEventType::AsyncBegin, Name, Id, Timestamp);
+}
+
+void FHttpTrace::AsyncStep(const char* Name, uint64_t Id, int64_t Timestamp)
+{
+	RecordEvent(EHttpTraceEventType::AsyncStep, Name, Id, Timestamp);
+}
+
+void FHttpTrace::AsyncEnd(const char* Name, uint64_t Id, int64_t Timestamp)
+{
+	RecordEvent(EHttpTraceEventType::AsyncEnd, Name, Id, Timestamp);
+}
+
+void FHttpTrace::RequestPhases(uint64_t Id, const FHttpRequestTimings& Timings)
+{
+	const std::pair<const char*, int64_t> Phases[] =
+	{
+		{ "NameLookup", Timings.NameLookup },
+		{ "Connected", Timings.Connected },
+		{ "TlsHandshake", Timings.TlsHandshake },
+		{ "FirstByte", Timings.FirstByte },
+		{ "LastByte", Timings.LastByte },
+	};
+	for (const auto& [Name, Timestamp] : Phases)
+	{
+		if (Timestamp != 0)
+		{
+			RecordEvent(EHttpTraceEventType::AsyncStep, Name, Id, Timestamp);
+		}
+	}
+}
+
+void FHttpTrace::Counter(const char* Name, int64_t Value)
+{
+	RecordEvent(EHttpTraceEventType::Counter, Name, uint64_t(Value), 0);
+}
@@ -0,0 +1,80 @@
+#include "HttpTransport.h"
+#include "HttpHeaders.h"
+#include "LoopbackHttpManager.h"
+#include <logger.h>
+#if ONLINEPP_WITH_CURL_HTTP
+#include "CurlHttpManager.h"
+#endif
+#if ONLINEPP_WITH_UV_HTTP
+#include "UvHttpManager.h"
+#endif
+
+bool EHttpTransport::FromString(std::string_view Name, EHttpTransport::Type& OutTransport)
+{
+	for (const EHttpTransport::Type Transport : { Curl, Uv, Loopback })
+	{
+		if (HttpHeaderNameEquals(Name, ToString(Transport)))
+		{
+			OutTransport = Transport;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool EHttpTransport::IsAvailable(EHttpTransport::Type Transport)
+{
+	switch (Transport)
+	{
+		case Curl:
+		{
+#if ONLINEPP_WITH_CURL_HTTP
+			return true;
+#else
+			return false;
+#endif
+		}
+		case Uv:
+		{
+#if ONLINEPP_WITH_UV_HTTP
+			return true;
+#else
+			return false;
+#endif
+		}
+		case Loopback:
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::unique_ptr<FHttpManager> CreateHttpManager(EHttpTransport::Type Transport)
+{
+	switch (Transport)
+	{
+#if ONLINEPP_WITH_CURL_HTTP
+		case EHttpTransport::Curl:
+		{
+			return std::make_unique<FCurlHttpManager>();
+		}
+#endif
+#if ONLINEPP_WITH_UV_HTTP
+		case EHttpTransport::Uv:
+		{
+			return std::make_unique<FUvHttpManager>();
+		}
+#endif
+		case EHttpTransport::Loopback:
+		{
+			return std::make_unique<FLoopbackHttpManager>();
+		}
+		default:
+		{
+			break;
+		}
+	}
+	LOG_ERROR("CreateHttpManager() - the {} transport was not compiled in", EHttpTransport::ToString(Transport));
+	return nullptr;
+}
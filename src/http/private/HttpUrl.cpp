@@ -0,0 +1,185 @@
+#include "HttpUrl.h"
+
+bool FUrlView::Parse(std::string_view URL, FUrlView& OutUrl)
+{
+	OutUrl = FUrlView();
+	size_t Position = 0;
+
+	// scheme, only when followed by "://"
+	for (size_t Index = 0; Index < URL.size(); ++Index)
+	{
+		const char Char = URL[Index];
+		if (Char == ':')
+		{
+			if (Index > 0 && URL.compare(Index, 3, "://") == 0)
+			{
+				OutUrl.Scheme = URL.substr(0, Index);
+				Position = Index + 3;
+			}
+			break;
+		}
+		if (Char == '/' || Char == '?' || Char == '#')
+		{
+			break;
+		}
+	}
+
+	// authority runs until the path, query or fragment, a relative URL without one starts with its path
+	size_t AuthorityEnd = Position;
+	if (Position < URL.size() && URL[Position] != '/')
+	{
+		while (AuthorityEnd < URL.size() && URL[AuthorityEnd] != '/' && URL[AuthorityEnd] != '?' && URL[AuthorityEnd] != '#')
+		{
+			++AuthorityEnd;
+		}
+	}
+	OutUrl.Authority = URL.substr(Position, AuthorityEnd - Position);
+
+	std::string_view HostPort = OutUrl.Authority;
+	const size_t UserInfoEnd = HostPort.rfind('@');
+	if (UserInfoEnd != std::string_view::npos)
+	{
+		HostPort.remove_prefix(UserInfoEnd + 1);
+	}
+	size_t PortStart = std::string_view::npos;
+	if (!HostPort.empty() && HostPort.front() == '[')
+	{
+		const size_t Bracket = HostPort.find(']');
+		if (Bracket == std::string_view::npos)
+		{
+			OutUrl = FUrlView();
+			return false;
+		}
+		OutUrl.Host = HostPort.substr(1, Bracket - 1);
+		if (Bracket + 1 < HostPort.size())
+		{
+			if (HostPort[Bracket + 1] != ':')
+			{
+				OutUrl = FUrlView();
+				return false;
+			}
+			PortStart = Bracket + 2;
+		}
+	}
+	else
+	{
+		const size_t Colon = HostPort.find(':');
+		OutUrl.Host = HostPort.substr(0, Colon);
+		if (Colon != std::string_view::npos)
+		{
+			PortStart = Colon + 1;
+		}
+	}
+	if (PortStart != std::string_view::npos && PortStart < HostPort.size())
+	{
+		uint32_t Port = 0;
+		for (size_t Index = PortStart; Index < HostPort.size(); ++Index)
+		{
+			const char Char = HostPort[Index];
+			if (Char < '0' || Char > '9')
+			{
+				OutUrl = FUrlView();
+				return false;
+			}
+			Port = Port * 10 + uint32_t(Char - '0');
+			if (Port > UINT16_MAX)
+			{
+				OutUrl = FUrlView();
+				return false;
+			}
+		}
+		OutUrl.Port = uint16_t(Port);
+	}
+
+	Position = AuthorityEnd;
+	size_t PathEnd = Position;
+	while (PathEnd < URL.size() && URL[PathEnd] != '?' && URL[PathEnd] != '#')
+	{
+		++PathEnd;
+	}
+	OutUrl.Path = URL.substr(Position, PathEnd - Position);
+
+	Position = PathEnd;
+	if (Position < URL.size() && URL[Position] == '?')
+	{
+		const size_t QueryEnd = URL.find('#', Position + 1);
+		OutUrl.Query = URL.substr(Position + 1, QueryEnd == std::string_view::npos ? std::string_view::npos : QueryEnd - Position - 1);
+		Position = QueryEnd == std::string_view::npos ? URL.size() : QueryEnd;
+	}
+	if (Position < URL.size() && URL[Position] == '#')
+	{
+		OutUrl.Fragment = URL.substr(Position + 1);
+	}
+	return true;
+}
+
+uint16_t FUrlView::GetPortOrDefault() const
+{
+	if (Port != 0)
+	{
+		return Port;
+	}
+	auto SchemeIs = [this](std::string_view Name)
+	{
+		if (Scheme.size() != Name.size())
+		{
+			return false;
+		}
+		for (size_t Index = 0; Index < Name.size(); ++Index)
+		{
+			if ((Scheme[Index] | 0x20) != Name[Index])
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+	if (SchemeIs("https") || SchemeIs("wss"))
+	{
+		return 443;
+	}
+	if (SchemeIs("http") || SchemeIs("ws"))
+	{
+		return 80;
+	}
+	return 0;
+}
+
+FUrlQueryIterator::FUrlQueryIterator(std::string_view InQuery)
+	: Remaining(InQuery)
+	, Equals(std::string_view::npos)
+{
+	ReadPair();
+}
+
+FUrlQueryIterator& FUrlQueryIterator::operator++()
+{
+	ReadPair();
+	return *this;
+}
+
+void FUrlQueryIterator::ReadPair()
+{
+	Pair = std::string_view();
+	Equals = std::string_view::npos;
+	while (Pair.empty() && !Remaining.empty())
+	{
+		const size_t End = Remaining.find('&');
+		Pair = Remaining.substr(0, End);
+		Remaining = End == std::string_view::npos ? std::string_view() : Remaining.substr(End + 1);
+	}
+	Equals = Pair.find('=');
+}
+
+bool FindUrlQueryParameter(std::string_view Query, std::string_view ParameterName, std::string_view& OutValue)
+{
+	for (FUrlQueryIterator It(Query); It; ++It)
+	{
+		if (It.Key() == ParameterName)
+		{
+			OutValue = It.Value();
+			return true;
+		}
+	}
+	return false;
+}
@@ -1,34 +1,45 @@
-#pragma once
-#include <string>
-#include <regex>
-inline void ParseUrl(const std::string& inurl, std::string* outScheme = nullptr, std::string* outAuthority = nullptr, std::string* outPort = nullptr, std::string* outPath = nullptr, std::string* outQuery = nullptr, std::string* outFragment = nullptr) {
-    //https://www.rfc-editor.org/rfc/rfc3986#page-50
-    std::regex url_regex(
-        R"(^(([^:\/?#]+):\/\/)?(([^:\/?#]*)(:([0-9]+))?)?([^:?#]*)(\?([^#]*))?(#(.*))?)",
-        std::regex::extended
-    );
-    std::smatch url_match_result;
-    int counter = 0;
-    /*url.assign( R"###(localhost.com/path\?hue\=br\#cool)###");*/
-    if (!std::regex_match(inurl, url_match_result, url_regex)) {
-        return;
-    }
-    if (outScheme) {
-        *outScheme = url_match_result[2];
-    }
-    if (outAuthority) {
-        *outAuthority = url_match_result[4];
-    }
-    if (outPort) {
-        *outPort = url_match_result[6];
-    }
-    if (outPath) {
-        *outPath = url_match_result[7];
-    }
-    if (outQuery) {
-        *outQuery = url_match_result[9];
-    }
-    if (outFragment) {
-        *outFragment = url_match_result[11];
-    }
-}
\ No newline at end of file
+#include "CurlHttpManager.h"
+#include "CurlHttpThread.h"
+#include "CurlRequest.h"
+#include <logger.h>
+#include <mutex>
+
+static std::once_flag CurlInitFlag;
+
+FCurlHttpManager::FCurlHttpManager()
+{
+	InitCurl();
+}
+
+void FCurlHttpManager::InitCurl()
+{
+	std::call_once(CurlInitFlag, []()
+		{
+			const CURLcode InitResult = curl_global_init(CURL_GLOBAL_ALL);
+			if (InitResult != CURLE_OK)
+			{
+				LOG_ERROR("Could not initialize libcurl (result={}), HTTP transfers will not function properly.", int(InitResult));
+				return;
+			}
+			curl_version_info_data* VersionInfo = curl_version_info(CURLVERSION_NOW);
+			if (VersionInfo)
+			{
+				LOG_INFO("Using libcurl {}", VersionInfo->version);
+			}
+		});
+}
+
+void FCurlHttpManager::ShutdownCurl()
+{
+	curl_global_cleanup();
+}
+
+FHttpRequestPtr FCurlHttpManager::CreateRequest()
+{
+	return std::make_shared<FCurlHttpRequest>(*this);
+}
+
+FHttpThread* FCurlHttpManager::CreateHttpThread()
+{
+	return new FCurlHttpThread();
+}
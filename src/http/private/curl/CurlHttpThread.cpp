@@ -0,0 +1,387 @@
+#include "CurlHttpThread.h"
+#include "CurlRequest.h"
+#include "HttpUrl.h"
+#include <logger.h>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+
+static long ToCurlHttpVersion(EHttpVersion::Type HttpVersion)
+{
+	switch (HttpVersion)
+	{
+		case EHttpVersion::Http1_1:
+		{
+			return CURL_HTTP_VERSION_1_1;
+		}
+		case EHttpVersion::Http2:
+		{
+			return CURL_HTTP_VERSION_2_0;
+		}
+		case EHttpVersion::Http2PriorKnowledge:
+		{
+			return CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE;
+		}
+		default:
+		{
+			return CURL_HTTP_VERSION_NONE;
+		}
+	}
+}
+
+/** Seconds libcurl keeps an idle connection when CURLOPT_MAXAGE_CONN is not set */
+static constexpr double CurlDefaultMaxConnectionAgeSeconds = 118.0;
+
+/** @return the scheme, host and port of a url in lower case, the connections libcurl may reuse for it */
+static std::string MakePreconnectKey(std::string_view URL)
+{
+	FUrlView Url;
+	if (!FUrlView::Parse(URL, Url) || Url.Host.empty())
+	{
+		return std::string();
+	}
+	std::string Key;
+	Key.reserve(Url.Scheme.size() + Url.Host.size() + 9);
+	Key.append(Url.Scheme).append("://").append(Url.Host);
+	std::transform(Key.begin(), Key.end(), Key.begin(), [](unsigned char Char) { return char(std::tolower(Char)); });
+	Key.append(":").append(std::to_string(Url.GetPortOrDefault()));
+	return Key;
+}
+
+FCurlHttpThread::FCurlHttpThread()
+	: MultiHandle(nullptr)
+	, ShareHandle(nullptr)
+{
+	MultiHandle = curl_multi_init();
+	if (MultiHandle == nullptr)
+	{
+		LOG_ERROR("Could not create libcurl multi handle! HTTP transfers will not function properly.");
+	}
+	ShareHandle = curl_share_init();
+	if (ShareHandle == nullptr)
+	{
+		LOG_ERROR("Could not create libcurl share handle, DNS results and TLS sessions will not be reused.");
+	}
+}
+
+FCurlHttpThread::~FCurlHttpThread()
+{
+	StopThread();
+	if (MultiHandle)
+	{
+		for (const auto& [EasyHandle, Request] : HandlesToRequests)
+		{
+			curl_multi_remove_handle(MultiHandle, EasyHandle);
+			curl_easy_setopt(EasyHandle, CURLOPT_SHARE, nullptr);
+		}
+		HandlesToRequests.clear();
+		for (const auto& [EasyHandle, Key] : PreconnectHandles)
+		{
+			RemoveEasyHandle(EasyHandle);
+			curl_easy_cleanup(EasyHandle);
+		}
+		PreconnectHandles.clear();
+		curl_multi_cleanup(MultiHandle);
+		MultiHandle = nullptr;
+	}
+	if (ShareHandle)
+	{
+		curl_share_cleanup(ShareHandle);
+		ShareHandle = nullptr;
+	}
+}
+
+bool FCurlHttpThread::Init()
+{
+	if (MultiHandle)
+	{
+		curl_multi_setopt(MultiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, long(ConnectionSettings.MaxConnectionsPerHost));
+		curl_multi_setopt(MultiHandle, CURLMOPT_MAX_TOTAL_CONNECTIONS, long(ConnectionSettings.MaxTotalConnections));
+		if (ConnectionSettings.MaxIdleConnections > 0)
+		{
+			curl_multi_setopt(MultiHandle, CURLMOPT_MAXCONNECTS, long(ConnectionSettings.MaxIdleConnections));
+		}
+		curl_multi_setopt(MultiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+		if (ConnectionSettings.MaxConcurrentStreams > 0)
+		{
+			curl_multi_setopt(MultiHandle, CURLMOPT_MAX_CONCURRENT_STREAMS, long(ConnectionSettings.MaxConcurrentStreams));
+		}
+	}
+	if (ShareHandle)
+	{
+		curl_share_setopt(ShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		if (ConnectionSettings.bShareTlsSessions)
+		{
+			curl_share_setopt(ShareHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+		}
+	}
+	return FHttpThread::Init();
+}
+
+void FCurlHttpThread::ApplyConnectionSettings(CURL* EasyHandle, EHttpVersion::Type HttpVersion)
+{
+	if (ShareHandle)
+	{
+		curl_easy_setopt(EasyHandle, CURLOPT_SHARE, ShareHandle);
+	}
+	if (ConnectionSettings.IdleConnectionTimeout > 0.0f)
+	{
+		curl_easy_setopt(EasyHandle, CURLOPT_MAXAGE_CONN, long(ConnectionSettings.IdleConnectionTimeout));
+	}
+	if (ConnectionSettings.DnsCacheTimeout > 0.0f)
+	{
+		curl_easy_setopt(EasyHandle, CURLOPT_DNS_CACHE_TIMEOUT, long(ConnectionSettings.DnsCacheTimeout));
+	}
+	// set on every start, the request may have run on another http thread before
+	if (HttpVersion == EHttpVersion::Default)
+	{
+		HttpVersion = ConnectionSettings.HttpVersion;
+	}
+	curl_easy_setopt(EasyHandle, CURLOPT_HTTP_VERSION, ToCurlHttpVersion(HttpVersion));
+	const bool bMultiplexed = HttpVersion == EHttpVersion::Http2 || HttpVersion == EHttpVersion::Http2PriorKnowledge;
+	curl_easy_setopt(EasyHandle, CURLOPT_PIPEWAIT, long(bMultiplexed && ConnectionSettings.bWaitForMultiplexing));
+}
+
+void FCurlHttpThread::RemoveEasyHandle(CURL* EasyHandle)
+{
+	curl_multi_remove_handle(MultiHandle, EasyHandle);
+	// the request may be reused on another http thread, its caches stay here
+	curl_easy_setopt(EasyHandle, CURLOPT_SHARE, nullptr);
+}
+
+void FCurlHttpThread::HttpThreadTick(float DeltaSeconds)
+{
+	if (HandlesToRequests.empty() && PreconnectHandles.empty())
+	{
+		return;
+	}
+
+	// removing a finished transfer lets libcurl hand its connection to a transfer parked past the connection caps, but that
+	// only happens in curl_multi_perform and doesn't always arm a timer, so perform again rather than wait on a poll that never returns
+	bool bRemovedAny = true;
+	while (bRemovedAny)
+	{
+		bRemovedAny = false;
+		int RunningRequests = -1;
+		curl_multi_perform(MultiHandle, &RunningRequests);
+
+		// drain every transfer libcurl finished during this perform
+		CURLMsg* Message = nullptr;
+		int MessagesInQueue = 0;
+		while ((Message = curl_multi_info_read(MultiHandle, &MessagesInQueue)) != nullptr)
+		{
+			if (Message->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+			// the message is invalidated by curl_multi_remove_handle, grab everything first
+			CURL* CompletedHandle = Message->easy_handle;
+			const CURLcode CompletionResult = Message->data.result;
+			long NewConnections = 0;
+			const bool bHasConnectionInfo = CompletionResult == CURLE_OK && curl_easy_getinfo(CompletedHandle, CURLINFO_NUM_CONNECTS, &NewConnections) == CURLE_OK;
+			RemoveEasyHandle(CompletedHandle);
+			bRemovedAny = true;
+
+			if (!PreconnectHandles.empty() && PreconnectHandles.contains(CompletedHandle))
+			{
+				CompletePreconnect(CompletedHandle, CompletionResult, bHasConnectionInfo && NewConnections > 0);
+				continue;
+			}
+			if (bHasConnectionInfo)
+			{
+				if (NewConnections > 0)
+				{
+					++NewConnectionCount;
+				}
+				else
+				{
+					++ReusedConnectionCount;
+				}
+			}
+
+			auto Itr = HandlesToRequests.find(CompletedHandle);
+			if (Itr != HandlesToRequests.end())
+			{
+				if (bHasConnectionInfo && NewConnections == 0 && !UnclaimedPreconnects.empty())
+				{
+					ClaimPreconnectedConnection(CompletedHandle, *Itr->second);
+				}
+				FCurlHttpRequest* CurlRequest = static_cast<FCurlHttpRequest*>(Itr->second);
+				CurlRequest->MarkAsCompleted(CompletionResult);
+				HandlesToRequests.erase(Itr);
+			}
+		}
+	}
+}
+
+bool FCurlHttpThread::StartThreadedRequest(IHttpThreadedRequest* Request)
+{
+	if (MultiHandle == nullptr || !FHttpThread::StartThreadedRequest(Request))
+	{
+		return false;
+	}
+
+	FCurlHttpRequest* CurlRequest = static_cast<FCurlHttpRequest*>(Request);
+	CURL* EasyHandle = CurlRequest->GetEasyHandle();
+	ApplyConnectionSettings(EasyHandle, Request->GetHttpVersion());
+	// HTTP/2 servers favour the streams of higher priority requests sharing a connection
+	static const long StreamWeights[EHttpRequestPriority::Count] = { 256, 16, 8, 1 };
+	curl_easy_setopt(EasyHandle, CURLOPT_STREAM_WEIGHT, StreamWeights[std::min(Request->GetPriority(), EHttpRequestPriority::Type(EHttpRequestPriority::Count - 1))]);
+	const CURLMcode AddResult = curl_multi_add_handle(MultiHandle, EasyHandle);
+	if (AddResult != CURLM_OK)
+	{
+		LOG_ERROR("Failed to add easy handle {} to multi handle with code {}", (void*)EasyHandle, int(AddResult));
+		curl_easy_setopt(EasyHandle, CURLOPT_SHARE, nullptr);
+		return false;
+	}
+
+	HandlesToRequests.emplace(EasyHandle, Request);
+	return true;
+}
+
+void FCurlHttpThread::CompleteThreadedRequest(IHttpThreadedRequest* Request)
+{
+	// requests that were cancelled are still attached to the multi handle
+	FCurlHttpRequest* CurlRequest = static_cast<FCurlHttpRequest*>(Request);
+	CURL* EasyHandle = CurlRequest->GetEasyHandle();
+	auto Itr = HandlesToRequests.find(EasyHandle);
+	if (Itr != HandlesToRequests.end())
+	{
+		RemoveEasyHandle(EasyHandle);
+		HandlesToRequests.erase(Itr);
+		// perform again before waiting so a transfer parked past the connection caps gets the connection, see HttpThreadTick
+		WakeUp();
+	}
+}
+
+void FCurlHttpThread::WaitForActivity(double MaxWaitSeconds)
+{
+	if (MultiHandle == nullptr)
+	{
+		FHttpThread::WaitForActivity(MaxWaitSeconds);
+		return;
+	}
+	// libcurl returns early on socket activity and on curl_multi_wakeup, so wait until its next timer at the latest
+	long CurlTimeoutMs = -1;
+	curl_multi_timeout(MultiHandle, &CurlTimeoutMs);
+	int TimeoutMs = CurlTimeoutMs < 0 ? std::numeric_limits<int>::max() : int(std::min<long>(CurlTimeoutMs, std::numeric_limits<int>::max()));
+	if (MaxWaitSeconds >= 0.0)
+	{
+		TimeoutMs = std::min(TimeoutMs, int(std::ceil(MaxWaitSeconds * 1000.0)));
+	}
+	curl_multi_poll(MultiHandle, nullptr, 0, TimeoutMs, nullptr);
+}
+
+void FCurlHttpThread::WakeUp()
+{
+	if (MultiHandle == nullptr)
+	{
+		FHttpThread::WakeUp();
+		return;
+	}
+	curl_multi_wakeup(MultiHandle);
+}
+
+void FCurlHttpThread::StartPreconnect(const FHttpPreconnectTarget& Target)
+{
+	const std::string Key = MakePreconnectKey(Target.URL);
+	if (MultiHandle == nullptr || Key.empty())
+	{
+		LOG_INFO("FCurlHttpThread::StartPreconnect() - {} can't be preconnected", Target.URL);
+		++FailedPreconnectCount;
+		return;
+	}
+	ExpireUnclaimedPreconnects();
+	// concurrent transfers each take a connection, reusing the idle ones first, so the host ends up with at least ConnectionCount.
+	// Preconnects to the host still in flight count towards it.
+	uint32_t InFlightCount = 0;
+	for (const auto& [EasyHandle, HandleKey] : PreconnectHandles)
+	{
+		InFlightCount += HandleKey == Key ? 1 : 0;
+	}
+	for (uint32_t Index = InFlightCount; Index < Target.ConnectionCount; ++Index)
+	{
+		CURL* EasyHandle = curl_easy_init();
+		if (EasyHandle == nullptr)
+		{
+			++FailedPreconnectCount;
+			return;
+		}
+		curl_easy_setopt(EasyHandle, CURLOPT_NOSIGNAL, 1L);
+		curl_easy_setopt(EasyHandle, CURLOPT_URL, Target.URL.c_str());
+		curl_easy_setopt(EasyHandle, CURLOPT_NOBODY, 1L);
+		ApplyConnectionSettings(EasyHandle, EHttpVersion::Default);
+		if (curl_multi_add_handle(MultiHandle, EasyHandle) != CURLM_OK)
+		{
+			curl_easy_setopt(EasyHandle, CURLOPT_SHARE, nullptr);
+			curl_easy_cleanup(EasyHandle);
+			++FailedPreconnectCount;
+			return;
+		}
+		PreconnectHandles.emplace(EasyHandle, Key);
+	}
+}
+
+void FCurlHttpThread::CompletePreconnect(CURL* EasyHandle, CURLcode CompletionResult, bool bNewConnection)
+{
+	auto Itr = PreconnectHandles.find(EasyHandle);
+	if (CompletionResult != CURLE_OK)
+	{
+		LOG_INFO("FCurlHttpThread::CompletePreconnect() - preconnect to {} failed: {}", Itr->second, curl_easy_strerror(CompletionResult));
+		++FailedPreconnectCount;
+	}
+	else if (bNewConnection)
+	{
+		++PreconnectedConnectionCount;
+		long LocalPort = 0;
+		if (curl_easy_getinfo(EasyHandle, CURLINFO_LOCAL_PORT, &LocalPort) == CURLE_OK && LocalPort > 0)
+		{
+			// libcurl closes it once idle for the max age, the same timeout ApplyConnectionSettings gives it
+			const double MaxAgeSeconds = ConnectionSettings.IdleConnectionTimeout > 0.0f ? double(long(ConnectionSettings.IdleConnectionTimeout)) : CurlDefaultMaxConnectionAgeSeconds;
+			UnclaimedPreconnects[Itr->second].push_back(FUnclaimedPreconnect{ LocalPort, GetHttpTimestamp() + int64_t(MaxAgeSeconds * 1e9) });
+		}
+	}
+	PreconnectHandles.erase(Itr);
+	curl_easy_cleanup(EasyHandle);
+}
+
+void FCurlHttpThread::ClaimPreconnectedConnection(CURL* EasyHandle, IHttpThreadedRequest& Request)
+{
+	long LocalPort = 0;
+	if (curl_easy_getinfo(EasyHandle, CURLINFO_LOCAL_PORT, &LocalPort) != CURLE_OK)
+	{
+		return;
+	}
+	auto Itr = UnclaimedPreconnects.find(MakePreconnectKey(Request.GetURL()));
+	if (Itr == UnclaimedPreconnects.end())
+	{
+		return;
+	}
+	// the connection was picked when the transfer started, the preconnects closed before then can't be it
+	curl_off_t TotalMicroseconds = 0;
+	curl_easy_getinfo(EasyHandle, CURLINFO_TOTAL_TIME_T, &TotalMicroseconds);
+	const int64_t TransferStart = GetHttpTimestamp() - int64_t(TotalMicroseconds) * 1000;
+	std::vector<FUnclaimedPreconnect>& Preconnects = Itr->second;
+	std::erase_if(Preconnects, [TransferStart](const FUnclaimedPreconnect& Preconnect) { return Preconnect.ExpiryTimestamp <= TransferStart; });
+	auto PreconnectItr = std::find_if(Preconnects.begin(), Preconnects.end(), [LocalPort](const FUnclaimedPreconnect& Preconnect) { return Preconnect.LocalPort == LocalPort; });
+	if (PreconnectItr != Preconnects.end())
+	{
+		++UsedPreconnectedConnectionCount;
+		Preconnects.erase(PreconnectItr);
+	}
+	if (Preconnects.empty())
+	{
+		UnclaimedPreconnects.erase(Itr);
+	}
+}
+
+void FCurlHttpThread::ExpireUnclaimedPreconnects()
+{
+	const int64_t Now = GetHttpTimestamp();
+	for (auto Itr = UnclaimedPreconnects.begin(); Itr != UnclaimedPreconnects.end();)
+	{
+		std::erase_if(Itr->second, [Now](const FUnclaimedPreconnect& Preconnect) { return Preconnect.ExpiryTimestamp <= Now; });
+		Itr = Itr->second.empty() ? UnclaimedPreconnects.erase(Itr) : std::next(Itr);
+	}
+}
@@ -1 +1,380 @@
-#include <CurlRequest.h>
\ No newline at end of file
+#include "CurlRequest.h"
+#include "CurlResponse.h"
+#include "HttpTrace.h"
+#include <logger.h>
+#include <limits>
+
+FCurlHttpRequest::FCurlHttpRequest(FHttpManager& InManager)
+	: FHttpRequestBase(InManager)
+	, EasyHandle(nullptr)
+	, HeaderList(nullptr)
+	, CurlCompletionResult(CURLE_OK)
+	, bSendCompressedBody(false)
+	, bDecodeResponse(false)
+	, bResponseDecoderStarted(false)
+	, bResponseDecodeFailed(false)
+{
+	ErrorBuffer[0] = '\0';
+
+	EasyHandle = curl_easy_init();
+
+	// Always setup the header, body and upload callbacks
+	curl_easy_setopt(EasyHandle, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(EasyHandle, CURLOPT_ERRORBUFFER, ErrorBuffer);
+	curl_easy_setopt(EasyHandle, CURLOPT_HEADERDATA, this);
+	curl_easy_setopt(EasyHandle, CURLOPT_HEADERFUNCTION, StaticReceiveResponseHeaderCallback);
+	curl_easy_setopt(EasyHandle, CURLOPT_WRITEDATA, this);
+	curl_easy_setopt(EasyHandle, CURLOPT_WRITEFUNCTION, StaticReceiveResponseBodyCallback);
+	curl_easy_setopt(EasyHandle, CURLOPT_READDATA, this);
+	curl_easy_setopt(EasyHandle, CURLOPT_READFUNCTION, StaticUploadCallback);
+}
+
+FCurlHttpRequest::~FCurlHttpRequest()
+{
+	if (EasyHandle)
+	{
+		curl_easy_cleanup(EasyHandle);
+		EasyHandle = nullptr;
+	}
+	if (HeaderList)
+	{
+		curl_slist_free_all(HeaderList);
+		HeaderList = nullptr;
+	}
+}
+
+bool FCurlHttpRequest::SetupRequest()
+{
+	if (EasyHandle == nullptr)
+	{
+		LOG_ERROR("FCurlHttpRequest::SetupRequest() - no curl easy handle");
+		return false;
+	}
+
+	// reset the verb related options in case the request is being reused
+	curl_easy_setopt(EasyHandle, CURLOPT_HTTPGET, 1L);
+	curl_easy_setopt(EasyHandle, CURLOPT_CUSTOMREQUEST, nullptr);
+	curl_easy_setopt(EasyHandle, CURLOPT_URL, URL.c_str());
+
+	const std::string RequestVerb = GetVerb();
+
+	// RequestBody keeps the original for GetContent and the next run
+	bSendCompressedBody = false;
+	CompressedBody.Reset();
+	const std::span<const uint8_t> Buffer = RequestBody.GetBuffer();
+	if (ContentCompressionThreshold > 0 && !RequestBody.HasSource() && Buffer.size() >= ContentCompressionThreshold &&
+		!Headers.Contains(EHttpHeader::ContentEncoding))
+	{
+		std::vector<uint8_t> Compressed;
+		if (HttpGzipCompress(Buffer, Compressed) && Compressed.size() < Buffer.size())
+		{
+			CompressedBody.SetBuffer(std::move(Compressed));
+			bSendCompressedBody = true;
+		}
+	}
+
+	// -1 for a source of unknown size, libcurl then sends it chunked
+	const curl_off_t PayloadSize = curl_off_t(bSendCompressedBody ? CompressedBody.GetSize() : RequestBody.GetSize());
+	const bool bHasPayload = PayloadSize != 0;
+	if (RequestVerb == "GET")
+	{
+		// already set up above
+	}
+	else if (RequestVerb == "HEAD")
+	{
+		curl_easy_setopt(EasyHandle, CURLOPT_NOBODY, 1L);
+	}
+	else if (RequestVerb == "POST")
+	{
+		// the payload is fed through the read callback
+		curl_easy_setopt(EasyHandle, CURLOPT_POST, 1L);
+		curl_easy_setopt(EasyHandle, CURLOPT_POSTFIELDS, nullptr);
+		curl_easy_setopt(EasyHandle, CURLOPT_POSTFIELDSIZE_LARGE, PayloadSize);
+	}
+	else if (RequestVerb == "PUT")
+	{
+		curl_easy_setopt(EasyHandle, CURLOPT_UPLOAD, 1L);
+		curl_easy_setopt(EasyHandle, CURLOPT_INFILESIZE_LARGE, PayloadSize);
+	}
+	else
+	{
+		if (bHasPayload)
+		{
+			curl_easy_setopt(EasyHandle, CURLOPT_UPLOAD, 1L);
+			curl_easy_setopt(EasyHandle, CURLOPT_INFILESIZE_LARGE, PayloadSize);
+		}
+		curl_easy_setopt(EasyHandle, CURLOPT_CUSTOMREQUEST, RequestVerb.c_str());
+	}
+
+	curl_easy_setopt(EasyHandle, CURLOPT_CONNECTTIMEOUT_MS, long(ConnectTimeout * 1000.0f));
+
+	if (HeaderList)
+	{
+		curl_slist_free_all(HeaderList);
+		HeaderList = nullptr;
+	}
+	std::string HeaderLine;
+	for (const FHttpHeaders::FHeader Header : Headers)
+	{
+		HeaderLine.assign(Header.Name).append(": ").append(Header.Value);
+		HeaderList = curl_slist_append(HeaderList, HeaderLine.c_str());
+	}
+	if (bSendCompressedBody)
+	{
+		HeaderList = curl_slist_append(HeaderList, "Content-Encoding: gzip");
+	}
+	// an Accept-Encoding set by the caller means it handles the coding itself
+	bDecodeResponse = bDecompressResponse && !Headers.Contains(EHttpHeader::AcceptEncoding);
+	if (bDecodeResponse)
+	{
+		HeaderLine.assign(EHttpHeader::ToString(EHttpHeader::AcceptEncoding)).append(": ").append(HttpAcceptedContentEncodings);
+		HeaderList = curl_slist_append(HeaderList, HeaderLine.c_str());
+	}
+	// don't wait on a 100 Continue round trip before sending the payload
+	if (bHasPayload && !Headers.Contains(EHttpHeader::Expect))
+	{
+		HeaderList = curl_slist_append(HeaderList, "Expect:");
+	}
+	curl_easy_setopt(EasyHandle, CURLOPT_HTTPHEADER, HeaderList);
+
+	CurlCompletionResult = CURLE_OK;
+	ErrorBuffer[0] = '\0';
+	ResponseDecoder.Reset();
+	bResponseDecoderStarted = false;
+	bResponseDecodeFailed = false;
+	if (bStreamPaused)
+	{
+		// left paused by the previous run, the handle is detached so this is safe here
+		curl_easy_pause(EasyHandle, CURLPAUSE_CONT);
+	}
+	Response = std::make_shared<FCurlHttpResponse>(URL);
+	return true;
+}
+
+FHttpResponsePtr FCurlHttpRequest::GetTransferResponse() const
+{
+	return Response;
+}
+
+void FCurlHttpRequest::MarkAsCompleted(CURLcode InCurlCompletionResult)
+{
+	if (bResponseDecodeFailed || (InCurlCompletionResult == CURLE_OK && !ResponseDecoder.Finish()))
+	{
+		// corrupt or cut short
+		InCurlCompletionResult = CURLE_BAD_CONTENT_ENCODING;
+	}
+	const bool bDecodedResponse = ResponseDecoder.IsDecoding();
+	ResponseDecoder.Reset();
+	CurlCompletionResult = InCurlCompletionResult;
+
+	if (Response)
+	{
+		long HttpCode = 0;
+		if (curl_easy_getinfo(EasyHandle, CURLINFO_RESPONSE_CODE, &HttpCode) == CURLE_OK)
+		{
+			Response->HttpCode = int32_t(HttpCode);
+		}
+		long ResponseHttpVersion = CURL_HTTP_VERSION_NONE;
+		if (curl_easy_getinfo(EasyHandle, CURLINFO_HTTP_VERSION, &ResponseHttpVersion) == CURLE_OK)
+		{
+			Response->HttpVersion = ResponseHttpVersion == CURL_HTTP_VERSION_2_0 ? EHttpVersion::Http2 :
+				ResponseHttpVersion == CURL_HTTP_VERSION_1_1 || ResponseHttpVersion == CURL_HTTP_VERSION_1_0 ? EHttpVersion::Http1_1 : EHttpVersion::Default;
+		}
+		curl_off_t DownloadContentLength = -1;
+		// the announced length is the one of the encoded body
+		if (bDecodedResponse || curl_easy_getinfo(EasyHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &DownloadContentLength) != CURLE_OK || DownloadContentLength < 0)
+		{
+			DownloadContentLength = Response->TotalBytesRead;
+		}
+		// GetContentLength can't hold a body past 2 GiB, report it as unknown rather than truncated
+		Response->ContentLength = DownloadContentLength <= std::numeric_limits<int32_t>::max() ? int32_t(DownloadContentLength) : -1;
+		if (RequestStreamDelegate && InCurlCompletionResult == CURLE_OK)
+		{
+			DeliverResponseStream(std::span<const uint8_t>());
+		}
+		// complete now, the response cache reads it before the completion is delivered
+		Response->bIsReady = true;
+	}
+	double TotalTime = 0.0;
+	if (curl_easy_getinfo(EasyHandle, CURLINFO_TOTAL_TIME, &TotalTime) == CURLE_OK)
+	{
+		ElapsedTime = float(TotalTime);
+	}
+
+	// libcurl times are microseconds since the transfer started, 0 for a phase that was skipped
+	auto GetPhaseTimestamp = [this](CURLINFO Info) -> int64_t
+	{
+		curl_off_t Microseconds = 0;
+		if (curl_easy_getinfo(EasyHandle, Info, &Microseconds) != CURLE_OK || Microseconds <= 0)
+		{
+			return 0;
+		}
+		return Timings.Started + int64_t(Microseconds) * 1000;
+	};
+	Timings.NameLookup = GetPhaseTimestamp(CURLINFO_NAMELOOKUP_TIME_T);
+	Timings.Connected = GetPhaseTimestamp(CURLINFO_CONNECT_TIME_T);
+	Timings.TlsHandshake = GetPhaseTimestamp(CURLINFO_APPCONNECT_TIME_T);
+	Timings.FirstByte = GetPhaseTimestamp(CURLINFO_STARTTRANSFER_TIME_T);
+	Timings.LastByte = InCurlCompletionResult == CURLE_OK ? GetPhaseTimestamp(CURLINFO_TOTAL_TIME_T) : 0;
+	HTTP_TRACE_EVENT(RequestPhases(GetTraceId(), Timings));
+
+	bTransferCompleted = true;
+}
+
+bool FCurlHttpRequest::HasTransferSucceeded() const
+{
+	return CurlCompletionResult == CURLE_OK;
+}
+
+bool FCurlHttpRequest::IsTransferConnectionError() const
+{
+	return CurlCompletionResult == CURLE_COULDNT_CONNECT ||
+		CurlCompletionResult == CURLE_COULDNT_RESOLVE_PROXY ||
+		CurlCompletionResult == CURLE_COULDNT_RESOLVE_HOST;
+}
+
+std::string FCurlHttpRequest::GetTransferError() const
+{
+	return std::string(curl_easy_strerror(CurlCompletionResult)) + " (" + ErrorBuffer + ")";
+}
+
+void FCurlHttpRequest::MarkTransferResponseReady(bool bSucceeded)
+{
+	if (Response)
+	{
+		Response->bSucceeded = bSucceeded;
+		Response->bIsReady = true;
+	}
+}
+
+bool FCurlHttpRequest::PauseTransfer(bool bPause)
+{
+	curl_easy_pause(EasyHandle, bPause ? CURLPAUSE_RECV : CURLPAUSE_CONT);
+	return true;
+}
+
+void FCurlHttpRequest::AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue)
+{
+	// SetupRequest rebuilds the list for the next transfer
+	std::string HeaderLine;
+	HeaderLine.append(HeaderName).append(": ").append(HeaderValue);
+	HeaderList = curl_slist_append(HeaderList, HeaderLine.c_str());
+	curl_easy_setopt(EasyHandle, CURLOPT_HTTPHEADER, HeaderList);
+}
+
+size_t FCurlHttpRequest::StaticUploadCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData)
+{
+	FCurlHttpRequest* Request = reinterpret_cast<FCurlHttpRequest*>(UserData);
+	return Request->UploadCallback(Ptr, SizeInBlocks, BlockSizeInBytes);
+}
+
+size_t FCurlHttpRequest::StaticReceiveResponseHeaderCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData)
+{
+	FCurlHttpRequest* Request = reinterpret_cast<FCurlHttpRequest*>(UserData);
+	return Request->ReceiveResponseHeaderCallback(Ptr, SizeInBlocks, BlockSizeInBytes);
+}
+
+size_t FCurlHttpRequest::StaticReceiveResponseBodyCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData)
+{
+	FCurlHttpRequest* Request = reinterpret_cast<FCurlHttpRequest*>(UserData);
+	return Request->ReceiveResponseBodyCallback(Ptr, SizeInBlocks, BlockSizeInBytes);
+}
+
+size_t FCurlHttpRequest::UploadCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes)
+{
+	const size_t SizeSentThisTime = (bSendCompressedBody ? CompressedBody : RequestBody).Read(std::span<uint8_t>(reinterpret_cast<uint8_t*>(Ptr), SizeInBlocks * BlockSizeInBytes));
+	if (SizeSentThisTime == IHttpBodySource::ReadError)
+	{
+		LOG_ERROR("{} {} failed to read the content", GetVerb(), URL);
+		return CURL_READFUNC_ABORT;
+	}
+	BytesSent += SizeSentThisTime;
+	return SizeSentThisTime;
+}
+
+size_t FCurlHttpRequest::ReceiveResponseHeaderCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes)
+{
+	const size_t HeaderSize = SizeInBlocks * BlockSizeInBytes;
+	if (!Response || HeaderSize == 0)
+	{
+		return HeaderSize;
+	}
+
+	std::string_view Header(reinterpret_cast<const char*>(Ptr), HeaderSize);
+	while (!Header.empty() && (Header.back() == '\r' || Header.back() == '\n'))
+	{
+		Header.remove_suffix(1);
+	}
+
+	const size_t Colon = Header.find(':');
+	if (Colon != std::string_view::npos)
+	{
+		std::string_view Value = Header.substr(Colon + 1);
+		while (!Value.empty() && (Value.front() == ' ' || Value.front() == '\t'))
+		{
+			Value.remove_prefix(1);
+		}
+		Response->Headers.Append(Header.substr(0, Colon), Value);
+	}
+	else if (Header.starts_with("HTTP/"))
+	{
+		// a new status line (e.g. after 100 Continue) starts a new header block
+		Response->Headers.Empty();
+		ResponseDecoder.Reset();
+		bResponseDecoderStarted = false;
+	}
+	return HeaderSize;
+}
+
+size_t FCurlHttpRequest::ReceiveResponseBodyCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes)
+{
+	const size_t SizeToDownload = SizeInBlocks * BlockSizeInBytes;
+	if (!Response || SizeToDownload == 0)
+	{
+		return SizeToDownload;
+	}
+	if (bDecodeResponse && !bResponseDecoderStarted)
+	{
+		bResponseDecoderStarted = true;
+		const EHttpContentEncoding::Type Encoding = EHttpContentEncoding::FromString(Response->Headers.Find(EHttpHeader::ContentEncoding));
+		if (Encoding != EHttpContentEncoding::Identity)
+		{
+			if (!ResponseDecoder.Begin(Encoding))
+			{
+				bResponseDecodeFailed = true;
+				return 0;
+			}
+			// the headers describe the body handed out, which is the decoded one
+			Response->Headers.Remove(EHttpHeader::ToString(EHttpHeader::ContentEncoding));
+			Response->Headers.Remove(EHttpHeader::ToString(EHttpHeader::ContentLength));
+		}
+	}
+	BytesReceived += SizeToDownload;
+
+	const std::span<const uint8_t> Data(reinterpret_cast<const uint8_t*>(Ptr), SizeToDownload);
+	if (!ResponseDecoder.IsDecoding())
+	{
+		ReceiveResponseBody(Data);
+	}
+	else if (!ResponseDecoder.Decode(Data, [this](std::span<const uint8_t> Chunk) { ReceiveResponseBody(Chunk); }))
+	{
+		LOG_ERROR("{} {} failed to decode the response body", GetVerb(), URL);
+		// aborts the transfer
+		bResponseDecodeFailed = true;
+		return 0;
+	}
+	return SizeToDownload;
+}
+
+void FCurlHttpRequest::ReceiveResponseBody(std::span<const uint8_t> Chunk)
+{
+	if (RequestStreamDelegate)
+	{
+		DeliverResponseStream(Chunk);
+	}
+	else
+	{
+		Response->Payload.insert(Response->Payload.end(), Chunk.begin(), Chunk.end());
+	}
+	Response->TotalBytesRead += int64_t(Chunk.size());
+}
@@ -1,34 +1,88 @@
-#pragma once
-#include <string>
-#include <regex>
-inline void ParseUrl(const std::string& inurl, std::string* outScheme = nullptr, std::string* outAuthority = nullptr, std::string* outPort = nullptr, std::string* outPath = nullptr, std::string* outQuery = nullptr, std::string* outFragment = nullptr) {
-    //https://www.rfc-editor.org/rfc/rfc3986#page-50
-    std::regex url_regex(
-        R"(^(([^:\/?#]+):\/\/)?(([^:\/?#]*)(:([0-9]+))?)?([^:?#]*)(\?([^#]*))?(#(.*))?)",
-        std::regex::extended
-    );
-    std::smatch url_match_result;
-    int counter = 0;
-    /*url.assign( R"###(localhost.com/path\?hue\=br\#cool)###");*/
-    if (!std::regex_match(inurl, url_match_result, url_regex)) {
-        return;
-    }
-    if (outScheme) {
-        *outScheme = url_match_result[2];
-    }
-    if (outAuthority) {
-        *outAuthority = url_match_result[4];
-    }
-    if (outPort) {
-        *outPort = url_match_result[6];
-    }
-    if (outPath) {
-        *outPath = url_match_result[7];
-    }
-    if (outQuery) {
-        *outQuery = url_match_result[9];
-    }
-    if (outFragment) {
-        *outFragment = url_match_result[11];
-    }
-}
\ No newline at end of file
+#include "CurlResponse.h"
+#include "HttpUrl.h"
+
+FCurlHttpResponse::FCurlHttpResponse(const std::string& InURL)
+	: URL(InURL)
+	, TotalBytesRead(0)
+	, HttpCode(EHttpResponseCodes::Unknown)
+	, ContentLength(0)
+	, HttpVersion(EHttpVersion::Default)
+	, bIsReady(false)
+	, bSucceeded(false)
+{
+}
+
+FCurlHttpResponse::~FCurlHttpResponse()
+{
+}
+
+std::string FCurlHttpResponse::GetURL()
+{
+	return URL;
+}
+
+std::string FCurlHttpResponse::GetURLParameter(const std::string& ParameterName)
+{
+	FUrlView Url;
+	std::string_view Value;
+	if (FUrlView::Parse(URL, Url) && FindUrlQueryParameter(Url.Query, ParameterName, Value))
+	{
+		return std::string(Value);
+	}
+	return std::string();
+}
+
+std::string FCurlHttpResponse::GetHeader(const std::string& HeaderName)
+{
+	return std::string(GetHeaderView(HeaderName));
+}
+
+std::string_view FCurlHttpResponse::GetHeaderView(std::string_view HeaderName)
+{
+	if (!bIsReady)
+	{
+		return std::string_view();
+	}
+	return Headers.Find(HeaderName);
+}
+
+const FHttpHeaders& FCurlHttpResponse::GetHeaders()
+{
+	static const FHttpHeaders NoHeaders;
+	return bIsReady ? Headers : NoHeaders;
+}
+
+std::vector<std::string> FCurlHttpResponse::GetAllHeaders()
+{
+	return GetHeaders().ToStrings();
+}
+
+std::string FCurlHttpResponse::GetContentType()
+{
+	return GetHeader("Content-Type");
+}
+
+int32_t FCurlHttpResponse::GetContentLength()
+{
+	return ContentLength;
+}
+
+const std::vector<uint8_t>& FCurlHttpResponse::GetContent()
+{
+	return Payload;
+}
+
+int32_t FCurlHttpResponse::GetResponseCode()
+{
+	return HttpCode;
+}
+
+std::string FCurlHttpResponse::GetContentAsString()
+{
+	return std::string(reinterpret_cast<const char*>(Payload.data()), Payload.size());
+}
+
+EHttpVersion::Type FCurlHttpResponse::GetHttpVersion()
+{
+	return HttpVersion;
+}
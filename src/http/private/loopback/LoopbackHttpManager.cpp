@@ -0,0 +1,27 @@
+#include "LoopbackHttpManager.h"
+#include "LoopbackHttpThread.h"
+#include <logger.h>
+
+FLoopbackHttpManager::FLoopbackHttpManager()
+{
+}
+
+void FLoopbackHttpManager::SetResponder(FLoopbackHttpResponder InResponder)
+{
+	if (!Threads.empty())
+	{
+		LOG_INFO("FLoopbackHttpManager::SetResponder() - ignored, http threads are already running");
+		return;
+	}
+	Responder = std::move(InResponder);
+}
+
+FHttpRequestPtr FLoopbackHttpManager::CreateRequest()
+{
+	return std::make_shared<FLoopbackHttpRequest>(*this);
+}
+
+FHttpThread* FLoopbackHttpManager::CreateHttpThread()
+{
+	return new FLoopbackHttpThread(Responder);
+}
@@ -0,0 +1,97 @@
+#include "LoopbackHttpRequest.h"
+#include "LoopbackHttpResponse.h"
+#include "HttpTrace.h"
+#include <algorithm>
+
+FLoopbackHttpRequest::FLoopbackHttpRequest(FHttpManager& InManager)
+	: FHttpRequestBase(InManager)
+	, ReplyResult(EHttpRequestStatus::NotStarted)
+{
+}
+
+FLoopbackHttpRequest::~FLoopbackHttpRequest()
+{
+}
+
+bool FLoopbackHttpRequest::SetupRequest()
+{
+	ReplyResult = EHttpRequestStatus::NotStarted;
+	TransferHeaders.Empty();
+	Response = std::make_shared<FLoopbackHttpResponse>(URL);
+	return true;
+}
+
+FHttpResponsePtr FLoopbackHttpRequest::GetTransferResponse() const
+{
+	return Response;
+}
+
+void FLoopbackHttpRequest::MarkAsCompleted(FLoopbackHttpReply&& Reply)
+{
+	ReplyResult = Reply.Result;
+	const bool bReplySucceeded = ReplyResult == EHttpRequestStatus::Succeeded;
+	if (Response && bReplySucceeded)
+	{
+		Response->HttpCode = Reply.ResponseCode;
+		Response->Headers = std::move(Reply.Headers);
+		if (!Reply.Content)
+		{
+			Reply.Content = std::make_shared<const std::vector<uint8_t>>(Reply.ContentLength, uint8_t(0));
+		}
+		Response->ContentLength = int32_t(Reply.Content->size());
+		if (RequestStreamDelegate)
+		{
+			DeliverResponseStream(std::move(Reply.Content));
+			DeliverResponseStream(std::span<const uint8_t>());
+		}
+		else
+		{
+			Response->Payload = std::move(Reply.Content);
+		}
+		BytesReceived = size_t(Response->ContentLength);
+		// complete now, the response cache reads it before the completion is delivered
+		Response->bIsReady = true;
+	}
+	BytesSent = size_t(std::max<int64_t>(RequestBody.GetSize(), 0));
+
+	const int64_t Now = GetHttpTimestamp();
+	ElapsedTime = float(double(Now - Timings.Started) * 1e-9);
+	if (bReplySucceeded)
+	{
+		Timings.FirstByte = Now;
+		Timings.LastByte = Now;
+	}
+	HTTP_TRACE_EVENT(RequestPhases(GetTraceId(), Timings));
+
+	bTransferCompleted = true;
+}
+
+bool FLoopbackHttpRequest::HasTransferSucceeded() const
+{
+	return ReplyResult == EHttpRequestStatus::Succeeded;
+}
+
+bool FLoopbackHttpRequest::IsTransferConnectionError() const
+{
+	return ReplyResult == EHttpRequestStatus::Failed_ConnectionError;
+}
+
+std::string FLoopbackHttpRequest::GetTransferError() const
+{
+	// a scripted failure, nothing went wrong worth logging
+	return std::string();
+}
+
+void FLoopbackHttpRequest::MarkTransferResponseReady(bool bSucceeded)
+{
+	if (Response)
+	{
+		Response->bIsReady = true;
+	}
+}
+
+void FLoopbackHttpRequest::AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue)
+{
+	// cleared by SetupRequest for the next transfer
+	TransferHeaders.Append(HeaderName, HeaderValue);
+}
@@ -0,0 +1,87 @@
+#include "LoopbackHttpResponse.h"
+#include "HttpUrl.h"
+
+FLoopbackHttpResponse::FLoopbackHttpResponse(const std::string& InURL)
+	: URL(InURL)
+	, HttpCode(EHttpResponseCodes::Unknown)
+	, ContentLength(0)
+	, bIsReady(false)
+{
+}
+
+FLoopbackHttpResponse::~FLoopbackHttpResponse()
+{
+}
+
+std::string FLoopbackHttpResponse::GetURL()
+{
+	return URL;
+}
+
+std::string FLoopbackHttpResponse::GetURLParameter(const std::string& ParameterName)
+{
+	FUrlView Url;
+	std::string_view Value;
+	if (FUrlView::Parse(URL, Url) && FindUrlQueryParameter(Url.Query, ParameterName, Value))
+	{
+		return std::string(Value);
+	}
+	return std::string();
+}
+
+std::string FLoopbackHttpResponse::GetHeader(const std::string& HeaderName)
+{
+	return std::string(GetHeaderView(HeaderName));
+}
+
+std::string_view FLoopbackHttpResponse::GetHeaderView(std::string_view HeaderName)
+{
+	if (!bIsReady)
+	{
+		return std::string_view();
+	}
+	return Headers.Find(HeaderName);
+}
+
+const FHttpHeaders& FLoopbackHttpResponse::GetHeaders()
+{
+	static const FHttpHeaders NoHeaders;
+	return bIsReady ? Headers : NoHeaders;
+}
+
+std::vector<std::string> FLoopbackHttpResponse::GetAllHeaders()
+{
+	return GetHeaders().ToStrings();
+}
+
+std::string FLoopbackHttpResponse::GetContentType()
+{
+	return GetHeader("Content-Type");
+}
+
+int32_t FLoopbackHttpResponse::GetContentLength()
+{
+	return ContentLength;
+}
+
+const std::vector<uint8_t>& FLoopbackHttpResponse::GetContent()
+{
+	static const std::vector<uint8_t> NoContent;
+	return Payload ? *Payload : NoContent;
+}
+
+int32_t FLoopbackHttpResponse::GetResponseCode()
+{
+	return HttpCode;
+}
+
+std::string FLoopbackHttpResponse::GetContentAsString()
+{
+	const std::vector<uint8_t>& Content = GetContent();
+	return std::string(reinterpret_cast<const char*>(Content.data()), Content.size());
+}
+
+EHttpVersion::Type FLoopbackHttpResponse::GetHttpVersion()
+{
+	return EHttpVersion::Http1_1;
+}
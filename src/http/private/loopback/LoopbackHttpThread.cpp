@@ -0,0 +1,71 @@
+#include "LoopbackHttpThread.h"
+#include "HttpTimings.h"
+#include <algorithm>
+
+FLoopbackHttpThread::FLoopbackHttpThread(FLoopbackHttpResponder InResponder)
+	: Responder(std::move(InResponder))
+{
+}
+
+FLoopbackHttpThread::~FLoopbackHttpThread()
+{
+	StopThread();
+}
+
+void FLoopbackHttpThread::HttpThreadTick(float DeltaSeconds)
+{
+	const int64_t Now = GetHttpTimestamp();
+	while (!DelayedReplies.empty() && DelayedReplies.begin()->first <= Now)
+	{
+		auto Itr = DelayedReplies.begin();
+		FLoopbackHttpRequest* Request = Itr->second.Request;
+		FLoopbackHttpReply Reply = std::move(Itr->second.Reply);
+		RequestsToReplies.erase(Request);
+		DelayedReplies.erase(Itr);
+		Request->MarkAsCompleted(std::move(Reply));
+	}
+}
+
+bool FLoopbackHttpThread::StartThreadedRequest(IHttpThreadedRequest* Request)
+{
+	if (!FHttpThread::StartThreadedRequest(Request))
+	{
+		return false;
+	}
+
+	FLoopbackHttpRequest* LoopbackRequest = static_cast<FLoopbackHttpRequest*>(Request);
+	FLoopbackHttpReply Reply = Responder ? Responder(*LoopbackRequest) : FLoopbackHttpReply();
+	if (Reply.LatencySeconds <= 0.0)
+	{
+		// picked up as complete by the same pass
+		LoopbackRequest->MarkAsCompleted(std::move(Reply));
+		return true;
+	}
+
+	const int64_t DueTime = GetHttpTimestamp() + int64_t(Reply.LatencySeconds * 1e9);
+	auto Itr = DelayedReplies.emplace(DueTime, FDelayedReply{ LoopbackRequest, std::move(Reply) });
+	RequestsToReplies.emplace(Request, Itr);
+	return true;
+}
+
+void FLoopbackHttpThread::CompleteThreadedRequest(IHttpThreadedRequest* Request)
+{
+	// requests that were cancelled or timed out still wait for their reply
+	auto Itr = RequestsToReplies.find(Request);
+	if (Itr != RequestsToReplies.end())
+	{
+		DelayedReplies.erase(Itr->second);
+		RequestsToReplies.erase(Itr);
+	}
+}
+
+void FLoopbackHttpThread::WaitForActivity(double MaxWaitSeconds)
+{
+	if (!DelayedReplies.empty())
+	{
+		// wake up for the next reply rather than a frame later
+		const double NextReplySeconds = std::max<double>(double(DelayedReplies.begin()->first - GetHttpTimestamp()) * 1e-9, 0.0);
+		MaxWaitSeconds = MaxWaitSeconds < 0.0 ? NextReplySeconds : std::min(MaxWaitSeconds, NextReplySeconds);
+	}
+	FHttpThread::WaitForActivity(MaxWaitSeconds);
+}
@@ -0,0 +1,17 @@
+#include "UvHttpManager.h"
+#include "UvHttpThread.h"
+#include "UvRequest.h"
+
+FUvHttpManager::FUvHttpManager()
+{
+}
+
+FHttpRequestPtr FUvHttpManager::CreateRequest()
+{
+	return std::make_shared<FUvHttpRequest>(*this);
+}
+
+FHttpThread* FUvHttpManager::CreateHttpThread()
+{
+	return new FUvHttpThread();
+}
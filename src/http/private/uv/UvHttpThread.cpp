@@ -0,0 +1,742 @@
+#include "UvHttpThread.h"
+#include "UvRequest.h"
+#include "HttpUrl.h"
+#include <logger.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+/** Size of the buffer of each connection the socket is read into */
+static constexpr size_t UvReadBufferSize = 64 * 1024;
+/** Largest part of a streamed payload written at once */
+static constexpr size_t UvUploadChunkSize = 64 * 1024;
+/** Defaults matching the ones of libcurl, used when the connection settings leave them at 0 */
+static constexpr double UvDefaultIdleConnectionTimeout = 118.0;
+static constexpr double UvDefaultDnsCacheTimeout = 60.0;
+
+FUvHttpThread::FUvHttpThread()
+	: OpenConnectionCount(0)
+	, IdleConnectionCount(0)
+	, NextIdleCheckTime(0)
+	, bShuttingDown(false)
+{
+	// set up here rather than in Init, WakeUp may be called before the thread starts
+	uv_loop_init(&Loop);
+	Loop.data = this;
+	uv_async_init(&Loop, &WakeUpSignal, [](uv_async_t*) {});
+	uv_timer_init(&Loop, &WaitTimer);
+}
+
+FUvHttpThread::~FUvHttpThread()
+{
+	StopThread();
+
+	bShuttingDown = true;
+	for (const auto& [Key, Pool] : HostPools)
+	{
+		if (Pool->Resolver)
+		{
+			// a resolution already running on the libuv thread pool can't be cancelled, its callback frees it
+			uv_cancel(reinterpret_cast<uv_req_t*>(Pool->Resolver));
+		}
+	}
+	uv_walk(&Loop, [](uv_handle_t* Handle, void*)
+		{
+			if (!uv_is_closing(Handle))
+			{
+				uv_close(Handle, Handle->type == UV_TCP ? OnClose : nullptr);
+			}
+		}, nullptr);
+	uv_run(&Loop, UV_RUN_DEFAULT);
+	if (uv_loop_close(&Loop) != 0)
+	{
+		LOG_ERROR("FUvHttpThread::~FUvHttpThread() - the loop still had active handles");
+	}
+}
+
+void FUvHttpThread::WakeUp()
+{
+	uv_async_send(&WakeUpSignal);
+}
+
+void FUvHttpThread::SetReceivePaused(FUvHttpConnection& Connection, bool bPaused)
+{
+	if (!Connection.bConnected || Connection.bClosing || bPaused != Connection.bReading)
+	{
+		return;
+	}
+	if (bPaused)
+	{
+		uv_read_stop(reinterpret_cast<uv_stream_t*>(&Connection.Handle));
+	}
+	else
+	{
+		uv_read_start(reinterpret_cast<uv_stream_t*>(&Connection.Handle), OnAlloc, OnRead);
+	}
+	Connection.bReading = !bPaused;
+}
+
+void FUvHttpThread::HttpThreadTick(float DeltaSeconds)
+{
+	// callbacks run here when the thread is pumped by Tick, WaitForActivity runs them otherwise
+	uv_run(&Loop, UV_RUN_NOWAIT);
+
+	if (IdleConnectionCount > 0 && uv_now(&Loop) >= NextIdleCheckTime)
+	{
+		NextIdleCheckTime = uv_now(&Loop) + 1000;
+		CloseExpiredConnections();
+	}
+}
+
+bool FUvHttpThread::StartThreadedRequest(IHttpThreadedRequest* Request)
+{
+	if (!FHttpThread::StartThreadedRequest(Request))
+	{
+		return false;
+	}
+
+	FUvHttpRequest* UvRequest = static_cast<FUvHttpRequest*>(Request);
+	UvRequest->bRetried = false;
+	AssignConnection(GetHostPool(UvRequest->ConnectionKey, UvRequest->Host, UvRequest->Port), UvRequest);
+	return true;
+}
+
+void FUvHttpThread::CompleteThreadedRequest(IHttpThreadedRequest* Request)
+{
+	// requests that were cancelled or timed out are still in flight or waiting for a connection
+	FUvHttpRequest* UvRequest = static_cast<FUvHttpRequest*>(Request);
+	if (FUvHttpConnection* Connection = UvRequest->Connection)
+	{
+		// the rest of the response can't be told apart from the next one, the connection can't be reused
+		Connection->Request = nullptr;
+		UvRequest->Connection = nullptr;
+		CloseConnection(*Connection);
+		return;
+	}
+	auto PoolItr = HostPools.find(UvRequest->ConnectionKey);
+	if (PoolItr != HostPools.end())
+	{
+		std::deque<FUvHttpRequest*>& WaitingRequests = PoolItr->second->WaitingRequests;
+		auto Itr = std::find(WaitingRequests.begin(), WaitingRequests.end(), UvRequest);
+		if (Itr != WaitingRequests.end())
+		{
+			WaitingRequests.erase(Itr);
+		}
+	}
+}
+
+void FUvHttpThread::WaitForActivity(double MaxWaitSeconds)
+{
+	// the loop returns early on socket activity, on WakeUp and once the wait timer is due
+	if (MaxWaitSeconds >= 0.0)
+	{
+		uv_timer_start(&WaitTimer, [](uv_timer_t*) {}, uint64_t(std::ceil(MaxWaitSeconds * 1000.0)), 0);
+	}
+	uv_run(&Loop, UV_RUN_ONCE);
+	uv_timer_stop(&WaitTimer);
+}
+
+double FUvHttpThread::GetMaxActivityWaitSeconds() const
+{
+	// sockets wake the loop up and timeouts are on the timer wheel, only the idle connections expire on their own
+	const double WaitSeconds = FHttpThread::GetMaxActivityWaitSeconds();
+	if (IdleConnectionCount == 0)
+	{
+		return WaitSeconds;
+	}
+	const uint64_t Now = uv_now(&Loop);
+	const double IdleCheckSeconds = NextIdleCheckTime > Now ? double(NextIdleCheckTime - Now) * 1e-3 : 0.0;
+	return WaitSeconds < 0.0 ? IdleCheckSeconds : std::min(WaitSeconds, IdleCheckSeconds);
+}
+
+void FUvHttpThread::StartPreconnect(const FHttpPreconnectTarget& Target)
+{
+	FUrlView Url;
+	if (!FUrlView::Parse(Target.URL, Url) || Url.Host.empty() || !HttpHeaderNameEquals(Url.Scheme, "http"))
+	{
+		LOG_INFO("FUvHttpThread::StartPreconnect() - {} is not a plain http url, nothing to preconnect", Target.URL);
+		++FailedPreconnectCount;
+		return;
+	}
+	const std::string Host(Url.Host);
+	const uint16_t Port = Url.GetPortOrDefault();
+	FUvHttpHostPool& Pool = GetHostPool(Host + ":" + std::to_string(Port), Host, Port);
+	// connections already open, or being opened, to the host count towards the target. Unlike a request, a preconnect
+	// never closes the idle connections of other hosts to make room.
+	for (uint32_t Index = Pool.OpenConnectionCount; Index < Target.ConnectionCount; ++Index)
+	{
+		if ((ConnectionSettings.MaxConnectionsPerHost > 0 && Pool.OpenConnectionCount >= ConnectionSettings.MaxConnectionsPerHost) ||
+			(ConnectionSettings.MaxTotalConnections > 0 && OpenConnectionCount >= ConnectionSettings.MaxTotalConnections))
+		{
+			break;
+		}
+		OpenConnection(Pool, nullptr, 0, true);
+	}
+}
+
+FUvHttpHostPool& FUvHttpThread::GetHostPool(const std::string& ConnectionKey, const std::string& Host, uint16_t Port)
+{
+	std::unique_ptr<FUvHttpHostPool>& Pool = HostPools[ConnectionKey];
+	if (!Pool)
+	{
+		Pool = std::make_unique<FUvHttpHostPool>();
+		Pool->Host = Host;
+		Pool->Port = Port;
+	}
+	return *Pool;
+}
+
+void FUvHttpThread::AssignConnection(FUvHttpHostPool& Pool, FUvHttpRequest* Request)
+{
+	if (!Pool.IdleConnections.empty())
+	{
+		FUvHttpConnection* Connection = Pool.IdleConnections.back();
+		Pool.IdleConnections.pop_back();
+		--IdleConnectionCount;
+		SendRequest(*Connection, Request);
+	}
+	else if (CanOpenConnection(Pool))
+	{
+		OpenConnection(Pool, Request, 0, false);
+	}
+	else
+	{
+		Pool.WaitingRequests.push_back(Request);
+	}
+}
+
+bool FUvHttpThread::CanOpenConnection(FUvHttpHostPool& Pool)
+{
+	if (ConnectionSettings.MaxConnectionsPerHost > 0 && Pool.OpenConnectionCount >= ConnectionSettings.MaxConnectionsPerHost)
+	{
+		return false;
+	}
+	if (ConnectionSettings.MaxTotalConnections == 0 || OpenConnectionCount < ConnectionSettings.MaxTotalConnections)
+	{
+		return true;
+	}
+	// make room by closing a connection nobody is using
+	for (const auto& [Key, OtherPool] : HostPools)
+	{
+		if (!OtherPool->IdleConnections.empty())
+		{
+			// closing serves waiting requests first, which may take the slot back
+			CloseConnection(*OtherPool->IdleConnections.front());
+			return CanOpenConnection(Pool);
+		}
+	}
+	return false;
+}
+
+void FUvHttpThread::OpenConnection(FUvHttpHostPool& Pool, FUvHttpRequest* Request, size_t AddressIndex, bool bPreconnect)
+{
+	FUvHttpConnection* Connection = new FUvHttpConnection();
+	uv_tcp_init(&Loop, &Connection->Handle);
+	Connection->Handle.data = Connection;
+	Connection->Pool = &Pool;
+	Connection->Request = Request;
+	Connection->AddressIndex = AddressIndex;
+	Connection->bPreconnected = bPreconnect;
+	if (Request)
+	{
+		Request->Connection = Connection;
+	}
+	++Pool.OpenConnectionCount;
+	++OpenConnectionCount;
+
+	const float ConnectTimeout = Request ? Request->GetConnectTimeout() : 0.0f;
+	if (ConnectTimeout > 0.0f)
+	{
+		Connection->ConnectTimer = Timers.Schedule(ConnectTimeout, [this, Connection]()
+			{
+				Connection->bHasConnectTimer = false;
+				FailConnection(*Connection, UV_ETIMEDOUT);
+			});
+		Connection->bHasConnectTimer = true;
+	}
+
+	if (!Pool.Addresses.empty() && uv_now(&Loop) < Pool.AddressesExpireTime)
+	{
+		Connect(*Connection);
+		return;
+	}
+	Pool.ResolvingConnections.push_back(Connection);
+	if (Pool.Resolver == nullptr)
+	{
+		ResolveHost(Pool);
+	}
+}
+
+void FUvHttpThread::ResolveHost(FUvHttpHostPool& Pool)
+{
+	sockaddr_storage Address = {};
+	if (uv_ip4_addr(Pool.Host.c_str(), Pool.Port, reinterpret_cast<sockaddr_in*>(&Address)) == 0 ||
+		uv_ip6_addr(Pool.Host.c_str(), Pool.Port, reinterpret_cast<sockaddr_in6*>(&Address)) == 0)
+	{
+		// nothing to resolve, and nothing that can change
+		Pool.Addresses.assign(1, Address);
+		Pool.AddressesExpireTime = UINT64_MAX;
+		std::vector<FUvHttpConnection*> Connections = std::move(Pool.ResolvingConnections);
+		Pool.ResolvingConnections.clear();
+		for (FUvHttpConnection* Connection : Connections)
+		{
+			Connect(*Connection);
+		}
+		return;
+	}
+
+	addrinfo Hints = {};
+	Hints.ai_family = AF_UNSPEC;
+	Hints.ai_socktype = SOCK_STREAM;
+	Hints.ai_protocol = IPPROTO_TCP;
+	char Service[8];
+	std::snprintf(Service, sizeof(Service), "%u", unsigned(Pool.Port));
+
+	Pool.Resolver = new uv_getaddrinfo_t();
+	Pool.Resolver->data = &Pool;
+	const int Result = uv_getaddrinfo(&Loop, Pool.Resolver, OnResolved, Pool.Host.c_str(), Service, &Hints);
+	if (Result != 0)
+	{
+		delete Pool.Resolver;
+		Pool.Resolver = nullptr;
+		std::vector<FUvHttpConnection*> Connections = std::move(Pool.ResolvingConnections);
+		Pool.ResolvingConnections.clear();
+		for (FUvHttpConnection* Connection : Connections)
+		{
+			FailConnection(*Connection, Result);
+		}
+	}
+}
+
+void FUvHttpThread::OnResolved(uv_getaddrinfo_t* Resolver, int Status, addrinfo* Result)
+{
+	FUvHttpThread& Thread = *static_cast<FUvHttpThread*>(Resolver->loop->data);
+	FUvHttpHostPool& Pool = *static_cast<FUvHttpHostPool*>(Resolver->data);
+	delete Resolver;
+	if (Thread.bShuttingDown)
+	{
+		uv_freeaddrinfo(Result);
+		return;
+	}
+	Pool.Resolver = nullptr;
+
+	Pool.Addresses.clear();
+	for (const addrinfo* Info = Result; Status == 0 && Info != nullptr; Info = Info->ai_next)
+	{
+		if (Info->ai_addrlen <= sizeof(sockaddr_storage))
+		{
+			sockaddr_storage& Address = Pool.Addresses.emplace_back();
+			std::memcpy(&Address, Info->ai_addr, Info->ai_addrlen);
+		}
+	}
+	uv_freeaddrinfo(Result);
+	if (Status == 0 && Pool.Addresses.empty())
+	{
+		Status = UV_EAI_NONAME;
+	}
+	const double DnsCacheTimeout = Thread.ConnectionSettings.DnsCacheTimeout > 0.0f ? Thread.ConnectionSettings.DnsCacheTimeout : UvDefaultDnsCacheTimeout;
+	Pool.AddressesExpireTime = Status == 0 ? uv_now(&Thread.Loop) + uint64_t(DnsCacheTimeout * 1000.0) : 0;
+
+	// connecting may fail and close connections right away, which edits the list
+	std::vector<FUvHttpConnection*> Connections = std::move(Pool.ResolvingConnections);
+	Pool.ResolvingConnections.clear();
+	for (FUvHttpConnection* Connection : Connections)
+	{
+		if (Status != 0)
+		{
+			Thread.FailConnection(*Connection, Status);
+			continue;
+		}
+		if (Connection->Request)
+		{
+			Connection->Request->Timings.NameLookup = GetHttpTimestamp();
+		}
+		Thread.Connect(*Connection);
+	}
+}
+
+void FUvHttpThread::Connect(FUvHttpConnection& Connection)
+{
+	const sockaddr_storage& Address = Connection.Pool->Addresses[std::min(Connection.AddressIndex, Connection.Pool->Addresses.size() - 1)];
+	Connection.ConnectRequest.data = &Connection;
+	const int Result = uv_tcp_connect(&Connection.ConnectRequest, &Connection.Handle, reinterpret_cast<const sockaddr*>(&Address), OnConnect);
+	if (Result != 0)
+	{
+		FailConnection(Connection, Result);
+	}
+}
+
+void FUvHttpThread::OnConnect(uv_connect_t* ConnectRequest, int Status)
+{
+	FUvHttpConnection& Connection = *static_cast<FUvHttpConnection*>(ConnectRequest->data);
+	FUvHttpThread& Thread = GetThread(Connection);
+	if (Connection.bClosing || Thread.bShuttingDown)
+	{
+		return;
+	}
+	if (Connection.bHasConnectTimer)
+	{
+		Thread.Timers.Cancel(Connection.ConnectTimer);
+		Connection.bHasConnectTimer = false;
+	}
+
+	FUvHttpRequest* Request = Connection.Request;
+	if (Status != 0)
+	{
+		FUvHttpHostPool& Pool = *Connection.Pool;
+		const size_t NextAddressIndex = Connection.AddressIndex + 1;
+		if ((Request || Connection.bPreconnected) && NextAddressIndex < Pool.Addresses.size())
+		{
+			// e.g. ::1 refused by a server only listening on 127.0.0.1. Opened before the close, which would hand the slot to a waiting request.
+			Connection.Request = nullptr;
+			Thread.OpenConnection(Pool, Request, NextAddressIndex, Connection.bPreconnected);
+			Thread.CloseConnection(Connection);
+			return;
+		}
+		Thread.FailConnection(Connection, Status);
+		return;
+	}
+
+	Connection.bConnected = true;
+	uv_tcp_nodelay(&Connection.Handle, 1);
+	Connection.ReadBuffer.reset(new uint8_t[UvReadBufferSize]);
+	Connection.bReading = true;
+	uv_read_start(reinterpret_cast<uv_stream_t*>(&Connection.Handle), OnAlloc, OnRead);
+	if (Request == nullptr)
+	{
+		// a request leaving a connection being opened closes it, only a preconnect gets here
+		++Thread.PreconnectedConnectionCount;
+		Thread.ReleaseConnection(Connection);
+		return;
+	}
+	Request->Timings.Connected = GetHttpTimestamp();
+	Thread.SendRequest(Connection, Request);
+}
+
+void FUvHttpThread::SendRequest(FUvHttpConnection& Connection, FUvHttpRequest* Request)
+{
+	Connection.Request = Request;
+	Request->Connection = &Connection;
+	Connection.Parser.Reset(Request->bHeadRequest);
+	if (Connection.bPreconnected && Connection.CompletedRequestCount == 0)
+	{
+		++UsedPreconnectedConnectionCount;
+	}
+	if (!Connection.bReading)
+	{
+		// left paused by the previous response
+		SetReceivePaused(Connection, false);
+	}
+
+	// request line and headers, the empty line and an in memory payload go out in a single writev
+	static const char EndOfHead[] = "\r\n";
+	uv_buf_t Buffers[4];
+	uint32_t BufferCount = 0;
+	Buffers[BufferCount++] = uv_buf_init(Request->RequestHead.data(), uint32_t(Request->RequestHead.size()));
+	if (!Request->TransferHeaderLines.empty())
+	{
+		Buffers[BufferCount++] = uv_buf_init(Request->TransferHeaderLines.data(), uint32_t(Request->TransferHeaderLines.size()));
+	}
+	Buffers[BufferCount++] = uv_buf_init(const_cast<char*>(EndOfHead), 2);
+
+	FHttpRequestBody& Body = Request->GetUploadBody();
+	Connection.PendingUploadBytes = 0;
+	Connection.bUploading = false;
+	if (Request->bSendBody)
+	{
+		if (Body.HasSource())
+		{
+			Connection.bUploading = true;
+		}
+		else if (!Body.GetBuffer().empty())
+		{
+			// written from the buffer of the request, which outlives the write
+			const std::span<const uint8_t> Buffer = Body.GetBuffer();
+			Buffers[BufferCount++] = uv_buf_init(const_cast<char*>(reinterpret_cast<const char*>(Buffer.data())), uint32_t(Buffer.size()));
+			Connection.PendingUploadBytes = Buffer.size();
+		}
+	}
+
+	Connection.WriteRequest.data = &Connection;
+	const int Result = uv_write(&Connection.WriteRequest, reinterpret_cast<uv_stream_t*>(&Connection.Handle), Buffers, BufferCount, OnWrite);
+	if (Result != 0)
+	{
+		FailTransfer(Connection, Result);
+	}
+}
+
+void FUvHttpThread::SendNextBodyChunk(FUvHttpConnection& Connection)
+{
+	FUvHttpRequest* Request = Connection.Request;
+	const bool bChunked = Request->bChunkedUpload;
+	Connection.UploadBuffer.resize(UvUploadChunkSize);
+	const size_t ReadSize = Request->GetUploadBody().Read(std::span<uint8_t>(Connection.UploadBuffer));
+	if (ReadSize == IHttpBodySource::ReadError)
+	{
+		LOG_ERROR("{} {} failed to read the content", Request->GetVerb(), Request->URL);
+		FailTransfer(Connection, UV_EIO);
+		return;
+	}
+
+	static const char ChunkEnd[] = "\r\n";
+	static const char LastChunk[] = "0\r\n\r\n";
+	uv_buf_t Buffers[3];
+	uint32_t BufferCount = 0;
+	if (ReadSize == 0)
+	{
+		Connection.bUploading = false;
+		if (!bChunked)
+		{
+			return;
+		}
+		Buffers[BufferCount++] = uv_buf_init(const_cast<char*>(LastChunk), 5);
+	}
+	else
+	{
+		if (bChunked)
+		{
+			const int HeaderSize = std::snprintf(Connection.ChunkHeader, sizeof(Connection.ChunkHeader), "%zx\r\n", ReadSize);
+			Buffers[BufferCount++] = uv_buf_init(Connection.ChunkHeader, uint32_t(HeaderSize));
+		}
+		Buffers[BufferCount++] = uv_buf_init(reinterpret_cast<char*>(Connection.UploadBuffer.data()), uint32_t(ReadSize));
+		if (bChunked)
+		{
+			Buffers[BufferCount++] = uv_buf_init(const_cast<char*>(ChunkEnd), 2);
+		}
+	}
+	Connection.PendingUploadBytes = ReadSize;
+	const int Result = uv_write(&Connection.WriteRequest, reinterpret_cast<uv_stream_t*>(&Connection.Handle), Buffers, BufferCount, OnWrite);
+	if (Result != 0)
+	{
+		FailTransfer(Connection, Result);
+	}
+}
+
+void FUvHttpThread::OnWrite(uv_write_t* WriteRequest, int Status)
+{
+	FUvHttpConnection& Connection = *static_cast<FUvHttpConnection*>(WriteRequest->data);
+	FUvHttpThread& Thread = GetThread(Connection);
+	if (Connection.bClosing || Thread.bShuttingDown || Connection.Request == nullptr)
+	{
+		return;
+	}
+	if (Status != 0)
+	{
+		Thread.FailTransfer(Connection, Status);
+		return;
+	}
+	Connection.Request->BytesSent += Connection.PendingUploadBytes;
+	Connection.PendingUploadBytes = 0;
+	if (Connection.bUploading)
+	{
+		Thread.SendNextBodyChunk(Connection);
+	}
+}
+
+void FUvHttpThread::OnAlloc(uv_handle_t* Handle, size_t SuggestedSize, uv_buf_t* Buffer)
+{
+	FUvHttpConnection& Connection = *static_cast<FUvHttpConnection*>(Handle->data);
+	*Buffer = uv_buf_init(reinterpret_cast<char*>(Connection.ReadBuffer.get()), uint32_t(UvReadBufferSize));
+}
+
+void FUvHttpThread::OnRead(uv_stream_t* Stream, ssize_t ReadSize, const uv_buf_t* Buffer)
+{
+	FUvHttpConnection& Connection = *static_cast<FUvHttpConnection*>(Stream->data);
+	if (ReadSize == 0 || Connection.bClosing)
+	{
+		return;
+	}
+	FUvHttpThread& Thread = GetThread(Connection);
+	FUvHttpRequest* Request = Connection.Request;
+	if (Request == nullptr)
+	{
+		// an idle connection closed by the server, or sending bytes nobody asked for
+		Thread.CloseConnection(Connection);
+		return;
+	}
+
+	if (ReadSize < 0)
+	{
+		if (ReadSize == UV_EOF && Connection.Parser.ParseEndOfInput() == EHttpResponseParseResult::Complete)
+		{
+			Thread.CompleteTransfer(Connection, false);
+		}
+		else
+		{
+			Thread.FailTransfer(Connection, int32_t(ReadSize));
+		}
+		return;
+	}
+
+	size_t Consumed = 0;
+	const EHttpResponseParseResult::Type Result = Connection.Parser.Parse(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(Buffer->base), size_t(ReadSize)), *Request, Consumed);
+	if (Result == EHttpResponseParseResult::Complete)
+	{
+		// a response sent before the whole payload went out, or followed by stray bytes, leaves the connection unusable
+		const bool bKeepAlive = Connection.Parser.IsKeepAlive() && !Request->bCloseConnection && !Connection.bUploading &&
+			Connection.PendingUploadBytes == 0 && Consumed == size_t(ReadSize);
+		Thread.CompleteTransfer(Connection, bKeepAlive);
+	}
+	else if (Result == EHttpResponseParseResult::Error)
+	{
+		Thread.FailTransfer(Connection, UV_EPROTO);
+	}
+}
+
+void FUvHttpThread::CompleteTransfer(FUvHttpConnection& Connection, bool bKeepAlive)
+{
+	FUvHttpRequest* Request = Connection.Request;
+	// a preconnected connection was opened ahead of time, off the path of its first request
+	if (Connection.CompletedRequestCount++ == 0 && !Connection.bPreconnected)
+	{
+		++NewConnectionCount;
+	}
+	else
+	{
+		++ReusedConnectionCount;
+	}
+	Connection.Request = nullptr;
+	Request->Connection = nullptr;
+	Request->MarkAsCompleted(0, false);
+	if (bKeepAlive)
+	{
+		ReleaseConnection(Connection);
+	}
+	else
+	{
+		CloseConnection(Connection);
+	}
+}
+
+void FUvHttpThread::FailTransfer(FUvHttpConnection& Connection, int32_t Result)
+{
+	FUvHttpRequest* Request = Connection.Request;
+	FUvHttpHostPool& Pool = *Connection.Pool;
+	// the server may close a kept alive connection just as it is reused, the request never reached it then
+	const bool bRetry = (Connection.CompletedRequestCount > 0 || Connection.bPreconnected) && !Connection.Parser.HasStarted() && !Request->bRetried &&
+		!Request->bCanceled && Request->GetUploadBody().Rewind();
+	Connection.Request = nullptr;
+	Request->Connection = nullptr;
+	if (bRetry)
+	{
+		// opened before the close, which would hand the slot to a waiting request
+		Request->bRetried = true;
+		Request->BytesSent = 0;
+		OpenConnection(Pool, Request, 0, false);
+		CloseConnection(Connection);
+		return;
+	}
+	CloseConnection(Connection);
+	Request->MarkAsCompleted(Result, false);
+}
+
+void FUvHttpThread::FailConnection(FUvHttpConnection& Connection, int32_t Result)
+{
+	FUvHttpRequest* Request = Connection.Request;
+	Connection.Request = nullptr;
+	if (Request)
+	{
+		Request->Connection = nullptr;
+	}
+	CloseConnection(Connection);
+	if (Request)
+	{
+		Request->MarkAsCompleted(Result, true);
+	}
+	else if (Connection.bPreconnected)
+	{
+		LOG_INFO("FUvHttpThread::FailConnection() - preconnect to {}:{} failed: {}", Connection.Pool->Host, Connection.Pool->Port, uv_strerror(Result));
+		++FailedPreconnectCount;
+	}
+}
+
+void FUvHttpThread::ReleaseConnection(FUvHttpConnection& Connection)
+{
+	FUvHttpHostPool& Pool = *Connection.Pool;
+	if (!Pool.WaitingRequests.empty())
+	{
+		FUvHttpRequest* Request = Pool.WaitingRequests.front();
+		Pool.WaitingRequests.pop_front();
+		SendRequest(Connection, Request);
+		return;
+	}
+	if (ConnectionSettings.MaxIdleConnections > 0 && IdleConnectionCount >= ConnectionSettings.MaxIdleConnections)
+	{
+		CloseConnection(Connection);
+		return;
+	}
+	Connection.IdleSince = uv_now(&Loop);
+	Pool.IdleConnections.push_back(&Connection);
+	++IdleConnectionCount;
+}
+
+void FUvHttpThread::CloseConnection(FUvHttpConnection& Connection)
+{
+	if (Connection.bClosing)
+	{
+		return;
+	}
+	Connection.bClosing = true;
+	if (Connection.bHasConnectTimer)
+	{
+		Timers.Cancel(Connection.ConnectTimer);
+		Connection.bHasConnectTimer = false;
+	}
+
+	FUvHttpHostPool& Pool = *Connection.Pool;
+	auto IdleItr = std::find(Pool.IdleConnections.begin(), Pool.IdleConnections.end(), &Connection);
+	if (IdleItr != Pool.IdleConnections.end())
+	{
+		Pool.IdleConnections.erase(IdleItr);
+		--IdleConnectionCount;
+	}
+	auto ResolvingItr = std::find(Pool.ResolvingConnections.begin(), Pool.ResolvingConnections.end(), &Connection);
+	if (ResolvingItr != Pool.ResolvingConnections.end())
+	{
+		Pool.ResolvingConnections.erase(ResolvingItr);
+	}
+	--Pool.OpenConnectionCount;
+	--OpenConnectionCount;
+	// freed in OnClose, after the callbacks of the pending connect and write were called
+	uv_close(reinterpret_cast<uv_handle_t*>(&Connection.Handle), OnClose);
+
+	// the slot is free, hand it to a request held back by the limits, of the same host first
+	while (!Pool.WaitingRequests.empty() && CanOpenConnection(Pool))
+	{
+		FUvHttpRequest* Request = Pool.WaitingRequests.front();
+		Pool.WaitingRequests.pop_front();
+		OpenConnection(Pool, Request, 0, false);
+	}
+	if (ConnectionSettings.MaxTotalConnections > 0 && !bShuttingDown)
+	{
+		for (const auto& [Key, OtherPool] : HostPools)
+		{
+			while (!OtherPool->WaitingRequests.empty() && CanOpenConnection(*OtherPool))
+			{
+				FUvHttpRequest* Request = OtherPool->WaitingRequests.front();
+				OtherPool->WaitingRequests.pop_front();
+				OpenConnection(*OtherPool, Request, 0, false);
+			}
+		}
+	}
+}
+
+void FUvHttpThread::CloseExpiredConnections()
+{
+	const double IdleTimeout = ConnectionSettings.IdleConnectionTimeout > 0.0f ? ConnectionSettings.IdleConnectionTimeout : UvDefaultIdleConnectionTimeout;
+	const uint64_t Now = uv_now(&Loop);
+	for (const auto& [Key, Pool] : HostPools)
+	{
+		// the least recently used come first
+		while (!Pool->IdleConnections.empty() && Now - Pool->IdleConnections.front()->IdleSince >= uint64_t(IdleTimeout * 1000.0))
+		{
+			CloseConnection(*Pool->IdleConnections.front());
+		}
+	}
+}
+
+void FUvHttpThread::OnClose(uv_handle_t* Handle)
+{
+	delete static_cast<FUvHttpConnection*>(Handle->data);
+}
@@ -0,0 +1,279 @@
+#include "UvRequest.h"
+#include "UvResponse.h"
+#include "UvHttpThread.h"
+#include "HttpTrace.h"
+#include "HttpUrl.h"
+#include <logger.h>
+#include <uv.h>
+#include <charconv>
+#include <limits>
+#include <string_view>
+
+FUvHttpRequest::FUvHttpRequest(FHttpManager& InManager)
+	: FHttpRequestBase(InManager)
+	, UvCompletionResult(0)
+	, bConnectionError(false)
+	, bSendCompressedBody(false)
+	, bDecodeResponse(false)
+	, bResponseDecodeFailed(false)
+	, Port(0)
+	, bSendBody(false)
+	, bChunkedUpload(false)
+	, bHeadRequest(false)
+	, bCloseConnection(false)
+	, bRetried(false)
+	, Connection(nullptr)
+{
+}
+
+FUvHttpRequest::~FUvHttpRequest()
+{
+}
+
+bool FUvHttpRequest::SetupRequest()
+{
+	FUrlView Url;
+	if (!FUrlView::Parse(URL, Url) || Url.Host.empty())
+	{
+		LOG_INFO("FUvHttpRequest::SetupRequest() - {} is not a valid url", URL);
+		return false;
+	}
+	if (!HttpHeaderNameEquals(Url.Scheme, "http"))
+	{
+		LOG_INFO("FUvHttpRequest::SetupRequest() - {} is not supported, the uv transport only speaks plain http", URL);
+		return false;
+	}
+	Host.assign(Url.Host);
+	Port = Url.GetPortOrDefault();
+	ConnectionKey.assign(Host).append(":").append(std::to_string(Port));
+
+	const std::string RequestVerb = GetVerb();
+	bHeadRequest = RequestVerb == "HEAD";
+	// like libcurl, GET and HEAD never send the payload
+	bSendBody = RequestVerb != "GET" && !bHeadRequest;
+
+	// RequestBody keeps the original for GetContent and the next run
+	bSendCompressedBody = false;
+	CompressedBody.Reset();
+	const std::span<const uint8_t> Buffer = RequestBody.GetBuffer();
+	if (bSendBody && ContentCompressionThreshold > 0 && !RequestBody.HasSource() && Buffer.size() >= ContentCompressionThreshold &&
+		!Headers.Contains(EHttpHeader::ContentEncoding))
+	{
+		std::vector<uint8_t> Compressed;
+		if (HttpGzipCompress(Buffer, Compressed) && Compressed.size() < Buffer.size())
+		{
+			CompressedBody.SetBuffer(std::move(Compressed));
+			bSendCompressedBody = true;
+		}
+	}
+	// -1 for a source of unknown size, sent chunked
+	const int64_t PayloadSize = bSendBody ? GetUploadBody().GetSize() : 0;
+	bChunkedUpload = PayloadSize < 0;
+
+	RequestHead.clear();
+	RequestHead.append(RequestVerb).append(" ").append(Url.Path.empty() ? std::string_view("/") : Url.Path);
+	if (!Url.Query.empty())
+	{
+		RequestHead.append("?").append(Url.Query);
+	}
+	RequestHead.append(" HTTP/1.1\r\n");
+	if (!Headers.Contains(EHttpHeader::Host))
+	{
+		const bool bIPv6 = Url.Host.find(':') != std::string_view::npos;
+		RequestHead.append("Host: ").append(bIPv6 ? "[" : "").append(Url.Host).append(bIPv6 ? "]" : "");
+		if (Url.Port != 0)
+		{
+			RequestHead.append(":").append(std::to_string(Url.Port));
+		}
+		RequestHead.append("\r\n");
+	}
+	for (const FHttpHeaders::FHeader Header : Headers)
+	{
+		RequestHead.append(Header.Name).append(": ").append(Header.Value).append("\r\n");
+	}
+	if (bSendCompressedBody)
+	{
+		RequestHead.append("Content-Encoding: gzip\r\n");
+	}
+	if (bChunkedUpload)
+	{
+		RequestHead.append("Transfer-Encoding: chunked\r\n");
+	}
+	else if (bSendBody && (PayloadSize > 0 || RequestVerb == "POST" || RequestVerb == "PUT") && !Headers.Contains(EHttpHeader::ContentLength))
+	{
+		RequestHead.append("Content-Length: ").append(std::to_string(PayloadSize)).append("\r\n");
+	}
+	// an Accept-Encoding set by the caller means it handles the coding itself
+	bDecodeResponse = bDecompressResponse && !Headers.Contains(EHttpHeader::AcceptEncoding);
+	if (bDecodeResponse)
+	{
+		RequestHead.append(EHttpHeader::ToString(EHttpHeader::AcceptEncoding)).append(": ").append(HttpAcceptedContentEncodings).append("\r\n");
+	}
+	bCloseConnection = HttpHeaderNameEquals(Headers.Find(EHttpHeader::Connection), "close");
+	TransferHeaderLines.clear();
+
+	UvCompletionResult = 0;
+	bConnectionError = false;
+	ResponseDecoder.Reset();
+	bResponseDecodeFailed = false;
+	Response = std::make_shared<FUvHttpResponse>(URL);
+	return true;
+}
+
+FHttpResponsePtr FUvHttpRequest::GetTransferResponse() const
+{
+	return Response;
+}
+
+void FUvHttpRequest::MarkAsCompleted(int32_t InUvCompletionResult, bool bInConnectionError)
+{
+	if (bResponseDecodeFailed || (InUvCompletionResult == 0 && !ResponseDecoder.Finish()))
+	{
+		// corrupt or cut short
+		InUvCompletionResult = UV_EILSEQ;
+	}
+	const bool bDecodedResponse = ResponseDecoder.IsDecoding();
+	ResponseDecoder.Reset();
+	UvCompletionResult = InUvCompletionResult;
+	bConnectionError = bInConnectionError;
+
+	if (Response)
+	{
+		// the announced length is the one of the encoded body, and the only one of a HEAD response
+		const std::string_view AnnouncedLength = Response->Headers.Find(EHttpHeader::ContentLength);
+		int64_t DownloadContentLength = -1;
+		if (bDecodedResponse || AnnouncedLength.empty() ||
+			std::from_chars(AnnouncedLength.data(), AnnouncedLength.data() + AnnouncedLength.size(), DownloadContentLength).ec != std::errc())
+		{
+			DownloadContentLength = Response->TotalBytesRead;
+		}
+		// GetContentLength can't hold a body past 2 GiB, report it as unknown rather than truncated
+		Response->ContentLength = DownloadContentLength <= std::numeric_limits<int32_t>::max() ? int32_t(DownloadContentLength) : -1;
+		if (RequestStreamDelegate && InUvCompletionResult == 0)
+		{
+			DeliverResponseStream(std::span<const uint8_t>());
+		}
+		// complete now, the response cache reads it before the completion is delivered
+		Response->bIsReady = true;
+	}
+
+	const int64_t Now = GetHttpTimestamp();
+	ElapsedTime = float(double(Now - Timings.Started) * 1e-9);
+	Timings.LastByte = InUvCompletionResult == 0 ? Now : 0;
+	HTTP_TRACE_EVENT(RequestPhases(GetTraceId(), Timings));
+
+	bTransferCompleted = true;
+}
+
+bool FUvHttpRequest::HasTransferSucceeded() const
+{
+	return UvCompletionResult == 0;
+}
+
+bool FUvHttpRequest::IsTransferConnectionError() const
+{
+	return bConnectionError;
+}
+
+std::string FUvHttpRequest::GetTransferError() const
+{
+	return uv_strerror(UvCompletionResult);
+}
+
+void FUvHttpRequest::MarkTransferResponseReady(bool bSucceeded)
+{
+	if (Response)
+	{
+		Response->bSucceeded = bSucceeded;
+		Response->bIsReady = true;
+	}
+}
+
+bool FUvHttpRequest::PauseTransfer(bool bPause)
+{
+	if (!Connection)
+	{
+		// not connected yet, reading starts unpaused and the next tick catches up
+		return false;
+	}
+	FUvHttpThread::SetReceivePaused(*Connection, bPause);
+	return true;
+}
+
+void FUvHttpRequest::AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue)
+{
+	// SetupRequest clears them for the next transfer
+	TransferHeaderLines.append(HeaderName).append(": ").append(HeaderValue).append("\r\n");
+}
+
+bool FUvHttpRequest::OnResponseHead(int32_t StatusCode, FHttpHeaders& ResponseHeaders)
+{
+	Timings.FirstByte = GetHttpTimestamp();
+	if (!Response)
+	{
+		return false;
+	}
+	Response->HttpCode = StatusCode;
+	Response->HttpVersion = EHttpVersion::Http1_1;
+	Response->Headers = std::move(ResponseHeaders);
+
+	if (bDecodeResponse)
+	{
+		const EHttpContentEncoding::Type Encoding = EHttpContentEncoding::FromString(Response->Headers.Find(EHttpHeader::ContentEncoding));
+		if (Encoding != EHttpContentEncoding::Identity)
+		{
+			if (!ResponseDecoder.Begin(Encoding))
+			{
+				bResponseDecodeFailed = true;
+				return false;
+			}
+			// the headers describe the body handed out, which is the decoded one
+			Response->Headers.Remove(EHttpHeader::ToString(EHttpHeader::ContentEncoding));
+			Response->Headers.Remove(EHttpHeader::ToString(EHttpHeader::ContentLength));
+		}
+	}
+	if (!RequestStreamDelegate && !ResponseDecoder.IsDecoding())
+	{
+		// one allocation for the whole body, bounded so a bogus length can't reserve gigabytes up front
+		const std::string_view AnnouncedLength = Response->Headers.Find(EHttpHeader::ContentLength);
+		size_t Length = 0;
+		if (std::from_chars(AnnouncedLength.data(), AnnouncedLength.data() + AnnouncedLength.size(), Length).ec == std::errc())
+		{
+			Response->Payload.reserve(std::min<size_t>(Length, 64 * 1024 * 1024));
+		}
+	}
+	return true;
+}
+
+bool FUvHttpRequest::OnResponseBody(std::span<const uint8_t> Data)
+{
+	if (!Response)
+	{
+		return false;
+	}
+	BytesReceived += Data.size();
+	if (!ResponseDecoder.IsDecoding())
+	{
+		ReceiveResponseBody(Data);
+	}
+	else if (!ResponseDecoder.Decode(Data, [this](std::span<const uint8_t> Chunk) { ReceiveResponseBody(Chunk); }))
+	{
+		LOG_ERROR("{} {} failed to decode the response body", GetVerb(), URL);
+		bResponseDecodeFailed = true;
+		return false;
+	}
+	return true;
+}
+
+void FUvHttpRequest::ReceiveResponseBody(std::span<const uint8_t> Chunk)
+{
+	if (RequestStreamDelegate)
+	{
+		DeliverResponseStream(Chunk);
+	}
+	else
+	{
+		Response->Payload.insert(Response->Payload.end(), Chunk.begin(), Chunk.end());
+	}
+	Response->TotalBytesRead += int64_t(Chunk.size());
+}
@@ -0,0 +1,88 @@
+#include "UvResponse.h"
+#include "HttpUrl.h"
+
+FUvHttpResponse::FUvHttpResponse(const std::string& InURL)
+	: URL(InURL)
+	, TotalBytesRead(0)
+	, HttpCode(EHttpResponseCodes::Unknown)
+	, ContentLength(0)
+	, HttpVersion(EHttpVersion::Default)
+	, bIsReady(false)
+	, bSucceeded(false)
+{
+}
+
+FUvHttpResponse::~FUvHttpResponse()
+{
+}
+
+std::string FUvHttpResponse::GetURL()
+{
+	return URL;
+}
+
+std::string FUvHttpResponse::GetURLParameter(const std::string& ParameterName)
+{
+	FUrlView Url;
+	std::string_view Value;
+	if (FUrlView::Parse(URL, Url) && FindUrlQueryParameter(Url.Query, ParameterName, Value))
+	{
+		return std::string(Value);
+	}
+	return std::string();
+}
+
+std::string FUvHttpResponse::GetHeader(const std::string& HeaderName)
+{
+	return std::string(GetHeaderView(HeaderName));
+}
+
+std::string_view FUvHttpResponse::GetHeaderView(std::string_view HeaderName)
+{
+	if (!bIsReady)
+	{
+		return std::string_view();
+	}
+	return Headers.Find(HeaderName);
+}
+
+const FHttpHeaders& FUvHttpResponse::GetHeaders()
+{
+	static const FHttpHeaders NoHeaders;
+	return bIsReady ? Headers : NoHeaders;
+}
+
+std::vector<std::string> FUvHttpResponse::GetAllHeaders()
+{
+	return GetHeaders().ToStrings();
+}
+
+std::string FUvHttpResponse::GetContentType()
+{
+	return GetHeader("Content-Type");
+}
+
+int32_t FUvHttpResponse::GetContentLength()
+{
+	return ContentLength;
+}
+
+const std::vector<uint8_t>& FUvHttpResponse::GetContent()
+{
+	return Payload;
+}
+
+int32_t FUvHttpResponse::GetResponseCode()
+{
+	return HttpCode;
+}
+
+std::string FUvHttpResponse::GetContentAsString()
+{
+	return std::string(reinterpret_cast<const char*>(Payload.data()), Payload.size());
+}
+
+EHttpVersion::Type FUvHttpResponse::GetHttpVersion()
+{
+	return HttpVersion;
+}
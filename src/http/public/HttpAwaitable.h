@@ -0,0 +1,72 @@
+#pragma once
+#include "IHttpRequest.h"
+#include <atomic>
+#include <coroutine>
+#include <memory>
+
+/**
+ * Awaitable that processes a request and suspends the awaiting coroutine until it completes, e.g.
+ * auto Response = co_await Manager.Send(Request);
+ * The coroutine resumes with the response, or nullptr if the request failed, where the completion delegate runs
+ * unless a resume executor is given. Destroying the suspended coroutine cancels the request.
+ * Takes over the completion delegate of the request while it is awaited.
+ */
+class FHttpRequestAwaiter
+{
+public:
+
+	/**
+	 * @param InRequest - the request to process, not processing yet
+	 * @param InResumeExecutor - executor the coroutine is resumed on, empty to resume where the completion delegate runs
+	 */
+	FHttpRequestAwaiter(FHttpRequestPtr InRequest, FHttpExecutor InResumeExecutor);
+	FHttpRequestAwaiter(FHttpRequestAwaiter&& Other) = default;
+	FHttpRequestAwaiter& operator=(FHttpRequestAwaiter&& Other) = default;
+
+	/**
+	 * Cancels the request if the coroutine is destroyed while it is suspended
+	 */
+	~FHttpRequestAwaiter();
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	/**
+	 * Process the request
+	 *
+	 * @return false to resume right away when the request could not be processed
+	 */
+	bool await_suspend(std::coroutine_handle<> Handle);
+
+	/**
+	 * @return the response of the request, nullptr if it failed
+	 */
+	FHttpResponsePtr await_resume();
+
+private:
+	/** Progress of the await, shared with the completion delegate */
+	enum class EPhase : uint8_t
+	{
+		NotSuspended,
+		Pending,
+		Completed,
+		Resumed,
+		Abandoned
+	};
+
+	struct FState
+	{
+		std::atomic<EPhase> Phase{ EPhase::NotSuspended };
+		std::coroutine_handle<> Handle;
+		FHttpResponsePtr Response;
+		FHttpExecutor ResumeExecutor;
+	};
+
+	/** Resume the coroutine unless it was destroyed meanwhile */
+	static void Resume(const std::shared_ptr<FState>& State);
+
+	FHttpRequestPtr Request;
+	std::shared_ptr<FState> State;
+};
@@ -0,0 +1,219 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <span>
+#include <cstdint>
+
+/**
+ * Immutable, refcounted request body. The same buffer can be set on any number of requests without copying it.
+ */
+typedef std::shared_ptr<const std::vector<uint8_t>> FHttpSharedBuffer;
+
+/**
+ * Source of a request body that is read incrementally while it is uploaded, so the body never sits fully in memory.
+ * Read and Rewind are called on the http thread, never concurrently.
+ */
+class IHttpBodySource
+{
+public:
+
+	/** Returned by Read to abort the upload */
+	static constexpr size_t ReadError = size_t(-1);
+
+	/**
+	 * @return the size of the body in bytes, -1 if unknown. A body of unknown size is sent chunked.
+	 */
+	virtual int64_t GetSize() = 0;
+
+	/**
+	 * Fill the start of Dest with the next bytes of the body
+	 *
+	 * @param Dest - buffer to fill
+	 * @return the number of bytes written, 0 at the end of the body, ReadError on failure
+	 */
+	virtual size_t Read(std::span<uint8_t> Dest) = 0;
+
+	/**
+	 * Restart the body from its first byte, so the request can be processed again
+	 *
+	 * @return false if the source can't be read again
+	 */
+	virtual bool Rewind() = 0;
+
+	/**
+	 * Destructor for overrides
+	 */
+	virtual ~IHttpBodySource() {};
+};
+
+typedef std::shared_ptr<IHttpBodySource> FHttpBodySourcePtr;
+
+/**
+ * Delegate reading the next bytes of a body
+ *
+ * @param first parameter - buffer to fill
+ * @return the number of bytes written, 0 at the end of the body, IHttpBodySource::ReadError on failure
+ */
+typedef std::function<size_t(std::span<uint8_t>)> FHttpBodyReadDelegate;
+/**
+ * Delegate restarting a body from its first byte
+ *
+ * @return false if the body can't be read again
+ */
+typedef std::function<bool()> FHttpBodyRewindDelegate;
+
+/**
+ * Body source pulling the body from caller supplied delegates
+ */
+class FHttpCallbackBodySource : public IHttpBodySource
+{
+public:
+
+	/**
+	 * @param InReadDelegate - reads the body
+	 * @param InSize - size of the body, -1 if unknown
+	 * @param InRewindDelegate - restarts the body, a source without one can only be sent once
+	 */
+	FHttpCallbackBodySource(FHttpBodyReadDelegate InReadDelegate, int64_t InSize = -1, FHttpBodyRewindDelegate InRewindDelegate = FHttpBodyRewindDelegate());
+
+	// IHttpBodySource
+	virtual int64_t GetSize() override;
+	virtual size_t Read(std::span<uint8_t> Dest) override;
+	virtual bool Rewind() override;
+
+private:
+	FHttpBodyReadDelegate ReadDelegate;
+	FHttpBodyRewindDelegate RewindDelegate;
+	int64_t Size;
+	/** Whether Read was called since the last rewind */
+	bool bStarted;
+};
+
+/**
+ * Body source reading a range of a file with positional reads (pread / overlapped ReadFile).
+ * Reads don't share a file position, so one open file can back several sources.
+ */
+class FHttpFileBodySource : public IHttpBodySource
+{
+public:
+
+	/**
+	 * Open a file to upload
+	 *
+	 * @param Path - file to read
+	 * @param Offset - first byte of the file to send
+	 * @param Length - number of bytes to send, -1 to send until the end of the file
+	 * @return the source, nullptr if the file can't be opened or the range is outside of it
+	 */
+	static std::shared_ptr<FHttpFileBodySource> Open(const std::string& Path, int64_t Offset = 0, int64_t Length = -1);
+
+	virtual ~FHttpFileBodySource();
+
+	// IHttpBodySource
+	virtual int64_t GetSize() override;
+	virtual size_t Read(std::span<uint8_t> Dest) override;
+	virtual bool Rewind() override;
+
+private:
+	FHttpFileBodySource(intptr_t InFile, int64_t InOffset, int64_t InLength);
+
+	/** Native file descriptor or handle */
+	intptr_t File;
+	/** Range of the file that is sent */
+	int64_t Offset;
+	int64_t Length;
+	/** Bytes of the range read so far */
+	int64_t Position;
+};
+
+/**
+ * Body of a request: nothing, a buffer owned by the request or shared with others, or a streaming source.
+ * Not thread safe, the request only changes it while it is not in flight.
+ */
+class FHttpRequestBody
+{
+public:
+
+	/** Drop the current body */
+	void Reset();
+
+	/** Use a copy of Content */
+	void SetBuffer(const std::vector<uint8_t>& Content);
+
+	/** Take ownership of Content without copying it */
+	void SetBuffer(std::vector<uint8_t>&& Content);
+
+	/** Share an immutable buffer */
+	void SetBuffer(FHttpSharedBuffer Content);
+
+	/** Take ownership of a string without copying it */
+	void SetString(std::string&& Content);
+
+	/** Read the body from a source while it is uploaded */
+	void SetSource(FHttpBodySourcePtr InSource);
+
+	/**
+	 * @return the size of the body in bytes, -1 if it comes from a source of unknown size
+	 */
+	int64_t GetSize() const;
+
+	/**
+	 * @return true if there is no body to send
+	 */
+	bool IsEmpty() const
+	{
+		return GetSize() == 0;
+	}
+
+	/**
+	 * @return the in memory body, empty when it comes from a source. A body set from a string is copied into a vector the first time.
+	 */
+	const std::vector<uint8_t>& GetContent();
+
+	/**
+	 * @return the in memory body without copying it, empty when it comes from a source
+	 */
+	std::span<const uint8_t> GetBuffer() const
+	{
+		return Data;
+	}
+
+	/**
+	 * @return true if the body is read from a source
+	 */
+	bool HasSource() const
+	{
+		return Source != nullptr;
+	}
+
+	/**
+	 * Prepare to send the body from its first byte
+	 *
+	 * @return false if the body comes from a source that can't be read again
+	 */
+	bool Rewind();
+
+	/**
+	 * Copy the next bytes of the body
+	 *
+	 * @param Dest - buffer to fill
+	 * @return the number of bytes written, 0 at the end of the body, IHttpBodySource::ReadError on failure
+	 */
+	size_t Read(std::span<uint8_t> Dest);
+
+private:
+	/** Keeps the in memory body alive, a vector or a string */
+	std::shared_ptr<const void> Owner;
+	/** Bytes of the in memory body */
+	std::span<const uint8_t> Data;
+	/** Vector holding the in memory body, nullptr when the body is a string */
+	const std::vector<uint8_t>* Vector = nullptr;
+	/** Copy of a string body handed out by GetContent */
+	std::vector<uint8_t> ContentCopy;
+	/** Streaming body, replaces the in memory body when set */
+	FHttpBodySourcePtr Source;
+	/** Bytes of the in memory body read since the last rewind */
+	size_t ReadOffset = 0;
+};
@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+struct z_stream_s;
+
+namespace EHttpContentEncoding
+{
+	/**
+	 * Content codings the http module can decode, https://www.rfc-editor.org/rfc/rfc9110#section-8.4.1
+	 */
+	enum Type
+	{
+		/** No coding, or one the module doesn't know */
+		Identity,
+		/** gzip file format */
+		Gzip,
+		/** zlib format, raw deflate data is accepted too since some servers send it */
+		Deflate
+	};
+
+	/**
+	 * @return the coding of a Content-Encoding header, Identity if it is empty, unknown or a list of several codings
+	 */
+	Type FromString(std::string_view ContentEncoding);
+}
+
+/** Value of the Accept-Encoding header sent by requests that decompress their response */
+inline constexpr std::string_view HttpAcceptedContentEncodings = "gzip, deflate";
+
+/**
+ * Streaming inflate of a gzip or deflate response body. Output is handed out in chunks while the input arrives,
+ * the decoded body is never held in one piece. Not thread safe, only used by the thread receiving the response.
+ */
+class FHttpContentDecoder
+{
+public:
+
+	/** Receives a chunk of decoded data, only valid during the call */
+	typedef std::function<void(std::span<const uint8_t>)> FOutputFunction;
+
+	FHttpContentDecoder();
+	~FHttpContentDecoder();
+	FHttpContentDecoder(const FHttpContentDecoder&) = delete;
+	FHttpContentDecoder& operator=(const FHttpContentDecoder&) = delete;
+
+	/**
+	 * Start decoding a new body
+	 *
+	 * @param InEncoding - coding of the body, Identity to pass it through
+	 * @return false if zlib could not be initialized
+	 */
+	bool Begin(EHttpContentEncoding::Type InEncoding);
+
+	/**
+	 * Decode the next part of the body
+	 *
+	 * @param Input - the encoded bytes as received
+	 * @param Output - called with each chunk of decoded bytes
+	 * @return false if the body is corrupt
+	 */
+	bool Decode(std::span<const uint8_t> Input, const FOutputFunction& Output);
+
+	/**
+	 * @return true if the whole encoded body was decoded, false if it was cut short
+	 */
+	bool Finish();
+
+	/**
+	 * Release the zlib state, Begin must be called again before decoding
+	 */
+	void Reset();
+
+	/**
+	 * @return true between Begin and Reset with a coding other than Identity
+	 */
+	bool IsDecoding() const
+	{
+		return Encoding != EHttpContentEncoding::Identity;
+	}
+
+private:
+	/** Restart a deflate body as raw deflate data once it turned out to have no zlib header */
+	bool RestartAsRawDeflate();
+
+	std::unique_ptr<z_stream_s> Stream;
+	EHttpContentEncoding::Type Encoding;
+	bool bStreamEnded;
+	/** Whether any output was produced, a deflate body may only fall back to raw data before that */
+	bool bProducedOutput;
+	/** Whether a deflate body turned out to be raw deflate data */
+	bool bRawDeflate;
+	/** Input consumed so far by a deflate body, replayed when falling back to raw data */
+	std::vector<uint8_t> ConsumedInput;
+	std::vector<uint8_t> OutputBuffer;
+};
+
+/**
+ * Compress a whole request body in the gzip format
+ *
+ * @param Input - the body
+ * @param OutEncoded - receives the compressed body
+ * @param Level - zlib compression level, 1 (fastest) to 9 (smallest), -1 for the zlib default
+ * @return false if zlib failed
+ */
+bool HttpGzipCompress(std::span<const uint8_t> Input, std::vector<uint8_t>& OutEncoded, int32_t Level = -1);
@@ -0,0 +1,192 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace EHttpHeader
+{
+	/**
+	 * Well known headers, interned when a header is added so lookups by id skip the name comparison
+	 */
+	enum Type : uint8_t
+	{
+		Unknown = 0,
+		Accept,
+		AcceptEncoding,
+		Authorization,
+		CacheControl,
+		Connection,
+		ContentEncoding,
+		ContentLength,
+		ContentType,
+		ETag,
+		Expect,
+		Expires,
+		Host,
+		IfModifiedSince,
+		IfNoneMatch,
+		LastModified,
+		Location,
+		Range,
+		SetCookie,
+		TransferEncoding,
+		UserAgent,
+		Count
+	};
+
+	/**
+	 * @return canonical name of a well known header, empty for Unknown
+	 */
+	std::string_view ToString(Type Header);
+
+	/**
+	 * @return id of a header name, compared case-insensitively, Unknown if it is not a well known header
+	 */
+	Type FromString(std::string_view HeaderName);
+}
+
+/**
+ * Compare two strings ignoring ASCII case, eight bytes at a time
+ */
+bool HttpHeaderNameEquals(std::string_view A, std::string_view B);
+
+/**
+ * Compact header block. Names and values live in a single buffer, entries only hold offsets,
+ * so reading headers hands out string_views and allocates nothing.
+ * Names are matched case-insensitively and keep their original spelling, entries keep insertion order.
+ * Not thread safe.
+ */
+class FHttpHeaders
+{
+public:
+
+	/** Name and value of a header, viewing into the block */
+	struct FHeader
+	{
+		std::string_view Name;
+		std::string_view Value;
+		EHttpHeader::Type Id;
+	};
+
+	class FIterator
+	{
+	public:
+		FIterator(const FHttpHeaders& InHeaders, size_t InIndex)
+			: Headers(InHeaders)
+			, Index(InIndex)
+		{
+		}
+
+		FHeader operator*() const
+		{
+			return Headers.GetHeader(Index);
+		}
+
+		FIterator& operator++()
+		{
+			++Index;
+			return *this;
+		}
+
+		bool operator!=(const FIterator& Other) const
+		{
+			return Index != Other.Index;
+		}
+
+	private:
+		const FHttpHeaders& Headers;
+		size_t Index;
+	};
+
+	FHttpHeaders();
+
+	/**
+	 * Set a header, replacing any previous value
+	 */
+	void Set(std::string_view Name, std::string_view Value);
+
+	/**
+	 * Append to a header, previous values are kept and separated by ", ". Same as Set if the header is not present.
+	 */
+	void Append(std::string_view Name, std::string_view Value);
+
+	/**
+	 * Remove a header
+	 *
+	 * @return true if it was present
+	 */
+	bool Remove(std::string_view Name);
+
+	/**
+	 * Remove every header
+	 */
+	void Empty();
+
+	/**
+	 * Get the value of a header, empty if not present. The view is invalidated by the next modification.
+	 */
+	std::string_view Find(std::string_view Name) const;
+	std::string_view Find(EHttpHeader::Type Id) const;
+
+	bool Contains(std::string_view Name) const;
+	bool Contains(EHttpHeader::Type Id) const;
+
+	size_t Num() const
+	{
+		return Entries.size();
+	}
+
+	FHeader GetHeader(size_t Index) const;
+
+	FIterator begin() const
+	{
+		return FIterator(*this, 0);
+	}
+
+	FIterator end() const
+	{
+		return FIterator(*this, Entries.size());
+	}
+
+	/**
+	 * Return all headers in "Name: Value" format, for the by-value API
+	 */
+	std::vector<std::string> ToStrings() const;
+
+private:
+	struct FEntry
+	{
+		uint32_t NameOffset;
+		uint32_t ValueOffset;
+		uint32_t ValueLength;
+		uint16_t NameLength;
+		EHttpHeader::Type Id;
+	};
+
+	/** @return index of the entry of a header, or -1 */
+	int32_t FindIndex(std::string_view Name, EHttpHeader::Type Id) const;
+
+	std::string_view GetName(const FEntry& Entry) const
+	{
+		// well known headers added with their canonical spelling only keep the id
+		return Entry.NameOffset == UINT32_MAX ? EHttpHeader::ToString(Entry.Id) : std::string_view(Buffer.data() + Entry.NameOffset, Entry.NameLength);
+	}
+
+	std::string_view GetValue(const FEntry& Entry) const
+	{
+		return std::string_view(Buffer.data() + Entry.ValueOffset, Entry.ValueLength);
+	}
+
+	/** Store a new value for an entry at the end of the buffer */
+	void StoreValue(FEntry& Entry, std::string_view Previous, std::string_view Value);
+
+	/** Drop the bytes of replaced values once they make up most of the buffer */
+	void CompactIfNeeded();
+
+	/** Names and values of every entry */
+	std::string Buffer;
+	/** Bytes of Buffer no longer referenced by any entry */
+	size_t WastedBytes;
+	std::vector<FEntry> Entries;
+};
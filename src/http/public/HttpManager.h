@@ -2,7 +2,64 @@
 #include "IHttpRequest.h"
 #include "IHttpResponse.h"
 #include "HttpThread.h"
+#include "HttpRequestRegistry.h"
+#include "HttpTimerWheel.h"
+#include "HttpResponseCache.h"
+#include "HttpAwaitable.h"
+#include <unordered_map>
 #include <list>
+#include <functional>
+#include <chrono>
+#include <condition_variable>
+
+namespace EHttpCompletionDispatch
+{
+	/**
+	 * Where completed requests are finished and their completion delegates run
+	 */
+	enum Type
+	{
+		/** On the thread calling FHttpManager::Tick, the default */
+		Tick,
+		/** Inline on the http thread that ran the request, as soon as it completes. Delegates must not block. */
+		HttpThread,
+		/** Posted to an executor, e.g. a thread pool */
+		Executor
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpCompletionDispatch::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case Tick:
+			{
+				return "Tick";
+			}
+			case HttpThread:
+			{
+				return "HttpThread";
+			}
+			case Executor:
+			{
+				return "Executor";
+			}
+		}
+		return "";
+	}
+}
+
+/**
+ * Counters of the request coalescing of a manager
+ */
+struct FHttpCoalescingStats
+{
+	/** Requests that could be coalesced and started their own transfer */
+	uint64_t Transfers = 0;
+	/** Requests that attached to an identical request in flight instead, i.e. transfers saved */
+	uint64_t CoalescedRequests = 0;
+};
+
 class FHttpManager
 {
 public:
@@ -17,13 +74,127 @@ public:
 	/**
 	 * Destructor
 	 */
-	~FHttpManager();
+	virtual ~FHttpManager();
 
 	/**
 	 * Initialize
 	 */
 	void Initialize();
 
+	/**
+	 * Create a new request object for the transport implemented by this manager
+	 *
+	 * @return the new request, or nullptr if the manager has no transport
+	 */
+	virtual FHttpRequestPtr CreateRequest();
+
+	/**
+	 * Process a request and await its completion from a coroutine:
+	 * FHttpResponsePtr Response = co_await Manager.Send(Request);
+	 * Destroying the awaiting coroutine cancels the request. The completion delegate of the request is replaced.
+	 *
+	 * @param Request - the request to process, created by this manager
+	 * @param ResumeExecutor - executor the coroutine is resumed on, empty to resume where completions are delivered
+	 * @return the awaitable, resuming with the response or nullptr if the request failed
+	 */
+	FHttpRequestAwaiter Send(FHttpRequestPtr Request, FHttpExecutor ResumeExecutor = nullptr);
+
+	/**
+	 * Set the number of http threads requests are spread over. Must be called before Initialize.
+	 * Requests to the same host always go to the same thread so connections can be reused.
+	 *
+	 * @param InHttpThreadCount - number of http threads, at least 1
+	 */
+	void SetHttpThreadCount(uint32_t InHttpThreadCount);
+
+	/**
+	 * Set the limits of the connections each http thread keeps to servers. Must be called before Initialize.
+	 *
+	 * @param InConnectionSettings - the limits
+	 */
+	void SetConnectionSettings(const FHttpConnectionSettings& InConnectionSettings);
+
+	/**
+	 * Cap the requests each http thread runs at once, requests past a cap stay queued by priority.
+	 * Must be called before Initialize.
+	 *
+	 * @param InMaxRunningRequests - most requests running on one http thread, 0 for no limit
+	 * @param InMaxRunningRequestsPerHost - most requests running to the same host and port, 0 for no limit
+	 */
+	void SetRequestLimits(uint32_t InMaxRunningRequests, uint32_t InMaxRunningRequestsPerHost);
+
+	/**
+	 * Let identical GET and HEAD requests share one transfer. While a request is in flight, a request with the
+	 * same verb, URL and headers attaches to it and completes with the same, shared response.
+	 * Requests with a body or a stream delegate are never coalesced. Can be changed at any time.
+	 *
+	 * @param bInCoalesceRequests - true to coalesce requests
+	 */
+	void SetRequestCoalescing(bool bInCoalesceRequests);
+
+	/**
+	 * @return the counters of the request coalescing
+	 */
+	FHttpCoalescingStats GetCoalescingStats() const;
+
+	/**
+	 * Choose where completed requests are finished. Outside of Tick mode completions don't wait for a Tick,
+	 * which then only reports progress. Must be called before Initialize.
+	 *
+	 * @param InCompletionDispatch - where completions are delivered
+	 * @param InCompletionExecutor - executor completions are posted to in Executor mode, it must run posted work before the manager is destroyed
+	 */
+	void SetCompletionDispatch(EHttpCompletionDispatch::Type InCompletionDispatch, FHttpExecutor InCompletionExecutor = nullptr);
+
+	/**
+	 * Set a function called, on any thread, when completions are waiting for a Tick in Tick mode,
+	 * so a caller can tick on demand instead of polling. Must be called before Initialize.
+	 *
+	 * @param InCompletionSignal - the function, must be cheap and not call back into the manager
+	 */
+	void SetCompletionSignal(std::function<void()> InCompletionSignal);
+
+	/**
+	 * Look up GET requests in a response cache before sending them. Fresh responses complete the request on the
+	 * next Tick without a transfer, stale ones are revalidated. Must be called before Initialize.
+	 *
+	 * @param InResponseCache - the cache, may be shared between managers, nullptr for none
+	 */
+	void SetResponseCache(std::shared_ptr<FHttpResponseCache> InResponseCache);
+
+	/**
+	 * Set the hosts connections are opened to as soon as the http threads start, so the first requests skip the
+	 * name resolution, connect and TLS handshake. Must be called before Initialize.
+	 *
+	 * @param InPreconnectTargets - hosts and how many connections to open to each
+	 */
+	void SetPreconnectTargets(std::vector<FHttpPreconnectTarget> InPreconnectTargets);
+
+	/**
+	 * Resolve a host and open connections to it in the background, they are kept alive for the requests that follow.
+	 * The warmed connections are counted in the stats of the http thread owning the host, see GetHttpThreadStats.
+	 * Called before Initialize, the connections are opened once it starts the http threads.
+	 *
+	 * @param URL - url of the host, e.g. https://api.example.com, see FHttpPreconnectTarget
+	 * @param ConnectionCount - connections wanted, the ones already open to the host count
+	 */
+	void Preconnect(const std::string& URL, uint32_t ConnectionCount = 1);
+
+	/**
+	 * Get a snapshot of the latency histograms of the transfers to each host, built from the timings of every
+	 * request that reached an http thread. Hosts past the first MaxLatencyHosts share the entry of host "*".
+	 *
+	 * @return one entry per host and port
+	 */
+	std::vector<FHttpHostLatencySnapshot> GetLatencyStats() const;
+
+	/**
+	 * Get a snapshot of the counters of every http thread
+	 *
+	 * @return one entry per http thread
+	 */
+	std::vector<FHttpThreadStats> GetHttpThreadStats() const;
+
 	/**
 	 * Adds an Http request instance to the manager for tracking/ticking
 	 * Manager should always have a list of requests currently being processed
@@ -50,11 +221,37 @@ public:
 	bool IsValidRequest(const IHttpRequest* RequestPtr) const;
 
 	/**
-	 * Block until all pending requests are finished processing
+	 * Block until all pending requests are finished processing, sleeping until completions arrive.
+	 * In Tick mode it ticks the manager, call it from the thread that does. In Executor mode the completion executor
+	 * delivers them, never call it from the only thread running that executor.
 	 *
 	 * @param bShutdown true if final flush during shutdown
+	 * @param TimeoutSeconds - longest time to wait, negative to wait until every request finished
+	 * @return false if requests were still outstanding when the timeout expired, they are logged
+	 */
+	bool Flush(bool bShutdown, double TimeoutSeconds = -1.0);
+
+	/**
+	 * Block until every request of a list finished, sleeping until completions arrive.
+	 * Requests that are not processing count as finished. In Tick mode it ticks the manager, call it from the thread that does.
+	 * In Executor mode the completion executor delivers them, never call it from the only thread running that executor.
+	 *
+	 * @param InRequests - the requests to wait on
+	 * @param TimeoutSeconds - longest time to wait, negative for no limit
+	 * @return the requests still processing when the timeout expired, they are logged. Empty once all finished.
+	 */
+	std::vector<FHttpRequestPtr> WaitAll(const std::vector<FHttpRequestPtr>& InRequests, double TimeoutSeconds = -1.0);
+
+	/**
+	 * Block until any request of a list finished, sleeping until completions arrive.
+	 * Requests that are not processing count as finished. In Tick mode it ticks the manager, call it from the thread that does.
+	 * In Executor mode the completion executor delivers them, never call it from the only thread running that executor.
+	 *
+	 * @param InRequests - the requests to wait on
+	 * @param TimeoutSeconds - longest time to wait, negative for no limit
+	 * @return the first finished request of the list, nullptr if none finished before the timeout expired
 	 */
-	void Flush(bool bShutdown);
+	FHttpRequestPtr WaitAny(const std::vector<FHttpRequestPtr>& InRequests, double TimeoutSeconds = -1.0);
 
 	/**
 	 * FTicker callback
@@ -79,6 +276,13 @@ public:
 	 */
 	void CancelThreadedRequest(const std::shared_ptr<IHttpThreadedRequest>& Request);
 
+	/**
+	 * Wake up the http thread running a request, so it picks up a change made on another thread
+	 *
+	 * @param Request - the request that changed
+	 */
+	void WakeUpThreadedRequest(const std::shared_ptr<IHttpThreadedRequest>& Request);
+
 	/**
 	 * List all of the Http requests currently being processed
 	 *
@@ -87,6 +291,75 @@ public:
 	void DumpRequests() const;
 
 protected:
+	/**
+	 * Finish completed requests and run their delegates
+	 *
+	 * @param OnlyThread - the http thread to take completed requests from, nullptr for all of them
+	 */
+	void DispatchCompletions(FHttpThread* OnlyThread);
+
+	/**
+	 * Add the timings of a finished transfer to the latency histograms of its host
+	 */
+	void RecordRequestLatency(IHttpThreadedRequest& Request);
+
+	/**
+	 * Called on an http thread once it handed back completed requests
+	 */
+	void OnThreadCompletions(FHttpThread& Thread);
+
+	/**
+	 * Have completions that did not come from an http thread, like cache hits, delivered
+	 *
+	 * @param Request - the request that completed
+	 */
+	void SignalCompletions(IHttpRequest& Request);
+
+	/**
+	 * Post a completion dispatch to the completion executor unless one is already waiting to run
+	 */
+	void PostCompletionDispatch();
+
+	/**
+	 * Wake up the threads blocked in Flush, WaitAll or WaitAny
+	 */
+	void NotifyCompletionWaiters();
+
+	/**
+	 * Deliver the completions waiting on the calling thread, then sleep until more arrive, until done
+	 *
+	 * @param IsDone - checked after each delivery
+	 * @param TimeoutSeconds - longest time to wait, negative for no limit
+	 * @return false if the timeout expired before IsDone returned true
+	 */
+	bool WaitForCompletions(const std::function<bool()>& IsDone, double TimeoutSeconds);
+
+	/**
+	 * Pick the http thread a request is queued on, based on the host of its URL
+	 *
+	 * @param Request - the request to queue
+	 * @return the http thread owning the host of the request
+	 */
+	FHttpThread* GetThreadForRequest(IHttpRequest& Request) const;
+
+	/**
+	 * Pick the http thread owning the host of a URL
+	 *
+	 * @param URL - url of the host
+	 * @return the http thread requests to the host and port are queued on
+	 */
+	FHttpThread* GetThreadForUrl(std::string_view URL) const;
+
+	/**
+	 * @return true if the request may share its transfer with identical requests
+	 */
+	bool CanCoalesceRequest(IHttpRequest& Request) const;
+
+	/**
+	 * Build the key identical requests share: verb, URL and headers
+	 */
+	static std::string MakeCoalescingKey(IHttpRequest& Request);
+
 	/**
 	 * Create HTTP thread object
 	 *
@@ -96,30 +369,102 @@ protected:
 
 
 protected:
-	/** List of Http requests that are actively being processed */
-	std::list<std::shared_ptr<IHttpRequest>> Requests;
-	std::mutex RequestLock;
-	/** Keep track of a request that should be deleted later */
-	class FRequestPendingDestroy
+	/** Http requests that are actively being processed */
+	FHttpRequestRegistry Requests;
+	/** Dead requests that need to be destroyed, each timer callback holds a reference until it fires */
+	FHttpTimerWheel PendingDestroyTimers;
+	std::mutex PendingDestroyLock;
+	/** Last time the pending destroy timers advanced outside of Tick. Protected by PendingDestroyLock. */
+	std::chrono::steady_clock::time_point LastPendingDestroyTime;
+
+	EHttpCompletionDispatch::Type CompletionDispatch;
+	FHttpExecutor CompletionExecutor;
+	std::function<void()> CompletionSignal;
+	/** Set while a dispatch posted to the completion executor did not start yet */
+	std::atomic_bool bCompletionDispatchPosted;
+	/** Held while taking completed requests from the http threads, they only allow one consumer */
+	std::mutex CompletionConsumerLock;
+	/** Bumped whenever completions arrive or are delivered, waiters sleep until it changes. Protected by CompletionWaitLock. */
+	uint64_t CompletionSerial;
+	std::mutex CompletionWaitLock;
+	std::condition_variable CompletionWaitEvent;
+
+	/** Http threads, requests are assigned by host */
+	std::vector<FHttpThread*> Threads;
+	uint32_t HttpThreadCount;
+	FHttpConnectionSettings ConnectionSettings;
+	uint32_t MaxRunningRequests;
+	uint32_t MaxRunningRequestsPerHost;
+	/** Hosts preconnected by Initialize */
+	std::vector<FHttpPreconnectTarget> PreconnectTargets;
+
+	/** A transfer shared by identical requests */
+	struct FCoalescedTransfer
+	{
+		/** The request running the transfer */
+		std::shared_ptr<IHttpThreadedRequest> Leader;
+		/** Requests completed with the response of the leader, in the order they were added */
+		std::list<std::shared_ptr<IHttpThreadedRequest>> Followers;
+	};
+	/** Where a follower waits, so a cancel removes it without searching the transfers */
+	struct FCoalescedFollower
 	{
-	public:
-		FRequestPendingDestroy(float InTimeLeft, const std::shared_ptr<IHttpRequest>& InHttpRequest)
-			: TimeLeft(InTimeLeft)
-			, HttpRequest(InHttpRequest)
-		{}
+		/** Transfer the follower waits on, values of CoalescedTransfers keep their address */
+		FCoalescedTransfer* Transfer;
+		/** Position of the follower in the transfer */
+		std::list<std::shared_ptr<IHttpThreadedRequest>>::iterator Itr;
+	};
+	/** Transfers in flight by coalescing key. Protected by CoalescingLock. */
+	std::unordered_map<std::string, FCoalescedTransfer> CoalescedTransfers;
+	/** Coalescing key of each leader. Protected by CoalescingLock. */
+	std::unordered_map<const IHttpRequest*, std::string> CoalescingKeys;
+	/** Every follower waiting on a transfer. Protected by CoalescingLock. */
+	std::unordered_map<const IHttpRequest*, FCoalescedFollower> CoalescedFollowers;
+	/** Followers cancelled before their leader completed, finished on the next Tick. Protected by CoalescingLock. */
+	std::vector<std::shared_ptr<IHttpThreadedRequest>> CancelledFollowers;
+	mutable std::mutex CoalescingLock;
+	std::atomic_bool bCoalesceRequests;
+	std::atomic<uint64_t> CoalescingTransferCount;
+	std::atomic<uint64_t> CoalescedRequestCount;
 
-		inline bool operator==(const FRequestPendingDestroy& Other) const
-		{
-			return Other.HttpRequest == HttpRequest;
-		}
+	std::shared_ptr<FHttpResponseCache> ResponseCache;
+	/** Requests served by the response cache, finished on the next Tick. Protected by CacheHitsLock. */
+	std::vector<std::pair<std::shared_ptr<IHttpThreadedRequest>, FHttpResponsePtr>> CacheHits;
+	std::mutex CacheHitsLock;
+	float DeferredDestroyDelay;
 
-		float TimeLeft;
-		std::shared_ptr<IHttpRequest> HttpRequest;
+	/** Latency histograms of one host */
+	struct FHostLatency
+	{
+		/** Host and port */
+		std::string Host;
+		std::array<FHttpLatencyHistogram, EHttpTimingPhase::Count> Histograms;
+	};
+	/** Slot of the table of host latencies, claimed by setting its hash then published by setting its histograms */
+	struct FHostLatencySlot
+	{
+		/** Hash of the host and port, 0 while the slot is free */
+		std::atomic<uint64_t> HostHash{ 0 };
+		std::atomic<FHostLatency*> Latency{ nullptr };
 	};
 
-	/** Dead requests that need to be destroyed */
-	std::list<FRequestPendingDestroy> PendingDestroyRequests;
+	/**
+	 * Find the histograms of a host, adding them when it has none yet. Lock-free.
+	 *
+	 * @param HostHash - hash of the host and port, never 0
+	 * @param Host - host the histograms are added for
+	 * @param Port - port the histograms are added for, 0 to name them after the host only
+	 */
+	FHostLatency& FindOrAddHostLatency(uint64_t HostHash, std::string_view Host, uint32_t Port);
 
-	FHttpThread* Thread;
-	float DeferredDestroyDelay;
+	/** Most hosts with their own latency histograms */
+	static constexpr size_t MaxLatencyHosts = 128;
+	/** Slots of the open addressing table of host latencies, a power of two well past MaxLatencyHosts */
+	static constexpr size_t HostLatencySlotCount = 256;
+	/** Hash of the host "*" shared by the hosts past MaxLatencyHosts, the hashes of real hosts are odd */
+	static constexpr uint64_t OverflowHostHash = 2;
+	/** Latency histograms by hash of host and port, never removed so recording takes no lock */
+	std::array<FHostLatencySlot, HostLatencySlotCount> HostLatencySlots;
+	/** Number of hosts that claimed a slot */
+	std::atomic<uint32_t> HostLatencyCount;
 };
@@ -0,0 +1,256 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/** Size used to keep producer and consumer positions on separate cache lines */
+inline constexpr size_t HttpQueueCacheLineSize = 64;
+
+/**
+ * Bounded lock-free multi producer single consumer queue.
+ * Any thread may enqueue. Only one thread at a time may dequeue.
+ * When the ring is full, items spill into a locked overflow array so producers never block on the consumer.
+ * Producers keep spilling until the consumer emptied the overflow, which it only reads once the ring is empty,
+ * so the items are handed out in the order they were enqueued.
+ */
+template<typename T>
+class TMpscRingQueue
+{
+public:
+
+	/**
+	 * @param InCapacity - ring size, rounded up to a power of two
+	 */
+	explicit TMpscRingQueue(size_t InCapacity = 4096)
+	{
+		size_t Capacity = 2;
+		while (Capacity < InCapacity)
+		{
+			Capacity <<= 1;
+		}
+		Mask = Capacity - 1;
+		Cells.reset(new FCell[Capacity]);
+		for (size_t Index = 0; Index < Capacity; ++Index)
+		{
+			Cells[Index].Sequence.store(Index, std::memory_order_relaxed);
+		}
+	}
+
+	TMpscRingQueue(const TMpscRingQueue&) = delete;
+	TMpscRingQueue& operator=(const TMpscRingQueue&) = delete;
+
+	/**
+	 * Add an item. Called on any thread.
+	 */
+	void Enqueue(const T& Item)
+	{
+		// keep the order once items started spilling, the ring is only used again after the overflow drained
+		if (bHasOverflow.load(std::memory_order_acquire))
+		{
+			EnqueueOverflow(Item);
+			return;
+		}
+		size_t Position = EnqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			FCell& Cell = Cells[Position & Mask];
+			const size_t Sequence = Cell.Sequence.load(std::memory_order_acquire);
+			const intptr_t Difference = intptr_t(Sequence) - intptr_t(Position);
+			if (Difference == 0)
+			{
+				if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+				{
+					Cell.Value = Item;
+					Cell.Sequence.store(Position + 1, std::memory_order_release);
+					return;
+				}
+			}
+			else if (Difference < 0)
+			{
+				// ring is full
+				EnqueueOverflow(Item);
+				return;
+			}
+			else
+			{
+				Position = EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	/**
+	 * Remove the oldest item. Consumer only.
+	 *
+	 * @return false if the queue was empty
+	 */
+	bool Dequeue(T& OutItem)
+	{
+		FCell& Cell = Cells[DequeuePosition & Mask];
+		const size_t Sequence = Cell.Sequence.load(std::memory_order_acquire);
+		if (intptr_t(Sequence) - intptr_t(DequeuePosition + 1) >= 0)
+		{
+			OutItem = Cell.Value;
+			Cell.Sequence.store(DequeuePosition + Mask + 1, std::memory_order_release);
+			++DequeuePosition;
+			return true;
+		}
+		if (bHasOverflow.load(std::memory_order_acquire))
+		{
+			std::scoped_lock Lock(OverflowLock);
+			if (OverflowRead < Overflow.size())
+			{
+				OutItem = Overflow[OverflowRead++];
+				if (OverflowRead == Overflow.size())
+				{
+					Overflow.clear();
+					OverflowRead = 0;
+					bHasOverflow.store(false, std::memory_order_relaxed);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Move up to MaxCount items to the end of an array. Consumer only.
+	 *
+	 * @return number of items moved
+	 */
+	size_t DequeueBatch(std::vector<T>& OutItems, size_t MaxCount = SIZE_MAX)
+	{
+		size_t Count = 0;
+		T Item;
+		while (Count < MaxCount && Dequeue(Item))
+		{
+			OutItems.push_back(Item);
+			++Count;
+		}
+		return Count;
+	}
+
+private:
+	/**
+	 * Add an item to the overflow array, making the producers that come after spill as well
+	 */
+	void EnqueueOverflow(const T& Item)
+	{
+		std::scoped_lock Lock(OverflowLock);
+		Overflow.push_back(Item);
+		bHasOverflow.store(true, std::memory_order_release);
+	}
+
+	struct FCell
+	{
+		std::atomic<size_t> Sequence;
+		T Value{};
+	};
+
+	std::unique_ptr<FCell[]> Cells;
+	size_t Mask;
+
+	alignas(HttpQueueCacheLineSize) std::atomic<size_t> EnqueuePosition{0};
+	alignas(HttpQueueCacheLineSize) size_t DequeuePosition = 0;
+
+	/** Items that did not fit in the ring and the ones enqueued after them, only touched once the ring got full */
+	alignas(HttpQueueCacheLineSize) std::atomic_bool bHasOverflow{false};
+	std::mutex OverflowLock;
+	std::vector<T> Overflow;
+	size_t OverflowRead = 0;
+};
+
+/**
+ * Bounded lock-free single producer single consumer queue.
+ * When the ring is full, items spill into a locked overflow array so the producer never blocks on the consumer.
+ */
+template<typename T>
+class TSpscRingQueue
+{
+public:
+
+	/**
+	 * @param InCapacity - ring size, rounded up to a power of two
+	 */
+	explicit TSpscRingQueue(size_t InCapacity = 4096)
+	{
+		size_t Capacity = 2;
+		while (Capacity < InCapacity)
+		{
+			Capacity <<= 1;
+		}
+		Mask = Capacity - 1;
+		Items.reset(new T[Capacity]);
+	}
+
+	TSpscRingQueue(const TSpscRingQueue&) = delete;
+	TSpscRingQueue& operator=(const TSpscRingQueue&) = delete;
+
+	/**
+	 * Add an item. Producer only.
+	 */
+	void Enqueue(const T& Item)
+	{
+		const size_t Tail = TailPosition.load(std::memory_order_relaxed);
+		// keep the order once items started spilling
+		if (!bHasOverflow.load(std::memory_order_relaxed) && Tail - HeadPosition.load(std::memory_order_acquire) <= Mask)
+		{
+			Items[Tail & Mask] = Item;
+			TailPosition.store(Tail + 1, std::memory_order_release);
+			return;
+		}
+		std::scoped_lock Lock(OverflowLock);
+		Overflow.push_back(Item);
+		bHasOverflow.store(true, std::memory_order_release);
+	}
+
+	/**
+	 * Move every queued item to the end of an array. Consumer only.
+	 *
+	 * @return number of items moved
+	 */
+	size_t DequeueAll(std::vector<T>& OutItems)
+	{
+		const size_t Head = HeadPosition.load(std::memory_order_relaxed);
+		const size_t Tail = TailPosition.load(std::memory_order_acquire);
+		for (size_t Position = Head; Position != Tail; ++Position)
+		{
+			OutItems.push_back(Items[Position & Mask]);
+		}
+		HeadPosition.store(Tail, std::memory_order_release);
+		size_t Count = Tail - Head;
+
+		if (bHasOverflow.load(std::memory_order_acquire))
+		{
+			std::scoped_lock Lock(OverflowLock);
+			// anything the producer put in the ring before spilling is older, take it first
+			const size_t LateTail = TailPosition.load(std::memory_order_acquire);
+			for (size_t Position = Tail; Position != LateTail; ++Position)
+			{
+				OutItems.push_back(Items[Position & Mask]);
+			}
+			HeadPosition.store(LateTail, std::memory_order_release);
+			Count += LateTail - Tail;
+
+			OutItems.insert(OutItems.end(), Overflow.begin(), Overflow.end());
+			Count += Overflow.size();
+			Overflow.clear();
+			bHasOverflow.store(false, std::memory_order_release);
+		}
+		return Count;
+	}
+
+private:
+	std::unique_ptr<T[]> Items;
+	size_t Mask;
+
+	alignas(HttpQueueCacheLineSize) std::atomic<size_t> TailPosition{0};
+	alignas(HttpQueueCacheLineSize) std::atomic<size_t> HeadPosition{0};
+
+	/** Items that did not fit in the ring, only touched when the ring is full */
+	alignas(HttpQueueCacheLineSize) std::atomic_bool bHasOverflow{false};
+	std::mutex OverflowLock;
+	std::vector<T> Overflow;
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include "IHttpRequest.h"
+#include <string>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+class FHttpManager;
+
+/**
+ * Part of an Http request shared by every transport: the properties set before processing, the progress and the
+ * completion of the request. A transport implements the transfer itself through the hooks at the end.
+ */
+class FHttpRequestBase : public IHttpThreadedRequest, public std::enable_shared_from_this<FHttpRequestBase>
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InManager - manager the request is submitted to when processed
+	 */
+	FHttpRequestBase(FHttpManager& InManager);
+
+	virtual ~FHttpRequestBase();
+
+	// IHttpBase
+	virtual std::string GetURL() override;
+	virtual std::string GetURLParameter(const std::string& ParameterName) override;
+	virtual std::string GetHeader(const std::string& HeaderName) override;
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) override;
+	virtual const FHttpHeaders& GetHeaders() override;
+	virtual std::vector<std::string> GetAllHeaders() override;
+	virtual std::string GetContentType() override;
+	virtual int32_t GetContentLength() override;
+	virtual const std::vector<uint8_t>& GetContent() override;
+
+	// IHttpRequest
+	virtual std::string GetVerb() override;
+	virtual void SetVerb(const std::string& InVerb) override;
+	virtual void SetURL(const std::string& InURL) override;
+	virtual void SetContent(const std::vector<uint8_t>& ContentPayload) override;
+	virtual void SetContent(std::vector<uint8_t>&& ContentPayload) override;
+	virtual void SetContent(FHttpSharedBuffer ContentPayload) override;
+	virtual void SetContentAsString(const std::string& ContentString) override;
+	virtual void SetContentAsString(std::string&& ContentString) override;
+	virtual void SetContentSource(FHttpBodySourcePtr ContentSource) override;
+	virtual void SetHeader(const std::string& HeaderName, const std::string& HeaderValue) override;
+	virtual void AppendToHeader(const std::string& HeaderName, const std::string& AdditionalHeaderValue) override;
+	virtual void SetHttpVersion(EHttpVersion::Type InHttpVersion) override;
+	virtual EHttpVersion::Type GetHttpVersion() override;
+	virtual void SetPriority(EHttpRequestPriority::Type InPriority) override;
+	virtual EHttpRequestPriority::Type GetPriority() override;
+	virtual void SetResponseDecompression(bool bInDecompress) override;
+	virtual bool GetResponseDecompression() override;
+	virtual void SetContentCompressionThreshold(size_t InThreshold) override;
+	virtual size_t GetContentCompressionThreshold() override;
+	virtual bool ProcessRequest() override;
+	virtual FHttpRequestCompleteDelegate& OnProcessRequestComplete() override;
+	virtual FHttpRequestProgressDelegate& OnRequestProgress() override;
+	virtual FHttpRequestStreamDelegate& OnResponseStream() override;
+	virtual void SetResponseStreamExecutor(FHttpExecutor Executor, size_t MaxQueuedBytes) override;
+	virtual void PauseResponseStream() override;
+	virtual void ResumeResponseStream() override;
+	virtual void CancelRequest() override;
+	virtual EHttpRequestStatus::Type GetStatus() override;
+	virtual const FHttpResponsePtr GetResponse() const override;
+	virtual void Tick(float DeltaSeconds) override;
+	virtual void SetTimeout(float InTimeoutSecs) override;
+	virtual float GetTimeout() override;
+	virtual void SetConnectTimeout(float InTimeoutSecs) override;
+	virtual float GetConnectTimeout() override;
+	virtual float GetElapsedTime() override;
+	virtual FHttpRequestTimings GetTimings() override;
+
+	// IHttpThreadedRequest
+	virtual bool StartThreadedRequest() override;
+	virtual bool IsThreadedRequestComplete() override;
+	virtual void TickThreadedRequest(float DeltaSeconds) override;
+	virtual bool IsThreadedRequestTickable() override;
+	virtual void TimeoutThreadedRequest() override;
+	virtual bool HasThreadedRequestSucceeded() override;
+	virtual std::string_view GetThreadedRequestURL() override;
+	virtual void SetThreadedRequestOwner(FHttpThread* Owner) override;
+	virtual FHttpThread* GetThreadedRequestOwner() override;
+	virtual void FinishRequest() override;
+	virtual void FinishCoalescedRequest(IHttpRequest& LeaderRequest) override;
+	virtual void FinishCachedRequest(FHttpResponsePtr CachedResponse) override;
+
+protected:
+
+	/**
+	 * Configure the transfer from the current verb, url, headers and payload, and reset what the previous one left behind.
+	 * Called by ProcessRequest before the shared state is reset.
+	 *
+	 * @return true if the request is ready to be handed to the HTTP thread
+	 */
+	virtual bool SetupRequest() = 0;
+
+	/**
+	 * @return the response the transfer fills in, nullptr before the request was processed
+	 */
+	virtual FHttpResponsePtr GetTransferResponse() const = 0;
+
+	/**
+	 * Mark the response of the transfer as complete, right before the completion delegate runs
+	 *
+	 * @param bSucceeded - whether the transfer succeeded
+	 */
+	virtual void MarkTransferResponseReady(bool bSucceeded) = 0;
+
+	/**
+	 * @return true if the completed transfer got a response
+	 */
+	virtual bool HasTransferSucceeded() const = 0;
+
+	/**
+	 * @return true if the completed transfer failed before a connection to the server was established, so it is safe to retry
+	 */
+	virtual bool IsTransferConnectionError() const = 0;
+
+	/**
+	 * @return the description of the failure of the completed transfer to log, empty to log nothing
+	 */
+	virtual std::string GetTransferError() const = 0;
+
+	/**
+	 * Stop or restart receiving the response of the transfer. HTTP thread only.
+	 *
+	 * @param bPause - true to stop receiving
+	 * @return false if the transfer can't be paused, e.g. it hands over the body at once or is not connected yet
+	 */
+	virtual bool PauseTransfer(bool bPause);
+
+	/**
+	 * @return true if the transfer should be paused for the requested pause or the stream executor backlog
+	 */
+	bool ShouldPauseResponseStream() const;
+
+	/**
+	 * Pause or resume the transfer to match the requested pause and the stream executor backlog. HTTP thread only.
+	 */
+	void UpdateResponseStreamPause();
+
+	/**
+	 * Hand a chunk of the response body to the stream delegate, inline or through the stream executor. HTTP thread only.
+	 * An empty chunk marks the end of the body.
+	 */
+	void DeliverResponseStream(std::span<const uint8_t> Chunk);
+
+	/**
+	 * Same as above for a chunk the request shares, queued for the stream executor without a copy
+	 */
+	void DeliverResponseStream(FHttpSharedBuffer Chunk);
+
+	/**
+	 * Queue a chunk for the stream executor, posting a task to deliver the queue unless one is already delivering it.
+	 * HTTP thread only.
+	 *
+	 * @param Chunk - the chunk, nullptr for the end of the body
+	 */
+	void QueueResponseStream(FHttpSharedBuffer Chunk);
+
+	/**
+	 * Run the stream delegate with the queued chunks in order, until the queue is empty. Stream executor only.
+	 */
+	void DrainResponseStream();
+
+	/**
+	 * Run the completion delegate with the response it is given
+	 */
+	void ExecuteCompleteDelegate(FHttpResponsePtr CompletedResponse);
+
+	/**
+	 * Make the current Timings the ones GetTimings returns
+	 */
+	void PublishTimings();
+
+	/** @return the id of the request in the trace, see FHttpTrace */
+	uint64_t GetTraceId() const
+	{
+		return uint64_t(reinterpret_cast<uintptr_t>(this));
+	}
+
+	/** Manager the request is tracked by while processing */
+	FHttpManager& Manager;
+	/** Cached URL */
+	std::string URL;
+	/** Cached verb */
+	std::string Verb;
+	/** HTTP version asked for, Default to use the one of the http thread */
+	EHttpVersion::Type HttpVersion;
+	/** Priority class the http thread schedules the request with */
+	EHttpRequestPriority::Type Priority;
+	/** Set to true when request has been canceled */
+	std::atomic_bool bCanceled;
+	/** Set to true when the http thread gave up on the request because it ran past its timeout */
+	std::atomic_bool bTimedOut;
+	/** Set to true once the transport completed the transfer, successfully or not */
+	std::atomic_bool bTransferCompleted;
+	/** Http thread the request was last queued on or stolen by */
+	std::atomic<FHttpThread*> OwningThread;
+	/** Mapping of header section to values. */
+	FHttpHeaders Headers;
+	/** The request payload, in memory or read from a source while uploading */
+	FHttpRequestBody RequestBody;
+	/** Smallest payload in bytes to compress, 0 to never compress */
+	size_t ContentCompressionThreshold;
+	/** Whether a compressed response is decompressed */
+	bool bDecompressResponse;
+	/** Number of bytes sent already */
+	std::atomic<size_t> BytesSent;
+	/** Number of bytes received already, mirrors the response payload size for progress reporting */
+	std::atomic<size_t> BytesReceived;
+	/** Last progress values reported to OnRequestProgress */
+	size_t LastReportedBytesSent;
+	size_t LastReportedBytesReceived;
+	/** Current status of request being processed, read by threads waiting on the request */
+	std::atomic<EHttpRequestStatus::Type> CompletionStatus;
+	/** Response the request completed with when it did not come from its own transfer, a shared or cached one */
+	FHttpResponsePtr BorrowedResponse;
+	/** Timeout of the whole request in seconds, 0 for none */
+	float Timeout;
+	/** Timeout of the connection phase in seconds, 0 for the transport default */
+	float ConnectTimeout;
+	/** Time taken by the transfer, accumulated on the HTTP thread */
+	std::atomic<float> ElapsedTime;
+	/** When the request reached each phase, written by whichever thread runs that phase */
+	FHttpRequestTimings Timings;
+	/** Copy of Timings handed to GetTimings, updated when the request is queued and when it finished */
+	FHttpRequestTimings PublishedTimings;
+	/** Guards PublishedTimings */
+	mutable std::mutex PublishedTimingsLock;
+	/** Delegate that will get called once request completes or on any error */
+	FHttpRequestCompleteDelegate RequestCompleteDelegate;
+	/** Delegate that will get called once per tick with bytes downloaded so far */
+	FHttpRequestProgressDelegate RequestProgressDelegate;
+	/** Delegate receiving the response body as it arrives, the body is buffered in the response when unbound */
+	FHttpRequestStreamDelegate RequestStreamDelegate;
+	/** Executor running the stream delegate, empty to run it on the HTTP thread */
+	FHttpExecutor StreamExecutor;
+	/** Bytes allowed to wait for the stream executor before receiving is paused */
+	size_t MaxQueuedStreamBytes;
+	/** Bytes copied for the stream executor that it did not deliver yet */
+	std::atomic<size_t> QueuedStreamBytes;
+	/** Chunks handed to the stream executor that it did not deliver yet, the end of the body included. The completion waits for 0. */
+	std::atomic<size_t> QueuedStreamChunks;
+	/** Chunks waiting for the stream executor in arrival order, nullptr for the end of the body */
+	std::deque<FHttpSharedBuffer> StreamQueue;
+	/** Whether a task delivering StreamQueue is posted to the stream executor, only one runs at a time */
+	bool bStreamDrainPosted;
+	/** Guards StreamQueue and bStreamDrainPosted */
+	std::mutex StreamQueueLock;
+	/** Set by PauseResponseStream, cleared by ResumeResponseStream */
+	std::atomic_bool bStreamPauseRequested;
+	/** Whether receiving is currently paused. Only changed on the HTTP thread. */
+	std::atomic_bool bStreamPaused;
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include "IHttpRequest.h"
+#include "HttpQueues.h"
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <array>
+
+/**
+ * Set of the requests a manager is tracking, with O(1) add, remove and lookup by pointer.
+ * Requests are spread over independently locked shards so callers on different threads rarely contend,
+ * and each shard keeps its requests in a dense array for cheap iteration. The requests that need a Tick are also kept
+ * in an array of their own, so ticking doesn't visit every tracked request.
+ */
+class FHttpRequestRegistry
+{
+public:
+
+	/**
+	 * Start tracking a request
+	 *
+	 * @param Request - the request to add
+	 * @param bTickable - whether the request needs a Tick, see GetTickable
+	 * @return false if the request was already tracked
+	 */
+	bool Add(const FHttpRequestPtr& Request, bool bTickable = false);
+
+	/**
+	 * Stop tracking a request
+	 *
+	 * @param RequestPtr - the request to remove
+	 * @return the removed request, or nullptr if it was not tracked
+	 */
+	FHttpRequestPtr Remove(const IHttpRequest* RequestPtr);
+
+	/**
+	 * @param RequestPtr - the request to look for
+	 * @return true if the request is being tracked
+	 */
+	bool Contains(const IHttpRequest* RequestPtr) const;
+
+	/**
+	 * @return number of tracked requests
+	 */
+	size_t Num() const
+	{
+		return Count.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @return number of tracked requests that need a Tick
+	 */
+	size_t NumTickable() const
+	{
+		return TickableCount.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Append every tracked request to an array.
+	 * Shards are locked one at a time, so the result may miss requests added or removed concurrently.
+	 *
+	 * @param OutRequests - array the requests are appended to
+	 */
+	void GetAll(std::vector<FHttpRequestPtr>& OutRequests) const;
+
+	/**
+	 * Append the tracked requests that were added as tickable to an array, with the same guarantees as GetAll
+	 *
+	 * @param OutRequests - array the requests are appended to
+	 */
+	void GetTickable(std::vector<FHttpRequestPtr>& OutRequests) const;
+
+private:
+	static constexpr size_t ShardCount = 16;
+	static constexpr size_t NotTickable = ~size_t(0);
+
+	/** Where a request is in the arrays of its shard */
+	struct FIndices
+	{
+		size_t Index;
+		/** Index in TickableRequests, NotTickable if it is not in it */
+		size_t TickableIndex;
+	};
+
+	struct alignas(HttpQueueCacheLineSize) FShard
+	{
+		mutable std::mutex Lock;
+		/** Dense array of requests, removal swaps with the last entry */
+		std::vector<FHttpRequestPtr> Requests;
+		/** Dense array of the requests that need a Tick, removal swaps with the last entry */
+		std::vector<FHttpRequestPtr> TickableRequests;
+		/** Indices of each request in Requests and TickableRequests */
+		std::unordered_map<const IHttpRequest*, FIndices> Indices;
+	};
+
+	FShard& GetShard(const IHttpRequest* RequestPtr) const;
+
+	mutable std::array<FShard, ShardCount> Shards;
+	std::atomic<size_t> Count{0};
+	std::atomic<size_t> TickableCount{0};
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "IHttpRequest.h"
+#include <unordered_map>
+#include <deque>
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Decides which queued requests an http thread starts. Higher priority classes always go first,
+ * hosts take turns within a class, and requests are only started while the global and per host caps leave room.
+ * Not thread safe, only used on the http thread.
+ */
+class FHttpRequestScheduler
+{
+public:
+
+	/**
+	 * Set the caps on running requests, 0 for no limit
+	 *
+	 * @param InMaxRunning - most requests running at once
+	 * @param InMaxRunningPerHost - most requests running at once to the same host and port
+	 */
+	void SetLimits(uint32_t InMaxRunning, uint32_t InMaxRunningPerHost);
+
+	/**
+	 * Queue a request until a slot is free for it
+	 *
+	 * @param Request - the request to queue
+	 */
+	void Enqueue(IHttpThreadedRequest* Request);
+
+	/**
+	 * Take a request out of the queue before it started
+	 *
+	 * @param Request - the request to remove
+	 * @return false if the request is not queued
+	 */
+	bool Remove(IHttpThreadedRequest* Request);
+
+	/**
+	 * Move the requests that fit in the free slots out of the queue, best first. They count as running until Finish.
+	 *
+	 * @param OutRequests - the requests to start are appended to it
+	 */
+	void DequeueStartable(std::vector<IHttpThreadedRequest*>& OutRequests);
+
+	/**
+	 * Free the slot of a request returned by DequeueStartable. Ignored for any other request.
+	 *
+	 * @param Request - the request that completed or failed to start
+	 */
+	void Finish(IHttpThreadedRequest* Request);
+
+	/**
+	 * @return true if a queued request would be returned by DequeueStartable
+	 */
+	bool HasStartable() const;
+
+	/**
+	 * @return number of queued requests
+	 */
+	size_t NumQueued() const
+	{
+		return QueuedCount;
+	}
+
+private:
+	struct FHost
+	{
+		/** Host and port the requests go to */
+		std::string Key;
+		/** Requests of this host returned by DequeueStartable and not finished yet */
+		uint32_t Running = 0;
+		/** Queued requests of each priority, oldest first */
+		std::array<std::deque<IHttpThreadedRequest*>, EHttpRequestPriority::Count> Queues;
+		/** Whether the host is in the turn order of each priority */
+		std::array<bool, EHttpRequestPriority::Count> bInTurnOrder = {};
+	};
+
+	struct FRequestState
+	{
+		FHost* Host;
+		bool bRunning;
+	};
+
+	bool HasRoom(const FHost& Host) const;
+
+	/** Forget a host that has nothing queued or running and is in no turn order */
+	void ReleaseHostIfUnused(FHost* Host);
+
+	uint32_t MaxRunning = 0;
+	uint32_t MaxRunningPerHost = 0;
+	uint32_t RunningCount = 0;
+	size_t QueuedCount = 0;
+
+	/** Hosts with queued requests of each priority, in the order they get their next turn */
+	std::array<std::deque<FHost*>, EHttpRequestPriority::Count> TurnOrders;
+	/** Hosts with queued or running requests */
+	std::unordered_map<std::string, std::unique_ptr<FHost>> Hosts;
+	/** Host of each queued or running request */
+	std::unordered_map<IHttpThreadedRequest*, FRequestState> Requests;
+};
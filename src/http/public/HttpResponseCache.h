@@ -0,0 +1,175 @@
+#pragma once
+#include "IHttpRequest.h"
+#include "IHttpResponse.h"
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <string>
+
+/**
+ * Limits of a response cache
+ */
+struct FHttpResponseCacheSettings
+{
+	/** Most bytes of responses kept in memory, least recently used ones are dropped first */
+	size_t MaxMemoryBytes = 32 * 1024 * 1024;
+	/** Directory of the on-disk store, empty to only cache in memory */
+	std::string DiskDirectory;
+	/** Most bytes kept on disk, the oldest segment file is deleted first */
+	uint64_t MaxDiskBytes = 256 * 1024 * 1024;
+	/** Size at which a segment file is sealed and the next one started */
+	uint32_t SegmentBytes = 16 * 1024 * 1024;
+};
+
+/**
+ * Counters of a response cache
+ */
+struct FHttpResponseCacheStats
+{
+	/** Requests served from the cache without a transfer */
+	uint64_t Hits = 0;
+	/** Requests sent with validators that came back 304 Not Modified and were served from the cache */
+	uint64_t Revalidations = 0;
+	/** Cacheable requests that had to be sent, including failed revalidations */
+	uint64_t Misses = 0;
+	/** Responses stored */
+	uint64_t Stores = 0;
+	/** Bytes of responses in memory */
+	size_t MemoryBytes = 0;
+	/** Bytes of segment files on disk */
+	uint64_t DiskBytes = 0;
+};
+
+/**
+ * Response served from a cache. Immutable, the body is shared with the cache entry.
+ */
+class FHttpCachedResponse : public IHttpResponse
+{
+public:
+
+	FHttpCachedResponse(const std::string& InURL, int32_t InResponseCode, const FHttpHeaders& InHeaders, FHttpSharedBuffer InBody);
+
+	// IHttpBase
+	virtual std::string GetURL() override;
+	virtual std::string GetURLParameter(const std::string& ParameterName) override;
+	virtual std::string GetHeader(const std::string& HeaderName) override;
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) override;
+	virtual const FHttpHeaders& GetHeaders() override;
+	virtual std::vector<std::string> GetAllHeaders() override;
+	virtual std::string GetContentType() override;
+	virtual int32_t GetContentLength() override;
+	virtual const std::vector<uint8_t>& GetContent() override;
+
+	// IHttpResponse
+	virtual int32_t GetResponseCode() override;
+	virtual std::string GetContentAsString() override;
+	virtual EHttpVersion::Type GetHttpVersion() override;
+
+private:
+	std::string URL;
+	int32_t ResponseCode;
+	FHttpHeaders Headers;
+	FHttpSharedBuffer Body;
+};
+
+class FHttpDiskCacheStore;
+
+/**
+ * Private HTTP cache of GET responses following https://www.rfc-editor.org/rfc/rfc9111.
+ * Fresh responses are kept in a size bounded LRU in memory and optionally in memory-mapped segment files on disk.
+ * Stale responses are revalidated with If-None-Match / If-Modified-Since. One variant is kept per URL,
+ * a request whose Vary headers don't match it is a miss. Thread safe.
+ */
+class FHttpResponseCache
+{
+public:
+
+	FHttpResponseCache(const FHttpResponseCacheSettings& InSettings = FHttpResponseCacheSettings());
+	~FHttpResponseCache();
+
+	/**
+	 * Look up a request before it is sent. Called on the thread processing the request.
+	 * Every request that has to be sent must be handed to EndRequest once it completes, or to AbandonRequest when it
+	 * completes without a transfer of its own.
+	 *
+	 * @param Request - the request about to be sent
+	 * @param OutValidators - receives the If-None-Match / If-Modified-Since headers to send along when a stale response can be revalidated
+	 * @return the response to complete the request with right away, or nullptr if it has to be sent
+	 */
+	FHttpResponsePtr BeginRequest(IHttpRequest& Request, FHttpHeaders& OutValidators);
+
+	/**
+	 * Store the response of a request that was sent. Called on the game thread before the request is finished.
+	 *
+	 * @param Request - the completed request
+	 * @param bSucceeded - whether the transfer succeeded
+	 * @return the cached response to complete the request with when the server answered 304 Not Modified, otherwise nullptr
+	 */
+	FHttpResponsePtr EndRequest(IHttpRequest& Request, bool bSucceeded);
+
+	/**
+	 * Forget a request handed to BeginRequest that completes without its own transfer, e.g. one coalesced with an
+	 * identical request or cancelled before it was sent.
+	 *
+	 * @param Request - the completed request
+	 */
+	void AbandonRequest(const IHttpRequest& Request);
+
+	/**
+	 * Drop every response, in memory and on disk
+	 */
+	void Clear();
+
+	/**
+	 * @return the counters of the cache
+	 */
+	FHttpResponseCacheStats GetStats() const;
+
+	/** A cached response */
+	struct FEntry
+	{
+		std::string URL;
+		int32_t ResponseCode = 0;
+		FHttpHeaders Headers;
+		FHttpSharedBuffer Body;
+		/** Seconds since the epoch at which the response was received or last revalidated, minus its Age */
+		int64_t ResponseTime = 0;
+		/** Seconds the response stays fresh after ResponseTime */
+		int64_t FreshnessLifetime = 0;
+		/** Names and values of the request headers the response varies on */
+		std::vector<std::pair<std::string, std::string>> Vary;
+		/** Bytes the entry takes in memory */
+		size_t Bytes = 0;
+	};
+
+private:
+	typedef std::shared_ptr<FEntry> FEntryPtr;
+
+	/** Find the entry of a URL in memory. CacheLock must be held. */
+	FEntryPtr FindEntry(const std::string& URL);
+
+	/** Insert or replace the entry of its URL in memory, dropping least recently used entries past the limit. CacheLock must be held. */
+	void InsertEntry(const FEntryPtr& Entry);
+
+	/** Drop the entry of a URL, in memory and on disk. CacheLock must be held. */
+	void RemoveEntry(const std::string& URL);
+
+	/** Drop the entry of a URL from memory only. CacheLock must be held. */
+	void RemoveEntryFromMemory(const std::string& URL);
+
+	FHttpResponseCacheSettings Settings;
+
+	mutable std::mutex CacheLock;
+	/** Entries, most recently used first */
+	std::list<FEntryPtr> Lru;
+	std::unordered_map<std::string, std::list<FEntryPtr>::iterator> Entries;
+	size_t MemoryBytes = 0;
+	/** Entry each request sent with validators revalidates, until EndRequest */
+	std::unordered_map<const IHttpRequest*, FEntryPtr> PendingRequests;
+	/** Bumped whenever an entry is stored or removed, tells a disk read made without CacheLock whether it is outdated */
+	uint64_t EntryGeneration = 0;
+	/** Has its own lock, called without CacheLock when it may touch the file system */
+	std::unique_ptr<FHttpDiskCacheStore> DiskStore;
+	FHttpResponseCacheStats Stats;
+};
@@ -0,0 +1,183 @@
+#pragma once
+#include "IHttpBase.h"
+#include "HttpHeaders.h"
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace EHttpResponseParseResult
+{
+	/**
+	 * Outcome of feeding bytes to FHttpResponseParser
+	 */
+	enum Type
+	{
+		/** The response is not complete yet */
+		NeedMoreInput,
+		/** The whole response was parsed */
+		Complete,
+		/** The response is malformed or the listener aborted it */
+		Error
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpResponseParseResult::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case NeedMoreInput:
+			{
+				return "NeedMoreInput";
+			}
+			case Complete:
+			{
+				return "Complete";
+			}
+			case Error:
+			{
+				return "Error";
+			}
+		}
+		return "Unknown";
+	}
+}
+
+/**
+ * Receives the parts of a response as FHttpResponseParser reads them
+ */
+class IHttpResponseParserListener
+{
+public:
+
+	/**
+	 * Called once with the status line and headers of the final response, interim 1xx responses are skipped
+	 *
+	 * @param StatusCode - status code of the response
+	 * @param Headers - headers of the response, may be moved from
+	 * @return false to abort the response
+	 */
+	virtual bool OnResponseHead(int32_t StatusCode, FHttpHeaders& Headers) = 0;
+
+	/**
+	 * Called with each part of the body as it is parsed, with the chunked framing removed
+	 *
+	 * @param Data - the bytes, viewing into the input given to Parse
+	 * @return false to abort the response
+	 */
+	virtual bool OnResponseBody(std::span<const uint8_t> Data) = 0;
+
+	/**
+	 * Destructor for overrides
+	 */
+	virtual ~IHttpResponseParserListener() {};
+};
+
+/**
+ * Incremental HTTP/1.1 response parser. Bytes are fed as they are received, in pieces of any size. The body is handed
+ * to the listener as views into the input, only a head or a chunk size line split across two reads is copied.
+ * Not thread safe.
+ */
+class FHttpResponseParser
+{
+public:
+
+	FHttpResponseParser();
+
+	/**
+	 * Start parsing a new response
+	 *
+	 * @param bInHeadRequest - whether the response answers a HEAD request, which has no body whatever its headers say
+	 */
+	void Reset(bool bInHeadRequest);
+
+	/**
+	 * Parse the next bytes of the response
+	 *
+	 * @param Input - bytes received
+	 * @param Listener - receives the head and the body
+	 * @param OutConsumed - bytes of Input that belong to the response, anything after them follows the response
+	 * @return Complete once the whole response was parsed
+	 */
+	EHttpResponseParseResult::Type Parse(std::span<const uint8_t> Input, IHttpResponseParserListener& Listener, size_t& OutConsumed);
+
+	/**
+	 * The server closed the connection
+	 *
+	 * @return Complete if that ends a body delimited by the end of the connection, Error if the response was cut short
+	 */
+	EHttpResponseParseResult::Type ParseEndOfInput();
+
+	/**
+	 * @return true if the connection can carry another request once the response is complete
+	 */
+	bool IsKeepAlive() const
+	{
+		return bKeepAlive;
+	}
+
+	/**
+	 * @return true if any byte of the response was received
+	 */
+	bool HasStarted() const
+	{
+		return ReceivedBytes > 0;
+	}
+
+	/**
+	 * @return HTTP version of the status line
+	 */
+	EHttpVersion::Type GetHttpVersion() const
+	{
+		return HttpVersion;
+	}
+
+	/** Longest head accepted, status line and headers */
+	static constexpr size_t MaxHeadSize = 64 * 1024;
+
+private:
+
+	enum class EState : uint8_t
+	{
+		Head,
+		Body,
+		BodyUntilClose,
+		ChunkSize,
+		ChunkData,
+		ChunkDataEnd,
+		Trailers,
+		Complete,
+		Error
+	};
+
+	/**
+	 * Parse a complete head, from the status line to the empty line, and pick how the body is delimited
+	 *
+	 * @return false if it is malformed or the listener aborted
+	 */
+	bool ParseHead(std::string_view Head, IHttpResponseParserListener& Listener);
+
+	/**
+	 * Read the next CRLF terminated line, copying it only when it is split across two inputs
+	 *
+	 * @param OutLine - the line without its line ending, valid until the next call
+	 * @return false if more input is needed, or the line is too long which sets the state to Error
+	 */
+	bool ReadLine(std::span<const uint8_t> Input, size_t& Offset, std::string_view& OutLine);
+
+	EState State;
+	bool bHeadRequest;
+	bool bKeepAlive;
+	EHttpVersion::Type HttpVersion;
+	/** Bytes left in the body or in the current chunk */
+	uint64_t RemainingBytes;
+	/** Bytes of the response received so far */
+	uint64_t ReceivedBytes;
+	/** Start of a head split across inputs */
+	std::string HeadBuffer;
+	/** Start of a line split across inputs, and whether it holds the line returned last */
+	std::string LineBuffer;
+	bool bLineBufferReturned;
+	/** Headers of the response being parsed, handed to the listener */
+	FHttpHeaders Headers;
+};
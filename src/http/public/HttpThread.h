@@ -1,7 +1,84 @@
 #pragma once
 #include "IHttpRequest.h"
+#include "HttpQueues.h"
+#include "HttpTimerWheel.h"
+#include "HttpRequestScheduler.h"
+#include <unordered_map>
 #include <thread>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <vector>
+#include <functional>
+
+/**
+ * Snapshot of the counters of one http thread, used to size the thread pool
+ */
+struct FHttpThreadStats
+{
+	/** Requests started on this thread, including stolen ones */
+	uint64_t StartedRequests = 0;
+	/** Requests handed back as completed, including cancelled ones */
+	uint64_t CompletedRequests = 0;
+	/** Requests that were cancelled while running on this thread */
+	uint64_t CancelledRequests = 0;
+	/** Requests this thread took from the queue of a busier thread */
+	uint64_t StolenRequests = 0;
+	/** Requests waiting to be started at the time of the snapshot, including those held back by the caps */
+	uint32_t PendingRequests = 0;
+	/** Requests running at the time of the snapshot */
+	uint32_t RunningRequests = 0;
+	/** Time spent processing rather than waiting for activity */
+	double BusySeconds = 0.0;
+	/** Completed transfers that had to open a new connection */
+	uint64_t NewConnections = 0;
+	/** Completed transfers that reused a connection kept alive by an earlier one */
+	uint64_t ReusedConnections = 0;
+	/** Connections opened ahead of time by FHttpManager::Preconnect */
+	uint64_t PreconnectedConnections = 0;
+	/** Preconnected connections that went on to carry a request */
+	uint64_t UsedPreconnectedConnections = 0;
+	/** Preconnects that failed to resolve, connect or complete the TLS handshake */
+	uint64_t FailedPreconnects = 0;
+};
+
+/**
+ * Host to open connections to ahead of the first request, see FHttpManager::Preconnect
+ */
+struct FHttpPreconnectTarget
+{
+	/** Url of the host, its scheme and port pick the connections warmed up. The path is only requested by transports that need a request to open a connection. */
+	std::string URL;
+	/** Connections wanted, the ones already open to the host count */
+	uint32_t ConnectionCount = 1;
+};
+
+/**
+ * Limits of the connections an http thread keeps to servers. Connections, DNS results and TLS sessions
+ * are kept per http thread and reused by every request to the same host and port.
+ */
+struct FHttpConnectionSettings
+{
+	/** Most connections open to a single host and port, 0 for no limit. Requests past it wait for a free connection. */
+	uint32_t MaxConnectionsPerHost = 0;
+	/** Most connections open at once, 0 for no limit */
+	uint32_t MaxTotalConnections = 0;
+	/** Most idle connections kept alive for reuse, 0 for the transport default */
+	uint32_t MaxIdleConnections = 0;
+	/** Seconds an idle connection is kept before it is closed instead of reused, 0 for the transport default */
+	float IdleConnectionTimeout = 0.0f;
+	/** Seconds a resolved address is reused, 0 for the transport default */
+	float DnsCacheTimeout = 0.0f;
+	/** Resume TLS sessions of earlier connections to the same host to skip the full handshake */
+	bool bShareTlsSessions = true;
+	/** HTTP version of requests that don't set their own, Default for the transport default */
+	EHttpVersion::Type HttpVersion = EHttpVersion::Default;
+	/** Most HTTP/2 streams multiplexed over one connection, 0 for the transport default */
+	uint32_t MaxConcurrentStreams = 0;
+	/** Let a new HTTP/2 request wait for a connection being set up to the same host, rather than opening another one */
+	bool bWaitForMultiplexing = true;
+};
+
 class FHttpThread
 {
 public:
@@ -19,6 +96,14 @@ public:
 	 */
 	void StopThread();
 
+	/**
+	 * @return true if the HTTP thread is running, otherwise Tick has to pump it
+	 */
+	bool IsThreadRunning() const
+	{
+		return Thread != nullptr;
+	}
+
 	/**
 	 * Add a request to begin processing on HTTP thread.
 	 *
@@ -27,14 +112,14 @@ public:
 	void AddRequest(IHttpThreadedRequest* Request);
 
 	/**
-	 * Mark a request as cancelled.    Called on non-HTTP thread.
+	 * Mark a request as cancelled, forwarded to the thread that stole it if it was. Called on any thread.
 	 *
 	 * @param Request the request to be processed on the HTTP thread
 	 */
 	void CancelRequest(IHttpThreadedRequest* Request);
 
 	/**
-	 * Get completed requests.  Clears internal arrays.  Called on non-HTTP thread.
+	 * Get completed requests, appended to the output array.  Clears internal arrays.  Called on non-HTTP thread.
 	 *
 	 * @param OutCompletedRequests array of requests that have been completed
 	 */
@@ -42,6 +127,68 @@ public:
 
 	virtual void Tick();
 
+	/**
+	 * Select between blocking on activity (default) and the fixed frame time loop.
+	 * Must be called before StartThread.
+	 *
+	 * @param bInEventDriven true to block until woken or sockets are ready, false to sleep out frame times
+	 */
+	void SetEventDriven(bool bInEventDriven);
+
+	/**
+	 * Set the other threads of the same pool. Requests queued on a busy sibling may be stolen
+	 * by this thread when it has nothing to start. Must be called before StartThread.
+	 *
+	 * @param InSiblingThreads all threads of the pool, may include this thread
+	 */
+	void SetSiblingThreads(const std::vector<FHttpThread*>& InSiblingThreads);
+
+	/**
+	 * Set the limits of the connections kept to servers. Must be called before StartThread.
+	 *
+	 * @param InConnectionSettings - the limits
+	 */
+	void SetConnectionSettings(const FHttpConnectionSettings& InConnectionSettings);
+
+	/**
+	 * Cap the requests running at once, requests past a cap stay queued until a slot frees up.
+	 * Must be called before StartThread.
+	 *
+	 * @param MaxRunning - most requests running on this thread, 0 for no limit
+	 * @param MaxRunningPerHost - most requests running to the same host and port, 0 for no limit
+	 */
+	void SetRequestLimits(uint32_t MaxRunning, uint32_t MaxRunningPerHost);
+
+	/**
+	 * Set the function called on the http thread once it handed back completed requests, so they are picked up
+	 * right away instead of being polled. Must be called before StartThread.
+	 *
+	 * @param InCompletionCallback - called with this thread after each pass that completed requests
+	 */
+	void SetCompletionCallback(std::function<void(FHttpThread&)> InCompletionCallback);
+
+	/**
+	 * Have the completion callback called after the next pass even if no request completes. Called on any thread.
+	 */
+	void RequestCompletionCallback();
+
+	/**
+	 * Get a snapshot of the counters of this thread. Called on any thread.
+	 */
+	FHttpThreadStats GetStats();
+
+	/**
+	 * Wake up the http thread if it is blocked in WaitForActivity. Called on any thread.
+	 */
+	virtual void WakeUp();
+
+	/**
+	 * Open connections to a host ahead of its requests, they are kept alive for reuse. Called on any thread.
+	 *
+	 * @param Target - host and number of connections
+	 */
+	void Preconnect(const FHttpPreconnectTarget& Target);
+
 
 protected:
 
@@ -60,6 +207,28 @@ protected:
 	 */
 	virtual void CompleteThreadedRequest(IHttpThreadedRequest* Request);
 
+	/**
+	 * Block the http thread until it is woken up, there is activity to process or the timeout expires.
+	 * Only used in event driven mode.
+	 *
+	 * @param MaxWaitSeconds longest time to wait, negative to wait until woken up
+	 */
+	virtual void WaitForActivity(double MaxWaitSeconds);
+
+	/**
+	 * Longest time WaitForActivity may block before the running requests need servicing again. Only used in event driven mode.
+	 * Waits for the next timer, or an active frame while a running request is tickable.
+	 *
+	 * @return the time in seconds, negative to wait until woken up
+	 */
+	virtual double GetMaxActivityWaitSeconds() const;
+
+	/**
+	 * Start opening the connections of a preconnect on the http thread. Transports without connections ignore it.
+	 * Counted in PreconnectedConnectionCount, UsedPreconnectedConnectionCount and FailedPreconnectCount.
+	 */
+	virtual void StartPreconnect(const FHttpPreconnectTarget& Target);
+
 
 protected:
 	// Threading functions
@@ -72,10 +241,35 @@ protected:
 
 	void Process(std::vector<IHttpThreadedRequest*>& RequestsToCancel, std::vector<IHttpThreadedRequest*>& RequestsToStart, std::vector<IHttpThreadedRequest*>& RequestsToComplete);
 
+	/**
+	 * Move part of the queue of a busy sibling into RequestsToStart
+	 *
+	 * @return true if any request was stolen
+	 */
+	bool StealRequests(std::vector<IHttpThreadedRequest*>& RequestsToStart);
+
+	/**
+	 * Remove a request from RunningThreadedRequests, the last one takes its place
+	 *
+	 * @param Index - position of the request in RunningThreadedRequests
+	 */
+	void RemoveRunningRequest(size_t Index);
+
 	/** signal request to stop and exit thread */
 	std::atomic_bool ExitRequest{false};
 
-	/** Time in seconds to use as frame time when actively processing requests. 0 means no frame time. */
+	/** Block on activity instead of sleeping out frame times */
+	bool bEventDriven;
+
+	/** Set by WakeUp, consumed by WaitForActivity. Protected by WakeUpLock. */
+	bool bWakeUpPending;
+	std::mutex WakeUpLock;
+	std::condition_variable WakeUpEvent;
+
+	/**
+	 * Time in seconds to use as frame time when actively processing requests. 0 means no frame time.
+	 * In event driven mode this is the longest wait while a running request is tickable.
+	 */
 	double HttpThreadActiveFrameTimeInSeconds;
 	/** Time in seconds to sleep minimally when actively processing requests. */
 	double HttpThreadActiveMinimumSleepTimeInSeconds;
@@ -86,21 +280,64 @@ protected:
 	/** Last time the thread has been processed. Used in the non-game thread. */
 	double LastTime;
 
-protected:
-	/** Critical section to lock access to PendingThreadedRequests, CancelledThreadedRequests, and CompletedThreadedRequests */
-	std::mutex RequestArraysLock;
+	/** Threads of the same pool that requests can be stolen from */
+	std::vector<FHttpThread*> SiblingThreads;
+	/** Minimum number of queued requests on a busy sibling before they get stolen */
+	size_t WorkStealingThreshold;
+	/** True while the http thread is blocked in WaitForActivity */
+	std::atomic_bool bWaiting{false};
+
+	/** Called on the http thread after a pass that completed requests */
+	std::function<void(FHttpThread&)> CompletionCallback;
+	/** Set by RequestCompletionCallback, consumed by Process */
+	std::atomic_bool bCompletionCallbackRequested{false};
+
+	/** Limits of the connections kept to servers, applied by the transport */
+	FHttpConnectionSettings ConnectionSettings;
 
+	std::atomic<uint64_t> StartedRequestCount{0};
+	std::atomic<uint64_t> CompletedRequestCount{0};
+	std::atomic<uint64_t> CancelledRequestCount{0};
+	std::atomic<uint64_t> StolenRequestCount{0};
+	std::atomic<uint32_t> RunningRequestCount{0};
+	std::atomic<uint64_t> BusyNanoseconds{0};
+	std::atomic<uint64_t> NewConnectionCount{0};
+	std::atomic<uint64_t> ReusedConnectionCount{0};
+	std::atomic<uint32_t> ScheduledRequestCount{0};
+	std::atomic<uint64_t> PreconnectedConnectionCount{0};
+	std::atomic<uint64_t> UsedPreconnectedConnectionCount{0};
+	std::atomic<uint64_t> FailedPreconnectCount{0};
+
+	/** Preconnects waiting to be started on the http thread. Protected by PreconnectLock. */
+	std::vector<FHttpPreconnectTarget> PendingPreconnects;
+	std::mutex PreconnectLock;
+	/** Whether PendingPreconnects is not empty, checked without the lock */
+	std::atomic_bool bHasPendingPreconnects{false};
+
+protected:
 	/**
 	 * Threaded requests that are waiting to be processed on the http thread.
-	 * Added to on non-HTTP thread, processed then cleared on HTTP thread.
+	 * Added to on any thread, drained on the HTTP thread, or by a sibling stealing work while holding PendingConsumerFlag.
 	 */
-	std::vector<IHttpThreadedRequest*> PendingThreadedRequests;
+	TMpscRingQueue<IHttpThreadedRequest*> PendingThreadedRequests;
+
+	/** Number of requests in PendingThreadedRequests */
+	std::atomic<size_t> PendingRequestCount{0};
+
+	/** Held by whichever thread is currently dequeuing from PendingThreadedRequests */
+	std::atomic_flag PendingConsumerFlag;
 
 	/**
 	 * Threaded requests that are waiting to be cancelled on the http thread.
-	 * Added to on non-HTTP thread, processed then cleared on HTTP thread.
+	 * Added to on any thread, drained on the HTTP thread.
 	 */
-	std::vector<IHttpThreadedRequest*> CancelledThreadedRequests;
+	TMpscRingQueue<IHttpThreadedRequest*> CancelledThreadedRequests;
+
+	/**
+	 * Requests taken from PendingThreadedRequests that wait for a free slot, by priority and host.
+	 * Only accessed on the HTTP thread.
+	 */
+	FHttpRequestScheduler Scheduler;
 
 	/**
 	 * Currently running threaded requests (not in any of the other arrays).
@@ -108,11 +345,28 @@ protected:
 	 */
 	std::vector<IHttpThreadedRequest*> RunningThreadedRequests;
 
+	/** Position of each request in RunningThreadedRequests, to cancel or time it out. Only accessed on the HTTP thread. */
+	std::unordered_map<IHttpThreadedRequest*, size_t> RunningRequestIndices;
+
+	/**
+	 * Timers of the http thread: request timeouts. Only accessed on the HTTP thread.
+	 */
+	FHttpTimerWheel Timers;
+
+	/** Timeout timer of each running request that has a timeout. Only accessed on the HTTP thread. */
+	std::unordered_map<IHttpThreadedRequest*, FHttpTimerWheel::FTimerHandle> RequestTimeouts;
+
+	/** Requests whose timeout fired during the current Process. Only accessed on the HTTP thread. */
+	std::vector<IHttpThreadedRequest*> TimedOutRequests;
+
+	/** Reused storage for the expired timer callbacks. Only accessed on the HTTP thread. */
+	std::vector<FHttpTimerWheel::FTimerCallback> ExpiredTimerCallbacks;
+
 	/**
 	 * Threaded requests that have completed and are waiting for the game thread to process.
-	 * Added to on HTTP thread, processed then cleared on game thread.
+	 * Added to on HTTP thread, drained on game thread.
 	 */
-	std::vector<IHttpThreadedRequest*> CompletedThreadedRequests;
+	TSpscRingQueue<IHttpThreadedRequest*> CompletedThreadedRequests;
 
 	/** Pointer to Runnable Thread */
 	std::thread* Thread;
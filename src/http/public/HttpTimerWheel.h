@@ -0,0 +1,109 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+/**
+ * Hierarchical timing wheel. Scheduling and cancelling are O(1), advancing time only touches the buckets
+ * that expire or cascade. Not thread safe, each owner drives its own wheel.
+ */
+class FHttpTimerWheel
+{
+public:
+	typedef std::function<void()> FTimerCallback;
+	/** Identifies a scheduled timer, 0 is never a valid handle */
+	typedef uint64_t FTimerHandle;
+
+	/**
+	 * Constructor
+	 *
+	 * @param InTickSeconds - resolution of the wheel, timers fire on the first tick at or after their expiry
+	 */
+	explicit FHttpTimerWheel(double InTickSeconds = 0.01);
+
+	/**
+	 * Schedule a callback
+	 *
+	 * @param DelaySeconds - time from now until the callback is due
+	 * @param Callback - callback handed out by Advance once due
+	 * @return handle used to cancel the timer
+	 */
+	FTimerHandle Schedule(double DelaySeconds, FTimerCallback Callback);
+
+	/**
+	 * Cancel a timer that has not fired yet
+	 *
+	 * @param Handle - handle returned by Schedule
+	 * @return true if the timer was pending
+	 */
+	bool Cancel(FTimerHandle Handle);
+
+	/**
+	 * Advance time and collect the callbacks of every timer that became due.
+	 * Callbacks are handed out instead of invoked so the caller can run them outside of its own locks.
+	 *
+	 * @param DeltaSeconds - time since the last call
+	 * @param OutExpiredCallbacks - due callbacks are appended in expiry order
+	 */
+	void Advance(double DeltaSeconds, std::vector<FTimerCallback>& OutExpiredCallbacks);
+
+	/**
+	 * @return time until the next timer may be due, never later than its expiry, negative when no timer is pending
+	 */
+	double GetSecondsUntilNextExpiry() const;
+
+	/**
+	 * @return number of pending timers
+	 */
+	size_t Num() const
+	{
+		return TimerCount;
+	}
+
+private:
+	static constexpr uint32_t SlotBits = 6;
+	static constexpr uint32_t SlotCount = 1u << SlotBits;
+	static constexpr uint32_t SlotMask = SlotCount - 1;
+	static constexpr uint32_t LevelCount = 4;
+	static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+	struct FTimer
+	{
+		uint64_t ExpiryTick = 0;
+		FTimerCallback Callback;
+		/** Bumped every time the entry is reused so stale handles can be detected */
+		uint32_t Generation = 1;
+		uint32_t Prev = InvalidIndex;
+		uint32_t Next = InvalidIndex;
+		uint16_t Level = 0;
+		uint16_t Slot = 0;
+		bool bActive = false;
+	};
+
+	struct FLevel
+	{
+		/** Head timer index of each slot */
+		std::array<uint32_t, SlotCount> Heads;
+		/** Bit set for every slot that holds at least one timer */
+		uint64_t Occupied = 0;
+	};
+
+	/** Put a timer in the bucket matching its expiry relative to the current tick */
+	void Link(uint32_t TimerIndex);
+	void Unlink(uint32_t TimerIndex);
+	/** Re-distribute the timers of the slot of Level the current tick just entered */
+	void Cascade(uint32_t Level);
+	/** Move every timer of the current level 0 slot to the expired callbacks */
+	void Expire(std::vector<FTimerCallback>& OutExpiredCallbacks);
+
+	double TickSeconds;
+	/** Time accumulated but not yet converted into ticks */
+	double Remainder;
+	uint64_t CurrentTick;
+	size_t TimerCount;
+
+	std::array<FLevel, LevelCount> Levels;
+	std::vector<FTimer> Timers;
+	std::vector<uint32_t> FreeTimers;
+};
@@ -0,0 +1,202 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @return monotonic time in nanoseconds, the clock of every request timestamp
+ */
+inline int64_t GetHttpTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * When a request reached each phase, monotonic nanoseconds from GetHttpTimestamp. 0 for a phase that was not reached
+ * or does not apply, e.g. TLS on a plain connection. Complete once the request finished.
+ */
+struct FHttpRequestTimings
+{
+	/** ProcessRequest handed the request to the manager */
+	int64_t Queued = 0;
+	/** An http thread started the transfer */
+	int64_t Started = 0;
+	/** The host name was resolved, 0 on a reused connection */
+	int64_t NameLookup = 0;
+	/** The connection was established, 0 on a reused connection */
+	int64_t Connected = 0;
+	/** The TLS handshake was done */
+	int64_t TlsHandshake = 0;
+	/** The first byte of the response arrived */
+	int64_t FirstByte = 0;
+	/** The last byte of the response arrived */
+	int64_t LastByte = 0;
+	/** The completion was delivered, right before the completion delegate */
+	int64_t Completed = 0;
+};
+
+namespace EHttpTimingPhase
+{
+	/**
+	 * Durations between the timestamps of a request that the manager keeps histograms of
+	 */
+	enum Type
+	{
+		/** Queued to Started, waiting for the http thread and a free slot */
+		Queue,
+		/** Started to NameLookup */
+		NameLookup,
+		/** NameLookup to Connected */
+		Connect,
+		/** Connected to TlsHandshake */
+		TlsHandshake,
+		/** End of the connection setup to FirstByte, the request upload and server time */
+		FirstByte,
+		/** FirstByte to LastByte */
+		Download,
+		/** LastByte to Completed, waiting for the completion to be delivered */
+		Delivery,
+		/** Queued to Completed */
+		Total,
+		Count
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpTimingPhase::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case Queue:
+			{
+				return "Queue";
+			}
+			case NameLookup:
+			{
+				return "NameLookup";
+			}
+			case Connect:
+			{
+				return "Connect";
+			}
+			case TlsHandshake:
+			{
+				return "TlsHandshake";
+			}
+			case FirstByte:
+			{
+				return "FirstByte";
+			}
+			case Download:
+			{
+				return "Download";
+			}
+			case Delivery:
+			{
+				return "Delivery";
+			}
+			case Total:
+			{
+				return "Total";
+			}
+			case Count:
+			{
+				break;
+			}
+		}
+		return "";
+	}
+}
+
+/**
+ * Copy of the counts of a latency histogram
+ */
+struct FHttpLatencySnapshot
+{
+	/** Count of each bucket, see FHttpLatencyHistogram */
+	std::vector<uint64_t> Counts;
+	/** Number of recorded values */
+	uint64_t TotalCount = 0;
+	/** Sum of the recorded values in microseconds */
+	uint64_t SumMicroseconds = 0;
+	/** Largest recorded value in microseconds */
+	uint64_t MaxMicroseconds = 0;
+
+	/**
+	 * @param Percentile - 0 to 100
+	 * @return the value in microseconds below which that percentage of the recorded values are, within the bucket precision
+	 */
+	uint64_t GetPercentile(double Percentile) const;
+
+	/**
+	 * @return the mean of the recorded values in microseconds
+	 */
+	double GetMean() const
+	{
+		return TotalCount ? double(SumMicroseconds) / double(TotalCount) : 0.0;
+	}
+};
+
+/**
+ * Log-linear histogram of durations in microseconds, in the spirit of HdrHistogram: every power of two is split in
+ * 16 linear buckets, so values are kept within 6.25%, up to about 71 minutes. Recording is lock-free, thread safe.
+ */
+class FHttpLatencyHistogram
+{
+public:
+	/** Buckets per power of two, as a number of bits */
+	static constexpr uint32_t SubBucketBits = 4;
+	static constexpr uint32_t SubBucketCount = 1u << SubBucketBits;
+	/** Values past 2^MaxValueBits microseconds land in the last bucket */
+	static constexpr uint32_t MaxValueBits = 32;
+	static constexpr uint32_t BucketCount = (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+	/**
+	 * Record a duration
+	 *
+	 * @param Nanoseconds - the duration, negative values are recorded as 0
+	 */
+	void Record(int64_t Nanoseconds);
+
+	/**
+	 * @return a copy of the counts, consistent enough for monitoring while values are recorded
+	 */
+	FHttpLatencySnapshot Snapshot() const;
+
+	/**
+	 * @return the bucket of a value in microseconds
+	 */
+	static uint32_t GetBucketIndex(uint64_t Microseconds);
+
+	/**
+	 * @return the highest value in microseconds that falls in a bucket
+	 */
+	static uint64_t GetBucketUpperBound(uint32_t Index);
+
+private:
+	std::array<std::atomic<uint64_t>, BucketCount> Counts = {};
+	std::atomic<uint64_t> TotalCount{ 0 };
+	std::atomic<uint64_t> SumMicroseconds{ 0 };
+	std::atomic<uint64_t> MaxMicroseconds{ 0 };
+};
+
+/**
+ * Latency histograms of the requests to one host
+ */
+struct FHttpHostLatencySnapshot
+{
+	/** Host and port */
+	std::string Host;
+	/** One histogram per EHttpTimingPhase */
+	std::array<FHttpLatencySnapshot, EHttpTimingPhase::Count> Phases;
+};
+
+/**
+ * Record the phase durations of a request in one histogram per phase
+ *
+ * @param Histograms - one histogram per EHttpTimingPhase
+ * @param Timings - timestamps of a finished request
+ */
+void RecordHttpRequestTimings(std::array<FHttpLatencyHistogram, EHttpTimingPhase::Count>& Histograms, const FHttpRequestTimings& Timings);
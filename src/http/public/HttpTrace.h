@@ -0,0 +1,126 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+struct FHttpRequestTimings;
+
+#ifndef ONLINEPP_HTTP_TRACE
+#define ONLINEPP_HTTP_TRACE 0
+#endif
+
+/**
+ * Low overhead event tracing of the http module. Each thread records into its own ring buffer, the oldest events are
+ * overwritten once it is full. The events are dumped on demand as Chrome trace-event JSON, which chrome://tracing and
+ * the Perfetto UI open. Compiled in with ONLINEPP_HTTP_TRACE, a disabled trace then costs one relaxed load per event.
+ * Event names must be string literals, only the pointer is recorded.
+ */
+class FHttpTrace
+{
+public:
+
+	/**
+	 * Start recording, dropping the events of a previous recording
+	 *
+	 * @param EventsPerThread - size of the ring buffer of each thread
+	 */
+	static void Start(size_t EventsPerThread = 64 * 1024);
+
+	/**
+	 * Stop recording, the recorded events are kept until the next Start
+	 */
+	static void Stop();
+
+	/**
+	 * @return true while recording
+	 */
+	static bool IsEnabled()
+	{
+		return bEnabled.load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Build the recorded events of every thread as Chrome trace-event JSON. Can be called while recording.
+	 */
+	static std::string ToChromeTraceJson();
+
+	/**
+	 * Write ToChromeTraceJson to a file
+	 *
+	 * @return false if the file could not be written
+	 */
+	static bool WriteChromeTrace(const std::string& Path);
+
+	/** Name the calling thread in the trace */
+	static void SetThreadName(const char* Name);
+
+	/** Begin a duration on the calling thread, closed by the next EndScope */
+	static void BeginScope(const char* Name);
+	static void EndScope(const char* Name);
+
+	/**
+	 * Mark a point of an asynchronous operation, e.g. a request, that may span threads
+	 *
+	 * @param Id - identifies the operation, the same for all of its events
+	 * @param Timestamp - GetHttpTimestamp of the event, 0 for now
+	 */
+	static void AsyncBegin(const char* Name, uint64_t Id, int64_t Timestamp = 0);
+	static void AsyncStep(const char* Name, uint64_t Id, int64_t Timestamp = 0);
+	static void AsyncEnd(const char* Name, uint64_t Id, int64_t Timestamp = 0);
+
+	/**
+	 * Mark the network phases a request reached, at the time it reached them
+	 *
+	 * @param Id - the id of the request, see AsyncBegin
+	 */
+	static void RequestPhases(uint64_t Id, const FHttpRequestTimings& Timings);
+
+	/** Record the value of a counter of the calling thread, e.g. a queue depth */
+	static void Counter(const char* Name, int64_t Value);
+
+private:
+	inline static std::atomic_bool bEnabled{ false };
+};
+
+/**
+ * Traces the duration of a scope
+ */
+class FHttpTraceScope
+{
+public:
+	explicit FHttpTraceScope(const char* InName)
+		: Name(FHttpTrace::IsEnabled() ? InName : nullptr)
+	{
+		if (Name)
+		{
+			FHttpTrace::BeginScope(Name);
+		}
+	}
+
+	~FHttpTraceScope()
+	{
+		if (Name)
+		{
+			FHttpTrace::EndScope(Name);
+		}
+	}
+
+	FHttpTraceScope(const FHttpTraceScope&) = delete;
+	FHttpTraceScope& operator=(const FHttpTraceScope&) = delete;
+
+private:
+	const char* Name;
+};
+
+#define HTTP_TRACE_JOIN_INNER(A, B) A##B
+#define HTTP_TRACE_JOIN(A, B) HTTP_TRACE_JOIN_INNER(A, B)
+
+#if ONLINEPP_HTTP_TRACE
+/** Trace the duration of the enclosing scope */
+#define HTTP_TRACE_SCOPE(Name) FHttpTraceScope HTTP_TRACE_JOIN(HttpTraceScope, __LINE__)(Name)
+/** Record an event, e.g. HTTP_TRACE_EVENT(Counter("Running", Count)), the arguments are only evaluated while recording */
+#define HTTP_TRACE_EVENT(Call) do { if (FHttpTrace::IsEnabled()) { FHttpTrace::Call; } } while (0)
+#else
+#define HTTP_TRACE_SCOPE(Name)
+#define HTTP_TRACE_EVENT(Call) do { } while (0)
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#include <memory>
+#include <string_view>
+
+class FHttpManager;
+
+namespace EHttpTransport
+{
+	/**
+	 * Transports an http manager can send its requests with
+	 */
+	enum Type
+	{
+		/** libcurl, http and https, HTTP/1.1 and HTTP/2 */
+		Curl,
+		/** Native HTTP/1.1 client on libuv, plain http only */
+		Uv,
+		/** In memory replies, nothing leaves the process, see FLoopbackHttpManager */
+		Loopback
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpTransport::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case Curl:
+			{
+				return "curl";
+			}
+			case Uv:
+			{
+				return "uv";
+			}
+			case Loopback:
+			{
+				return "loopback";
+			}
+		}
+		return "unknown";
+	}
+
+	/**
+	 * @param Name - name of a transport as returned by ToString, case-insensitive
+	 * @param OutTransport - the transport when the name is known
+	 * @return false if the name is not one of a transport
+	 */
+	bool FromString(std::string_view Name, EHttpTransport::Type& OutTransport);
+
+	/**
+	 * @return true if the transport was compiled in, see ONLINEPP_WITH_CURL_HTTP and ONLINEPP_WITH_UV_HTTP
+	 */
+	bool IsAvailable(EHttpTransport::Type Transport);
+}
+
+/**
+ * Create an http manager sending its requests with the given transport, to pick it at runtime
+ *
+ * @param Transport - transport of the requests of the manager
+ * @return the manager, not initialized yet, or nullptr if the transport was not compiled in
+ */
+std::unique_ptr<FHttpManager> CreateHttpManager(EHttpTransport::Type Transport);
@@ -0,0 +1,92 @@
+#pragma once
+#include <string_view>
+#include <cstdint>
+
+/**
+ * Components of a URL, viewing into the parsed string. Parsing is a single pass and does not allocate,
+ * the views are only valid as long as the parsed string is alive and unchanged.
+ * Follows the generic syntax of https://www.rfc-editor.org/rfc/rfc3986#appendix-B
+ */
+struct FUrlView
+{
+	/** Scheme without "://", empty if the URL has none */
+	std::string_view Scheme;
+	/** Host and port as written in the URL, including user info */
+	std::string_view Authority;
+	/** Host name or address, without user info, port or IPv6 brackets */
+	std::string_view Host;
+	/** Port as written in the URL, 0 if absent */
+	uint16_t Port = 0;
+	/** Path including the leading '/' */
+	std::string_view Path;
+	/** Query without the leading '?' */
+	std::string_view Query;
+	/** Fragment without the leading '#' */
+	std::string_view Fragment;
+
+	/**
+	 * Split a URL into its components
+	 *
+	 * @param URL - the URL to parse, must outlive the view
+	 * @param OutUrl - receives the components
+	 * @return false if the authority is malformed, OutUrl is then left empty
+	 */
+	static bool Parse(std::string_view URL, FUrlView& OutUrl);
+
+	/**
+	 * @return the port of the URL, or the default port of its scheme when the URL has none
+	 */
+	uint16_t GetPortOrDefault() const;
+};
+
+/**
+ * Iterates the Key=Value pairs of a query string without allocating.
+ * Values are returned as written, they are not percent-decoded.
+ *
+ *	for (FUrlQueryIterator It(Url.Query); It; ++It)
+ *	{
+ *		It.Key(); It.Value();
+ *	}
+ */
+class FUrlQueryIterator
+{
+public:
+
+	explicit FUrlQueryIterator(std::string_view InQuery);
+
+	explicit operator bool() const
+	{
+		return !Pair.empty();
+	}
+
+	FUrlQueryIterator& operator++();
+
+	std::string_view Key() const
+	{
+		return Pair.substr(0, Equals);
+	}
+
+	/** @return the value, empty if the pair has no '=' */
+	std::string_view Value() const
+	{
+		return Equals == std::string_view::npos ? std::string_view() : Pair.substr(Equals + 1);
+	}
+
+private:
+	/** Move to the next non empty pair */
+	void ReadPair();
+
+	std::string_view Remaining;
+	std::string_view Pair;
+	size_t Equals;
+};
+
+/**
+ * Find a parameter in a query string
+ *
+ * @param Query - query string without the leading '?'
+ * @param ParameterName - key to look for
+ * @param OutValue - receives the value of the first pair with that key
+ * @return true if the key is present
+ */
+bool FindUrlQueryParameter(std::string_view Query, std::string_view ParameterName, std::string_view& OutValue);
@@ -1,6 +1,50 @@
 #pragma once
+#include "HttpHeaders.h"
 #include <string>
 #include <vector>
+
+namespace EHttpVersion
+{
+	/**
+	 * Enumerates the HTTP protocol versions a request can use
+	 */
+	enum Type
+	{
+		/** Let the manager, or else the transport, pick */
+		Default,
+		/** HTTP/1.1 only, one request in flight per connection */
+		Http1_1,
+		/** HTTP/2 negotiated through TLS ALPN or an h2c upgrade, falling back to HTTP/1.1 */
+		Http2,
+		/** HTTP/2 without negotiation (h2c with prior knowledge), for plaintext services known to speak it */
+		Http2PriorKnowledge
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpVersion::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case Default:
+			{
+				return "Default";
+			}
+			case Http1_1:
+			{
+				return "HTTP/1.1";
+			}
+			case Http2:
+			{
+				return "HTTP/2";
+			}
+			case Http2PriorKnowledge:
+			{
+				return "HTTP/2 (prior knowledge)";
+			}
+		}
+		return "";
+	}
+}
 class IHttpBase
 {
 public:
@@ -29,6 +73,21 @@ public:
 	 */
 	virtual std::string GetHeader(const std::string& HeaderName) = 0;
 
+	/**
+	 * Gets the value of a header without copying it, or empty view if not found.
+	 * The view stays valid until the headers are modified.
+	 *
+	 * @param HeaderName - name of the header, compared case-insensitively.
+	 */
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) = 0;
+
+	/**
+	 * Gets the header block, iterating it reads every header without allocating.
+	 *
+	 * @return the headers
+	 */
+	virtual const FHttpHeaders& GetHeaders() = 0;
+
 	/**
 	 * Return all headers in an array in "Name: Value" format.
 	 *
@@ -1,10 +1,14 @@
 #pragma once
 
 #include "IHttpBase.h"
+#include "HttpBody.h"
+#include "HttpTimings.h"
 #include <memory>
 #include <functional>
+#include <span>
 class IHttpRequest;
 class IHttpResponse;
+class FHttpThread;
 
 namespace EHttpRequestStatus
 {
@@ -55,6 +59,54 @@ namespace EHttpRequestStatus
 	}
 }
 
+namespace EHttpRequestPriority
+{
+	/**
+	 * Enumerates the priority classes of an Http request. Queued requests of a class are started before any of a lower one.
+	 */
+	enum Type
+	{
+		/** Latency critical, e.g. a request the user is waiting on */
+		High,
+		/** Default */
+		Normal,
+		/** Can wait behind everything else */
+		Low,
+		/** Prefetches and other speculative work */
+		Background,
+		Count
+	};
+
+	/** @return the stringified version of the enum passed in */
+	inline const char* ToString(EHttpRequestPriority::Type EnumVal)
+	{
+		switch (EnumVal)
+		{
+			case High:
+			{
+				return "High";
+			}
+			case Normal:
+			{
+				return "Normal";
+			}
+			case Low:
+			{
+				return "Low";
+			}
+			case Background:
+			{
+				return "Background";
+			}
+			case Count:
+			{
+				break;
+			}
+		}
+		return "";
+	}
+}
+
 typedef std::shared_ptr<class IHttpRequest> FHttpRequestPtr;
 typedef std::shared_ptr<class IHttpResponse> FHttpResponsePtr;
 
@@ -74,6 +126,19 @@ typedef std::function<void(FHttpRequestPtr, FHttpResponsePtr)> FHttpRequestCompl
  * @param third parameter - the number of bytes received / downloaded in the response so far.
  */
 typedef std::function<void(FHttpRequestPtr, int32_t, int32_t)> FHttpRequestProgressDelegate;
+/**
+ * Delegate called as the response body arrives, the body is then not buffered in the response
+ *
+ * @param first parameter - original Http request that started things
+ * @param second parameter - the bytes received, only valid during the call. An empty span marks the end of a successful body.
+ */
+typedef std::function<void(FHttpRequestPtr, std::span<const uint8_t>)> FHttpRequestStreamDelegate;
+/**
+ * Runs a task on another thread, e.g. by posting it to a thread pool
+ *
+ * @param first parameter - the task to run
+ */
+typedef std::function<void(std::function<void()>)> FHttpExecutor;
 /**
  * Interface for Http requests (created using FHttpFactory)
  */
@@ -116,6 +181,20 @@ public:
 	 */
 	virtual void SetContent(const std::vector<uint8_t>& ContentPayload) = 0;
 
+	/**
+	 * Sets the content of the request, taking ownership of the payload instead of copying it.
+	 *
+	 * @param ContentPayload - payload to set.
+	 */
+	virtual void SetContent(std::vector<uint8_t>&& ContentPayload) = 0;
+
+	/**
+	 * Sets the content of the request to an immutable buffer that may be shared with other requests.
+	 *
+	 * @param ContentPayload - payload to set.
+	 */
+	virtual void SetContent(FHttpSharedBuffer ContentPayload) = 0;
+
 	/**
 	 * Sets the content of the request as a string encoded as UTF8.
 	 *
@@ -123,6 +202,22 @@ public:
 	 */
 	virtual void SetContentAsString(const std::string& ContentString) = 0;
 
+	/**
+	 * Sets the content of the request as a string encoded as UTF8, taking ownership of the string instead of copying it.
+	 *
+	 * @param ContentString - payload to set.
+	 */
+	virtual void SetContentAsString(std::string&& ContentString) = 0;
+
+	/**
+	 * Sets a source the content is read from while it is uploaded, the content then never sits fully in memory.
+	 * GetContent returns an empty array for such a request. A source of unknown size is sent chunked.
+	 * The source is rewound when the request is processed again.
+	 *
+	 * @param ContentSource - source of the payload, e.g. FHttpFileBodySource or FHttpCallbackBodySource
+	 */
+	virtual void SetContentSource(FHttpBodySourcePtr ContentSource) = 0;
+
 	/**
 	 * Sets optional header info.
 	 * SetHeader for a given HeaderName will overwrite any previous values
@@ -149,6 +244,63 @@ public:
 	*/
 	virtual void AppendToHeader(const std::string& HeaderName, const std::string& AdditionalHeaderValue) = 0;
 
+	/**
+	 * Sets the HTTP version the request asks for. HTTP/2 requests to the same host are multiplexed over one connection.
+	 * Should be set before calling ProcessRequest.
+	 * If not specified then the version of the manager's connection settings is used.
+	 *
+	 * @param InHttpVersion - version to use
+	 */
+	virtual void SetHttpVersion(EHttpVersion::Type InHttpVersion) = 0;
+
+	/**
+	 * @return the HTTP version the request asks for, Default if it uses the manager's
+	 */
+	virtual EHttpVersion::Type GetHttpVersion() = 0;
+
+	/**
+	 * Sets the priority class of the request. The http thread starts queued requests of a higher class first.
+	 * Should be set before calling ProcessRequest.
+	 * If not specified then Normal is assumed.
+	 *
+	 * @param InPriority - priority to use
+	 */
+	virtual void SetPriority(EHttpRequestPriority::Type InPriority) = 0;
+
+	/**
+	 * @return the priority class of the request
+	 */
+	virtual EHttpRequestPriority::Type GetPriority() = 0;
+
+	/**
+	 * Sets whether a compressed response is decompressed. Unless an Accept-Encoding header was set, the request then
+	 * asks for gzip or deflate and inflates the body on the http thread, both into the response and into the stream delegate.
+	 * A decompressed response has no Content-Encoding nor Content-Length header.
+	 * If not specified then true is assumed.
+	 *
+	 * @param bInDecompress - true to decompress the response
+	 */
+	virtual void SetResponseDecompression(bool bInDecompress) = 0;
+
+	/**
+	 * @return whether a compressed response is decompressed
+	 */
+	virtual bool GetResponseDecompression() = 0;
+
+	/**
+	 * Sets the size from which the content is sent compressed with gzip and a Content-Encoding header.
+	 * Only content set in memory without a Content-Encoding header of its own is compressed, and only when it gets smaller.
+	 * The server must accept compressed requests. If not specified then 0 is assumed, never compress.
+	 *
+	 * @param InThreshold - smallest content in bytes to compress, 0 to never compress
+	 */
+	virtual void SetContentCompressionThreshold(size_t InThreshold) = 0;
+
+	/**
+	 * @return the smallest content in bytes sent compressed, 0 if it is never compressed
+	 */
+	virtual size_t GetContentCompressionThreshold() = 0;
+
 	/**
 	 * Called to begin processing the request.
 	 * OnProcessRequestComplete delegate is always called when the request completes or on error if it is bound.
@@ -165,9 +317,39 @@ public:
 
 	/**
 	 * Delegate called to update the request/response progress. See FHttpRequestProgressDelegate
+	 * Bind it before ProcessRequest, the manager only ticks the requests that had it bound then.
 	 */
 	virtual FHttpRequestProgressDelegate& OnRequestProgress() = 0;
 
+	/**
+	 * Delegate called with the response body as it arrives. See FHttpRequestStreamDelegate
+	 * Runs on the http thread unless a stream executor is set. Must be bound before calling ProcessRequest.
+	 */
+	virtual FHttpRequestStreamDelegate& OnResponseStream() = 0;
+
+	/**
+	 * Run the stream delegate on an executor instead of the http thread.
+	 * Chunks are copied and queued, the transfer is paused while more than MaxQueuedBytes wait for the executor.
+	 * The queue is delivered by one task at a time, so chunks arrive in order and never concurrently, and the request
+	 * only completes once the end of the body was delivered. A cancelled or timed out request completes right away and
+	 * drops the chunks not delivered yet. Must be set before calling ProcessRequest.
+	 *
+	 * @param Executor - executor running the stream delegate, empty to run it on the http thread
+	 * @param MaxQueuedBytes - bytes allowed to wait for the executor before the transfer is paused
+	 */
+	virtual void SetResponseStreamExecutor(FHttpExecutor Executor, size_t MaxQueuedBytes = 4 * 1024 * 1024) = 0;
+
+	/**
+	 * Stop receiving the response body until ResumeResponseStream. The transport stops reading,
+	 * so the server is throttled instead of the body being buffered. Called on any thread.
+	 */
+	virtual void PauseResponseStream() = 0;
+
+	/**
+	 * Continue receiving a response body paused with PauseResponseStream. Called on any thread.
+	 */
+	virtual void ResumeResponseStream() = 0;
+
 	/**
 	 * Called to cancel a request that is still being processed
 	 */
@@ -194,6 +376,31 @@ public:
 	 */
 	virtual void Tick(float DeltaSeconds) = 0;
 
+	/**
+	 * Sets the maximum time the whole request may take, from the moment it is started on the http thread.
+	 * The request fails once it runs past it. 0 means no timeout.
+	 *
+	 * @param InTimeoutSecs - timeout in seconds
+	 */
+	virtual void SetTimeout(float InTimeoutSecs) = 0;
+
+	/**
+	 * @return the timeout of the whole request in seconds, 0 if none
+	 */
+	virtual float GetTimeout() = 0;
+
+	/**
+	 * Sets the maximum time establishing the connection may take. 0 means the transport default.
+	 *
+	 * @param InTimeoutSecs - timeout in seconds
+	 */
+	virtual void SetConnectTimeout(float InTimeoutSecs) = 0;
+
+	/**
+	 * @return the connect timeout in seconds, 0 if the transport default is used
+	 */
+	virtual float GetConnectTimeout() = 0;
+
 	/**
 	 * Gets the time that it took for the server to fully respond to the request.
 	 * 
@@ -201,6 +408,14 @@ public:
 	 */
 	virtual float GetElapsedTime() = 0;
 
+	/**
+	 * Gets when the request reached each phase, from queueing to the delivery of its completion.
+	 * Only Queued is set while the request is processing, the other phases are filled in once it finished.
+	 *
+	 * @return the timestamps of the last time the request was processed
+	 */
+	virtual FHttpRequestTimings GetTimings() = 0;
+
 	/** 
 	 * Destructor for overrides 
 	 */
@@ -215,9 +430,31 @@ public:
 	virtual bool StartThreadedRequest() = 0;
 	virtual bool IsThreadedRequestComplete() = 0;
 	virtual void TickThreadedRequest(float DeltaSeconds) = 0;
+	// Called on http thread before it waits for activity, true if TickThreadedRequest has work to retry without any activity of the transfer
+	virtual bool IsThreadedRequestTickable() = 0;
+	// Called on http thread when the request ran past its timeout, it is completed right after
+	virtual void TimeoutThreadedRequest() = 0;
+
+	// Called on game thread once the request completed, before it is finished
+	virtual bool HasThreadedRequestSucceeded() = 0;
+	// Called on game thread once the request completed, the URL it was sent to without a copy
+	virtual std::string_view GetThreadedRequestURL() = 0;
+
+	// Called by the http thread the request is queued on, and by a thread stealing it from that queue
+	virtual void SetThreadedRequestOwner(FHttpThread* Owner) = 0;
+	// Called on any thread, the http thread the request was last queued on or stolen by, nullptr before it reached one
+	virtual FHttpThread* GetThreadedRequestOwner() = 0;
+
+	// Called on the thread processing the request before it reaches an http thread.
+	// Adds a header to the current transfer only, it is not part of GetHeaders and is gone once the request is processed again.
+	virtual void AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue) = 0;
 
 	// Called on game thread
 	virtual void FinishRequest() = 0;
+	// Called on game thread instead of FinishRequest for a request that shared the transfer of LeaderRequest, which already finished
+	virtual void FinishCoalescedRequest(IHttpRequest& LeaderRequest) = 0;
+	// Called on game thread instead of FinishRequest for a request served from a cache, succeeds with CachedResponse unless cancelled
+	virtual void FinishCachedRequest(FHttpResponsePtr CachedResponse) = 0;
 
 protected:
 };
\ No newline at end of file
@@ -125,6 +125,13 @@ public:
 	 */
 	virtual std::string GetContentAsString() = 0;
 
+	/**
+	 * Gets the HTTP version the server answered with, Http2 for both negotiated and prior knowledge HTTP/2.
+	 *
+	 * @return the version, Default if unknown
+	 */
+	virtual EHttpVersion::Type GetHttpVersion() = 0;
+
 	/** 
 	 * Destructor for overrides 
 	 */
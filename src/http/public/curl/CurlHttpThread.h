@@ -0,0 +1,91 @@
+#pragma once
+#include "HttpThread.h"
+#include <curl/curl.h>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Http thread that runs every curl easy handle through a single multi handle
+ */
+class FCurlHttpThread : public FHttpThread
+{
+public:
+
+	FCurlHttpThread();
+	virtual ~FCurlHttpThread();
+
+	// FHttpThread
+	virtual void WakeUp() override;
+
+protected:
+	// FHttpThread
+	virtual void HttpThreadTick(float DeltaSeconds) override;
+	virtual bool StartThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void CompleteThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void WaitForActivity(double MaxWaitSeconds) override;
+	virtual bool Init() override;
+	virtual void StartPreconnect(const FHttpPreconnectTarget& Target) override;
+
+	/**
+	 * Attach an easy handle to the share handle and apply the connection settings of the thread to it
+	 *
+	 * @param HttpVersion - HTTP version asked for by the transfer, Default for the one of the connection settings
+	 */
+	void ApplyConnectionSettings(CURL* EasyHandle, EHttpVersion::Type HttpVersion);
+
+	/**
+	 * Detach an easy handle from the multi and share handles
+	 */
+	void RemoveEasyHandle(CURL* EasyHandle);
+
+	/**
+	 * A preconnect transfer finished, its connection stays in the connection cache of the multi handle
+	 */
+	void CompletePreconnect(CURL* EasyHandle, CURLcode CompletionResult, bool bNewConnection);
+
+	/**
+	 * A transfer reused a connection, count it if the connection was opened by a preconnect and carries its first request
+	 */
+	void ClaimPreconnectedConnection(CURL* EasyHandle, IHttpThreadedRequest& Request);
+
+	/**
+	 * Drop the unclaimed preconnects libcurl closed by now for being idle too long
+	 */
+	void ExpireUnclaimedPreconnects();
+
+protected:
+	/** Multi handle that drives all of the easy handles. Only accessed on the HTTP thread. */
+	CURLM* MultiHandle;
+
+	/**
+	 * Share handle holding the DNS and TLS session caches of every easy handle. The connection cache lives in the multi handle.
+	 * Only accessed on the HTTP thread, so it needs no lock callbacks.
+	 */
+	CURLSH* ShareHandle;
+
+	/** Mapping of libcurl easy handles to HTTP requests. Only accessed on the HTTP thread. */
+	std::unordered_map<CURL*, IHttpThreadedRequest*> HandlesToRequests;
+
+	/**
+	 * Easy handles warming up connections, with the scheme, host and port they connect to. libcurl never reuses
+	 * CURLOPT_CONNECT_ONLY connections, so a preconnect is a HEAD request. Only accessed on the HTTP thread.
+	 */
+	std::unordered_map<CURL*, std::string> PreconnectHandles;
+
+	/** Connection opened by a preconnect that no transfer reused yet */
+	struct FUnclaimedPreconnect
+	{
+		/** Local port of the connection */
+		long LocalPort;
+		/** GetHttpTimestamp past which libcurl closed the idle connection */
+		int64_t ExpiryTimestamp;
+	};
+
+	/**
+	 * Connections opened by preconnects that no transfer reused yet, by scheme, host and port, oldest first.
+	 * libcurl does not expose its connections, the local port tells them apart. They are forgotten once the idle
+	 * connection timeout passed, so the list stays bounded and a closed connection's port can't be claimed by a new one.
+	 * Only accessed on the HTTP thread.
+	 */
+	std::unordered_map<std::string, std::vector<FUnclaimedPreconnect>> UnclaimedPreconnects;
+};
@@ -1,34 +1,108 @@
 #pragma once
-#include <string>
-#include <regex>
-inline void ParseUrl(const std::string& inurl, std::string* outScheme = nullptr, std::string* outAuthority = nullptr, std::string* outPort = nullptr, std::string* outPath = nullptr, std::string* outQuery = nullptr, std::string* outFragment = nullptr) {
-    //https://www.rfc-editor.org/rfc/rfc3986#page-50
-    std::regex url_regex(
-        R"(^(([^:\/?#]+):\/\/)?(([^:\/?#]*)(:([0-9]+))?)?([^:?#]*)(\?([^#]*))?(#(.*))?)",
-        std::regex::extended
-    );
-    std::smatch url_match_result;
-    int counter = 0;
-    /*url.assign( R"###(localhost.com/path\?hue\=br\#cool)###");*/
-    if (!std::regex_match(inurl, url_match_result, url_regex)) {
-        return;
-    }
-    if (outScheme) {
-        *outScheme = url_match_result[2];
-    }
-    if (outAuthority) {
-        *outAuthority = url_match_result[4];
-    }
-    if (outPort) {
-        *outPort = url_match_result[6];
-    }
-    if (outPath) {
-        *outPath = url_match_result[7];
-    }
-    if (outQuery) {
-        *outQuery = url_match_result[9];
-    }
-    if (outFragment) {
-        *outFragment = url_match_result[11];
-    }
-}
\ No newline at end of file
+#include "HttpRequestBase.h"
+#include "HttpContentCoding.h"
+#include <curl/curl.h>
+
+class FCurlHttpResponse;
+
+/**
+ * Curl implementation of an Http request
+ */
+class FCurlHttpRequest : public FHttpRequestBase
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InManager - manager the request is submitted to when processed
+	 */
+	FCurlHttpRequest(FHttpManager& InManager);
+
+	/**
+	 * Destructor. Clean up any connection/request handles
+	 */
+	virtual ~FCurlHttpRequest();
+
+	// IHttpThreadedRequest
+	virtual void AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue) override;
+
+	/**
+	 * Returns libcurl's easy handle - needed for HTTP thread.
+	 *
+	 * @return libcurl's easy handle
+	 */
+	inline CURL* GetEasyHandle() const
+	{
+		return EasyHandle;
+	}
+
+	/**
+	 * Marks request as completed. Called on the HTTP thread once libcurl reports the transfer done.
+	 *
+	 * @param InCurlCompletionResult - operation result code as returned by libcurl
+	 */
+	void MarkAsCompleted(CURLcode InCurlCompletionResult);
+
+protected:
+
+	// FHttpRequestBase
+	virtual bool SetupRequest() override;
+	virtual FHttpResponsePtr GetTransferResponse() const override;
+	virtual void MarkTransferResponseReady(bool bSucceeded) override;
+	virtual bool HasTransferSucceeded() const override;
+	virtual bool IsTransferConnectionError() const override;
+	virtual std::string GetTransferError() const override;
+	virtual bool PauseTransfer(bool bPause) override;
+
+private:
+
+	/**
+	 * Static callback to be used as read function (CURLOPT_READFUNCTION), will dispatch the call to proper instance
+	 */
+	static size_t StaticUploadCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData);
+
+	/**
+	 * Static callback to be used as header function (CURLOPT_HEADERFUNCTION), will dispatch the call to proper instance
+	 */
+	static size_t StaticReceiveResponseHeaderCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData);
+
+	/**
+	 * Static callback to be used as write function (CURLOPT_WRITEFUNCTION), will dispatch the call to proper instance
+	 */
+	static size_t StaticReceiveResponseBodyCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes, void* UserData);
+
+	size_t UploadCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes);
+	size_t ReceiveResponseHeaderCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes);
+	size_t ReceiveResponseBodyCallback(void* Ptr, size_t SizeInBlocks, size_t BlockSizeInBytes);
+
+	/**
+	 * Hand a chunk of the decoded response body to the stream delegate or the response. HTTP thread only.
+	 */
+	void ReceiveResponseBody(std::span<const uint8_t> Chunk);
+
+	/** Pointer to an easy handle specific to this request */
+	CURL* EasyHandle;
+	/** List of custom headers to be passed to CURL */
+	curl_slist* HeaderList;
+	/** Operation result code as returned by libcurl */
+	CURLcode CurlCompletionResult;
+	/** Buffer for libcurl error messages */
+	char ErrorBuffer[CURL_ERROR_SIZE];
+	/** Gzip copy of the payload actually uploaded, when compression was worth it */
+	FHttpRequestBody CompressedBody;
+	/** Whether CompressedBody is uploaded instead of RequestBody */
+	bool bSendCompressedBody;
+	/** Whether the current transfer asked for a compressed response, decided in SetupRequest */
+	bool bDecodeResponse;
+	/** Whether the decoder was set up from the headers of the response. HTTP thread only. */
+	bool bResponseDecoderStarted;
+	/** Set when the response body could not be decoded. HTTP thread only. */
+	bool bResponseDecodeFailed;
+	/** Inflates the response body. HTTP thread only. */
+	FHttpContentDecoder ResponseDecoder;
+	/** Response data created when the request is processed */
+	std::shared_ptr<FCurlHttpResponse> Response;
+
+	friend class FCurlHttpResponse;
+};
@@ -1,34 +1,64 @@
 #pragma once
+#include "IHttpResponse.h"
 #include <string>
-#include <regex>
-inline void ParseUrl(const std::string& inurl, std::string* outScheme = nullptr, std::string* outAuthority = nullptr, std::string* outPort = nullptr, std::string* outPath = nullptr, std::string* outQuery = nullptr, std::string* outFragment = nullptr) {
-    //https://www.rfc-editor.org/rfc/rfc3986#page-50
-    std::regex url_regex(
-        R"(^(([^:\/?#]+):\/\/)?(([^:\/?#]*)(:([0-9]+))?)?([^:?#]*)(\?([^#]*))?(#(.*))?)",
-        std::regex::extended
-    );
-    std::smatch url_match_result;
-    int counter = 0;
-    /*url.assign( R"###(localhost.com/path\?hue\=br\#cool)###");*/
-    if (!std::regex_match(inurl, url_match_result, url_regex)) {
-        return;
-    }
-    if (outScheme) {
-        *outScheme = url_match_result[2];
-    }
-    if (outAuthority) {
-        *outAuthority = url_match_result[4];
-    }
-    if (outPort) {
-        *outPort = url_match_result[6];
-    }
-    if (outPath) {
-        *outPath = url_match_result[7];
-    }
-    if (outQuery) {
-        *outQuery = url_match_result[9];
-    }
-    if (outFragment) {
-        *outFragment = url_match_result[11];
-    }
-}
\ No newline at end of file
+#include <atomic>
+
+class FCurlHttpRequest;
+
+/**
+ * Curl implementation of an Http response
+ */
+class FCurlHttpResponse : public IHttpResponse
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InURL - url of the request that created this response
+	 */
+	FCurlHttpResponse(const std::string& InURL);
+
+	/**
+	 * Destructor
+	 */
+	virtual ~FCurlHttpResponse();
+
+	// IHttpBase
+	virtual std::string GetURL() override;
+	virtual std::string GetURLParameter(const std::string& ParameterName) override;
+	virtual std::string GetHeader(const std::string& HeaderName) override;
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) override;
+	virtual const FHttpHeaders& GetHeaders() override;
+	virtual std::vector<std::string> GetAllHeaders() override;
+	virtual std::string GetContentType() override;
+	virtual int32_t GetContentLength() override;
+	virtual const std::vector<uint8_t>& GetContent() override;
+
+	// IHttpResponse
+	virtual int32_t GetResponseCode() override;
+	virtual std::string GetContentAsString() override;
+	virtual EHttpVersion::Type GetHttpVersion() override;
+
+private:
+	/** URL of the request, the response outlives it when shared with coalesced requests */
+	std::string URL;
+	/** Byte array filled in by the curl write callback as the response is read */
+	std::vector<uint8_t> Payload;
+	/** Caches how many bytes of the response we've read so far */
+	std::atomic<int64_t> TotalBytesRead;
+	/** Cached key/value header pairs. Parsed once request completes. Only accessible on the game thread. */
+	FHttpHeaders Headers;
+	/** Cached code from completed response */
+	int32_t HttpCode;
+	/** Cached content length from completed response */
+	int32_t ContentLength;
+	/** HTTP version the server answered with */
+	EHttpVersion::Type HttpVersion;
+	/** True when the response has finished async processing */
+	std::atomic_bool bIsReady;
+	/** True if the response was successfully received/processed */
+	std::atomic_bool bSucceeded;
+
+	friend class FCurlHttpRequest;
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include "HttpManager.h"
+#include "LoopbackHttpRequest.h"
+
+/**
+ * Http manager whose requests never leave the process, they complete with the replies of a responder.
+ * Runs the submit, process, complete and finish pipeline without the cost of a transport, to profile the manager
+ * and the http threads on their own and to run deterministic load tests.
+ */
+class FLoopbackHttpManager : public FHttpManager
+{
+public:
+
+	FLoopbackHttpManager();
+
+	/**
+	 * Set the responder scripting the reply to each request, every request gets an empty 200 without one.
+	 * Must be called before Initialize.
+	 *
+	 * @param InResponder - called on the http thread starting a request, thread safe when there is more than one http thread
+	 */
+	void SetResponder(FLoopbackHttpResponder InResponder);
+
+	// FHttpManager
+	virtual FHttpRequestPtr CreateRequest() override;
+
+protected:
+	// FHttpManager
+	virtual FHttpThread* CreateHttpThread() override;
+
+	/** Copied into every http thread */
+	FLoopbackHttpResponder Responder;
+};
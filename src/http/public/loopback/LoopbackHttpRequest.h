@@ -0,0 +1,86 @@
+#pragma once
+#include "HttpRequestBase.h"
+#include "IHttpResponse.h"
+
+class FLoopbackHttpRequest;
+class FLoopbackHttpResponse;
+
+/**
+ * Scripted outcome of a loopback request
+ */
+struct FLoopbackHttpReply
+{
+	/** Succeeded to deliver a response, Failed or Failed_ConnectionError to fail without one */
+	EHttpRequestStatus::Type Result = EHttpRequestStatus::Succeeded;
+	/** Status code of the response */
+	int32_t ResponseCode = EHttpResponseCodes::Ok;
+	/** Headers of the response */
+	FHttpHeaders Headers;
+	/** Body of the response, shared rather than copied. When empty, ContentLength zero bytes are the body. */
+	FHttpSharedBuffer Content;
+	/** Size of the zero filled body when Content is empty */
+	size_t ContentLength = 0;
+	/** Seconds between the start of the request on the http thread and its completion */
+	double LatencySeconds = 0.0;
+};
+
+/**
+ * Scripts the reply to each loopback request. Called on the http thread starting the request, so it must be thread safe
+ * when the manager runs more than one.
+ */
+typedef std::function<FLoopbackHttpReply(FLoopbackHttpRequest&)> FLoopbackHttpResponder;
+
+/**
+ * Request that never touches a socket, it completes on the http thread with the reply of a responder.
+ * Measures the cost of the manager and the http threads on their own.
+ */
+class FLoopbackHttpRequest : public FHttpRequestBase
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InManager - manager the request is submitted to when processed
+	 */
+	FLoopbackHttpRequest(FHttpManager& InManager);
+
+	virtual ~FLoopbackHttpRequest();
+
+	// IHttpThreadedRequest
+	virtual void AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue) override;
+
+	/**
+	 * @return the headers added to the current transfer only, e.g. cache validators
+	 */
+	const FHttpHeaders& GetTransferHeaders() const
+	{
+		return TransferHeaders;
+	}
+
+	/**
+	 * Marks request as completed with its reply. Called on the HTTP thread once the reply is due.
+	 */
+	void MarkAsCompleted(FLoopbackHttpReply&& Reply);
+
+protected:
+
+	// FHttpRequestBase
+	virtual bool SetupRequest() override;
+	virtual FHttpResponsePtr GetTransferResponse() const override;
+	virtual void MarkTransferResponseReady(bool bSucceeded) override;
+	virtual bool HasTransferSucceeded() const override;
+	virtual bool IsTransferConnectionError() const override;
+	virtual std::string GetTransferError() const override;
+
+private:
+
+	/** Result of the reply */
+	EHttpRequestStatus::Type ReplyResult;
+	/** Headers of the current transfer only */
+	FHttpHeaders TransferHeaders;
+	/** Response data created when the request is processed */
+	std::shared_ptr<FLoopbackHttpResponse> Response;
+
+	friend class FLoopbackHttpResponse;
+};
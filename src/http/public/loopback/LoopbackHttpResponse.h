@@ -0,0 +1,56 @@
+#pragma once
+#include "IHttpResponse.h"
+#include "HttpBody.h"
+#include <string>
+#include <atomic>
+
+class FLoopbackHttpRequest;
+
+/**
+ * Loopback implementation of an Http response, holds the scripted reply
+ */
+class FLoopbackHttpResponse : public IHttpResponse
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InURL - url of the request that created this response
+	 */
+	FLoopbackHttpResponse(const std::string& InURL);
+
+	virtual ~FLoopbackHttpResponse();
+
+	// IHttpBase
+	virtual std::string GetURL() override;
+	virtual std::string GetURLParameter(const std::string& ParameterName) override;
+	virtual std::string GetHeader(const std::string& HeaderName) override;
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) override;
+	virtual const FHttpHeaders& GetHeaders() override;
+	virtual std::vector<std::string> GetAllHeaders() override;
+	virtual std::string GetContentType() override;
+	virtual int32_t GetContentLength() override;
+	virtual const std::vector<uint8_t>& GetContent() override;
+
+	// IHttpResponse
+	virtual int32_t GetResponseCode() override;
+	virtual std::string GetContentAsString() override;
+	virtual EHttpVersion::Type GetHttpVersion() override;
+
+private:
+	/** URL of the request, the response outlives it when shared with coalesced requests */
+	std::string URL;
+	/** Body of the reply, empty when it was delivered to the stream delegate */
+	FHttpSharedBuffer Payload;
+	/** Headers of the reply */
+	FHttpHeaders Headers;
+	/** Status code of the reply */
+	int32_t HttpCode;
+	/** Size of the body of the reply */
+	int32_t ContentLength;
+	/** True when the reply was applied */
+	std::atomic_bool bIsReady;
+
+	friend class FLoopbackHttpRequest;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include "HttpThread.h"
+#include "LoopbackHttpRequest.h"
+#include <map>
+#include <unordered_map>
+
+/**
+ * Http thread completing loopback requests with the replies of a responder, once their latency elapsed
+ */
+class FLoopbackHttpThread : public FHttpThread
+{
+public:
+
+	/**
+	 * @param InResponder - scripts the reply to each request, empty to answer every request with an empty 200
+	 */
+	FLoopbackHttpThread(FLoopbackHttpResponder InResponder);
+	virtual ~FLoopbackHttpThread();
+
+protected:
+	// FHttpThread
+	virtual void HttpThreadTick(float DeltaSeconds) override;
+	virtual bool StartThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void CompleteThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void WaitForActivity(double MaxWaitSeconds) override;
+
+protected:
+	struct FDelayedReply
+	{
+		FLoopbackHttpRequest* Request;
+		FLoopbackHttpReply Reply;
+	};
+
+	/** Scripts the reply to each request */
+	FLoopbackHttpResponder Responder;
+
+	/** Replies waiting for their latency to elapse, by due GetHttpTimestamp. Only accessed on the HTTP thread. */
+	std::multimap<int64_t, FDelayedReply> DelayedReplies;
+
+	/** Position of the delayed reply of each request, to drop it when the request is cancelled. Only accessed on the HTTP thread. */
+	std::unordered_map<IHttpThreadedRequest*, std::multimap<int64_t, FDelayedReply>::iterator> RequestsToReplies;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "HttpManager.h"
+
+/**
+ * Http manager that drives requests through the native HTTP/1.1 client of FUvHttpThread, one libuv loop per http thread.
+ * Plain http only, https urls fail to process.
+ */
+class FUvHttpManager : public FHttpManager
+{
+public:
+
+	FUvHttpManager();
+
+	// FHttpManager
+	virtual FHttpRequestPtr CreateRequest() override;
+
+protected:
+	// FHttpManager
+	virtual FHttpThread* CreateHttpThread() override;
+};
@@ -0,0 +1,178 @@
+#pragma once
+#include "HttpThread.h"
+#include "HttpResponseParser.h"
+#include <uv.h>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class FUvHttpRequest;
+struct FUvHttpHostPool;
+
+/**
+ * One HTTP/1.1 connection of FUvHttpThread, carrying at most one request at a time. HTTP thread only.
+ */
+struct FUvHttpConnection
+{
+	/** Socket, its data points back to the connection */
+	uv_tcp_t Handle;
+	uv_connect_t ConnectRequest;
+	uv_write_t WriteRequest;
+	/** Pool of the host the connection is open to */
+	FUvHttpHostPool* Pool = nullptr;
+	/** Request being sent or received, nullptr while idle */
+	FUvHttpRequest* Request = nullptr;
+	/** Reads the response of the current request */
+	FHttpResponseParser Parser;
+	/** Receives the socket reads, reused for the lifetime of the connection */
+	std::unique_ptr<uint8_t[]> ReadBuffer;
+	/** Next bytes of a streamed payload, and the chunk size line framing them when it is sent chunked */
+	std::vector<uint8_t> UploadBuffer;
+	char ChunkHeader[24];
+	/** Payload bytes in the write in flight, counted as sent once it completes */
+	size_t PendingUploadBytes = 0;
+	/** Index in the addresses of the pool of the address connected to */
+	size_t AddressIndex = 0;
+	/** Requests completed over the connection, a reused connection has served at least one */
+	uint32_t CompletedRequestCount = 0;
+	/** uv_now when the connection went idle */
+	uint64_t IdleSince = 0;
+	/** Connection timeout timer, valid while bHasConnectTimer */
+	FHttpTimerWheel::FTimerHandle ConnectTimer;
+	bool bHasConnectTimer = false;
+	bool bConnected = false;
+	bool bReading = false;
+	/** Whether the payload is still being written */
+	bool bUploading = false;
+	bool bClosing = false;
+	/** Opened by a preconnect rather than for a request */
+	bool bPreconnected = false;
+};
+
+/**
+ * Connections and resolved addresses of one host and port
+ */
+struct FUvHttpHostPool
+{
+	std::string Host;
+	uint16_t Port = 0;
+	/** Connections open or being opened to the host */
+	uint32_t OpenConnectionCount = 0;
+	/** Kept alive connections waiting for a request, the most recently used last */
+	std::vector<FUvHttpConnection*> IdleConnections;
+	/** Requests waiting for a connection to free up, past the connection limits */
+	std::deque<FUvHttpRequest*> WaitingRequests;
+	/** Resolved addresses of the host, tried in order */
+	std::vector<sockaddr_storage> Addresses;
+	/** uv_now past which the addresses are resolved again */
+	uint64_t AddressesExpireTime = 0;
+	/** Address resolution in flight, nullptr if none */
+	uv_getaddrinfo_t* Resolver = nullptr;
+	/** Connections waiting for the address resolution to connect */
+	std::vector<FUvHttpConnection*> ResolvingConnections;
+};
+
+/**
+ * Http thread running a native HTTP/1.1 client on its own libuv loop, an alternative to libcurl for plain http.
+ * Requests are serialized once and written with a single writev, responses are parsed in place as they are read
+ * and connections are kept alive in per host pools.
+ */
+class FUvHttpThread : public FHttpThread
+{
+public:
+
+	FUvHttpThread();
+	virtual ~FUvHttpThread();
+
+	// FHttpThread
+	virtual void WakeUp() override;
+
+	/**
+	 * Stop or restart reading from a connection, to hold back a response its reader can't keep up with. HTTP thread only.
+	 */
+	static void SetReceivePaused(FUvHttpConnection& Connection, bool bPaused);
+
+protected:
+	// FHttpThread
+	virtual void HttpThreadTick(float DeltaSeconds) override;
+	virtual bool StartThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void CompleteThreadedRequest(IHttpThreadedRequest* Request) override;
+	virtual void WaitForActivity(double MaxWaitSeconds) override;
+	virtual double GetMaxActivityWaitSeconds() const override;
+	virtual void StartPreconnect(const FHttpPreconnectTarget& Target) override;
+
+private:
+
+	/** Send a request over an idle connection of its host, a new one, or queue it until a connection frees up */
+	void AssignConnection(FUvHttpHostPool& Pool, FUvHttpRequest* Request);
+
+	/** @return true if the connection limits allow another connection to the host, closing an idle one of another host if needed */
+	bool CanOpenConnection(FUvHttpHostPool& Pool);
+
+	/** @return the pool of a host and port, created on first use */
+	FUvHttpHostPool& GetHostPool(const std::string& ConnectionKey, const std::string& Host, uint16_t Port);
+
+	/** Open a connection carrying Request once connected, or kept idle when it is preconnected, resolving the host first if needed */
+	void OpenConnection(FUvHttpHostPool& Pool, FUvHttpRequest* Request, size_t AddressIndex, bool bPreconnect);
+
+	/** Resolve the host of a pool, numeric addresses are used as is */
+	void ResolveHost(FUvHttpHostPool& Pool);
+
+	/** Connect to the address of the pool the connection is meant for */
+	void Connect(FUvHttpConnection& Connection);
+
+	/** Write the request line, the headers and an in memory payload at once */
+	void SendRequest(FUvHttpConnection& Connection, FUvHttpRequest* Request);
+
+	/** Write the next part of a payload read from a source */
+	void SendNextBodyChunk(FUvHttpConnection& Connection);
+
+	/** The response was read, complete the request and keep the connection alive if possible */
+	void CompleteTransfer(FUvHttpConnection& Connection, bool bKeepAlive);
+
+	/** The transfer failed once connected, retry it on a new connection if a kept alive one was closed under it */
+	void FailTransfer(FUvHttpConnection& Connection, int32_t Result);
+
+	/** The connection could not be established, fail the request it was opened for */
+	void FailConnection(FUvHttpConnection& Connection, int32_t Result);
+
+	/** Hand an idle connection to a waiting request or keep it in the pool */
+	void ReleaseConnection(FUvHttpConnection& Connection);
+
+	/** Close a connection and open connections for the requests waiting on the limits */
+	void CloseConnection(FUvHttpConnection& Connection);
+
+	/** Close the idle connections kept past the idle timeout */
+	void CloseExpiredConnections();
+
+	static void OnResolved(uv_getaddrinfo_t* Resolver, int Status, addrinfo* Result);
+	static void OnConnect(uv_connect_t* ConnectRequest, int Status);
+	static void OnAlloc(uv_handle_t* Handle, size_t SuggestedSize, uv_buf_t* Buffer);
+	static void OnRead(uv_stream_t* Stream, ssize_t ReadSize, const uv_buf_t* Buffer);
+	static void OnWrite(uv_write_t* WriteRequest, int Status);
+	static void OnClose(uv_handle_t* Handle);
+
+	/** @return the thread running a connection */
+	static FUvHttpThread& GetThread(FUvHttpConnection& Connection)
+	{
+		return *static_cast<FUvHttpThread*>(Connection.Handle.loop->data);
+	}
+
+	/** Loop of the http thread, only run on the HTTP thread */
+	uv_loop_t Loop;
+	/** Wakes the loop up from any thread */
+	uv_async_t WakeUpSignal;
+	/** Bounds WaitForActivity */
+	uv_timer_t WaitTimer;
+	/** Connection pools by host and port. Only accessed on the HTTP thread. */
+	std::unordered_map<std::string, std::unique_ptr<FUvHttpHostPool>> HostPools;
+	/** Connections open or being opened to any host, and the idle ones among them */
+	uint32_t OpenConnectionCount;
+	uint32_t IdleConnectionCount;
+	/** uv_now of the next look for expired idle connections */
+	uint64_t NextIdleCheckTime;
+	/** Set once the destructor closes everything, the callbacks still called then only release memory */
+	bool bShuttingDown;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include "HttpRequestBase.h"
+#include "HttpContentCoding.h"
+#include "HttpResponseParser.h"
+
+class FUvHttpResponse;
+class FUvHttpThread;
+struct FUvHttpConnection;
+
+/**
+ * Request sent by the native HTTP/1.1 client of FUvHttpThread, plain http only
+ */
+class FUvHttpRequest : public FHttpRequestBase, public IHttpResponseParserListener
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InManager - manager the request is submitted to when processed
+	 */
+	FUvHttpRequest(FHttpManager& InManager);
+
+	virtual ~FUvHttpRequest();
+
+	// IHttpThreadedRequest
+	virtual void AddTransferHeader(std::string_view HeaderName, std::string_view HeaderValue) override;
+
+	// IHttpResponseParserListener
+	virtual bool OnResponseHead(int32_t StatusCode, FHttpHeaders& ResponseHeaders) override;
+	virtual bool OnResponseBody(std::span<const uint8_t> Data) override;
+
+	/**
+	 * Marks request as completed, set by the http thread once the response was read or the transfer failed
+	 *
+	 * @param InUvCompletionResult - 0 on success, a libuv error code otherwise
+	 * @param bInConnectionError - whether the request failed before a connection to the server was established
+	 */
+	void MarkAsCompleted(int32_t InUvCompletionResult, bool bInConnectionError);
+
+protected:
+
+	// FHttpRequestBase
+	virtual bool SetupRequest() override;
+	virtual FHttpResponsePtr GetTransferResponse() const override;
+	virtual void MarkTransferResponseReady(bool bSucceeded) override;
+	virtual bool HasTransferSucceeded() const override;
+	virtual bool IsTransferConnectionError() const override;
+	virtual std::string GetTransferError() const override;
+	virtual bool PauseTransfer(bool bPause) override;
+
+private:
+
+	/**
+	 * Hand a chunk of the decoded response body to the stream delegate or the response. HTTP thread only.
+	 */
+	void ReceiveResponseBody(std::span<const uint8_t> Chunk);
+
+	/** @return the body actually uploaded */
+	FHttpRequestBody& GetUploadBody()
+	{
+		return bSendCompressedBody ? CompressedBody : RequestBody;
+	}
+
+	/** Result of the transfer, 0 or a libuv error code */
+	int32_t UvCompletionResult;
+	/** Whether the transfer failed before it was connected */
+	bool bConnectionError;
+	/** Gzip copy of the payload actually uploaded, when compression was worth it */
+	FHttpRequestBody CompressedBody;
+	/** Whether CompressedBody is uploaded instead of RequestBody */
+	bool bSendCompressedBody;
+	/** Whether the current transfer asked for a compressed response, decided in SetupRequest */
+	bool bDecodeResponse;
+	/** Set when the response body could not be decoded. HTTP thread only. */
+	bool bResponseDecodeFailed;
+	/** Inflates the response body. HTTP thread only. */
+	FHttpContentDecoder ResponseDecoder;
+	/** Host and port the request connects to, and the key of their connection pool */
+	std::string Host;
+	uint16_t Port;
+	std::string ConnectionKey;
+	/** Request line and headers, without the empty line ending them */
+	std::string RequestHead;
+	/** Headers added to the current transfer only, in the same format */
+	std::string TransferHeaderLines;
+	/** Whether the verb sends the payload */
+	bool bSendBody;
+	/** Whether the payload is of unknown size and sent chunked */
+	bool bChunkedUpload;
+	/** Whether the response has no body whatever its headers say */
+	bool bHeadRequest;
+	/** Whether the caller asked for the connection to be closed after the response */
+	bool bCloseConnection;
+	/** Whether the transfer was already retried on a new connection after a kept alive one failed. HTTP thread only. */
+	bool bRetried;
+	/** Connection carrying the transfer. HTTP thread only. */
+	FUvHttpConnection* Connection;
+	/** Response data created when the request is processed */
+	std::shared_ptr<FUvHttpResponse> Response;
+
+	friend class FUvHttpResponse;
+	friend class FUvHttpThread;
+};
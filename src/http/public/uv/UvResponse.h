@@ -0,0 +1,64 @@
+#pragma once
+#include "IHttpResponse.h"
+#include <string>
+#include <atomic>
+
+class FUvHttpRequest;
+
+/**
+ * Response read by the native HTTP/1.1 client of FUvHttpThread
+ */
+class FUvHttpResponse : public IHttpResponse
+{
+public:
+
+	/**
+	 * Constructor
+	 *
+	 * @param InURL - url of the request that created this response
+	 */
+	FUvHttpResponse(const std::string& InURL);
+
+	/**
+	 * Destructor
+	 */
+	virtual ~FUvHttpResponse();
+
+	// IHttpBase
+	virtual std::string GetURL() override;
+	virtual std::string GetURLParameter(const std::string& ParameterName) override;
+	virtual std::string GetHeader(const std::string& HeaderName) override;
+	virtual std::string_view GetHeaderView(std::string_view HeaderName) override;
+	virtual const FHttpHeaders& GetHeaders() override;
+	virtual std::vector<std::string> GetAllHeaders() override;
+	virtual std::string GetContentType() override;
+	virtual int32_t GetContentLength() override;
+	virtual const std::vector<uint8_t>& GetContent() override;
+
+	// IHttpResponse
+	virtual int32_t GetResponseCode() override;
+	virtual std::string GetContentAsString() override;
+	virtual EHttpVersion::Type GetHttpVersion() override;
+
+private:
+	/** URL of the request, the response outlives it when shared with coalesced requests */
+	std::string URL;
+	/** Byte array filled in as the response body is read */
+	std::vector<uint8_t> Payload;
+	/** Caches how many bytes of the response we've read so far */
+	std::atomic<int64_t> TotalBytesRead;
+	/** Cached key/value header pairs. Parsed once request completes. Only accessible on the game thread. */
+	FHttpHeaders Headers;
+	/** Cached code from completed response */
+	int32_t HttpCode;
+	/** Cached content length from completed response */
+	int32_t ContentLength;
+	/** HTTP version the server answered with */
+	EHttpVersion::Type HttpVersion;
+	/** True when the response has finished async processing */
+	std::atomic_bool bIsReady;
+	/** True if the response was successfully received/processed */
+	std::atomic_bool bSucceeded;
+
+	friend class FUvHttpRequest;
+};
@@ -0,0 +1,840 @@
+#include "HttpAwaitable.h"
+#include "HttpContentCoding.h"
+#include "HttpLoopbackServer.h"
+#include "HttpQueues.h"
+#include "HttpRequestRegistry.h"
+#include "HttpTransport.h"
+#include "HttpUrl.h"
+#include "LoopbackHttpManager.h"
+#include "HttpTimings.h"
+#include "HttpTrace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <regex>
+#include <semaphore>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+/**
+ * Throughput and latency scenarios run through FCurlHttpManager or FUvHttpManager against FHttpLoopbackServer, or through
+ * FLoopbackHttpManager to measure the manager and the http threads without a transport. Micro benchmarks of single
+ * components run first, whatever the transport. Every scenario prints one JSON object per line on stdout, progress
+ * and errors go to stderr.
+ *
+ * Usage: online_http_benchmark [--transport curl|uv|loopback] [--filter <substring>] [--scale <factor>] [--threads <count>]
+ *     [--max-connections <count>] [--trace <file>]
+ */
+
+namespace
+{
+	struct FBenchmarkScenario
+	{
+		std::string Name;
+		uint32_t Concurrency = 1;
+		/** Threads issuing the requests, sharing the Concurrency budget */
+		uint32_t ProducerCount = 1;
+		uint32_t RequestCount = 0;
+		size_t RequestBodySize = 0;
+		size_t ResponseBodySize = 0;
+		bool bKeepAlive = true;
+		/** Wait for each request with co_await Manager.Send instead of its completion delegate */
+		bool bAwait = false;
+	};
+
+	struct FBenchmarkOptions
+	{
+		EHttpTransport::Type Transport = EHttpTransport::Curl;
+		std::string Filter;
+		double Scale = 1.0;
+		uint32_t HttpThreadCount = 0;
+		uint32_t MaxConnectionsPerHost = 256;
+		/** Chrome trace of the whole run written there, see FHttpTrace */
+		std::string TracePath;
+	};
+
+	/**
+	 * Measures a component of the http module on its own, without a manager
+	 */
+	struct FMicroBenchmark
+	{
+		const char* Name;
+		/** Prints one JSON line per measured operation, returns false if the component misbehaved */
+		bool (*Run)(double Scale);
+	};
+
+	struct FBenchmarkResult
+	{
+		double Seconds = 0.0;
+		double CpuSeconds = 0.0;
+		uint64_t Succeeded = 0;
+		uint64_t Failed = 0;
+		FHttpLatencySnapshot Latency;
+	};
+
+	/** @return CPU time of the whole process, the loopback server included */
+	double GetProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME Creation, Exit, Kernel, User;
+		if (!GetProcessTimes(GetCurrentProcess(), &Creation, &Exit, &Kernel, &User))
+		{
+			return 0.0;
+		}
+		auto ToSeconds = [](const FILETIME& Time)
+		{
+			return double((uint64_t(Time.dwHighDateTime) << 32) | Time.dwLowDateTime) * 1e-7;
+		};
+		return ToSeconds(Kernel) + ToSeconds(User);
+#else
+		rusage Usage;
+		if (getrusage(RUSAGE_SELF, &Usage) != 0)
+		{
+			return 0.0;
+		}
+		return double(Usage.ru_utime.tv_sec + Usage.ru_stime.tv_sec) + double(Usage.ru_utime.tv_usec + Usage.ru_stime.tv_usec) * 1e-6;
+#endif
+	}
+
+	std::vector<FBenchmarkScenario> MakeScenarios(double Scale)
+	{
+		auto Scaled = [Scale](uint32_t Count)
+		{
+			return std::max<uint32_t>(uint32_t(double(Count) * Scale), 1);
+		};
+		std::vector<FBenchmarkScenario> Scenarios;
+		for (bool bKeepAlive : { true, false })
+		{
+			const char* ConnectionName = bKeepAlive ? "keepalive" : "close";
+			for (uint32_t Concurrency : { 1u, 16u, 256u, 1024u, 10000u })
+			{
+				FBenchmarkScenario& Scenario = Scenarios.emplace_back();
+				Scenario.Name = "get_64B_c" + std::to_string(Concurrency) + "_" + ConnectionName;
+				Scenario.Concurrency = Concurrency;
+				Scenario.RequestCount = Scaled(std::max<uint32_t>(5000, Concurrency * 4));
+				Scenario.ResponseBodySize = 64;
+				Scenario.bKeepAlive = bKeepAlive;
+			}
+			// 1 MiB bodies, the concurrency is capped to keep the memory of the responses reasonable
+			for (uint32_t Concurrency : { 1u, 16u, 64u })
+			{
+				FBenchmarkScenario Download;
+				Download.Name = "get_1MiB_c" + std::to_string(Concurrency) + "_" + ConnectionName;
+				Download.Concurrency = Concurrency;
+				Download.RequestCount = Scaled(std::max<uint32_t>(200, Concurrency * 4));
+				Download.ResponseBodySize = 1024 * 1024;
+				Download.bKeepAlive = bKeepAlive;
+
+				FBenchmarkScenario Upload = Download;
+				Upload.Name = "post_1MiB_c" + std::to_string(Concurrency) + "_" + ConnectionName;
+				Upload.RequestBodySize = 1024 * 1024;
+				Upload.ResponseBodySize = 64;
+
+				Scenarios.push_back(std::move(Download));
+				Scenarios.push_back(std::move(Upload));
+			}
+		}
+		// the same load submitted from more and more threads, measures the submission queues of the http threads
+		for (uint32_t ProducerCount : { 1u, 2u, 4u, 8u, 16u, 32u })
+		{
+			FBenchmarkScenario& Scenario = Scenarios.emplace_back();
+			Scenario.Name = "get_64B_c1024_p" + std::to_string(ProducerCount);
+			Scenario.Concurrency = 1024;
+			Scenario.ProducerCount = ProducerCount;
+			Scenario.RequestCount = Scaled(50000);
+			Scenario.ResponseBodySize = 64;
+		}
+		// per request overhead of the two completion paths, best seen with --transport loopback
+		for (uint32_t Concurrency : { 1u, 256u })
+		{
+			for (bool bAwait : { false, true })
+			{
+				FBenchmarkScenario& Scenario = Scenarios.emplace_back();
+				Scenario.Name = "completion_64B_c" + std::to_string(Concurrency) + (bAwait ? "_await" : "_delegate");
+				Scenario.Concurrency = Concurrency;
+				Scenario.RequestCount = Scaled(50000);
+				Scenario.ResponseBodySize = 64;
+				Scenario.bAwait = bAwait;
+			}
+		}
+		return Scenarios;
+	}
+
+	/**
+	 * Coroutine that runs as soon as it is called and frees itself once it returns
+	 */
+	struct FDetachedCoroutine
+	{
+		struct promise_type
+		{
+			FDetachedCoroutine get_return_object() noexcept
+			{
+				return {};
+			}
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {};
+			}
+			std::suspend_never final_suspend() noexcept
+			{
+				return {};
+			}
+			void return_void() noexcept
+			{
+			}
+			void unhandled_exception() noexcept
+			{
+				std::terminate();
+			}
+		};
+	};
+
+	/**
+	 * Process a request with co_await and hand its response to OnComplete, which must outlive the request
+	 */
+	template <typename FunctionType>
+	FDetachedCoroutine AwaitRequest(FHttpManager& Manager, FHttpRequestPtr Request, const FunctionType& OnComplete)
+	{
+		FHttpResponsePtr Response = co_await Manager.Send(Request);
+		OnComplete(std::move(Request), std::move(Response));
+	}
+
+	/**
+	 * Keep Concurrency requests in flight from ProducerCount threads until RequestCount completed.
+	 * The bookkeeping is lock-free so the producers only contend in the manager.
+	 */
+	FBenchmarkResult RunScenario(FHttpManager& Manager, const std::string& BaseUrl, const FBenchmarkScenario& Scenario)
+	{
+		const std::string Url = BaseUrl + "/bytes/" + std::to_string(Scenario.ResponseBodySize);
+		const FHttpSharedBuffer RequestBody = Scenario.RequestBodySize ? std::make_shared<const std::vector<uint8_t>>(Scenario.RequestBodySize, uint8_t('x')) : nullptr;
+
+		FHttpLatencyHistogram Latency;
+		std::counting_semaphore<> InFlightSlots(Scenario.Concurrency);
+		std::latch CompletedLatch(Scenario.RequestCount);
+		std::atomic<uint32_t> Issued{0};
+		std::atomic<uint64_t> Succeeded{0};
+		std::atomic<uint64_t> Failed{0};
+
+		auto OnComplete = [&](FHttpRequestPtr Request, FHttpResponsePtr Response)
+		{
+			const FHttpRequestTimings Timings = Request->GetTimings();
+			const bool bSucceeded = Response && Response->GetResponseCode() == 200 && size_t(Response->GetContentLength()) == Scenario.ResponseBodySize;
+			Latency.Record(Timings.Completed - Timings.Queued);
+			(bSucceeded ? Succeeded : Failed).fetch_add(1, std::memory_order_relaxed);
+			InFlightSlots.release();
+			CompletedLatch.count_down();
+		};
+
+		auto Produce = [&]()
+		{
+			while (Issued.fetch_add(1, std::memory_order_relaxed) < Scenario.RequestCount)
+			{
+				InFlightSlots.acquire();
+				FHttpRequestPtr Request = Manager.CreateRequest();
+				Request->SetURL(Url);
+				if (RequestBody)
+				{
+					Request->SetVerb("POST");
+					Request->SetContent(RequestBody);
+				}
+				if (!Scenario.bKeepAlive)
+				{
+					Request->SetHeader("Connection", "close");
+				}
+				if (Scenario.bAwait)
+				{
+					AwaitRequest(Manager, std::move(Request), OnComplete);
+					continue;
+				}
+				Request->OnProcessRequestComplete() = OnComplete;
+				if (!Request->ProcessRequest())
+				{
+					Failed.fetch_add(1, std::memory_order_relaxed);
+					InFlightSlots.release();
+					CompletedLatch.count_down();
+				}
+			}
+		};
+
+		FBenchmarkResult Result;
+		const double CpuBegin = GetProcessCpuSeconds();
+		const std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+		std::vector<std::thread> Producers;
+		for (uint32_t ProducerIndex = 1; ProducerIndex < Scenario.ProducerCount; ++ProducerIndex)
+		{
+			Producers.emplace_back(Produce);
+		}
+		Produce();
+		for (std::thread& Producer : Producers)
+		{
+			Producer.join();
+		}
+		CompletedLatch.wait();
+		Result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+		Result.CpuSeconds = GetProcessCpuSeconds() - CpuBegin;
+		Result.Succeeded = Succeeded.load();
+		Result.Failed = Failed.load();
+		Result.Latency = Latency.Snapshot();
+		return Result;
+	}
+
+	void PrintResult(EHttpTransport::Type Transport, const FBenchmarkScenario& Scenario, const FBenchmarkResult& Result)
+	{
+		const double Completed = double(std::max<uint64_t>(Result.Succeeded + Result.Failed, 1));
+		std::printf("{\"transport\":\"%s\",\"scenario\":\"%s\",\"concurrency\":%u,\"producers\":%u,\"requests\":%u,\"keep_alive\":%s,\"completion\":\"%s\",\"request_bytes\":%zu,\"response_bytes\":%zu,"
+			"\"seconds\":%.6f,\"requests_per_second\":%.1f,\"succeeded\":%llu,\"failed\":%llu,"
+			"\"latency_us\":{\"mean\":%.1f,\"p50\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu},\"cpu_us_per_request\":%.2f}\n",
+			EHttpTransport::ToString(Transport), Scenario.Name.c_str(), Scenario.Concurrency, Scenario.ProducerCount, Scenario.RequestCount, Scenario.bKeepAlive ? "true" : "false", Scenario.bAwait ? "await" : "delegate", Scenario.RequestBodySize, Scenario.ResponseBodySize,
+			Result.Seconds, Result.Seconds > 0.0 ? Completed / Result.Seconds : 0.0, (unsigned long long)Result.Succeeded, (unsigned long long)Result.Failed,
+			Result.Latency.GetMean(), (unsigned long long)Result.Latency.GetPercentile(50.0), (unsigned long long)Result.Latency.GetPercentile(99.0),
+			(unsigned long long)Result.Latency.GetPercentile(99.9), (unsigned long long)Result.Latency.MaxMicroseconds, Result.CpuSeconds * 1e6 / Completed);
+		std::fflush(stdout);
+	}
+
+	/**
+	 * @return seconds taken by a call to Function
+	 */
+	template <typename FunctionType>
+	double MeasureSeconds(FunctionType&& Function)
+	{
+		const std::chrono::steady_clock::time_point Begin = std::chrono::steady_clock::now();
+		Function();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - Begin).count();
+	}
+
+	/**
+	 * @param Bytes - bytes processed by all of the operations, 0 when throughput doesn't apply
+	 * @param Library - implementation measured when it depends on the build, nullptr otherwise
+	 */
+	void PrintMicroResult(const std::string& Scenario, uint64_t Operations, double Seconds, uint64_t Bytes = 0, const char* Library = nullptr)
+	{
+		std::printf("{\"scenario\":\"%s\",\"operations\":%llu,\"seconds\":%.6f,\"ns_per_operation\":%.1f",
+			Scenario.c_str(), (unsigned long long)Operations, Seconds, Operations ? Seconds * 1e9 / double(Operations) : 0.0);
+		if (Bytes)
+		{
+			std::printf(",\"megabytes_per_second\":%.1f", Seconds > 0.0 ? double(Bytes) / (1024.0 * 1024.0) / Seconds : 0.0);
+		}
+		if (Library)
+		{
+			std::printf(",\"library\":\"%s\"", Library);
+		}
+		std::printf("}\n");
+		std::fflush(stdout);
+	}
+
+	/**
+	 * The mutex guarded array FHttpThread queued its pending requests in before TMpscRingQueue, for comparison
+	 */
+	template <typename T>
+	class TLockedQueue
+	{
+	public:
+		void Enqueue(const T& Item)
+		{
+			std::scoped_lock Lock(ItemsLock);
+			Items.push_back(Item);
+		}
+
+		size_t DequeueBatch(std::vector<T>& OutItems)
+		{
+			std::scoped_lock Lock(ItemsLock);
+			OutItems.insert(OutItems.end(), Items.begin(), Items.end());
+			const size_t Count = Items.size();
+			Items.clear();
+			return Count;
+		}
+
+	private:
+		std::mutex ItemsLock;
+		std::vector<T> Items;
+	};
+
+	/**
+	 * ProducerCount threads enqueue ItemsPerProducer items each while the calling thread drains them in batches, the way
+	 * the http thread drains its submissions.
+	 *
+	 * @param bSucceeded - set to false if an item got lost or duplicated
+	 * @return seconds until the last item was dequeued
+	 */
+	template <typename QueueType>
+	double MeasureSubmission(QueueType& Queue, uint32_t ProducerCount, uint32_t ItemsPerProducer, bool& bSucceeded)
+	{
+		const uint64_t ItemCount = uint64_t(ProducerCount) * ItemsPerProducer;
+		std::latch StartLatch(ProducerCount + 1);
+		std::atomic<uint32_t> RunningProducers{ProducerCount};
+		std::vector<std::thread> Producers;
+		for (uint32_t ProducerIndex = 0; ProducerIndex < ProducerCount; ++ProducerIndex)
+		{
+			Producers.emplace_back([&, ProducerIndex]()
+			{
+				StartLatch.arrive_and_wait();
+				const uint64_t First = uint64_t(ProducerIndex) * ItemsPerProducer + 1;
+				for (uint64_t Item = First; Item < First + ItemsPerProducer; ++Item)
+				{
+					Queue.Enqueue(Item);
+				}
+				RunningProducers.fetch_sub(1, std::memory_order_release);
+			});
+		}
+
+		uint64_t Consumed = 0;
+		uint64_t Checksum = 0;
+		const double Seconds = MeasureSeconds([&]()
+		{
+			StartLatch.arrive_and_wait();
+			std::vector<uint64_t> Batch;
+			for (;;)
+			{
+				// once every producer is done, an empty queue means every item was seen
+				const bool bProducersDone = RunningProducers.load(std::memory_order_acquire) == 0;
+				Batch.clear();
+				Queue.DequeueBatch(Batch);
+				for (uint64_t Item : Batch)
+				{
+					Checksum += Item;
+				}
+				Consumed += Batch.size();
+				if (Batch.empty())
+				{
+					if (bProducersDone)
+					{
+						break;
+					}
+					std::this_thread::yield();
+				}
+			}
+		});
+		for (std::thread& Producer : Producers)
+		{
+			Producer.join();
+		}
+		bSucceeded &= Consumed == ItemCount && Checksum == ItemCount * (ItemCount + 1) / 2;
+		return Seconds;
+	}
+
+	/**
+	 * Submission from 1 to 32 producer threads to a single consumer, through the TMpscRingQueue of FHttpThread and through
+	 * the locked array it replaced
+	 */
+	bool RunSubmitQueueBenchmark(double Scale)
+	{
+		const uint32_t ItemCount = std::max<uint32_t>(uint32_t(1000000 * Scale), 1);
+		bool bSucceeded = true;
+		for (uint32_t ProducerCount : { 1u, 2u, 4u, 8u, 16u, 32u })
+		{
+			const uint32_t ItemsPerProducer = std::max<uint32_t>(ItemCount / ProducerCount, 1);
+			const uint64_t Operations = uint64_t(ItemsPerProducer) * ProducerCount;
+			{
+				TMpscRingQueue<uint64_t> Queue;
+				PrintMicroResult("submit_queue_mpsc_p" + std::to_string(ProducerCount), Operations, MeasureSubmission(Queue, ProducerCount, ItemsPerProducer, bSucceeded));
+			}
+			{
+				TLockedQueue<uint64_t> Queue;
+				PrintMicroResult("submit_queue_locked_p" + std::to_string(ProducerCount), Operations, MeasureSubmission(Queue, ProducerCount, ItemsPerProducer, bSucceeded));
+			}
+		}
+		return bSucceeded;
+	}
+
+	/**
+	 * FHttpRequestRegistry with 100k outstanding requests, 1 in 64 of them tickable like requests reporting progress
+	 */
+	bool RunRegistryBenchmark(double Scale)
+	{
+		constexpr uint32_t OutstandingCount = 100000;
+		const uint32_t ChurnCount = std::max<uint32_t>(uint32_t(1000000 * Scale), 1);
+
+		FLoopbackHttpManager Manager;
+		std::vector<FHttpRequestPtr> Requests(OutstandingCount);
+		for (FHttpRequestPtr& Request : Requests)
+		{
+			Request = Manager.CreateRequest();
+		}
+
+		FHttpRequestRegistry Registry;
+		bool bSucceeded = true;
+		PrintMicroResult("registry_100k_add", OutstandingCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Index = 0; Index < OutstandingCount; ++Index)
+			{
+				bSucceeded &= Registry.Add(Requests[Index], Index % 64 == 0);
+			}
+		}));
+
+		PrintMicroResult("registry_100k_contains", OutstandingCount, MeasureSeconds([&]()
+		{
+			for (const FHttpRequestPtr& Request : Requests)
+			{
+				bSucceeded &= Registry.Contains(Request.get());
+			}
+		}));
+
+		// what FHttpManager::Tick does with the requests in flight
+		const uint32_t TickCount = std::max<uint32_t>(uint32_t(1000 * Scale), 1);
+		std::vector<FHttpRequestPtr> Tickable;
+		PrintMicroResult("registry_100k_tick", TickCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Tick = 0; Tick < TickCount; ++Tick)
+			{
+				Tickable.clear();
+				Registry.GetTickable(Tickable);
+			}
+		}));
+		bSucceeded &= Tickable.size() == (OutstandingCount + 63) / 64;
+
+		// requests completing and new ones being added while 100k stay outstanding, each thread on its own requests
+		for (uint32_t ThreadCount : { 1u, 8u })
+		{
+			auto Churn = [&](uint32_t ThreadIndex)
+			{
+				std::minstd_rand Random(ThreadIndex + 1);
+				const uint32_t SliceSize = OutstandingCount / ThreadCount;
+				for (uint32_t Round = 0; Round < ChurnCount / ThreadCount; ++Round)
+				{
+					const uint32_t Index = ThreadIndex * SliceSize + Random() % SliceSize;
+					Registry.Remove(Requests[Index].get());
+					Registry.Add(Requests[Index], Index % 64 == 0);
+				}
+			};
+			PrintMicroResult("registry_100k_churn_t" + std::to_string(ThreadCount), ChurnCount / ThreadCount * ThreadCount, MeasureSeconds([&]()
+			{
+				std::vector<std::thread> Threads;
+				for (uint32_t ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+				{
+					Threads.emplace_back(Churn, ThreadIndex);
+				}
+				Churn(0);
+				for (std::thread& Thread : Threads)
+				{
+					Thread.join();
+				}
+			}));
+		}
+		bSucceeded &= Registry.Num() == OutstandingCount;
+
+		std::shuffle(Requests.begin(), Requests.end(), std::minstd_rand(1));
+		PrintMicroResult("registry_100k_remove", OutstandingCount, MeasureSeconds([&]()
+		{
+			for (const FHttpRequestPtr& Request : Requests)
+			{
+				bSucceeded &= Registry.Remove(Request.get()) != nullptr;
+			}
+		}));
+		return bSucceeded && Registry.Num() == 0;
+	}
+
+	/**
+	 * FUrlView::Parse against the std::regex parser it replaced, which built its regex on every call and copied every
+	 * component into a std::string. The regex is also measured prebuilt, to tell its construction from its matching.
+	 */
+	bool RunUrlParseBenchmark(double Scale)
+	{
+		static const std::string Urls[] = {
+			"https://api.example.com/v1/users/12345/profile?fields=name,email&locale=en-US",
+			"http://127.0.0.1:8080/bytes/64",
+			"https://cdn.example.com:8443/assets/textures/atlas_03.png?v=9f86d081#mip0",
+			"http://loopback/health",
+		};
+		constexpr size_t UrlCount = std::size(Urls);
+		// the pattern of the removed parser, with the '/' escapes libstdc++ rejects dropped
+		constexpr const char* Pattern = R"(^(([^:/?#]+)://)?(([^:/?#]*)(:([0-9]+))?)?([^:?#]*)(\?([^#]*))?(#(.*))?)";
+
+		struct FParsedUrl
+		{
+			std::string Scheme, Host, Port, Path, Query, Fragment;
+		};
+		auto RegexParse = [](const std::string& Url, const std::regex& UrlRegex, FParsedUrl& OutUrl)
+		{
+			std::smatch Match;
+			if (!std::regex_match(Url, Match, UrlRegex))
+			{
+				return false;
+			}
+			OutUrl.Scheme = Match[2];
+			OutUrl.Host = Match[4];
+			OutUrl.Port = Match[6];
+			OutUrl.Path = Match[7];
+			OutUrl.Query = Match[9];
+			OutUrl.Fragment = Match[11];
+			return true;
+		};
+
+		bool bSucceeded = true;
+		FParsedUrl Parsed;
+		const uint32_t RegexCount = std::max<uint32_t>(uint32_t(20000 * Scale), 1);
+		PrintMicroResult("url_parse_regex", RegexCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Index = 0; Index < RegexCount; ++Index)
+			{
+				bSucceeded &= RegexParse(Urls[Index % UrlCount], std::regex(Pattern, std::regex::extended), Parsed);
+			}
+		}));
+
+		const std::regex UrlRegex(Pattern, std::regex::extended);
+		const uint32_t CachedRegexCount = std::max<uint32_t>(uint32_t(200000 * Scale), 1);
+		PrintMicroResult("url_parse_regex_prebuilt", CachedRegexCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Index = 0; Index < CachedRegexCount; ++Index)
+			{
+				bSucceeded &= RegexParse(Urls[Index % UrlCount], UrlRegex, Parsed);
+			}
+		}));
+
+		FUrlView View;
+		const uint32_t ViewCount = std::max<uint32_t>(uint32_t(10000000 * Scale), 1);
+		PrintMicroResult("url_parse_view", ViewCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Index = 0; Index < ViewCount; ++Index)
+			{
+				bSucceeded &= FUrlView::Parse(Urls[Index % UrlCount], View);
+			}
+		}));
+
+		std::string_view Value;
+		PrintMicroResult("url_query_parameter", ViewCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Index = 0; Index < ViewCount; ++Index)
+			{
+				bSucceeded &= FindUrlQueryParameter("fields=name,email&locale=en-US&page=3", "page", Value);
+			}
+		}));
+		bSucceeded &= Value == "3";
+
+		// both parsers must agree for the comparison to hold
+		for (const std::string& Url : Urls)
+		{
+			bSucceeded &= RegexParse(Url, UrlRegex, Parsed) && FUrlView::Parse(Url, View);
+			bSucceeded &= Parsed.Scheme == View.Scheme && Parsed.Host == View.Host && Parsed.Path == View.Path && Parsed.Query == View.Query
+				&& Parsed.Fragment == View.Fragment && (Parsed.Port.empty() ? 0 : std::stoi(Parsed.Port)) == View.Port;
+		}
+		return bSucceeded;
+	}
+
+	/**
+	 * Gzip throughput of the zlib the module links, on a 1 MiB JSON body. zlibVersion tells a zlib build from a
+	 * ONLINEPP_WITH_ZLIB_NG one, run the benchmark from both to compare them.
+	 */
+	bool RunGzipBenchmark(double Scale)
+	{
+		std::string Json = "[";
+		for (uint32_t Index = 0; Json.size() < 1024 * 1024; ++Index)
+		{
+			Json += "{\"id\":" + std::to_string(Index) + ",\"name\":\"item_" + std::to_string(Index * 2654435761u % 100000)
+				+ "\",\"price\":" + std::to_string(Index % 977) + "." + std::to_string(Index % 100) + ",\"tags\":[\"common\",\"tradable\"]},";
+		}
+		Json.back() = ']';
+		const std::span<const uint8_t> Body(reinterpret_cast<const uint8_t*>(Json.data()), Json.size());
+		const uint32_t RoundCount = std::max<uint32_t>(uint32_t(50 * Scale), 1);
+
+		bool bSucceeded = true;
+		std::vector<uint8_t> Encoded;
+		for (int32_t Level : { 1, -1 })
+		{
+			PrintMicroResult(Level == 1 ? "gzip_compress_1MiB_fast" : "gzip_compress_1MiB", RoundCount, MeasureSeconds([&]()
+			{
+				for (uint32_t Round = 0; Round < RoundCount; ++Round)
+				{
+					bSucceeded &= HttpGzipCompress(Body, Encoded, Level);
+				}
+			}), uint64_t(Body.size()) * RoundCount, zlibVersion());
+		}
+
+		// fed the way a response arrives from the network
+		constexpr size_t ChunkSize = 16 * 1024;
+		FHttpContentDecoder Decoder;
+		std::vector<uint8_t> Decoded;
+		Decoded.reserve(Body.size());
+		PrintMicroResult("gzip_decode_1MiB", RoundCount, MeasureSeconds([&]()
+		{
+			for (uint32_t Round = 0; Round < RoundCount; ++Round)
+			{
+				Decoded.clear();
+				bSucceeded &= Decoder.Begin(EHttpContentEncoding::Gzip);
+				for (size_t Offset = 0; Offset < Encoded.size(); Offset += ChunkSize)
+				{
+					bSucceeded &= Decoder.Decode(std::span<const uint8_t>(Encoded).subspan(Offset, std::min(ChunkSize, Encoded.size() - Offset)), [&](std::span<const uint8_t> Output)
+					{
+						Decoded.insert(Decoded.end(), Output.begin(), Output.end());
+					});
+				}
+				bSucceeded &= Decoder.Finish();
+				Decoder.Reset();
+			}
+		}), uint64_t(Body.size()) * RoundCount, zlibVersion());
+		return bSucceeded && std::equal(Decoded.begin(), Decoded.end(), Body.begin(), Body.end());
+	}
+
+	const FMicroBenchmark MicroBenchmarks[] = {
+		{ "submit_queue", RunSubmitQueueBenchmark },
+		{ "registry_100k", RunRegistryBenchmark },
+		{ "url_parse", RunUrlParseBenchmark },
+		{ "gzip", RunGzipBenchmark },
+	};
+
+	bool ParseOptions(int Argc, char** Argv, FBenchmarkOptions& Options)
+	{
+		for (int Index = 1; Index < Argc; ++Index)
+		{
+			const bool bHasValue = Index + 1 < Argc;
+			if (std::strcmp(Argv[Index], "--transport") == 0 && bHasValue)
+			{
+				if (!EHttpTransport::FromString(Argv[++Index], Options.Transport) || !EHttpTransport::IsAvailable(Options.Transport))
+				{
+					std::fprintf(stderr, "transport %s is unknown or was not compiled in\n", Argv[Index]);
+					return false;
+				}
+			}
+			else if (std::strcmp(Argv[Index], "--filter") == 0 && bHasValue)
+			{
+				Options.Filter = Argv[++Index];
+			}
+			else if (std::strcmp(Argv[Index], "--scale") == 0 && bHasValue)
+			{
+				Options.Scale = std::atof(Argv[++Index]);
+			}
+			else if (std::strcmp(Argv[Index], "--threads") == 0 && bHasValue)
+			{
+				Options.HttpThreadCount = uint32_t(std::atoi(Argv[++Index]));
+			}
+			else if (std::strcmp(Argv[Index], "--max-connections") == 0 && bHasValue)
+			{
+				Options.MaxConnectionsPerHost = uint32_t(std::atoi(Argv[++Index]));
+			}
+			else if (std::strcmp(Argv[Index], "--trace") == 0 && bHasValue)
+			{
+				Options.TracePath = Argv[++Index];
+			}
+			else
+			{
+				std::fprintf(stderr, "usage: %s [--transport curl|uv|loopback] [--filter <substring>] [--scale <factor>] [--threads <count>] [--max-connections <count>] [--trace <file>]\n", Argv[0]);
+				return false;
+			}
+		}
+		return Options.Scale > 0.0;
+	}
+
+	/**
+	 * Answers /bytes/<N> like FHttpLoopbackServer, with bodies shared by every reply of the same size
+	 */
+	FLoopbackHttpReply RespondBytes(FLoopbackHttpRequest& Request)
+	{
+		static const FHttpSharedBuffer Bodies[] = {
+			std::make_shared<const std::vector<uint8_t>>(64, uint8_t('x')),
+			std::make_shared<const std::vector<uint8_t>>(1024 * 1024, uint8_t('x')),
+		};
+		FLoopbackHttpReply Reply;
+		const std::string Url = Request.GetURL();
+		const size_t Slash = Url.rfind('/');
+		const size_t Size = Slash == std::string::npos ? 0 : size_t(std::strtoull(Url.c_str() + Slash + 1, nullptr, 10));
+		for (const FHttpSharedBuffer& Body : Bodies)
+		{
+			if (Body->size() == Size)
+			{
+				Reply.Content = Body;
+			}
+		}
+		Reply.ContentLength = Size;
+		return Reply;
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	FBenchmarkOptions Options;
+	if (!ParseOptions(Argc, Argv, Options))
+	{
+		return 2;
+	}
+
+	const bool bLoopbackTransport = Options.Transport == EHttpTransport::Loopback;
+	FHttpLoopbackServer Server;
+	if (!bLoopbackTransport && !Server.Start())
+	{
+		std::fprintf(stderr, "could not start the loopback server\n");
+		return 1;
+	}
+	const std::string BaseUrl = bLoopbackTransport ? std::string("http://loopback") : Server.GetUrl("");
+
+	int ExitCode = 0;
+	for (const FMicroBenchmark& Benchmark : MicroBenchmarks)
+	{
+		if (!Options.Filter.empty() && std::string_view(Benchmark.Name).find(Options.Filter) == std::string_view::npos)
+		{
+			continue;
+		}
+		std::fprintf(stderr, "running %s\n", Benchmark.Name);
+		if (!Benchmark.Run(Options.Scale))
+		{
+			std::fprintf(stderr, "%s failed\n", Benchmark.Name);
+			ExitCode = 1;
+		}
+	}
+	{
+		std::unique_ptr<FHttpManager> ManagerPtr = CreateHttpManager(Options.Transport);
+		if (bLoopbackTransport)
+		{
+			static_cast<FLoopbackHttpManager&>(*ManagerPtr).SetResponder(RespondBytes);
+		}
+		FHttpManager& Manager = *ManagerPtr;
+		if (Options.HttpThreadCount)
+		{
+			Manager.SetHttpThreadCount(Options.HttpThreadCount);
+		}
+		FHttpConnectionSettings ConnectionSettings;
+		// thousands of requests in flight share a bounded pool of connections rather than exhausting the sockets
+		ConnectionSettings.MaxConnectionsPerHost = Options.MaxConnectionsPerHost;
+		Manager.SetConnectionSettings(ConnectionSettings);
+		// complete on the http threads, there is no game loop ticking the manager here
+		Manager.SetCompletionDispatch(EHttpCompletionDispatch::HttpThread);
+		Manager.Initialize();
+		if (!Options.TracePath.empty())
+		{
+			FHttpTrace::Start();
+		}
+
+		for (const FBenchmarkScenario& Scenario : MakeScenarios(Options.Scale))
+		{
+			if (!Options.Filter.empty() && Scenario.Name.find(Options.Filter) == std::string::npos)
+			{
+				continue;
+			}
+			std::fprintf(stderr, "running %s\n", Scenario.Name.c_str());
+			const FBenchmarkResult Result = RunScenario(Manager, BaseUrl, Scenario);
+			PrintResult(Options.Transport, Scenario, Result);
+			if (Result.Failed != 0)
+			{
+				ExitCode = 1;
+			}
+		}
+		Manager.Flush(true);
+		if (!Options.TracePath.empty())
+		{
+			FHttpTrace::Stop();
+			if (!FHttpTrace::WriteChromeTrace(Options.TracePath))
+			{
+				std::fprintf(stderr, "could not write the trace to %s\n", Options.TracePath.c_str());
+				ExitCode = 1;
+			}
+		}
+	}
+	Server.Stop();
+	return ExitCode;
+}
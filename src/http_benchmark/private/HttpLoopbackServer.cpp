@@ -0,0 +1,426 @@
+#include "HttpLoopbackServer.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+namespace
+{
+	/** Longest request head accepted before answering 431 */
+	constexpr size_t MaxRequestHeadSize = 64 * 1024;
+	/** Largest body /bytes/<N> serves */
+	constexpr size_t MaxResponseBodySize = 256 * 1024 * 1024;
+
+	bool EqualsIgnoreCase(std::string_view A, std::string_view B)
+	{
+		return A.size() == B.size() && std::equal(A.begin(), A.end(), B.begin(), [](char CharA, char CharB)
+		{
+			return std::tolower(uint8_t(CharA)) == std::tolower(uint8_t(CharB));
+		});
+	}
+
+	bool ContainsIgnoreCase(std::string_view Value, std::string_view Token)
+	{
+		return std::search(Value.begin(), Value.end(), Token.begin(), Token.end(), [](char CharA, char CharB)
+		{
+			return std::tolower(uint8_t(CharA)) == std::tolower(uint8_t(CharB));
+		}) != Value.end();
+	}
+
+	std::string_view Trim(std::string_view Value)
+	{
+		while (!Value.empty() && (Value.front() == ' ' || Value.front() == '\t'))
+		{
+			Value.remove_prefix(1);
+		}
+		while (!Value.empty() && (Value.back() == ' ' || Value.back() == '\t'))
+		{
+			Value.remove_suffix(1);
+		}
+		return Value;
+	}
+
+	const char* GetReasonPhrase(int32_t StatusCode)
+	{
+		switch (StatusCode)
+		{
+			case 200:
+			{
+				return "OK";
+			}
+			case 400:
+			{
+				return "Bad Request";
+			}
+			case 404:
+			{
+				return "Not Found";
+			}
+			case 431:
+			{
+				return "Request Header Fields Too Large";
+			}
+			case 501:
+			{
+				return "Not Implemented";
+			}
+		}
+		return "Unknown";
+	}
+}
+
+struct FHttpLoopbackServer::FConnection
+{
+	uv_tcp_t Tcp;
+	FHttpLoopbackServer* Server = nullptr;
+	/** Received bytes not parsed yet */
+	std::string Input;
+	/** Bytes of the current request body still to be dropped */
+	size_t BodyRemaining = 0;
+	bool bInBody = false;
+	/** Response to the current request, sent once its body is read */
+	int32_t PendingStatusCode = 0;
+	size_t PendingBodySize = 0;
+	bool bPendingClose = false;
+	/** A response asked to close the connection, ignore anything after it */
+	bool bClosing = false;
+	char ReadBuffer[64 * 1024];
+};
+
+struct FHttpLoopbackServer::FWriteRequest
+{
+	uv_write_t Request;
+	FConnection* Connection = nullptr;
+	std::string Head;
+	std::shared_ptr<const std::string> Body;
+	bool bClose = false;
+};
+
+FHttpLoopbackServer::FHttpLoopbackServer()
+	: Loop()
+	, Listener()
+	, StopSignal()
+	, Port(0)
+	, bRunning(false)
+{
+}
+
+FHttpLoopbackServer::~FHttpLoopbackServer()
+{
+	Stop();
+}
+
+bool FHttpLoopbackServer::Start()
+{
+	if (bRunning)
+	{
+		return true;
+	}
+	if (uv_loop_init(&Loop) != 0)
+	{
+		return false;
+	}
+	uv_tcp_init(&Loop, &Listener);
+	Listener.data = this;
+	uv_async_init(&Loop, &StopSignal, &FHttpLoopbackServer::OnStop);
+	StopSignal.data = this;
+
+	sockaddr_in Address;
+	uv_ip4_addr("127.0.0.1", 0, &Address);
+	sockaddr_storage BoundAddress;
+	int BoundAddressSize = sizeof(BoundAddress);
+	if (uv_tcp_bind(&Listener, reinterpret_cast<const sockaddr*>(&Address), 0) != 0 ||
+		uv_listen(reinterpret_cast<uv_stream_t*>(&Listener), 4096, &FHttpLoopbackServer::OnConnection) != 0 ||
+		uv_tcp_getsockname(&Listener, reinterpret_cast<sockaddr*>(&BoundAddress), &BoundAddressSize) != 0)
+	{
+		uv_close(reinterpret_cast<uv_handle_t*>(&Listener), nullptr);
+		uv_close(reinterpret_cast<uv_handle_t*>(&StopSignal), nullptr);
+		uv_run(&Loop, UV_RUN_DEFAULT);
+		uv_loop_close(&Loop);
+		return false;
+	}
+	Port = ntohs(reinterpret_cast<const sockaddr_in*>(&BoundAddress)->sin_port);
+
+	bRunning = true;
+	Thread = std::thread([this]()
+	{
+		uv_run(&Loop, UV_RUN_DEFAULT);
+	});
+	return true;
+}
+
+void FHttpLoopbackServer::Stop()
+{
+	if (!bRunning)
+	{
+		return;
+	}
+	uv_async_send(&StopSignal);
+	Thread.join();
+	uv_loop_close(&Loop);
+	bRunning = false;
+}
+
+std::string FHttpLoopbackServer::GetUrl(std::string_view Path) const
+{
+	std::string Url = "http://127.0.0.1:" + std::to_string(Port);
+	Url.append(Path);
+	return Url;
+}
+
+void FHttpLoopbackServer::OnStop(uv_async_t* Handle)
+{
+	FHttpLoopbackServer* Server = static_cast<FHttpLoopbackServer*>(Handle->data);
+	uv_walk(&Server->Loop, [](uv_handle_t* WalkedHandle, void* Arg)
+	{
+		if (uv_is_closing(WalkedHandle))
+		{
+			return;
+		}
+		if (WalkedHandle->data == Arg)
+		{
+			// the listener and the stop signal are members
+			uv_close(WalkedHandle, nullptr);
+		}
+		else
+		{
+			CloseConnection(*static_cast<FConnection*>(WalkedHandle->data));
+		}
+	}, Server);
+}
+
+void FHttpLoopbackServer::OnConnection(uv_stream_t* ListenStream, int Status)
+{
+	if (Status < 0)
+	{
+		return;
+	}
+	FHttpLoopbackServer* Server = static_cast<FHttpLoopbackServer*>(ListenStream->data);
+	FConnection* Connection = new FConnection();
+	Connection->Server = Server;
+	uv_tcp_init(&Server->Loop, &Connection->Tcp);
+	Connection->Tcp.data = Connection;
+	if (uv_accept(ListenStream, reinterpret_cast<uv_stream_t*>(&Connection->Tcp)) != 0)
+	{
+		CloseConnection(*Connection);
+		return;
+	}
+	uv_tcp_nodelay(&Connection->Tcp, 1);
+	uv_read_start(reinterpret_cast<uv_stream_t*>(&Connection->Tcp), &FHttpLoopbackServer::OnAlloc, &FHttpLoopbackServer::OnRead);
+}
+
+void FHttpLoopbackServer::OnAlloc(uv_handle_t* Handle, size_t SuggestedSize, uv_buf_t* Buffer)
+{
+	FConnection* Connection = static_cast<FConnection*>(Handle->data);
+	*Buffer = uv_buf_init(Connection->ReadBuffer, sizeof(Connection->ReadBuffer));
+}
+
+void FHttpLoopbackServer::OnRead(uv_stream_t* Stream, ssize_t ReadSize, const uv_buf_t* Buffer)
+{
+	FConnection* Connection = static_cast<FConnection*>(Stream->data);
+	if (ReadSize < 0)
+	{
+		CloseConnection(*Connection);
+		return;
+	}
+	if (ReadSize == 0 || Connection->bClosing)
+	{
+		return;
+	}
+	Connection->Input.append(Buffer->base, size_t(ReadSize));
+	Connection->Server->ProcessInput(*Connection);
+}
+
+void FHttpLoopbackServer::OnWrite(uv_write_t* Request, int Status)
+{
+	std::unique_ptr<FWriteRequest> Write(static_cast<FWriteRequest*>(Request->data));
+	if (Status < 0 || Write->bClose)
+	{
+		CloseConnection(*Write->Connection);
+	}
+}
+
+void FHttpLoopbackServer::CloseConnection(FConnection& Connection)
+{
+	uv_handle_t* Handle = reinterpret_cast<uv_handle_t*>(&Connection.Tcp);
+	Connection.bClosing = true;
+	if (!uv_is_closing(Handle))
+	{
+		uv_close(Handle, [](uv_handle_t* ClosedHandle)
+		{
+			delete static_cast<FConnection*>(ClosedHandle->data);
+		});
+	}
+}
+
+bool FHttpLoopbackServer::ProcessInput(FConnection& Connection)
+{
+	size_t Offset = 0;
+	while (!Connection.bClosing)
+	{
+		if (Connection.bInBody)
+		{
+			const size_t Consumed = std::min(Connection.BodyRemaining, Connection.Input.size() - Offset);
+			Offset += Consumed;
+			Connection.BodyRemaining -= Consumed;
+			if (Connection.BodyRemaining != 0)
+			{
+				break;
+			}
+			Connection.bInBody = false;
+			SendResponse(Connection, Connection.PendingStatusCode, Connection.PendingBodySize, Connection.bPendingClose);
+			continue;
+		}
+
+		const size_t HeadEnd = Connection.Input.find("\r\n\r\n", Offset);
+		if (HeadEnd == std::string::npos)
+		{
+			if (Connection.Input.size() - Offset > MaxRequestHeadSize)
+			{
+				SendResponse(Connection, 431, 0, true);
+			}
+			break;
+		}
+		std::string_view Head(Connection.Input.data() + Offset, HeadEnd - Offset);
+		Offset = HeadEnd + 4;
+
+		// request line
+		const size_t RequestLineEnd = std::min(Head.find("\r\n"), Head.size());
+		const std::string_view RequestLine = Head.substr(0, RequestLineEnd);
+		const size_t TargetBegin = RequestLine.find(' ');
+		const size_t TargetEnd = TargetBegin == std::string_view::npos ? std::string_view::npos : RequestLine.find(' ', TargetBegin + 1);
+		if (TargetEnd == std::string_view::npos)
+		{
+			SendResponse(Connection, 400, 0, true);
+			break;
+		}
+		const std::string_view Target = RequestLine.substr(TargetBegin + 1, TargetEnd - TargetBegin - 1);
+		const std::string_view Version = RequestLine.substr(TargetEnd + 1);
+
+		// headers
+		size_t ContentLength = 0;
+		bool bChunked = false;
+		bool bExpectContinue = false;
+		bool bClose = Version == "HTTP/1.0";
+		std::string_view Lines = Head.substr(RequestLineEnd);
+		while (!Lines.empty())
+		{
+			if (Lines.starts_with("\r\n"))
+			{
+				Lines.remove_prefix(2);
+			}
+			const size_t LineEnd = std::min(Lines.find("\r\n"), Lines.size());
+			const std::string_view Line = Lines.substr(0, LineEnd);
+			Lines.remove_prefix(LineEnd);
+			const size_t Colon = Line.find(':');
+			if (Colon == std::string_view::npos)
+			{
+				continue;
+			}
+			const std::string_view Name = Trim(Line.substr(0, Colon));
+			const std::string_view Value = Trim(Line.substr(Colon + 1));
+			if (EqualsIgnoreCase(Name, "Content-Length"))
+			{
+				std::from_chars(Value.data(), Value.data() + Value.size(), ContentLength);
+			}
+			else if (EqualsIgnoreCase(Name, "Transfer-Encoding"))
+			{
+				bChunked = ContainsIgnoreCase(Value, "chunked");
+			}
+			else if (EqualsIgnoreCase(Name, "Expect"))
+			{
+				bExpectContinue = ContainsIgnoreCase(Value, "100-continue");
+			}
+			else if (EqualsIgnoreCase(Name, "Connection"))
+			{
+				bClose = ContainsIgnoreCase(Value, "close") || (bClose && !ContainsIgnoreCase(Value, "keep-alive"));
+			}
+		}
+		if (bChunked)
+		{
+			// the benchmark always sends sized bodies
+			SendResponse(Connection, 501, 0, true);
+			break;
+		}
+
+		int32_t StatusCode = 404;
+		size_t BodySize = 0;
+		if (Target.starts_with("/bytes/"))
+		{
+			const std::string_view SizeString = Target.substr(7);
+			if (std::from_chars(SizeString.data(), SizeString.data() + SizeString.size(), BodySize).ec == std::errc() && BodySize <= MaxResponseBodySize)
+			{
+				StatusCode = 200;
+			}
+			else
+			{
+				BodySize = 0;
+				StatusCode = 400;
+			}
+		}
+
+		if (bExpectContinue && ContentLength != 0)
+		{
+			SendRaw(Connection, "HTTP/1.1 100 Continue\r\n\r\n");
+		}
+		Connection.bInBody = true;
+		Connection.BodyRemaining = ContentLength;
+		Connection.PendingStatusCode = StatusCode;
+		Connection.PendingBodySize = BodySize;
+		Connection.bPendingClose = bClose;
+	}
+	Connection.Input.erase(0, std::min(Offset, Connection.Input.size()));
+	return !Connection.bClosing;
+}
+
+void FHttpLoopbackServer::SendResponse(FConnection& Connection, int32_t StatusCode, size_t BodySize, bool bClose)
+{
+	FWriteRequest* Write = new FWriteRequest();
+	Write->Request.data = Write;
+	Write->Connection = &Connection;
+	Write->bClose = bClose;
+	Write->Body = BodySize ? GetBody(BodySize) : nullptr;
+	Write->Head = "HTTP/1.1 " + std::to_string(StatusCode) + " " + GetReasonPhrase(StatusCode) + "\r\nContent-Type: application/octet-stream\r\nContent-Length: " + std::to_string(BodySize) + "\r\n";
+	Write->Head += bClose ? "Connection: close\r\n\r\n" : "\r\n";
+
+	uv_buf_t Buffers[2];
+	unsigned int BufferCount = 0;
+	Buffers[BufferCount++] = uv_buf_init(Write->Head.data(), static_cast<unsigned int>(Write->Head.size()));
+	if (Write->Body)
+	{
+		Buffers[BufferCount++] = uv_buf_init(const_cast<char*>(Write->Body->data()), static_cast<unsigned int>(Write->Body->size()));
+	}
+	if (bClose)
+	{
+		Connection.bClosing = true;
+	}
+	++ServedRequestCount;
+	if (uv_write(&Write->Request, reinterpret_cast<uv_stream_t*>(&Connection.Tcp), Buffers, BufferCount, &FHttpLoopbackServer::OnWrite) != 0)
+	{
+		delete Write;
+		CloseConnection(Connection);
+	}
+}
+
+void FHttpLoopbackServer::SendRaw(FConnection& Connection, std::string Data)
+{
+	FWriteRequest* Write = new FWriteRequest();
+	Write->Request.data = Write;
+	Write->Connection = &Connection;
+	Write->Head = std::move(Data);
+	uv_buf_t Buffer = uv_buf_init(Write->Head.data(), static_cast<unsigned int>(Write->Head.size()));
+	if (uv_write(&Write->Request, reinterpret_cast<uv_stream_t*>(&Connection.Tcp), &Buffer, 1, &FHttpLoopbackServer::OnWrite) != 0)
+	{
+		delete Write;
+		CloseConnection(Connection);
+	}
+}
+
+std::shared_ptr<const std::string> FHttpLoopbackServer::GetBody(size_t Size)
+{
+	std::shared_ptr<const std::string>& Body = Bodies[Size];
+	if (!Body)
+	{
+		Body = std::make_shared<const std::string>(Size, 'x');
+	}
+	return Body;
+}
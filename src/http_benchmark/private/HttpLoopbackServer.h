@@ -0,0 +1,90 @@
+#pragma once
+#include <uv.h>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/**
+ * Minimal HTTP/1.1 server on 127.0.0.1 running its own libuv loop thread, to benchmark the client without a network.
+ * GET or POST /bytes/<N> answers with N bytes, any request body is read and dropped. Connections are kept alive
+ * unless the request asks for Connection: close.
+ */
+class FHttpLoopbackServer
+{
+public:
+
+	FHttpLoopbackServer();
+
+	/**
+	 * Stops the server if it is running
+	 */
+	~FHttpLoopbackServer();
+
+	FHttpLoopbackServer(const FHttpLoopbackServer&) = delete;
+	FHttpLoopbackServer& operator=(const FHttpLoopbackServer&) = delete;
+
+	/**
+	 * Listen on an ephemeral loopback port and start the loop thread
+	 *
+	 * @return false if the port could not be bound
+	 */
+	bool Start();
+
+	/**
+	 * Close every connection and join the loop thread
+	 */
+	void Stop();
+
+	/**
+	 * @return the url of a path on the server, e.g. GetUrl("/bytes/64")
+	 */
+	std::string GetUrl(std::string_view Path) const;
+
+	/** Number of requests answered so far */
+	uint64_t GetServedRequestCount() const
+	{
+		return ServedRequestCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	struct FConnection;
+	struct FWriteRequest;
+
+	static void OnConnection(uv_stream_t* ListenStream, int Status);
+	static void OnAlloc(uv_handle_t* Handle, size_t SuggestedSize, uv_buf_t* Buffer);
+	static void OnRead(uv_stream_t* Stream, ssize_t ReadSize, const uv_buf_t* Buffer);
+	static void OnWrite(uv_write_t* Request, int Status);
+	static void OnStop(uv_async_t* Handle);
+
+	/**
+	 * Parse and answer the complete requests buffered on a connection
+	 *
+	 * @return false once the connection is closing
+	 */
+	bool ProcessInput(FConnection& Connection);
+
+	/** Queue the response to a request, closing the connection after it if asked */
+	void SendResponse(FConnection& Connection, int32_t StatusCode, size_t BodySize, bool bClose);
+
+	/** Send a raw response part, e.g. 100 Continue */
+	void SendRaw(FConnection& Connection, std::string Data);
+
+	static void CloseConnection(FConnection& Connection);
+
+	/** @return a body of that size, shared by every response of the same size */
+	std::shared_ptr<const std::string> GetBody(size_t Size);
+
+	uv_loop_t Loop;
+	uv_tcp_t Listener;
+	uv_async_t StopSignal;
+	std::thread Thread;
+	uint16_t Port;
+	bool bRunning;
+	std::atomic<uint64_t> ServedRequestCount{ 0 };
+	/** Bodies by size, loop thread only */
+	std::map<size_t, std::shared_ptr<const std::string>> Bodies;
+};